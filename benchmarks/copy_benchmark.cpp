@@ -0,0 +1,68 @@
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include "tensor.hpp"
+#include "parallel.hpp"
+using namespace std;
+
+/*
+Throughput of clone() / contiguous() on views, in GB/s of memory traffic (bytes read + bytes written).
+
+The "baseline" column reproduces the previous implementation: the element-wise engine with an identity function, which walks the
+source row by row in the order of the destination, so a transposed source is read with a large stride.
+*/
+
+namespace
+{
+    volatile float sink;
+
+    double best_time(const function<void()> &fn, int repeats = 7)
+    {
+        fn(); // warm up
+        double best = 1e30;
+        for (int r = 0; r < repeats; ++r)
+        {
+            const auto start = chrono::steady_clock::now();
+            fn();
+            const auto end = chrono::steady_clock::now();
+            best = std::min(best, chrono::duration<double>(end - start).count());
+        }
+        return best;
+    }
+
+    void report(const string &name, const Tensor<> &view)
+    {
+        const double bytes = 2.0 * view.size() * sizeof(float);
+
+        const double baseline = best_time([&]
+                                          { sink = view.map([](const float &x)
+                                                            { return x; }).size(); });
+        const double engine = best_time([&]
+                                        { sink = view.clone().size(); });
+
+        printf("%-36s %10.2f GB/s %10.2f GB/s %8.2fx\n", name.c_str(), bytes / baseline / 1e9, bytes / engine / 1e9, baseline / engine);
+    }
+}
+
+int main()
+{
+    printf("threads: %zu\n\n", get_num_threads());
+    printf("%-36s %15s %15s %9s\n", "view", "baseline", "clone", "speedup");
+
+    const Tensor<> square = Tensor<>::empty({4096, 4096}).fill_(1.0f);
+    report("contiguous 4096 x 4096", square);
+    report("transpose 4096 x 4096", square.transpose());
+    report("transpose 1000 x 1000", square.index({":1000", ":1000"}).transpose());
+
+    // Layouts of Conv2d: N x C x H x W
+    const Tensor<> activations = Tensor<>::empty({64, 32, 28, 28}).fill_(1.0f);
+    report("permute(1, 0, 2, 3) 64x32x28x28", activations.permute(1, 0, 2, 3));
+    report("permute(0, 2, 3, 1) 64x32x28x28", activations.permute(0, 2, 3, 1));
+    report("permute(0, 3, 1, 2) 64x28x28x32", Tensor<>::empty({64, 28, 28, 32}).fill_(1.0f).permute(0, 3, 1, 2));
+
+    const Tensor<> batch = Tensor<>::empty({16, 512, 512}).fill_(1.0f);
+    report("transpose(1, 2) 16 x 512 x 512", batch.transpose(1, 2));
+
+    return 0;
+}
@@ -0,0 +1,175 @@
+#include <chrono>
+#include <cstdio>
+#include <cmath>
+#include <functional>
+#include <vector>
+#include "tensor.hpp"
+#include "simd.hpp"
+using namespace std;
+
+/*
+Throughput of the element-wise and reduction kernels, in GB/s of memory traffic (bytes read + bytes written).
+
+Usage: elementwise_benchmark [number of elements]
+
+The "baseline" rows reproduce the previous implementation: a scalar loop with the switch over the operation inside the loop body.
+The "kernel" rows call the vectorized kernels directly, once for every instruction set supported by the CPU.
+The "Tensor" rows measure the public Tensor operations (including the allocation of the result) with the default instruction set.
+*/
+
+namespace
+{
+    volatile float sink;
+
+    // Best time of a few repetitions, in seconds
+    double best_time(const function<void()> &fn, int repeats = 7)
+    {
+        fn(); // warm up
+        double best = 1e30;
+        for (int r = 0; r < repeats; ++r)
+        {
+            const auto start = chrono::steady_clock::now();
+            fn();
+            const auto end = chrono::steady_clock::now();
+            best = std::min(best, chrono::duration<double>(end - start).count());
+        }
+        return best;
+    }
+
+    void report(const char *name, const string &variant, size_t bytes, double seconds)
+    {
+        printf("%-8s %-10s %8.2f GB/s\n", name, variant.c_str(), bytes / seconds / 1e9);
+    }
+
+    // The previous element-wise loop: the operation is dispatched for every element
+    void baseline_binary(ArithmeticOp op, const float *a, const float *b, float *out, size_t n)
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            switch (op)
+            {
+            case ArithmeticOp::ADD:
+                out[i] = a[i] + b[i];
+                break;
+            case ArithmeticOp::SUB:
+                out[i] = a[i] - b[i];
+                break;
+            case ArithmeticOp::MUL:
+                out[i] = a[i] * b[i];
+                break;
+            case ArithmeticOp::DIV:
+                out[i] = a[i] / b[i];
+                break;
+            }
+        }
+    }
+
+    void baseline_sqrt(const float *a, float *out, size_t n)
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            out[i] = std::sqrt(a[i]);
+        }
+    }
+
+    float baseline_sum(const float *a, size_t n)
+    {
+        float sum = 0.0f;
+        for (size_t i = 0; i < n; ++i)
+        {
+            sum += a[i];
+        }
+        return sum;
+    }
+
+    float baseline_max(const float *a, size_t n)
+    {
+        float result = a[0];
+        for (size_t i = 1; i < n; ++i)
+        {
+            if (a[i] > result)
+            {
+                result = a[i];
+            }
+        }
+        return result;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const size_t n = (argc > 1) ? stoul(argv[1]) : (size_t(1) << 24);
+    const size_t bytes = n * sizeof(float);
+
+    printf("%zu elements (%.1f MB per array), default instruction set: %s\n\n", n, bytes / 1e6, simd::isa_name(simd::active_isa()).c_str());
+
+    vector<float> a(n), b(n), out(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        a[i] = static_cast<float>(i % 1000) * 0.001f + 1.0f;
+        b[i] = static_cast<float>(i % 777) * 0.002f + 1.0f;
+    }
+
+    const ArithmeticOp ops[] = {ArithmeticOp::ADD, ArithmeticOp::MUL, ArithmeticOp::DIV};
+    const char *op_names[] = {"add", "mul", "div"};
+
+    for (size_t k = 0; k < 3; ++k)
+    {
+        report(op_names[k], "baseline", 3 * bytes, best_time([&]
+                                                            { baseline_binary(ops[k], a.data(), b.data(), out.data(), n); }));
+    }
+    report("sqrt", "baseline", 2 * bytes, best_time([&]
+                                                     { baseline_sqrt(a.data(), out.data(), n); }));
+    report("sum", "baseline", bytes, best_time([&]
+                                                { sink = baseline_sum(a.data(), n); }));
+    report("max", "baseline", bytes, best_time([&]
+                                                { sink = baseline_max(a.data(), n); }));
+    printf("\n");
+
+    const simd::ISA default_isa = simd::active_isa();
+
+    for (const simd::ISA isa : {simd::ISA::SCALAR, simd::ISA::SSE42, simd::ISA::AVX2, simd::ISA::AVX512})
+    {
+        if (!simd::is_supported(isa))
+        {
+            continue;
+        }
+        simd::set_isa(isa);
+        const string name = simd::isa_name(isa);
+
+        for (size_t k = 0; k < 3; ++k)
+        {
+            report(op_names[k], name, 3 * bytes, best_time([&]
+                                                           { simd::binary(ops[k], a.data(), b.data(), out.data(), n); }));
+        }
+        report("sqrt", name, 2 * bytes, best_time([&]
+                                                   { simd::sqrt(a.data(), out.data(), n); }));
+        report("sum", name, bytes, best_time([&]
+                                              { sink = simd::sum(a.data(), n); }));
+        report("max", name, bytes, best_time([&]
+                                              { sink = simd::max(a.data(), n); }));
+        printf("\n");
+    }
+
+    simd::set_isa(default_isa);
+
+    const Tensor<> ta(vector<size_t>{n}, 1.5f);
+    const Tensor<> tb(vector<size_t>{n}, 2.5f);
+    const Tensor<> matrix(vector<size_t>{n / 1024, 1024}, 1.5f);
+    const Tensor<> row(vector<size_t>{1, 1024}, 2.5f);
+
+    report("add", "Tensor", 3 * bytes, best_time([&]
+                                                  { sink = (ta + tb)[0]; }));
+    report("add_bc", "Tensor", 2 * bytes, best_time([&]
+                                                     { sink = (matrix + row)[0, 0]; }));
+    report("scale", "Tensor", 2 * bytes, best_time([&]
+                                                    { sink = (ta * 3.0f)[0]; }));
+    report("sqrt", "Tensor", 2 * bytes, best_time([&]
+                                                   { sink = ta.sqrt()[0]; }));
+    report("sum", "Tensor", bytes, best_time([&]
+                                              { sink = ta.sum(); }));
+    report("max", "Tensor", bytes, best_time([&]
+                                              { sink = matrix.max()[0]; }));
+
+    return 0;
+}
@@ -0,0 +1,140 @@
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <vector>
+#include "tensor.hpp"
+#include "gemm.hpp"
+#include "parallel.hpp"
+using namespace std;
+
+/*
+Throughput of Tensor::matmul, in GFLOP/s (2 * M * N * K floating point operations per multiplication).
+
+The "baseline" column reproduces the previous implementation: an i-j-k triple loop that recomputes the strided offsets
+for every multiply-add and reads B column by column. It is skipped for the largest sizes.
+*/
+
+namespace
+{
+    volatile float sink;
+
+    double best_time(const function<void()> &fn, int repeats = 5)
+    {
+        fn(); // warm up
+        double best = 1e30;
+        for (int r = 0; r < repeats; ++r)
+        {
+            const auto start = chrono::steady_clock::now();
+            fn();
+            const auto end = chrono::steady_clock::now();
+            best = std::min(best, chrono::duration<double>(end - start).count());
+        }
+        return best;
+    }
+
+    void baseline_matmul(const vector<float> &A, const vector<float> &B, vector<float> &C, size_t M, size_t N, size_t K)
+    {
+        const size_t A_strides[2] = {K, 1}, B_strides[2] = {N, 1}, C_strides[2] = {N, 1};
+
+        for (size_t i = 0; i < M; ++i)
+        {
+            for (size_t j = 0; j < N; ++j)
+            {
+                float sum = 0.0f;
+                for (size_t k = 0; k < K; ++k)
+                {
+                    const size_t a_idx = i * A_strides[0] + k * A_strides[1];
+                    const size_t b_idx = k * B_strides[0] + j * B_strides[1];
+                    sum += A[a_idx] * B[b_idx];
+                }
+                C[i * C_strides[0] + j * C_strides[1]] = sum;
+            }
+        }
+    }
+}
+
+int main()
+{
+    printf("micro-kernel: %s, threads: %zu\n\n", gemm::kernel_name().c_str(), get_num_threads());
+    printf("%6s %6s %6s %14s %14s\n", "M", "N", "K", "baseline", "matmul");
+
+    // (batch x in) * (in x out) of the MLP layers, then square matrices
+    const size_t sizes[][3] = {{64, 128, 784}, {64, 10, 128}, {784, 128, 64}, {128, 128, 128}, {256, 256, 256}, {512, 512, 512}, {1024, 1024, 1024}};
+
+    for (const auto &size : sizes)
+    {
+        const size_t M = size[0], N = size[1], K = size[2];
+        const double flops = 2.0 * M * N * K;
+
+        vector<float> A(M * K), B(K * N), C(M * N);
+        for (size_t i = 0; i < A.size(); ++i)
+            A[i] = static_cast<float>(i % 13) * 0.1f;
+        for (size_t i = 0; i < B.size(); ++i)
+            B[i] = static_cast<float>(i % 7) * 0.1f;
+
+        const Tensor<> tA = Tensor<>(A).reshape({M, K});
+        const Tensor<> tB = Tensor<>(B).reshape({K, N});
+
+        double baseline = 0.0;
+        if (M * N * K <= 512 * 512 * 512)
+        {
+            baseline = flops / best_time([&]
+                                         { baseline_matmul(A, B, C, M, N, K); sink = C[0]; }) / 1e9;
+        }
+        const double engine = flops / best_time([&]
+                                                { sink = tA.matmul(tB)[0, 0]; }) / 1e9;
+
+        printf("%6zu %6zu %6zu %9.2f GF/s %9.2f GF/s\n", M, N, K, baseline, engine);
+    }
+
+    // Transposed operands of Linear::backward: X^T * dY (weight gradient) and dY * W^T (input gradient)
+    printf("\n%-28s %14s %14s\n", "transposed", "copy + matmul", "in place");
+    {
+        const size_t batch = 64, in = 784, out = 128;
+        const Tensor<> X({batch, in}, 0.5f), dY({batch, out}, 0.25f), W({in, out}, 0.125f);
+
+        const double flops = 2.0 * batch * in * out;
+
+        const double grad_w_copy = flops / best_time([&]
+                                                     { sink = X.transpose().clone().matmul(dY)[0, 0]; }) / 1e9;
+        const double grad_w = flops / best_time([&]
+                                                { sink = X.transpose().matmul(dY)[0, 0]; }) / 1e9;
+        printf("%-28s %9.2f GF/s %9.2f GF/s\n", "X^T * dY [784x64 * 64x128]", grad_w_copy, grad_w);
+
+        const double grad_x_copy = flops / best_time([&]
+                                                     { sink = dY.matmul(W.transpose().clone())[0, 0]; }) / 1e9;
+        const double grad_x = flops / best_time([&]
+                                                { sink = dY.matmul(W.transpose())[0, 0]; }) / 1e9;
+        printf("%-28s %9.2f GF/s %9.2f GF/s\n", "dY * W^T [64x128 * 128x784]", grad_x_copy, grad_x);
+    }
+
+    // Batched: (batch x M x K) * (batch x K x N) for attention-like shapes, then a batch multiplied by a shared matrix
+    printf("\n%6s %6s %6s %6s %14s %14s\n", "batch", "M", "N", "K", "baseline", "matmul");
+
+    const size_t batched_sizes[][4] = {{1024, 8, 8, 8}, {256, 16, 16, 16}, {96, 64, 64, 64}};
+
+    for (const auto &size : batched_sizes)
+    {
+        const size_t batch = size[0], M = size[1], N = size[2], K = size[3];
+        const double flops = 2.0 * batch * M * N * K;
+
+        vector<float> A(M * K, 0.5f), B(K * N, 0.25f), C(M * N);
+
+        const Tensor<> tA({batch, M, K}, 0.5f);
+        const Tensor<> tB({batch, K, N}, 0.25f);
+
+        const double baseline = flops / best_time([&]
+                                                  {
+            for (size_t b = 0; b < batch; ++b)
+            {
+                baseline_matmul(A, B, C, M, N, K);
+            }
+            sink = C[0]; }) / 1e9;
+        const double engine = flops / best_time([&]
+                                                { sink = tA.matmul(tB)[0, 0, 0]; }) / 1e9;
+
+        printf("%6zu %6zu %6zu %6zu %9.2f GF/s %9.2f GF/s\n", batch, M, N, K, baseline, engine);
+    }
+
+    return 0;
+}
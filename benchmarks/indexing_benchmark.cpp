@@ -0,0 +1,119 @@
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <vector>
+#include "tensor.hpp"
+#include "cross_entropy.hpp"
+using namespace std;
+
+/*
+Indexing primitives against the per-element loops they replace:
+- batch: assembling 256 MNIST-sized samples from vector<vector<float>>, with the nested vector constructor and with stack() of row views
+- labels: picking the 4096 target probabilities of a 4096 x 1000 softmax one operator[] at a time, and with gather()
+- grad: subtracting 1 at the 4096 target positions of the gradient one operator[] at a time, and with scatter_add_()
+- rows: selecting 1024 random rows of a 65536 x 256 table one by one, and with index_select()
+*/
+
+namespace
+{
+    volatile float sink;
+
+    double best_time(const function<void()> &fn, int repeats = 5)
+    {
+        fn(); // warm up
+        double best = 1e30;
+        for (int r = 0; r < repeats; ++r)
+        {
+            const auto start = chrono::steady_clock::now();
+            fn();
+            const auto end = chrono::steady_clock::now();
+            best = std::min(best, chrono::duration<double>(end - start).count());
+        }
+        return best;
+    }
+
+    void report(const char *name, double reference, double time)
+    {
+        printf("%-10s %14.3f ms %14.3f ms %9.1fx\n", name, reference * 1e3, time * 1e3, reference / time);
+    }
+}
+
+int main()
+{
+    printf("%-10s %17s %17s %10s\n", "operation", "per element", "primitive", "speedup");
+
+    rng::Generator gen(42);
+
+    {
+        vector<vector<float>> samples(256, vector<float>(784));
+        for (size_t i = 0; i < samples.size(); ++i)
+        {
+            rng::uniform(gen, samples[i].data(), samples[i].size());
+        }
+
+        report("batch", best_time([&]
+                                  { Tensor<> batch = samples; }),
+               best_time([&]
+                         {
+            vector<Tensor<>> rows;
+            rows.reserve(samples.size());
+            for (vector<float> &row : samples)
+            {
+                rows.push_back(Tensor<>::from_blob(row.data(), {row.size()}, nullptr));
+            }
+            Tensor<> batch = Tensor<>::stack(rows); }));
+    }
+
+    {
+        const size_t B = 4096, M = 1000;
+        const Tensor<> probs = Tensor<>::empty({B, M}).uniform_(0.1f, 1.0f, gen);
+        const Tensor<> labels = Tensor<>::empty({B}).uniform_(0.0f, M - 0.5f, gen).dtype<size_t>().dtype<float>();
+        const Tensor<size_t> index = labels.dtype<size_t>().reshape({B, 1});
+
+        report("labels", best_time([&]
+                                   {
+            float sum = 0.0f;
+            for (size_t i = 0; i < B; ++i)
+            {
+                sum += probs[i, static_cast<int>(labels[i])];
+            }
+            sink = sum; }),
+               best_time([&]
+                         { Tensor<> picked = probs.gather(1, index); }));
+
+        Tensor<> grad = probs.clone();
+        report("grad", best_time([&]
+                                 {
+            for (size_t i = 0; i < B; ++i)
+            {
+                grad[i, static_cast<int>(labels[i])] -= 1.0f;
+            } }),
+               best_time([&]
+                         { grad.scatter_add_(1, index, Tensor<>({B, 1}, -1.0f)); }));
+    }
+
+    {
+        const Tensor<> table = Tensor<>::empty({65536, 256}).uniform_(-1.0f, 1.0f, gen);
+        vector<size_t> ids(1024);
+        const Tensor<> u = Tensor<>::empty({ids.size()}).uniform_(0.0f, 65535.5f, gen);
+        for (size_t i = 0; i < ids.size(); ++i)
+        {
+            ids[i] = static_cast<size_t>(u[i]);
+        }
+
+        report("rows", best_time([&]
+                                 {
+            Tensor<> rows = Tensor<>::empty({ids.size(), 256});
+            for (size_t i = 0; i < ids.size(); ++i)
+            {
+                for (size_t j = 0; j < 256; ++j)
+                {
+                    rows[i, j] = table[ids[i], j];
+                }
+            } }),
+               best_time([&]
+                         { Tensor<> rows = table.index_select(0, ids); }));
+    }
+
+    return 0;
+}
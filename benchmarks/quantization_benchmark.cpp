@@ -0,0 +1,123 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <vector>
+#include "tensor.hpp"
+#include "qtensor.hpp"
+#include "qgemm.hpp"
+#include "gemm.hpp"
+#include "parallel.hpp"
+#include "mlp.hpp"
+#include "quantization.hpp"
+#include "quantized_linear.hpp"
+using namespace std;
+
+/*
+Inference with int8 quantized Linear layers, compared to float.
+
+1. The GEMMs alone: sgemm (float) against gemm_u8s8s32 (uint8 x int8 -> int32 with a prepacked B), in GOP/s.
+2. The forward pass of an MLP before and after post-training quantization (see quantization.hpp), and the size of its weights.
+*/
+
+namespace
+{
+    double best_time(const function<void()> &fn, int repeats = 5)
+    {
+        fn(); // warm up
+        double best = 1e30;
+        for (int r = 0; r < repeats; ++r)
+        {
+            const auto start = chrono::steady_clock::now();
+            fn();
+            const auto end = chrono::steady_clock::now();
+            best = std::min(best, chrono::duration<double>(end - start).count());
+        }
+        return best;
+    }
+
+    size_t weight_bytes(const Sequential &layers)
+    {
+        size_t bytes = 0;
+        for (size_t i = 0; i < layers.size(); ++i)
+        {
+            if (const Linear *linear = dynamic_cast<const Linear *>(layers.get(i)))
+                bytes += linear->get_weight().size() * sizeof(float);
+            else if (const QuantizedLinear *quantized = dynamic_cast<const QuantizedLinear *>(layers.get(i)))
+                bytes += quantized->weight_bytes();
+        }
+        return bytes;
+    }
+
+    Tensor<> inputs(size_t batch, size_t features, float phase)
+    {
+        return (Tensor<>::arange(0, batch * features - 1) * phase).map([](const float &v)
+                                                                      { return std::fabs(std::sin(v)); })
+            .reshape({batch, features});
+    }
+}
+
+int main()
+{
+    printf("sgemm: %s, qgemm: %s, threads: %zu\n\n", gemm::kernel_name().c_str(), qgemm::kernel_name().c_str(), get_num_threads());
+    printf("%6s %6s %6s %14s %14s %9s\n", "M", "N", "K", "sgemm", "qgemm", "speedup");
+
+    const size_t sizes[][3] = {{64, 128, 784}, {64, 512, 1024}, {256, 1024, 1024}, {1024, 1024, 1024}};
+
+    for (const auto &size : sizes)
+    {
+        const size_t M = size[0], N = size[1], K = size[2];
+        const double ops = 2.0 * M * N * K;
+
+        vector<float> A(M * K), B(K * N), C(M * N);
+        vector<uint8_t> qA(M * K);
+        vector<int8_t> qB(K * N);
+        vector<int32_t> qC(M * N);
+        for (size_t i = 0; i < A.size(); ++i)
+        {
+            A[i] = static_cast<float>(i % 13) * 0.1f;
+            qA[i] = static_cast<uint8_t>(i % 128);
+        }
+        for (size_t i = 0; i < B.size(); ++i)
+        {
+            B[i] = static_cast<float>(i % 7) * 0.1f;
+            qB[i] = static_cast<int8_t>(static_cast<int>(i % 255) - 127);
+        }
+        const qgemm::PackedMatrix packed(qB.data(), K, N, N, 1);
+
+        const double t_float = best_time([&]
+                                         { gemm::sgemm(M, N, K, 1.0f, A.data(), K, 1, B.data(), N, 1, 0.0f, C.data(), N, 1); });
+        const double t_int8 = best_time([&]
+                                        { qgemm::gemm_u8s8s32(M, qA.data(), K, packed, qC.data(), N); });
+
+        printf("%6zu %6zu %6zu %8.1f GOP/s %8.1f GOP/s %8.2fx\n", M, N, K, ops / t_float * 1e-9, ops / t_int8 * 1e-9, t_float / t_int8);
+    }
+
+    printf("\n%22s %8s %12s %12s %9s %14s\n", "MLP", "batch", "float", "int8", "speedup", "weights");
+
+    for (const size_t batch : {64, 256})
+    {
+        MLP model(784, {1024, 1024, 10});
+        model.eval();
+
+        vector<Tensor<>> calibration;
+        for (size_t b = 0; b < 4; ++b)
+            calibration.push_back(inputs(batch, 784, 0.37f + 0.1f * b));
+        const Tensor<> x = inputs(batch, 784, 0.91f);
+
+        const size_t float_bytes = weight_bytes(model.get_layers());
+        const double t_float = best_time([&]
+                                         { model.forward(x); });
+
+        nn::quantize_linear_layers(model, calibration);
+
+        const size_t int8_bytes = weight_bytes(model.get_layers());
+        const double t_int8 = best_time([&]
+                                        { model.forward(x); });
+
+        printf("%22s %8zu %9.3f ms %9.3f ms %8.2fx %6.2f -> %.2f MB\n", "784-1024-1024-10", batch, t_float * 1e3, t_int8 * 1e3, t_float / t_int8,
+               float_bytes / 1e6, int8_bytes / 1e6);
+    }
+
+    return 0;
+}
@@ -0,0 +1,103 @@
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include "tensor.hpp"
+#include "dropout.hpp"
+using namespace std;
+
+/*
+Random fills of a 4096 x 4096 float tensor (64 MB), with the standard distributions drawing from one mt19937 element by element,
+and with the counter-based fills of random.hpp. The last line is the forward pass of a Dropout layer over a 256 x 4096 batch.
+*/
+
+namespace
+{
+    double best_time(const function<void()> &fn, int repeats = 5)
+    {
+        fn(); // warm up
+        double best = 1e30;
+        for (int r = 0; r < repeats; ++r)
+        {
+            const auto start = chrono::steady_clock::now();
+            fn();
+            const auto end = chrono::steady_clock::now();
+            best = std::min(best, chrono::duration<double>(end - start).count());
+        }
+        return best;
+    }
+
+    template <typename Distribution>
+    void mt19937_fill(Tensor<> &t, Distribution dis)
+    {
+        mt19937 gen(42);
+        const TensorAccessor<float, 2> out = t.accessor<2>();
+        for (size_t i = 0; i < t.shapes()[0]; ++i)
+        {
+            for (size_t j = 0; j < t.shapes()[1]; ++j)
+            {
+                out[i, j] = static_cast<float>(dis(gen));
+            }
+        }
+    }
+
+    void report(const char *name, double reference, double time, size_t bytes)
+    {
+        printf("%-12s %12.2f ms %12.2f ms %9.1fx %9.2f GB/s\n", name, reference * 1e3, time * 1e3, reference / time, bytes / time / 1e9);
+    }
+}
+
+int main()
+{
+    Tensor<> t = Tensor<>::empty({4096, 4096});
+    const size_t bytes = t.size() * sizeof(float);
+    rng::Generator gen(42);
+
+    printf("%-12s %15s %15s %10s %14s\n", "fill", "mt19937", "philox", "speedup", "bandwidth");
+
+    report("uniform", best_time([&]
+                                { mt19937_fill(t, uniform_real_distribution<float>(-1.0f, 1.0f)); }),
+           best_time([&]
+                     { t.uniform_(-1.0f, 1.0f, gen); }),
+           bytes);
+
+    report("normal", best_time([&]
+                               { mt19937_fill(t, normal_distribution<float>(0.0f, 1.0f)); }),
+           best_time([&]
+                     { t.normal_(0.0f, 1.0f, gen); }),
+           bytes);
+
+    report("bernoulli", best_time([&]
+                                  { mt19937_fill(t, bernoulli_distribution(0.5)); }),
+           best_time([&]
+                     { t.bernoulli_(0.5f, gen); }),
+           bytes);
+
+    // the former Dropout::forward: one bernoulli_distribution sample per element, written with the scale into the result and the mask
+    const Tensor<> batch = Tensor<>::empty({256, 4096}).fill_(1.0f);
+    Tensor<> mask = Tensor<>::empty(batch.shapes());
+    Tensor<> result = Tensor<>::empty(batch.shapes());
+    const double reference = best_time([&]
+                                       {
+        mt19937 mt(42);
+        bernoulli_distribution pmf(0.5);
+        const TensorAccessor<const float, 2> in = batch.accessor<2>();
+        const TensorAccessor<float, 2> out = result.accessor<2>();
+        const TensorAccessor<float, 2> m = mask.accessor<2>();
+        for (size_t i = 0; i < 256; ++i)
+        {
+            for (size_t j = 0; j < 4096; ++j)
+            {
+                const bool is_active = pmf(mt);
+                out[i, j] = is_active ? in[i, j] * 2.0f : 0.0f;
+                m[i, j] = is_active ? 1.0f : 0.0f;
+            }
+        } });
+
+    nn::Dropout dropout(0.5f);
+    report("dropout", reference, best_time([&]
+                                           { dropout.forward(batch); }),
+           batch.size() * sizeof(float));
+
+    return 0;
+}
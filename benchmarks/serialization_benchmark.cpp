@@ -0,0 +1,80 @@
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include "mlp.hpp"
+#include "serialization.hpp"
+using namespace std;
+
+/*
+Time to load the weights of an MLP from a file in the page cache.
+
+The "read" column copies every tensor of the file into newly allocated tensors, as a loader that reads the data would.
+The "mmap" column is load_state_dict, whose parameters are backed by the mapping of the file: loading only reads the header,
+and the pages are touched by the first forward pass (included in the "+ forward" columns).
+*/
+
+namespace
+{
+    double best_time(const function<void()> &fn, int repeats = 5)
+    {
+        fn(); // warm up, and bring the file into the page cache
+        double best = 1e30;
+        for (int r = 0; r < repeats; ++r)
+        {
+            const auto start = chrono::steady_clock::now();
+            fn();
+            const auto end = chrono::steady_clock::now();
+            best = std::min(best, chrono::duration<double>(end - start).count());
+        }
+        return best;
+    }
+
+    // Copy every tensor of the file into a new tensor
+    void read_copy(const string &path, nn::Module &model)
+    {
+        nn::load_state_dict(model, path);
+
+        unordered_map<string, Tensor<> *> params, grads;
+        model.register_parameters(params, grads);
+        for (const auto &[name, param] : params)
+        {
+            *param = param->clone();
+        }
+    }
+}
+
+int main()
+{
+    const string path = (filesystem::temp_directory_path() / "neuralnet_serialization_benchmark.nnt").string();
+
+    printf("%-28s %10s %12s %12s %18s %18s\n", "model", "size", "read", "mmap", "read + forward", "mmap + forward");
+
+    for (const size_t hidden : {1024, 2048})
+    {
+        MLP model(784, {hidden, hidden, hidden, 10});
+        model.eval();
+        nn::save_state_dict(model, path);
+
+        const Tensor<> input = Tensor<>::empty({1, 784}).fill_(0.5f);
+
+        const double read = best_time([&]
+                                      { read_copy(path, model); });
+        const double mapped = best_time([&]
+                                        { nn::load_state_dict(model, path); });
+        const double read_forward = best_time([&]
+                                              { read_copy(path, model);
+                                                model.forward(input); });
+        const double mapped_forward = best_time([&]
+                                                { nn::load_state_dict(model, path);
+                                                  model.forward(input); });
+
+        const string name = "MLP 784-" + to_string(hidden) + "x3-10";
+        printf("%-28s %7.1f MB %9.3f ms %9.3f ms %15.3f ms %15.3f ms\n", name.c_str(), filesystem::file_size(path) / 1e6,
+               read * 1e3, mapped * 1e3, read_forward * 1e3, mapped_forward * 1e3);
+    }
+
+    filesystem::remove(path);
+    return 0;
+}
@@ -0,0 +1,81 @@
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include "linear.hpp"
+#include "sparse_tensor.hpp"
+using namespace std;
+
+/*
+Forward and backward pass of a linear layer on a batch of bag-of-features vectors, given as a dense tensor or as a sparse CSR matrix.
+The dense pass is a GEMM over every input feature, the sparse one only reads the rows of the weight selected by the active features.
+*/
+
+namespace
+{
+    double best_time(const function<void()> &fn, int repeats = 5)
+    {
+        fn(); // warm up
+        double best = 1e30;
+        for (int r = 0; r < repeats; ++r)
+        {
+            const auto start = chrono::steady_clock::now();
+            fn();
+            const auto end = chrono::steady_clock::now();
+            best = std::min(best, chrono::duration<double>(end - start).count());
+        }
+        return best;
+    }
+
+    // batch_size rows of in_features columns, with a fraction density of them set to 1
+    SparseCSR random_batch(size_t batch_size, size_t in_features, float density)
+    {
+        mt19937 gen(42);
+        uniform_int_distribution<size_t> feature(0, in_features - 1);
+
+        const size_t active = static_cast<size_t>(density * in_features);
+        SparseCOO coo(batch_size, in_features);
+        coo.reserve(batch_size * active);
+        for (size_t i = 0; i < batch_size; ++i)
+        {
+            for (size_t k = 0; k < active; ++k)
+            {
+                coo.push_back(i, feature(gen), 1.0f);
+            }
+        }
+        return coo.to_csr();
+    }
+}
+
+int main()
+{
+    const size_t batch_size = 128;
+    const size_t out_features = 128;
+
+    printf("%-24s %8s %16s %16s %9s\n", "input", "density", "dense fwd+bwd", "sparse fwd+bwd", "speedup");
+
+    for (const size_t in_features : {4096, 32768})
+    {
+        for (const float density : {0.05f, 0.01f})
+        {
+            const SparseCSR sparse = random_batch(batch_size, in_features, density);
+            const Tensor<> dense = sparse.to_dense();
+            const Tensor<> grad_output = Tensor<>::empty({batch_size, out_features}).fill_(0.01f);
+
+            nn::Linear linear(in_features, out_features);
+
+            const double dense_time = best_time([&]
+                                                { linear.forward(dense);
+                                                  linear.backward(grad_output); });
+            const double sparse_time = best_time([&]
+                                                 { linear.forward(sparse);
+                                                   linear.backward(grad_output); });
+
+            const string name = to_string(batch_size) + " x " + to_string(in_features);
+            printf("%-24s %7.1f%% %13.3f ms %13.3f ms %8.1fx\n", name.c_str(), sparse.density() * 100, dense_time * 1e3, sparse_time * 1e3,
+                   dense_time / sparse_time);
+        }
+    }
+
+    return 0;
+}
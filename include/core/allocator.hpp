@@ -0,0 +1,199 @@
+#pragma once
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+using namespace std;
+
+/*
+Memory allocators of the tensor storage (see storage.hpp).
+
+Every allocator returns blocks aligned to at least ALIGNMENT bytes (a cache line, and the width of an AVX-512 register).
+The storage of new tensors is taken from the current allocator, which is the CachingAllocator unless it is changed
+with set_allocator() or an AllocatorGuard (or with the environment variable NEURALNET_CACHING_ALLOCATOR=0, which selects the DefaultAllocator):
+
+    memory::ArenaAllocator arena;
+    {
+        memory::AllocatorGuard guard(&arena); // the tensors created in this scope are allocated from the arena
+        ...
+    }
+
+An allocator must outlive every tensor allocated from it.
+
+Buffers of at least HUGE_PAGE_SIZE bytes are backed by transparent huge pages when huge pages are enabled (Linux only),
+which cuts the TLB misses of big weight and activation tensors. They are enabled by default, and can be disabled with
+set_huge_pages(false) or the environment variable NEURALNET_HUGE_PAGES=0.
+*/
+namespace memory
+{
+    constexpr size_t ALIGNMENT = 64;
+    constexpr size_t HUGE_PAGE_SIZE = size_t(2) << 20; // 2 MB
+
+    class Allocator
+    {
+    public:
+        virtual ~Allocator() = default;
+
+        // Allocate nbytes of uninitialized memory, aligned to ALIGNMENT bytes. Throws bad_alloc on failure
+        virtual void *allocate(size_t nbytes) = 0;
+
+        // Free a block returned by allocate(nbytes)
+        virtual void deallocate(void *ptr, size_t nbytes) = 0;
+
+        virtual string name() const = 0;
+    };
+
+    // Aligned operator new / delete. Buffers of at least HUGE_PAGE_SIZE bytes are aligned to HUGE_PAGE_SIZE and advised as huge pages
+    class DefaultAllocator : public Allocator
+    {
+    public:
+        void *allocate(size_t nbytes) override;
+        void deallocate(void *ptr, size_t nbytes) override;
+        string name() const override { return "default"; }
+    };
+
+    /*
+    Keeps the freed blocks in free lists, one per power-of-two size class, and reuses them for the next allocations of the same class.
+    The cached blocks are only released by release() or by the destructor.
+    */
+    class PoolAllocator : public Allocator
+    {
+    public:
+        // Blocks bigger than max_block_size are not cached
+        explicit PoolAllocator(size_t max_block_size = size_t(256) << 20);
+        ~PoolAllocator() override;
+
+        void *allocate(size_t nbytes) override;
+        void deallocate(void *ptr, size_t nbytes) override;
+        string name() const override { return "pool"; }
+
+        // Free all the cached blocks
+        void release();
+
+    private:
+        size_t max_block_size_;
+        vector<vector<void *>> free_lists_; // indexed by the log2 of the block size
+        mutex mutex_;
+    };
+
+    /*
+    Bump allocator: the blocks are carved out of big chunks, deallocate() does nothing,
+    and all the memory is reclaimed at once by reset() or by the destructor.
+    Meant for a scope in which every tensor is temporary (e.g. the activations of one inference).
+    */
+    class ArenaAllocator : public Allocator
+    {
+    public:
+        explicit ArenaAllocator(size_t chunk_size = size_t(64) << 20);
+        ~ArenaAllocator() override;
+
+        void *allocate(size_t nbytes) override;
+        void deallocate(void *, size_t) override {}
+        string name() const override { return "arena"; }
+
+        // Reuse all the chunks from the beginning. No tensor allocated from the arena may be used afterwards
+        void reset();
+
+        // Total size of the chunks
+        size_t capacity() const;
+
+    private:
+        struct Chunk
+        {
+            char *data;
+            size_t size;
+        };
+
+        size_t chunk_size_;
+        vector<Chunk> chunks_;
+        size_t current_ = 0; // index of the chunk being filled
+        size_t used_ = 0;    // bytes used in the current chunk
+        mutable mutex mutex_;
+    };
+
+    // Every block is mapped with its own anonymous mmap and unmapped when it is freed. Blocks of at least HUGE_PAGE_SIZE bytes are advised as huge pages
+    class MmapAllocator : public Allocator
+    {
+    public:
+        void *allocate(size_t nbytes) override;
+        void deallocate(void *ptr, size_t nbytes) override;
+        string name() const override { return "mmap"; }
+    };
+
+    struct CacheStats
+    {
+        size_t allocations = 0;  // calls to allocate()
+        size_t hits = 0;         // allocations served from the cache
+        size_t misses = 0;       // allocations that went to the system allocator
+        size_t bytes_in_use = 0; // bytes of the blocks currently allocated (rounded up to their size class)
+        size_t bytes_cached = 0; // bytes of the free blocks kept in the caches
+    };
+
+    /*
+    Caching allocator, in the spirit of the CPU caching allocator of PyTorch.
+
+    The requested sizes are rounded up to size classes (4 classes per power of two, so at most 25% is wasted), and the freed blocks
+    are kept in free lists, to be reused by the next allocation of the same class. Since a training step allocates and frees the same
+    set of activation, gradient and temporary buffers at every iteration, the steady state does almost no malloc / free.
+
+    Each thread has its own cache, so allocations and frees do not contend with the other threads. The blocks of a thread that exits
+    are moved to a shared cache, from which every thread can take them. The memory is only returned to the system by empty_cache().
+
+    There is one process-wide instance, returned by caching_allocator().
+    */
+    class CachingAllocator : public Allocator
+    {
+    public:
+        void *allocate(size_t nbytes) override;
+        void deallocate(void *ptr, size_t nbytes) override;
+        string name() const override { return "caching"; }
+
+        // Return all the cached blocks (of every thread) to the system
+        void empty_cache();
+
+        CacheStats stats() const;
+
+        // Reset the allocations, hits and misses counters
+        void reset_stats();
+
+        // The size of the block allocated for a request of nbytes
+        static size_t round_size(size_t nbytes);
+
+    private:
+        CachingAllocator() = default;
+        friend CachingAllocator *caching_allocator();
+    };
+
+    // The process-wide CachingAllocator
+    CachingAllocator *caching_allocator();
+
+    // Shortcut for caching_allocator()->empty_cache()
+    void empty_cache();
+
+    // The allocator of the new tensors
+    Allocator *get_allocator();
+
+    // Set the allocator of the new tensors. nullptr restores the initial one (the caching allocator by default)
+    void set_allocator(Allocator *allocator);
+
+    // The process-wide DefaultAllocator
+    Allocator *default_allocator();
+
+    // Enable or disable transparent huge pages for the buffers of at least HUGE_PAGE_SIZE bytes
+    void set_huge_pages(bool enabled);
+    bool huge_pages_enabled();
+
+    // Set the allocator of the new tensors for the lifetime of the guard
+    class AllocatorGuard
+    {
+    public:
+        explicit AllocatorGuard(Allocator *allocator) : previous_(get_allocator()) { set_allocator(allocator); }
+        ~AllocatorGuard() { set_allocator(this->previous_); }
+
+        AllocatorGuard(const AllocatorGuard &) = delete;
+        AllocatorGuard &operator=(const AllocatorGuard &) = delete;
+
+    private:
+        Allocator *previous_;
+    };
+}
@@ -4,6 +4,7 @@
 #include <vector>
 #include <unordered_map>
 #include "tensor.hpp"
+#include "logging.hpp"
 using namespace std;
 
 namespace nn
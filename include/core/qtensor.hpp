@@ -0,0 +1,332 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#include "tensor.hpp"
+#include "qgemm.hpp"
+using namespace std;
+
+/*
+Quantization parameters of an affine mapping between floats and integers:
+
+    real = scale * (q - zero_point)
+
+The zero point is an integer, so that 0.0 is represented exactly (e.g. by the padding and the outputs of ReLU).
+*/
+struct QuantParams
+{
+    float scale = 1.0f;
+    int32_t zero_point = 0;
+};
+
+/**
+ * Choose the parameters mapping the range [min, max] to the integers [qmin, qmax].
+ * The range is extended to contain 0.
+ *
+ * @param symmetric If true, the range is [-amax, amax] where amax = max(|min|, |max|), and the zero point is the middle of [qmin, qmax]
+ * (0 for [-127, 127]), so that the zero point does not need to be subtracted. It is used for the weights.
+ */
+inline QuantParams choose_qparams(float min, float max, int32_t qmin, int32_t qmax, bool symmetric = false)
+{
+    if (!(min <= max) || qmin >= qmax)
+    {
+        throw invalid_argument("Invalid range for the quantization parameters");
+    }
+
+    min = std::min(min, 0.0f);
+    max = std::max(max, 0.0f);
+
+    QuantParams params;
+
+    if (symmetric)
+    {
+        const float amax = std::max(-min, max);
+        params.scale = amax / (static_cast<float>(qmax - qmin) / 2.0f);
+        params.zero_point = (qmin + qmax + 1) / 2;
+    }
+    else
+    {
+        params.scale = (max - min) / static_cast<float>(qmax - qmin);
+    }
+
+    // A constant range (e.g. all the inputs are 0): any scale represents it
+    if (!(params.scale > numeric_limits<float>::min()) || !std::isfinite(params.scale))
+    {
+        params.scale = 1.0f;
+    }
+
+    if (!symmetric)
+    {
+        const float zero_point = static_cast<float>(qmin) - std::nearbyint(min / params.scale);
+        params.zero_point = static_cast<int32_t>(std::clamp(zero_point, static_cast<float>(qmin), static_cast<float>(qmax)));
+    }
+
+    return params;
+}
+
+/*
+A tensor of 8-bit integers with its quantization parameters:
+- per tensor: one scale and one zero point
+- per channel: one scale and one zero point for every index along the axis (e.g. every output channel of a weight)
+
+    QTensor<int8_t> qw = QTensor<int8_t>::quantize_per_channel(weight, scales, zero_points, 1);
+    Tensor<> w = qw.dequantize();
+
+The integers are stored contiguously, in a Tensor<Q> (see int_repr()).
+*/
+template <typename Q = int8_t>
+class QTensor
+{
+    static_assert(is_same_v<Q, int8_t> || is_same_v<Q, uint8_t>, "QTensor only supports int8_t and uint8_t");
+
+private:
+    Tensor<Q> values_;
+    vector<float> scales_;
+    vector<int32_t> zero_points_;
+    int64_t axis_ = -1; // -1 for per tensor quantization
+    int32_t qmin_ = numeric_limits<Q>::min();
+    int32_t qmax_ = numeric_limits<Q>::max();
+
+    /*
+    Quantize n contiguous floats: q = clamp(round(x / scale) + zero_point, qmin, qmax), rounding half to even as nearbyint.
+
+    The value is clamped before rounding, so it is below 2^22 and adding 1.5 * 2^23 rounds it in the float addition.
+    The loop has no calls and no branches, and it is vectorized by the compiler. NaN is quantized to qmin.
+    */
+    static void quantize_block(const float *x, Q *q, size_t n, float scale, int32_t zero_point, int32_t qmin, int32_t qmax)
+    {
+        constexpr float ROUND_MAGIC = 12582912.0f; // 1.5 * 2^23
+
+        const float inv_scale = 1.0f / scale;
+        const float lo = static_cast<float>(qmin - zero_point);
+        const float hi = static_cast<float>(qmax - zero_point);
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            const float clamped = std::min(hi, std::max(lo, x[i] * inv_scale));
+            const float rounded = (clamped + ROUND_MAGIC) - ROUND_MAGIC;
+            q[i] = static_cast<Q>(static_cast<int32_t>(rounded) + zero_point);
+        }
+    }
+
+    static void dequantize_block(const Q *q, float *x, size_t n, float scale, int32_t zero_point)
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            x[i] = scale * static_cast<float>(static_cast<int32_t>(q[i]) - zero_point);
+        }
+    }
+
+    static void check_range(int32_t qmin, int32_t qmax)
+    {
+        if (qmin < numeric_limits<Q>::min() || qmax > numeric_limits<Q>::max() || qmin >= qmax)
+        {
+            throw invalid_argument("The quantized range must be within the range of the integer type");
+        }
+    }
+
+    // Number of elements after the axis, i.e. the distance between two consecutive indices along the axis
+    size_t inner_size() const
+    {
+        size_t inner = 1;
+        for (size_t i = this->axis_ + 1; i < this->values_.ndim(); ++i)
+        {
+            inner *= this->values_.shapes()[i];
+        }
+        return inner;
+    }
+
+    const Q *values_data() const { return this->values_.data_->data() + this->values_.offset_; }
+
+public:
+    QTensor() = default;
+
+    /**
+     * Per tensor quantization.
+     *
+     * @param qmin, qmax The range of the integers, by default the whole range of Q. It can be narrowed, e.g. to [-127, 127] or [0, 127]
+     * for the quantized GEMM (see qgemm.hpp).
+     */
+    static QTensor<Q> quantize(const Tensor<> &x, float scale, int32_t zero_point,
+                               int32_t qmin = numeric_limits<Q>::min(), int32_t qmax = numeric_limits<Q>::max())
+    {
+        check_range(qmin, qmax);
+
+        const Tensor<> source = x.is_contiguous() ? x : x.clone();
+        const float *in = source.data_->data() + source.offset_;
+
+        QTensor<Q> result;
+        result.values_ = Tensor<Q>::empty(x.shapes());
+        result.scales_ = {scale};
+        result.zero_points_ = {zero_point};
+        result.qmin_ = qmin;
+        result.qmax_ = qmax;
+
+        Q *out = result.values_.data_->data();
+
+        parallel_for(0, x.size(), Tensor<>::PARALLEL_ELEMENTWISE_NUMEL, [&](size_t begin, size_t end)
+                     { quantize_block(in + begin, out + begin, end - begin, scale, zero_point, qmin, qmax); });
+
+        return result;
+    }
+
+    static QTensor<Q> quantize(const Tensor<> &x, const QuantParams &params,
+                               int32_t qmin = numeric_limits<Q>::min(), int32_t qmax = numeric_limits<Q>::max())
+    {
+        return quantize(x, params.scale, params.zero_point, qmin, qmax);
+    }
+
+    /**
+     * Per channel quantization: the elements whose index along axis is c are quantized with scales[c] and zero_points[c].
+     * A negative axis counts from the last dimension.
+     */
+    static QTensor<Q> quantize_per_channel(const Tensor<> &x, const vector<float> &scales, const vector<int32_t> &zero_points, int64_t axis,
+                                           int32_t qmin = numeric_limits<Q>::min(), int32_t qmax = numeric_limits<Q>::max())
+    {
+        check_range(qmin, qmax);
+
+        if (axis < 0)
+        {
+            axis += x.ndim();
+        }
+        if (axis < 0 || axis >= static_cast<int64_t>(x.ndim()))
+        {
+            throw out_of_range("The axis of the quantization is out of range");
+        }
+
+        const size_t channels = x.shapes()[axis];
+
+        if (scales.size() != channels || zero_points.size() != channels)
+        {
+            throw invalid_argument("The number of scales and zero points must be the size of the axis");
+        }
+
+        const Tensor<> source = x.is_contiguous() ? x : x.clone();
+        const float *in = source.data_->data() + source.offset_;
+
+        QTensor<Q> result;
+        result.values_ = Tensor<Q>::empty(x.shapes());
+        result.scales_ = scales;
+        result.zero_points_ = zero_points;
+        result.axis_ = axis;
+        result.qmin_ = qmin;
+        result.qmax_ = qmax;
+
+        Q *out = result.values_.data_->data();
+        const size_t inner = result.inner_size();
+        const size_t outer = x.size() / (channels * inner);
+
+        parallel_for(0, outer * channels, std::max<size_t>(1, Tensor<>::PARALLEL_ELEMENTWISE_NUMEL / inner), [&](size_t begin, size_t end)
+                     {
+                         for (size_t i = begin; i < end; ++i)
+                         {
+                             const size_t c = i % channels;
+                             quantize_block(in + i * inner, out + i * inner, inner, scales[c], zero_points[c], qmin, qmax);
+                         } });
+
+        return result;
+    }
+
+    // Convert back to floats: scale * (q - zero_point)
+    Tensor<> dequantize() const
+    {
+        Tensor<> result = Tensor<>::empty(this->values_.shapes());
+        const Q *in = this->values_data();
+        float *out = result.data_->data();
+
+        if (!this->is_per_channel())
+        {
+            parallel_for(0, this->size(), Tensor<>::PARALLEL_ELEMENTWISE_NUMEL, [&](size_t begin, size_t end)
+                         { dequantize_block(in + begin, out + begin, end - begin, this->scales_[0], this->zero_points_[0]); });
+            return result;
+        }
+
+        const size_t channels = this->scales_.size();
+        const size_t inner = this->inner_size();
+        const size_t outer = this->size() / (channels * inner);
+
+        for (size_t i = 0; i < outer * channels; ++i)
+        {
+            const size_t c = i % channels;
+            dequantize_block(in + i * inner, out + i * inner, inner, this->scales_[c], this->zero_points_[c]);
+        }
+
+        return result;
+    }
+
+    /**
+     * Quantized linear map of a per tensor uint8 tensor of shape (..., K) with a packed K x N int8 weight, accumulated in int32:
+     *
+     *     y = dequantize(x) * dequantize(weight) + bias
+     *
+     * @param weight_scales The scale of every column of the weight (its zero points are 0, see choose_qparams).
+     * @param bias Empty, or the N values added to every row.
+     * @return A float tensor of shape (..., N).
+     */
+    Tensor<> linear(const qgemm::PackedMatrix &weight, const vector<float> &weight_scales, const vector<float> &bias = {}) const
+    {
+        if constexpr (!is_same_v<Q, uint8_t>)
+        {
+            throw runtime_error("The quantized linear map requires uint8 inputs");
+        }
+        else
+        {
+            if (this->is_per_channel() || this->qmin_ < 0 || this->qmax_ > qgemm::A_MAX)
+            {
+                throw runtime_error("The inputs of the quantized linear map must be quantized per tensor to [0, " + to_string(qgemm::A_MAX) + "]");
+            }
+
+            const size_t K = weight.rows(), N = weight.cols();
+
+            if (this->ndim() == 0 || this->values_.shapes()[this->ndim() - 1] != K)
+            {
+                throw invalid_argument("The last dimension of the input must be the number of rows of the weight");
+            }
+            if (weight_scales.size() != N || (!bias.empty() && bias.size() != N))
+            {
+                throw invalid_argument("There must be one weight scale and one bias per column of the weight");
+            }
+
+            DimVector output_shape = this->values_.shapes();
+            output_shape[this->ndim() - 1] = N;
+            Tensor<> result = Tensor<>::empty(output_shape);
+
+            vector<float> output_scales(N);
+            for (size_t j = 0; j < N; ++j)
+            {
+                output_scales[j] = this->scales_[0] * weight_scales[j];
+            }
+
+            qgemm::gemm_u8s8f32(this->size() / K, this->values_data(), K, this->zero_points_[0], weight, output_scales.data(),
+                                bias.empty() ? nullptr : bias.data(), result.data_->data(), N);
+
+            return result;
+        }
+    }
+
+    // The integers, as a contiguous tensor
+    inline const Tensor<Q> &int_repr() const { return this->values_; }
+
+    // Pointer to the first integer
+    inline const Q *data() const { return this->values_data(); }
+
+    inline const DimVector &shapes() const { return this->values_.shapes(); }
+    inline size_t ndim() const { return this->values_.ndim(); }
+    inline size_t size() const { return this->values_.size(); }
+
+    inline bool is_per_channel() const { return this->axis_ >= 0; }
+    inline int64_t axis() const { return this->axis_; }
+
+    // The scale and the zero point of a per tensor quantized tensor
+    inline float scale() const { return this->scales_.at(0); }
+    inline int32_t zero_point() const { return this->zero_points_.at(0); }
+
+    inline const vector<float> &scales() const { return this->scales_; }
+    inline const vector<int32_t> &zero_points() const { return this->zero_points_; }
+
+    inline int32_t qmin() const { return this->qmin_; }
+    inline int32_t qmax() const { return this->qmax_; }
+};
@@ -0,0 +1,141 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "tensor.hpp"
+using namespace std;
+
+/*
+Sparse float matrices, for inputs of which most elements are 0 (e.g. bag-of-features vectors):
+
+- SparseCOO (coordinate format) lists the (row, column, value) triplets in any order. It is meant for construction.
+- SparseCSR (compressed sparse rows) stores the columns and the values of every row contiguously, row after row.
+  It is meant for computation: its products with dense matrices cost a time proportional to the number of non-zero elements.
+
+    SparseCOO coo(batch_size, num_features);
+    coo.push_back(0, 12, 1.0f); // feature 12 of sample 0
+    ...
+    SparseCSR batch = coo.to_csr();
+    Tensor<> output = linear.forward(batch);
+*/
+
+class SparseCSR;
+
+class SparseCOO
+{
+private:
+    size_t rows_ = 0;
+    size_t cols_ = 0;
+    vector<size_t> row_indices_;
+    vector<size_t> col_indices_;
+    vector<float> values_;
+
+    void check_index(size_t row, size_t col) const;
+
+public:
+    SparseCOO() = default;
+
+    // Empty rows x cols matrix
+    SparseCOO(size_t rows, size_t cols);
+
+    /**
+     * Matrix with the elements values[i] at (row_indices[i], col_indices[i]). Duplicates are summed by coalesce().
+     *
+     * @throws invalid_argument If the vectors are not of the same size.
+     * @throws out_of_range If an index is out of the matrix.
+     */
+    SparseCOO(size_t rows, size_t cols, vector<size_t> row_indices, vector<size_t> col_indices, vector<float> values);
+
+    // The non-zero elements of a 2D tensor
+    static SparseCOO from_dense(const Tensor<> &dense);
+
+    // Add an element (summed with the other elements at the same position by coalesce())
+    void push_back(size_t row, size_t col, float value);
+
+    void reserve(size_t nnz);
+
+    // The elements sorted by row, then by column, with the duplicates summed
+    SparseCOO coalesce() const;
+
+    // Coalesce the elements into the compressed sparse rows format
+    SparseCSR to_csr() const;
+
+    Tensor<> to_dense() const;
+
+    inline size_t rows() const { return this->rows_; }
+    inline size_t cols() const { return this->cols_; }
+    inline size_t nnz() const { return this->values_.size(); }
+    inline DimVector shapes() const { return {this->rows_, this->cols_}; }
+
+    inline const vector<size_t> &row_indices() const { return this->row_indices_; }
+    inline const vector<size_t> &col_indices() const { return this->col_indices_; }
+    inline const vector<float> &values() const { return this->values_; }
+};
+
+class SparseCSR
+{
+private:
+    size_t rows_ = 0;
+    size_t cols_ = 0;
+    vector<size_t> row_ptr_ = {0}; // the elements of row r are [row_ptr_[r], row_ptr_[r + 1])
+    vector<size_t> col_indices_;
+    vector<float> values_;
+
+    // The elements of the dense matrix at the positions of the non-zero elements, in the order of values_
+    vector<float> gather(const Tensor<> &dense) const;
+
+public:
+    SparseCSR() = default;
+
+    /**
+     * Matrix whose row r has the elements values[i] at the columns col_indices[i], for row_ptr[r] <= i < row_ptr[r + 1].
+     * The columns of a row do not need to be sorted.
+     *
+     * @throws invalid_argument If row_ptr is not a non-decreasing sequence of rows + 1 offsets from 0 to the number of elements.
+     * @throws out_of_range If a column index is out of the matrix.
+     */
+    SparseCSR(size_t rows, size_t cols, vector<size_t> row_ptr, vector<size_t> col_indices, vector<float> values);
+
+    // The non-zero elements of a 2D tensor
+    static SparseCSR from_dense(const Tensor<> &dense);
+
+    Tensor<> to_dense() const;
+    SparseCOO to_coo() const;
+
+    // The cols x rows transpose, with its columns sorted
+    SparseCSR transpose() const;
+
+    /**
+     * Product with a dense matrix of shape (cols, N): a dense matrix of shape (rows, N).
+     * The rows are computed in parallel, in a time proportional to nnz() * N.
+     */
+    Tensor<> matmul(const Tensor<> &dense) const;
+
+    /**
+     * Product of the transpose with a dense matrix of shape (rows, N): a dense matrix of shape (cols, N), e.g. the gradient
+     * X^T * dL/dY of the weight of a linear layer whose input X is sparse.
+     */
+    Tensor<> transposed_matmul(const Tensor<> &dense) const;
+
+    /**
+     * Element-wise product with a dense matrix of shape (rows, cols), or broadcast to it (e.g. a row (1, cols)).
+     * The result has the same non-zero elements as this matrix.
+     */
+    SparseCSR multiply(const Tensor<> &dense) const;
+
+    // Element-wise sum with a dense matrix of shape (rows, cols): a dense matrix
+    Tensor<> add(const Tensor<> &dense) const;
+
+    SparseCSR operator*(float scaler) const;
+
+    inline size_t rows() const { return this->rows_; }
+    inline size_t cols() const { return this->cols_; }
+    inline size_t nnz() const { return this->values_.size(); }
+    inline DimVector shapes() const { return {this->rows_, this->cols_}; }
+
+    // Fraction of the elements which are non-zero
+    inline float density() const { return this->rows_ * this->cols_ == 0 ? 0.0f : static_cast<float>(this->nnz()) / (this->rows_ * this->cols_); }
+
+    inline const vector<size_t> &row_ptr() const { return this->row_ptr_; }
+    inline const vector<size_t> &col_indices() const { return this->col_indices_; }
+    inline const vector<float> &values() const { return this->values_; }
+};
@@ -0,0 +1,133 @@
+#pragma once
+#include <algorithm>
+#include <memory>
+#include <type_traits>
+#include "allocator.hpp"
+using namespace std;
+
+/*
+Contiguous buffer holding the elements of one or more tensors (copies and views share it through a shared_ptr).
+
+- The buffer is aligned to memory::ALIGNMENT (64) bytes, and taken from the allocator in use when it is created (see allocator.hpp).
+- Storage(size) does not initialize trivial types (float, int...), unlike vector, since the kernels overwrite every element anyway.
+  Other types are value-initialized.
+- A storage can also view elements owned by someone else (e.g. a memory mapped file, see serialization.hpp), which it keeps alive.
+*/
+template <typename T>
+class Storage
+{
+private:
+    T *data_ = nullptr;
+    size_t size_ = 0;
+    memory::Allocator *allocator_ = nullptr; // nullptr if the elements are not owned by the storage
+    shared_ptr<void> owner_ = nullptr;        // owner of the elements of an external storage
+
+    void allocate(size_t size)
+    {
+        this->size_ = size;
+        if (size > 0)
+        {
+            this->data_ = static_cast<T *>(this->allocator_->allocate(size * sizeof(T)));
+        }
+    }
+
+    void release() noexcept
+    {
+        if (this->data_ != nullptr && this->allocator_ != nullptr)
+        {
+            std::destroy_n(this->data_, this->size_);
+            this->allocator_->deallocate(this->data_, this->size_ * sizeof(T));
+        }
+    }
+
+public:
+    // Uninitialized storage of size elements (value-initialized for non-trivial types)
+    explicit Storage(size_t size, memory::Allocator *allocator = memory::get_allocator())
+        : allocator_(allocator)
+    {
+        this->allocate(size);
+        if constexpr (!std::is_trivially_default_constructible_v<T>)
+        {
+            std::uninitialized_value_construct_n(this->data_, size);
+        }
+    }
+
+    // Storage of size elements equal to value
+    Storage(size_t size, const T &value, memory::Allocator *allocator = memory::get_allocator())
+        : allocator_(allocator)
+    {
+        this->allocate(size);
+        std::uninitialized_fill_n(this->data_, size, value);
+    }
+
+    // Storage holding a copy of [first, last)
+    template <typename It, typename = std::enable_if_t<!std::is_integral_v<It>>>
+    Storage(It first, It last, memory::Allocator *allocator = memory::get_allocator())
+        : allocator_(allocator)
+    {
+        this->allocate(static_cast<size_t>(std::distance(first, last)));
+        std::uninitialized_copy(first, last, this->data_);
+    }
+
+    // External storage of the size elements at data, which stay owned by owner. They are neither copied nor destroyed
+    Storage(T *data, size_t size, shared_ptr<void> owner)
+        : data_(data), size_(size), owner_(std::move(owner))
+    {
+    }
+
+    ~Storage()
+    {
+        this->release();
+    }
+
+    // The storage is shared through a shared_ptr, and copied explicitly (copy-on-write)
+    Storage(const Storage &) = delete;
+    Storage &operator=(const Storage &) = delete;
+
+    inline T *data() { return this->data_; }
+    inline const T *data() const { return this->data_; }
+
+    inline size_t size() const { return this->size_; }
+
+    inline T &operator[](size_t i) { return this->data_[i]; }
+    inline const T &operator[](size_t i) const { return this->data_[i]; }
+
+    inline T *begin() { return this->data_; }
+    inline T *end() { return this->data_ + this->size_; }
+    inline const T *begin() const { return this->data_; }
+    inline const T *end() const { return this->data_ + this->size_; }
+
+    inline memory::Allocator *allocator() const { return this->allocator_; }
+};
+
+// Adapter of a memory::Allocator to the standard allocator interface
+template <typename U>
+struct StorageAllocator
+{
+    using value_type = U;
+
+    memory::Allocator *allocator;
+
+    explicit StorageAllocator(memory::Allocator *allocator) : allocator(allocator) {}
+
+    template <typename V>
+    StorageAllocator(const StorageAllocator<V> &other) : allocator(other.allocator) {}
+
+    U *allocate(size_t n) { return static_cast<U *>(this->allocator->allocate(n * sizeof(U))); }
+    void deallocate(U *ptr, size_t n) { this->allocator->deallocate(ptr, n * sizeof(U)); }
+
+    template <typename V>
+    bool operator==(const StorageAllocator<V> &other) const { return this->allocator == other.allocator; }
+};
+
+/*
+Create a shared storage, forwarding args to a constructor of Storage<T>.
+The shared_ptr control block is allocated from the same allocator as the buffer, so with the caching allocator
+creating a tensor does not call malloc at all in steady state.
+*/
+template <typename T, typename... Args>
+shared_ptr<Storage<T>> make_storage(Args &&...args)
+{
+    memory::Allocator *allocator = memory::get_allocator();
+    return allocate_shared<Storage<T>>(StorageAllocator<Storage<T>>(allocator), std::forward<Args>(args)..., allocator);
+}
@@ -1,19 +1,33 @@
 #pragma once
 #include "tensor_utils.hpp"
+#include "storage.hpp"
+#include "tensor_iterator.hpp"
+#include "tensor_accessor.hpp"
+#include "strided_copy.hpp"
+#include "simd.hpp"
+#include "gemm.hpp"
+#include "parallel.hpp"
+#include "summation.hpp"
+#include "tensor_expr.hpp"
+#include "logging.hpp"
+#include "random.hpp"
 using namespace std;
 
+template <typename Q>
+class QTensor;
+
 template <typename T = float>
 class Tensor
 {
 private:
-    shared_ptr<vector<T>> data_ = nullptr; // data is stored as a 1D vector // shared_ptr is used to avoid copying data
-    vector<size_t> shape_;                 // store the dimensions of the tensor
-    vector<size_t> strides_;               // store the strides of the tensor
+    shared_ptr<Storage<T>> data_ = nullptr; // data is stored as a 64-byte aligned 1D buffer (see storage.hpp) // shared between copies and views, copied on first write
+    DimVector shape_;                      // store the dimensions of the tensor (inline, see dim_vector.hpp)
+    DimVector strides_;                    // store the strides of the tensor
     size_t offset_ = 0;                    // offset for slicing
     mutable int64_t size_ = -1;            // it can be changed by const member functions (in size() function)
 
     // Helper function to calculate the index in the 1D vector for a given set of indices expressed in the form of N-D vector
-    size_t calculate_idx(const vector<size_t> &idxs) const
+    size_t calculate_idx(const DimVector &idxs) const
     {
         size_t idx = this->offset_;
         for (size_t i = 0; i < idxs.size(); ++i)
@@ -23,47 +37,88 @@ private:
         return idx;
     }
 
+    // Helper function to get the position in the buffer of the element at the given row-major linear index
+    size_t linear_to_offset(size_t linear_index) const
+    {
+        if (this->is_contiguous())
+        {
+            return this->offset_ + linear_index;
+        }
+
+        size_t idx = this->offset_;
+        for (int64_t i = this->ndim() - 1; i >= 0; --i)
+        {
+            idx += (linear_index % this->shape_[i]) * this->strides_[i];
+            linear_index /= this->shape_[i];
+        }
+        return idx;
+    }
+
+    /*
+    Copy-on-write support
+
+    Copies, views (transpose, permute, reshape, ...) and caches share the same underlying buffer.
+    Before the tensor is mutated, we make sure it is the only owner of the buffer.
+    If the buffer is shared, the elements of this tensor are copied to a new contiguous buffer first,
+    so that the mutation is not visible to the other tensors sharing the old buffer.
+    */
+    void detach()
+    {
+        if (this->data_ != nullptr && this->data_.use_count() > 1)
+        {
+            *this = this->clone();
+        }
+    }
+
     // Helper function for printing since we don't know the number of dimensions
-    void print_recursive_impl(size_t dim, size_t offset, int indent = 0) const
+    void print_recursive_impl(ostream &os, size_t dim, size_t offset, int indent = 0) const
     {
         const string indent_str(indent, ' ');
 
         // Handle empty dimensions
         if (this->shape_[dim] == 0)
         {
-            cout << indent_str << "[]";
+            os << indent_str << "[]";
             return;
         }
 
-        cout << indent_str << "[";
+        os << indent_str << "[";
 
         if (dim == this->ndim() - 1)
         { // Last dimension
             for (size_t i = 0; i < this->shape_[dim]; ++i)
             {
-                cout << (*this->data_)[offset + i * this->strides_[dim]];
+                os << (*this->data_)[offset + i * this->strides_[dim]];
                 if (i < this->shape_[dim] - 1)
-                    cout << ", ";
+                    os << ", ";
             }
         }
         else
         {
-            cout << "\n";
+            os << "\n";
             for (size_t i = 0; i < this->shape_[dim]; ++i)
             {
-                print_recursive_impl(dim + 1, offset + i * this->strides_[dim], indent + 2);
+                print_recursive_impl(os, dim + 1, offset + i * this->strides_[dim], indent + 2);
                 if (i < this->shape_[dim] - 1)
-                    cout << ",\n";
+                    os << ",\n";
             }
-            cout << "\n"
-                 << indent_str;
+            os << "\n"
+               << indent_str;
+        }
+        os << "]";
+    }
+
+    void check_accessor_rank(size_t rank) const
+    {
+        if (this->ndim() != rank)
+        {
+            throw std::invalid_argument("Accessor of rank " + to_string(rank) + " of a tensor of rank " + to_string(this->ndim()));
         }
-        cout << "]";
     }
 
     // Helper function for operator[] overloading
     template <typename... Indices>
-    const vector<size_t> get_idxs(Indices... indices) const
+    const DimVector get_idxs(Indices... indices) const
     {
         // Convert variadic arguments to vector
         vector<int64_t> idxs({static_cast<int64_t>(indices)...});
@@ -71,7 +126,7 @@ private:
         {
             throw std::invalid_argument("Number of indices does not match the number of dimensions");
         }
-        vector<size_t> normalized_idxs;
+        DimVector normalized_idxs;
 
         // for better performance, reserve the size of the vector
         normalized_idxs.reserve(idxs.size());
@@ -91,148 +146,750 @@ private:
      *
      * @tparam U The data type of the resulting tensor. Defaults to the type of the current tensor.
      * @param op The reduction operation to perform. Supported operations are MAX, MIN, ARGMAX, and ARGMIN.
-     * @return A Tensor<U> of shape (num_rows, 1) containing the reduced values or indices.
+     * @return A Tensor<U> of shape (num_rows) containing the reduced values or indices.
      * @throws runtime_error if the tensor's number of dimensions is greater than 2.
      */
-
     template <typename U = T>
     Tensor<U> reduce_impl(ReduceOp op) const
     {
-        const size_t ndim = this->ndim();
-
-        if (ndim > 2)
+        if (this->ndim() > 2)
         {
             throw std::runtime_error("Only 1D and 2D tensors are supported for reduce");
         }
 
-        // Determine tensor dimensions
-        const size_t num_rows = (ndim == 2) ? this->shape_[0] : 1;
-        const size_t num_cols = (ndim == 2) ? this->shape_[1] : this->shape_[0];
+        return this->reduce_dims_impl<U>(op, {-1}, false);
+    }
+
+    // Minimum number of input elements handled by a task of the parallel reductions
+    static constexpr size_t PARALLEL_REDUCE_NUMEL = 1 << 15;
 
-        vector<U> result(num_rows);
+    // Number of columns of the result accumulated at once when the innermost dimension is kept (fits in L1 with the input rows)
+    static constexpr size_t REDUCE_COLUMN_BLOCK = 1024;
 
-        for (size_t i = 0; i < num_rows; ++i)
+    /**
+     * Reduces the tensor over the given dimensions (see ReducePlan for the traversal order).
+     *
+     * Every element of the result is reduced by a single thread, in the same order whatever the number of threads,
+     * so the result is deterministic. The tasks of parallel_for are:
+     * - inner reduction (the innermost dimension is reduced): blocks of elements of the result, each one reduced from
+     *   contiguous rows with the SIMD kernels
+     * - outer reduction (the innermost dimension is kept): blocks of columns of the result, into which the input rows are
+     *   accumulated one after the other (stride-1 adds for both the input and the result)
+     *
+     * @tparam U The data type of the result (size_t for ARGMAX and ARGMIN).
+     * @param op The reduction. ARGMAX and ARGMIN reduce a single dimension.
+     * @param center For SQUARED_DEVIATION, the contiguous center of each element of the result.
+     */
+    template <typename U = T>
+    Tensor<U> reduce_dims_impl(ReduceOp op, const vector<int64_t> &dims, bool keepdim, const T *center = nullptr) const
+    {
+        if constexpr (is_half_v<T>)
         {
-            // Calculate base offset for current row
-            size_t row_offset = this->offset_;
-            if (ndim == 2)
+            // 16-bit floats are reduced in float, and the result is rounded once
+            using V = std::conditional_t<std::is_same_v<U, T>, float, U>;
+            const Tensor<V> reduced = this->template dtype<float>().template reduce_dims_impl<V>(op, dims, keepdim);
+
+            if constexpr (std::is_same_v<U, T>)
+            {
+                return reduced.template dtype<T>();
+            }
+            else
             {
-                row_offset += i * this->strides_[0];
+                return reduced;
             }
+        }
+        else
+        {
+            const ReducePlan plan(this->shape_, this->strides_, dims, keepdim);
 
-            T extreme_val = (*this->data_)[row_offset];
-            size_t extreme_idx = 0;
+            Tensor<U> result = Tensor<U>::empty(plan.out_shape);
 
-            // Process elements using stride-aware indexing
-            for (size_t j = 1; j < num_cols; ++j)
+            if (plan.out_numel == 0)
             {
-                size_t elem_offset = row_offset;
-                if (ndim == 2)
+                return result;
+            }
+
+            if (plan.reduce_numel == 0 && op != ReduceOp::SUM && op != ReduceOp::SQUARED_DEVIATION)
+            {
+                throw runtime_error("Cannot reduce over an empty dimension");
+            }
+
+            U *out = result.data_->data();
+
+            // The operation is selected once here, so that the element loops do not branch on it
+            switch (op)
+            {
+            case ReduceOp::SUM:
+                this->reduce_kernel<U, ReduceOp::SUM>(plan, out, center);
+                break;
+            case ReduceOp::MAX:
+                this->reduce_kernel<U, ReduceOp::MAX>(plan, out, center);
+                break;
+            case ReduceOp::MIN:
+                this->reduce_kernel<U, ReduceOp::MIN>(plan, out, center);
+                break;
+            case ReduceOp::ARGMAX:
+                this->reduce_kernel<U, ReduceOp::ARGMAX>(plan, out, center);
+                break;
+            case ReduceOp::ARGMIN:
+                this->reduce_kernel<U, ReduceOp::ARGMIN>(plan, out, center);
+                break;
+            case ReduceOp::SQUARED_DEVIATION:
+                this->reduce_kernel<U, ReduceOp::SQUARED_DEVIATION>(plan, out, center);
+                break;
+            }
+
+            return result;
+        }
+    }
+
+    template <typename U, ReduceOp Op>
+    void reduce_kernel(const ReducePlan &plan, U *out, const T *center) const
+    {
+        constexpr bool is_arg = (Op == ReduceOp::ARGMAX || Op == ReduceOp::ARGMIN);
+        constexpr bool is_max = (Op == ReduceOp::MAX || Op == ReduceOp::ARGMAX);
+        constexpr bool is_sum = (Op == ReduceOp::SUM || Op == ReduceOp::SQUARED_DEVIATION);
+
+        const T *data = this->data_->data() + this->offset_;
+
+        // The reduced dimensions, relative to the first element reduced into an element of the result
+        const TensorIterator<1> reduced_iter(plan.reduced_shape, {plan.reduced_strides}, {0});
+
+        // ARGMAX and ARGMIN reduce a single dimension, whose stride is the distance between two candidates
+        const size_t arg_stride = plan.reduced_strides.empty() ? 0 : plan.reduced_strides[0];
+
+        const size_t num_kept = plan.kept_shape.size();
+
+        if (plan.inner)
+        {
+            // Reduce the element of the result at out_offset, from the input elements starting at in_offset
+            auto reduce_one = [&](size_t in_offset, size_t out_offset) -> U
+            {
+                const T *base = data + in_offset;
+
+                if constexpr (is_arg)
                 {
-                    elem_offset += j * this->strides_[1];
+                    // a single pass keeping the first occurrence of the extreme value. A NaN never compares greater or smaller,
+                    // so it is skipped (and a NaN in the first position is kept), the same on every instruction set
+                    T extreme_val = base[0];
+                    size_t extreme_idx = 0;
+
+                    for (size_t j = 1; j < plan.reduce_numel; ++j)
+                    {
+                        const T &val = base[j * arg_stride];
+
+                        if (is_max ? val > extreme_val : val < extreme_val)
+                        {
+                            extreme_val = val;
+                            extreme_idx = j;
+                        }
+                    }
+                    return static_cast<U>(extreme_idx);
                 }
                 else
                 {
-                    elem_offset += j * this->strides_[0];
+                    T acc = is_sum ? static_cast<T>(0) : base[0];
+                    const T mean = (Op == ReduceOp::SQUARED_DEVIATION) ? center[out_offset] : static_cast<T>(0);
+
+                    reduced_iter.for_each([&](const array<size_t, 1> &offsets, size_t n, const array<size_t, 1> &strides)
+                                          {
+                        const T *row = base + offsets[0];
+
+                        if constexpr (Op == ReduceOp::SUM)
+                        {
+                            if (strides[0] == 1)
+                            {
+                                // blocked like sum(), so a full reduction gives the same bits as sum()
+                                acc += summation::sum(row, n);
+                                return;
+                            }
+                        }
+
+                        if constexpr (std::is_same_v<T, float> && !is_sum)
+                        {
+                            if (strides[0] == 1)
+                            {
+                                const T val = is_max ? simd::max(row, n) : simd::min(row, n);
+                                acc = (is_max ? val > acc : val < acc) ? val : acc;
+                                return;
+                            }
+                        }
+
+                        for (size_t i = 0; i < n; ++i)
+                        {
+                            const T &val = row[i * strides[0]];
+
+                            if constexpr (Op == ReduceOp::SUM)
+                            {
+                                acc += val;
+                            }
+                            else if constexpr (Op == ReduceOp::SQUARED_DEVIATION)
+                            {
+                                acc += (val - mean) * (val - mean);
+                            }
+                            else
+                            {
+                                acc = (is_max ? val > acc : val < acc) ? val : acc;
+                            }
+                        } });
+
+                    return acc;
                 }
+            };
+
+            const size_t grain = std::max<size_t>(1, PARALLEL_REDUCE_NUMEL / std::max<size_t>(1, plan.reduce_numel));
+
+            parallel_for(0, plan.out_numel, grain, [&](size_t begin, size_t end)
+                         {
+                // Offsets of the first element of the block, then advanced like an odometer
+                DimVector idxs = linear_to_multi_idxs(begin, plan.kept_shape);
+                size_t in_offset = 0;
+                size_t out_offset = 0;
+                for (size_t d = 0; d < num_kept; ++d)
+                {
+                    in_offset += idxs[d] * plan.kept_strides[d];
+                    out_offset += idxs[d] * plan.kept_out_strides[d];
+                }
+
+                for (size_t i = begin; i < end; ++i)
+                {
+                    out[out_offset] = reduce_one(in_offset, out_offset);
+
+                    for (int64_t d = static_cast<int64_t>(num_kept) - 1; d >= 0; --d)
+                    {
+                        in_offset += plan.kept_strides[d];
+                        out_offset += plan.kept_out_strides[d];
+
+                        if (++idxs[d] < plan.kept_shape[d])
+                        {
+                            break;
+                        }
+
+                        in_offset -= plan.kept_strides[d] * plan.kept_shape[d];
+                        out_offset -= plan.kept_out_strides[d] * plan.kept_shape[d];
+                        idxs[d] = 0;
+                    }
+                } });
+
+            return;
+        }
 
-                bool update = false;
-                switch (op)
+        // The innermost dimension is kept: accumulate the input rows into blocks of columns of the result
+        const size_t num_cols = plan.kept_shape[num_kept - 1];
+        const size_t in_col_stride = plan.kept_strides[num_kept - 1];
+        const size_t out_col_stride = plan.kept_out_strides[num_kept - 1];
+
+        const size_t block = std::min(num_cols, REDUCE_COLUMN_BLOCK);
+        const size_t blocks_per_row = (num_cols + block - 1) / block;
+        const size_t num_rows = plan.out_numel / num_cols;
+
+        const size_t grain = std::max<size_t>(1, PARALLEL_REDUCE_NUMEL / std::max<size_t>(1, block * plan.reduce_numel));
+
+        // The best values of ARGMAX / ARGMIN, next to their indices in the result
+        using ExtremeValues = array<T, is_arg ? REDUCE_COLUMN_BLOCK : 1>;
+
+        parallel_for(0, num_rows * blocks_per_row, grain, [&](size_t begin, size_t end)
+                     {
+            ExtremeValues extreme_vals;
+
+            for (size_t task = begin; task < end; ++task)
+            {
+                const size_t col = (task % blocks_per_row) * block;
+                const size_t n = std::min(block, num_cols - col);
+
+                size_t row = task / blocks_per_row;
+                size_t in_offset = col * in_col_stride;
+                size_t out_offset = col * out_col_stride;
+                for (int64_t d = static_cast<int64_t>(num_kept) - 2; d >= 0; --d)
                 {
-                case ReduceOp::MAX:
-                case ReduceOp::ARGMAX:
-                    update = (*this->data_)[elem_offset] > extreme_val;
-                    break;
-                case ReduceOp::MIN:
-                case ReduceOp::ARGMIN:
-                    update = (*this->data_)[elem_offset] < extreme_val;
-                    break;
+                    in_offset += (row % plan.kept_shape[d]) * plan.kept_strides[d];
+                    out_offset += (row % plan.kept_shape[d]) * plan.kept_out_strides[d];
+                    row /= plan.kept_shape[d];
                 }
 
-                if (update)
+                const T *in_row = data + in_offset;
+                U *out_row = out + out_offset;
+
+                if constexpr (is_arg)
+                {
+                    for (size_t j = 0; j < n; ++j)
+                    {
+                        extreme_vals[j] = in_row[j * in_col_stride];
+                        out_row[j * out_col_stride] = 0;
+                    }
+
+                    for (size_t k = 1; k < plan.reduce_numel; ++k)
+                    {
+                        const T *candidate = in_row + k * arg_stride;
+                        for (size_t j = 0; j < n; ++j)
+                        {
+                            const T &val = candidate[j * in_col_stride];
+                            if (is_max ? val > extreme_vals[j] : val < extreme_vals[j])
+                            {
+                                extreme_vals[j] = val;
+                                out_row[j * out_col_stride] = k;
+                            }
+                        }
+                    }
+                    continue;
+                }
+                else
                 {
-                    extreme_val = (*this->data_)[elem_offset];
-                    extreme_idx = j;
+                    const T *center_row = (Op == ReduceOp::SQUARED_DEVIATION) ? center + out_offset : nullptr;
+
+                    for (size_t j = 0; j < n; ++j)
+                    {
+                        out_row[j * out_col_stride] = is_sum ? static_cast<T>(0) : in_row[j * in_col_stride];
+                    }
+
+                    reduced_iter.for_each([&](const array<size_t, 1> &offsets, size_t count, const array<size_t, 1> &strides)
+                                          {
+                        for (size_t k = 0; k < count; ++k)
+                        {
+                            const T *src = in_row + offsets[0] + k * strides[0];
+
+                            if constexpr (std::is_same_v<T, float> && std::is_same_v<U, float> && Op == ReduceOp::SUM)
+                            {
+                                if (in_col_stride == 1 && out_col_stride == 1)
+                                {
+                                    simd::binary(ArithmeticOp::ADD, out_row, src, out_row, n);
+                                    continue;
+                                }
+                            }
+
+                            for (size_t j = 0; j < n; ++j)
+                            {
+                                const T &val = src[j * in_col_stride];
+                                U &acc = out_row[j * out_col_stride];
+
+                                if constexpr (Op == ReduceOp::SUM)
+                                {
+                                    acc += val;
+                                }
+                                else if constexpr (Op == ReduceOp::SQUARED_DEVIATION)
+                                {
+                                    const T mean = center_row[j * out_col_stride];
+                                    acc += (val - mean) * (val - mean);
+                                }
+                                else
+                                {
+                                    acc = (is_max ? val > acc : val < acc) ? val : acc;
+                                }
+                            }
+                        } });
                 }
+            } });
+    }
+
+    /*
+    Element-wise arithmetic operation with NumPy-style broadcasting.
+
+    The two shapes are aligned from the last dimension. Each pair of dimensions must either be equal or one of them must be 1,
+    and missing leading dimensions are treated as 1. E.g. (B, M) + (1, M) -> (B, M), (B, C, H, W) * (C, 1, 1) -> (B, C, H, W)
+
+    The broadcast operand is never expanded in memory. Instead, its stride along every broadcast dimension is set to 0,
+    so the same element is read again while the result is filled.
+    */
+    Tensor<T> arithmetic_operation_impl(ArithmeticOp op, const Tensor<T> &other) const
+    {
+        // The operation is selected once here, so that the element loops do not branch on it
+        switch (op)
+        {
+        case ArithmeticOp::ADD:
+            return this->binary_op_impl(other, std::plus<T>());
+        case ArithmeticOp::SUB:
+            return this->binary_op_impl(other, std::minus<T>());
+        case ArithmeticOp::MUL:
+            return this->binary_op_impl(other, std::multiplies<T>());
+        case ArithmeticOp::DIV:
+            return this->binary_op_impl(other, std::divides<T>());
+        }
+        throw invalid_argument("Invalid arithmetic operation");
+    }
+
+    Tensor<T> arithmetic_operation_with_scaler_impl(ArithmeticOp op, const T &scaler) const
+    {
+        if constexpr (simd::has_kernels_v<T>)
+        {
+            if (this->is_contiguous())
+            {
+                Tensor<T> result = Tensor<T>::empty(this->shape_);
+                const T *a = this->data_->data() + this->offset_;
+                T *out = result.data_->data();
+
+                parallel_for(0, this->size(), PARALLEL_ELEMENTWISE_NUMEL, [&](size_t begin, size_t end)
+                             { simd::binary_scalar(op, a + begin, scaler, out + begin, end - begin); });
+                return result;
             }
+        }
 
-            switch (op)
+        switch (op)
+        {
+        case ArithmeticOp::ADD:
+            return this->unary_op_impl([scaler](const T &x)
+                                       { return x + scaler; });
+        case ArithmeticOp::SUB:
+            return this->unary_op_impl([scaler](const T &x)
+                                       { return x - scaler; });
+        case ArithmeticOp::MUL:
+            return this->unary_op_impl([scaler](const T &x)
+                                       { return x * scaler; });
+        case ArithmeticOp::DIV:
+            return this->unary_op_impl([scaler](const T &x)
+                                       { return x / scaler; });
+        }
+        throw invalid_argument("Invalid arithmetic operation");
+    }
+
+    // Minimum number of elements handled by a task of the parallel element-wise engines
+    static constexpr size_t PARALLEL_ELEMENTWISE_NUMEL = 1 << 15;
+
+    /**
+     * Element-wise engine for binary operations: result = op(this, other), with broadcasting.
+     *
+     * If both operands are contiguous and have the same shape, a single flat loop is used.
+     * Otherwise, a TensorIterator walks the operands row by row after coalescing their dimensions.
+     * The loops are kept free of branches and index computations, so the compiler can vectorize them.
+     * Above PARALLEL_ELEMENTWISE_NUMEL elements, they are split across threads, so op may be called concurrently.
+     *
+     * @tparam U The data type of the result. Defaults to the type of the current tensor.
+     * @param other The second operand. It must be broadcastable with the current tensor.
+     * @param op A callable taking two elements of type T and returning an element of type U.
+     * @return A new contiguous tensor of the broadcast shape.
+     */
+    template <typename U = T, typename Op>
+    Tensor<U> binary_op_impl(const Tensor<T> &other, Op op) const
+    {
+        const DimVector result_shape = broadcast_shapes(this->shape_, other.shape_);
+
+        Tensor<U> result = Tensor<U>::empty(result_shape);
+
+        U *out = result.data_->data();
+        const T *a = this->data_->data();
+        const T *b = other.data_->data();
+
+        // Fast path: both operands are stored contiguously with the same shape
+        if (this->shape_ == other.shape_ && this->is_contiguous() && other.is_contiguous())
+        {
+            a += this->offset_;
+            b += other.offset_;
+
+            parallel_for(0, result.size(), PARALLEL_ELEMENTWISE_NUMEL, [&](size_t begin, size_t end)
+                         { binary_row(a + begin, b + begin, out + begin, end - begin, op); });
+            return result;
+        }
+
+        const TensorIterator<3> iter(result_shape,
+                                     {result.strides_, this->broadcast_strides(result_shape), other.broadcast_strides(result_shape)},
+                                     {0, this->offset_, other.offset_});
+
+        iter.parallel_for_each([&](const array<size_t, 3> &offsets, size_t n, const array<size_t, 3> &strides)
+                               {
+            U *out_row = out + offsets[0];
+            const T *a_row = a + offsets[1];
+            const T *b_row = b + offsets[2];
+
+            if (strides[0] == 1 && strides[1] == 1 && strides[2] == 1)
             {
-            case ReduceOp::MAX:
-            case ReduceOp::MIN:
-                result[i] = static_cast<U>(extreme_val);
-                break;
-            case ReduceOp::ARGMAX:
-            case ReduceOp::ARGMIN:
-                result[i] = static_cast<U>(extreme_idx);
-                break;
+                binary_row(a_row, b_row, out_row, n, op);
+            }
+            else if (strides[0] == 1 && strides[1] == 1 && strides[2] == 0)
+            {
+                // other is broadcast along the row
+                binary_row_with_scaler(a_row, *b_row, out_row, n, op);
+            }
+            else if (strides[0] == 1 && strides[1] == 0 && strides[2] == 1)
+            {
+                // this is broadcast along the row
+                scaler_with_binary_row(*a_row, b_row, out_row, n, op);
+            }
+            else
+            {
+                for (size_t i = 0; i < n; ++i)
+                {
+                    out_row[i * strides[0]] = op(a_row[i * strides[1]], b_row[i * strides[2]]);
+                }
+            } }, PARALLEL_ELEMENTWISE_NUMEL);
+
+        return result;
+    }
+
+    // Contiguous row loops of binary_op_impl. The vectorized kernels are used for float arithmetic, and plain loops otherwise
+    template <typename U, typename Op>
+    static void binary_row(const T *a, const T *b, U *out, size_t n, Op op)
+    {
+        if constexpr (simd::vectorized_op<T, U, Op>::value)
+        {
+            simd::binary(simd::vectorized_op<T, U, Op>::op, a, b, out, n);
+        }
+        else
+        {
+            for (size_t i = 0; i < n; ++i)
+            {
+                out[i] = op(a[i], b[i]);
             }
         }
+    }
 
-        return Tensor<U>(result);
+    template <typename U, typename Op>
+    static void binary_row_with_scaler(const T *a, const T b, U *out, size_t n, Op op)
+    {
+        if constexpr (simd::vectorized_op<T, U, Op>::value)
+        {
+            simd::binary_scalar(simd::vectorized_op<T, U, Op>::op, a, b, out, n);
+        }
+        else
+        {
+            for (size_t i = 0; i < n; ++i)
+            {
+                out[i] = op(a[i], b);
+            }
+        }
     }
 
-    Tensor<T> arithmetic_operation_impl(ArithmeticOp op, const Tensor<T> &other) const
+    template <typename U, typename Op>
+    static void scaler_with_binary_row(const T a, const T *b, U *out, size_t n, Op op)
     {
-        if (other.shape_ != this->shape_)
+        if constexpr (simd::vectorized_op<T, U, Op>::value)
+        {
+            simd::scalar_binary(simd::vectorized_op<T, U, Op>::op, a, b, out, n);
+        }
+        else
         {
-            throw runtime_error("Shape mismatch in arithmetic operation");
+            for (size_t i = 0; i < n; ++i)
+            {
+                out[i] = op(a, b[i]);
+            }
         }
+    }
 
-        size_t ndim = this->ndim();
+    /**
+     * Element-wise engine for in-place binary operations: this = op(this, other), with other broadcast to the shape of this tensor.
+     *
+     * The result is written into the storage of this tensor through its strides, so no tensor is allocated.
+     * If the storage is shared with another tensor (a copy or a view), it is copied first (copy-on-write).
+     */
+    template <typename Op>
+    void inplace_binary_op_impl(const Tensor<T> &other, Op op)
+    {
+        if (broadcast_shapes(this->shape_, other.shape_) != this->shape_)
+        {
+            throw runtime_error("In-place operation cannot broadcast the tensor to a bigger shape");
+        }
 
-        Tensor<T> result(this->shape_, static_cast<T>(0));
+        this->detach();
 
-        // Precompute result's contiguous strides for index calculation
-        const vector<size_t> &result_strides = result.strides_;
+        T *a = this->data_->data();
+        const T *b = other.data_->data();
 
-        for (size_t i = 0; i < this->size(); i++)
+        // Fast path: both operands are stored contiguously with the same shape
+        if (this->shape_ == other.shape_ && this->is_contiguous() && other.is_contiguous())
         {
-            auto [a_offset, b_offset] = calculate_tensors_offsets(i, ndim, result_strides, other);
+            a += this->offset_;
+            b += other.offset_;
 
-            switch (op)
+            parallel_for(0, this->size(), PARALLEL_ELEMENTWISE_NUMEL, [&](size_t begin, size_t end)
+                         { binary_row(a + begin, b + begin, a + begin, end - begin, op); });
+            return;
+        }
+
+        const TensorIterator<2> iter(this->shape_, {this->strides_, other.broadcast_strides(this->shape_)}, {this->offset_, other.offset_});
+
+        iter.parallel_for_each([&](const array<size_t, 2> &offsets, size_t n, const array<size_t, 2> &strides)
+                               {
+            T *a_row = a + offsets[0];
+            const T *b_row = b + offsets[1];
+
+            if (strides[0] == 1 && strides[1] == 1)
             {
-            case ArithmeticOp::ADD:
-                (*result.data_)[i] = (*this->data_)[a_offset] + (*other.data_)[b_offset];
-                break;
-            case ArithmeticOp::SUB:
-                (*result.data_)[i] = (*this->data_)[a_offset] - (*other.data_)[b_offset];
-                break;
-            case ArithmeticOp::MUL:
-                (*result.data_)[i] = (*this->data_)[a_offset] * (*other.data_)[b_offset];
-                break;
-            case ArithmeticOp::DIV:
-                (*result.data_)[i] = (*this->data_)[a_offset] / (*other.data_)[b_offset];
-                break;
+                binary_row(a_row, b_row, a_row, n, op);
+            }
+            else if (strides[0] == 1 && strides[1] == 0)
+            {
+                // other is broadcast along the row
+                binary_row_with_scaler(a_row, *b_row, a_row, n, op);
             }
+            else
+            {
+                for (size_t i = 0; i < n; ++i)
+                {
+                    a_row[i * strides[0]] = op(a_row[i * strides[0]], b_row[i * strides[1]]);
+                }
+            } }, PARALLEL_ELEMENTWISE_NUMEL);
+    }
+
+    // Element-wise engine for in-place unary operations: this = func(this), written through the strides of this tensor
+    template <typename Func>
+    void inplace_unary_op_impl(Func func)
+    {
+        this->detach();
+
+        T *a = this->data_->data();
+
+        if (this->is_contiguous())
+        {
+            a += this->offset_;
+
+            parallel_for(0, this->size(), PARALLEL_ELEMENTWISE_NUMEL, [&](size_t begin, size_t end)
+                         {
+                for (size_t i = begin; i < end; ++i)
+                {
+                    a[i] = func(a[i]);
+                } });
+            return;
         }
-        return result;
+
+        const TensorIterator<1> iter(this->shape_, {this->strides_}, {this->offset_});
+
+        iter.parallel_for_each([&](const array<size_t, 1> &offsets, size_t n, const array<size_t, 1> &strides)
+                               {
+            T *a_row = a + offsets[0];
+
+            if (strides[0] == 1)
+            {
+                for (size_t i = 0; i < n; ++i)
+                {
+                    a_row[i] = func(a_row[i]);
+                }
+                return;
+            }
+
+            for (size_t i = 0; i < n; ++i)
+            {
+                a_row[i * strides[0]] = func(a_row[i * strides[0]]);
+            } }, PARALLEL_ELEMENTWISE_NUMEL);
     }
 
-    Tensor<T> arithmetic_operation_with_scaler_impl(ArithmeticOp op, const T &scaler) const
+    void inplace_arithmetic_operation_impl(ArithmeticOp op, const Tensor<T> &other)
     {
-        Tensor<T> result = *this;
+        switch (op)
+        {
+        case ArithmeticOp::ADD:
+            return this->inplace_binary_op_impl(other, std::plus<T>());
+        case ArithmeticOp::SUB:
+            return this->inplace_binary_op_impl(other, std::minus<T>());
+        case ArithmeticOp::MUL:
+            return this->inplace_binary_op_impl(other, std::multiplies<T>());
+        case ArithmeticOp::DIV:
+            return this->inplace_binary_op_impl(other, std::divides<T>());
+        }
+        throw invalid_argument("Invalid arithmetic operation");
+    }
 
-        for (size_t i = 0; i < this->size(); i++)
+    void inplace_arithmetic_operation_with_scaler_impl(ArithmeticOp op, const T &scaler)
+    {
+        if constexpr (simd::has_kernels_v<T>)
         {
-            switch (op)
+            if (this->data_ != nullptr && this->is_contiguous())
             {
-            case ArithmeticOp::ADD:
-                (*result.data_)[i] += scaler;
-                break;
-            case ArithmeticOp::SUB:
-                (*result.data_)[i] -= scaler;
-                break;
-            case ArithmeticOp::MUL:
-                (*result.data_)[i] *= scaler;
-                break;
-            case ArithmeticOp::DIV:
-                (*result.data_)[i] /= scaler;
-                break;
+                this->detach();
+
+                T *a = this->data_->data() + this->offset_;
+
+                parallel_for(0, this->size(), PARALLEL_ELEMENTWISE_NUMEL, [&](size_t begin, size_t end)
+                             { simd::binary_scalar(op, a + begin, scaler, a + begin, end - begin); });
+                return;
             }
         }
+
+        switch (op)
+        {
+        case ArithmeticOp::ADD:
+            return this->inplace_unary_op_impl([scaler](const T &x)
+                                               { return x + scaler; });
+        case ArithmeticOp::SUB:
+            return this->inplace_unary_op_impl([scaler](const T &x)
+                                               { return x - scaler; });
+        case ArithmeticOp::MUL:
+            return this->inplace_unary_op_impl([scaler](const T &x)
+                                               { return x * scaler; });
+        case ArithmeticOp::DIV:
+            return this->inplace_unary_op_impl([scaler](const T &x)
+                                               { return x / scaler; });
+        }
+        throw invalid_argument("Invalid arithmetic operation");
+    }
+
+    /**
+     * Element-wise engine for unary operations: result = func(this).
+     *
+     * @tparam U The data type of the result. Defaults to the type of the current tensor.
+     * @param func A callable taking an element of type T and returning an element of type U.
+     * @return A new contiguous tensor with the same shape as the current tensor.
+     */
+    template <typename U = T, typename Func>
+    Tensor<U> unary_op_impl(Func func) const
+    {
+        Tensor<U> result = Tensor<U>::empty(this->shape_);
+
+        U *out = result.data_->data();
+        const T *a = this->data_->data();
+
+        // Fast path: the tensor is stored contiguously
+        if (this->is_contiguous())
+        {
+            a += this->offset_;
+
+            parallel_for(0, result.size(), PARALLEL_ELEMENTWISE_NUMEL, [&](size_t begin, size_t end)
+                         {
+                for (size_t i = begin; i < end; ++i)
+                {
+                    out[i] = func(a[i]);
+                } });
+            return result;
+        }
+
+        const TensorIterator<2> iter(this->shape_, {result.strides_, this->strides_}, {0, this->offset_});
+
+        iter.parallel_for_each([&](const array<size_t, 2> &offsets, size_t n, const array<size_t, 2> &strides)
+                               {
+            U *out_row = out + offsets[0];
+            const T *a_row = a + offsets[1];
+
+            if (strides[0] == 1 && strides[1] == 1)
+            {
+                for (size_t i = 0; i < n; ++i)
+                {
+                    out_row[i] = func(a_row[i]);
+                }
+                return;
+            }
+
+            for (size_t i = 0; i < n; ++i)
+            {
+                out_row[i * strides[0]] = func(a_row[i * strides[1]]);
+            } }, PARALLEL_ELEMENTWISE_NUMEL);
+
         return result;
     }
+
+    /**
+     * Element-wise conversion to the type V, used by dtype().
+     * Between float and the 16-bit floating-point types, a contiguous tensor is converted with the vectorized kernels of simd::convert.
+     *
+     * @return A new contiguous tensor with the same shape as the current tensor.
+     */
+    template <typename V>
+    Tensor<V> convert_impl() const
+    {
+        if constexpr (simd::has_conversion_v<T, V>)
+        {
+            if (this->is_contiguous())
+            {
+                Tensor<V> result = Tensor<V>::empty(this->shape_);
+                const T *a = this->data_->data() + this->offset_;
+                V *out = result.data_->data();
+
+                parallel_for(0, this->size(), PARALLEL_ELEMENTWISE_NUMEL, [&](size_t begin, size_t end)
+                             { simd::convert(a + begin, out + begin, end - begin); });
+                return result;
+            }
+        }
+
+        return this->unary_op_impl<V>([](const T &x)
+                                      { return static_cast<V>(x); });
+    }
+
     // Helper function to cacluate the stride of the tensor
     void compute_contiguous_strides()
     {
@@ -247,34 +904,139 @@ private:
         }
     }
 
-    std::tuple<size_t, size_t> calculate_tensors_offsets(const size_t idx, const size_t ndim, const vector<size_t> &result_strides, const Tensor<T> &other) const
+    // Dimension dim of this tensor, counted from the end if negative
+    size_t normalize_dim(int64_t dim, const char *op) const
     {
-        vector<size_t> indices(ndim);
+        const int64_t ndim = static_cast<int64_t>(this->ndim());
+        if (dim < -ndim || dim >= ndim)
+        {
+            throw out_of_range(string(op) + ": dimension " + to_string(dim) + " is out of range for a tensor of " + to_string(ndim) + " dimensions");
+        }
+        return static_cast<size_t>(dim < 0 ? dim + ndim : dim);
+    }
 
-        size_t remaining = idx;
+    static string shape_to_string(const DimVector &shape)
+    {
+        ostringstream os;
+        os << shape;
+        return os.str();
+    }
 
-        for (int64_t dim = 0; dim < ndim; ++dim)
+    // Check that index fits this tensor for gather / scatter_add_ along dimension d: same rank, no larger sizes in the other dimensions, and indices in range
+    void check_index_tensor(const Tensor<size_t> &index, size_t d, const char *op) const
+    {
+        if (index.ndim() != this->ndim())
         {
-            indices[dim] = remaining / result_strides[dim];
-            remaining %= result_strides[dim];
+            throw invalid_argument(string(op) + " expects an index of the rank of the tensor, got " + shape_to_string(index.shape_) + " and " +
+                                   shape_to_string(this->shape_));
+        }
+        for (size_t k = 0; k < this->ndim(); ++k)
+        {
+            if (k != d && index.shape_[k] > this->shape_[k])
+            {
+                throw invalid_argument(string(op) + " expects an index no larger than the tensor outside of dimension " + to_string(d) + ", got " +
+                                       shape_to_string(index.shape_) + " and " + shape_to_string(this->shape_));
+            }
         }
 
-        // Calculate offsets using original tensors' strides
-        size_t a_offset = this->offset_;
-        size_t b_offset = other.offset_;
+        const Tensor<size_t> idx = index.contiguous();
+        const size_t *ind = idx.data();
+        const size_t extent = this->shape_[d];
+        for (size_t i = 0; i < idx.size(); ++i)
+        {
+            if (ind[i] >= extent)
+            {
+                throw out_of_range(string(op) + ": index " + to_string(ind[i]) + " is out of dimension " + to_string(d) + " of size " + to_string(extent));
+            }
+        }
+    }
 
-        for (int64_t dim = 0; dim < ndim; ++dim)
+    // Offsets with the given strides of the positions of the dimensions [begin, end) of shape, in row-major order
+    static vector<size_t> dim_offsets(const DimVector &shape, size_t begin, size_t end, const DimVector &strides)
+    {
+        vector<size_t> offsets = {0};
+        for (size_t d = end; d-- > begin;)
         {
-            a_offset += indices[dim] * this->strides_[dim];
-            b_offset += indices[dim] * other.strides_[dim];
+            // the positions of dimension d repeat the positions of the dimensions after it, shifted by k * strides[d]
+            const size_t n = offsets.size();
+            offsets.resize(n * shape[d]);
+            for (size_t k = shape[d]; k-- > 1;)
+            {
+                for (size_t m = 0; m < n; ++m)
+                {
+                    offsets[k * n + m] = offsets[m] + k * strides[d];
+                }
+            }
         }
+        return offsets;
+    }
+
+    // Fill the tensor with fill(out, n), which writes n random floats to out
+    template <typename Fill>
+    Tensor<T> &random_fill_impl(Fill &&fill)
+    {
+        if (this->data_ == nullptr)
+        {
+            return *this;
+        }
+
+        // The old values are overwritten, so a shared storage is replaced instead of being copied first
+        if (this->data_.use_count() > 1)
+        {
+            *this = Tensor<T>::empty(this->shape_);
+        }
+
+        if constexpr (is_same_v<T, float>)
+        {
+            if (this->is_contiguous())
+            {
+                fill(this->data_->data() + this->offset_, this->size());
+                return *this;
+            }
+        }
+
+        // a view, or another element type: the numbers are generated contiguously, then copied through the strides
+        Tensor<float> values = Tensor<float>::empty(this->shape_);
+        fill(values.data_->data(), values.size());
 
-        return {a_offset, b_offset};
+        if constexpr (is_same_v<T, float>)
+        {
+            return this->copy_(values);
+        }
+        else
+        {
+            return this->copy_(values.template dtype<T>());
+        }
+    }
+
+    // Helper function to get the strides of the tensor when it is broadcast to target_shape. Broadcast dimensions have a stride of 0
+    DimVector broadcast_strides(const DimVector &target_shape) const
+    {
+        const size_t target_ndim = target_shape.size();
+        const size_t ndim = this->ndim();
+
+        DimVector strides(target_ndim, 0);
+
+        for (size_t i = 0; i < ndim; ++i)
+        {
+            const size_t target_dim = target_ndim - ndim + i;
+
+            if (this->shape_[i] == target_shape[target_dim])
+            {
+                strides[target_dim] = this->strides_[i];
+            }
+            else if (this->shape_[i] != 1)
+            {
+                throw runtime_error("Shape mismatch in broadcasting");
+            }
+        }
+
+        return strides;
     }
 
     // Helper to recursively flatten nested vectors and compute shapes
     template <typename V>
-    void flatten_vector(const std::vector<V> &vec, size_t depth = 0)
+    void flatten_vector(const std::vector<V> &vec, vector<T> &flat, size_t depth = 0)
     {
         // Add current level's size to shapes
         if (depth == this->shape_.size())
@@ -309,17 +1071,17 @@ private:
             // Recurse into nested vectors
             for (const auto &elem : vec)
             {
-                flatten_vector(elem, depth + 1);
+                flatten_vector(elem, flat, depth + 1);
             }
         }
         else
         {
             // Ensure leaf elements match the Tensor's data type
             // static_assert(std::is_same_v<V, T>, "Element type must match Tensor type");
-            this->data_->reserve(this->data_->size() + vec.size());
+            flat.reserve(flat.size() + vec.size());
             for (const auto &elem : vec)
             {
-                this->data_->emplace_back(static_cast<T>(elem));
+                flat.emplace_back(static_cast<T>(elem));
             }
         }
     }
@@ -328,6 +1090,57 @@ private:
     template <typename U, typename V>
     friend Tensor<V> dtype_impl(const Tensor<U> &tensor);
 
+    // Tensors of different data types can access each other's private members (e.g. for operations returning Tensor<int>)
+    template <typename U>
+    friend class Tensor;
+
+    // Leaves of lazy expressions read the storage directly (see tensor_expr.hpp)
+    template <typename U>
+    friend class TensorRef;
+
+    // Quantized tensors read and write the buffers of the float tensors they are converted from and to (see qtensor.hpp)
+    template <typename Q>
+    friend class QTensor;
+
+    // Minimum number of elements for a fused expression to be evaluated in parallel
+    static constexpr size_t PARALLEL_EXPR_NUMEL = 1 << 16;
+
+    // Evaluate the expression into the storage of this tensor, which is laid out contiguously with the shape of the expression
+    template <typename E>
+    void evaluate_expr(const E &expr)
+    {
+        T *out = this->data_->data() + this->offset_;
+        const size_t numel = this->size();
+
+        if (expr.is_flat(this->shape_))
+        {
+            expr.bind_flat();
+
+            if (numel >= PARALLEL_EXPR_NUMEL)
+            {
+                parallel_for(0, numel, PARALLEL_EXPR_NUMEL / 4, [&](size_t begin, size_t end)
+                             {
+                                 for (size_t i = begin; i < end; ++i)
+                                 {
+                                     out[i] = expr.flat(i);
+                                 } });
+            }
+            else
+            {
+                for (size_t i = 0; i < numel; ++i)
+                {
+                    out[i] = expr.flat(i);
+                }
+            }
+            return;
+        }
+
+        // Broadcast or strided operands are walked with cursors, in the row-major order of the output
+        size_t i = 0;
+        expr_ops::for_each_element(expr, this->shape_, [&](const T &value)
+                                   { out[i++] = value; });
+    }
+
 public:
     /*
     ====================== Constructors ======================
@@ -339,24 +1152,25 @@ public:
     template <typename V>
     Tensor(const std::vector<V> &input)
     {
-        this->data_ = make_shared<vector<T>>();
-        flatten_vector(input);
+        vector<T> flat;
+        flatten_vector(input, flat);
+        this->data_ = make_storage<T>(flat.begin(), flat.end());
         this->compute_contiguous_strides();
     }
 
     // Scaler constructor
     Tensor(const T &value)
     {
-        this->shape_ = vector<size_t>{1};
-        this->data_ = make_shared<vector<T>>(1, value);
+        this->shape_ = DimVector{1};
+        this->data_ = make_storage<T>(1, value);
         this->compute_contiguous_strides();
     }
 
     // 1D tensor constructor
     Tensor(const initializer_list<T> &data_1d)
     {
-        this->data_ = make_shared<vector<T>>(data_1d.begin(), data_1d.end());
-        this->shape_ = vector<size_t>{data_1d.size()};
+        this->data_ = make_storage<T>(data_1d.begin(), data_1d.end());
+        this->shape_ = DimVector{data_1d.size()};
         this->compute_contiguous_strides();
     }
 
@@ -365,14 +1179,18 @@ public:
     {
         const size_t n = data_2d.size(), m = data_2d.begin()->size();
 
-        this->shape_ = vector<size_t>{n, m};
+        this->shape_ = DimVector{n, m};
 
-        this->data_ = make_shared<vector<T>>();
-        this->data_->reserve(n * m); // Optimize memory allocation
+        this->data_ = make_storage<T>(n * m);
+        T *out = this->data_->data();
 
         for (const initializer_list<T> &row : data_2d)
         {
-            this->data_->insert(this->data_->end(), row.begin(), row.end());
+            if (row.size() != m)
+            {
+                throw invalid_argument("Inconsistent shape in nested initializer lists");
+            }
+            out = std::copy(row.begin(), row.end(), out);
         }
         this->compute_contiguous_strides();
     }
@@ -382,16 +1200,24 @@ public:
     {
         const size_t n = data_3d.size(), m = data_3d.begin()->size(), l = data_3d.begin()->begin()->size();
 
-        this->shape_ = vector<size_t>{n, m, l};
+        this->shape_ = DimVector{n, m, l};
 
-        this->data_ = make_shared<vector<T>>();
-        this->data_->reserve(n * m * l); // Optimize memory allocation
+        this->data_ = make_storage<T>(n * m * l);
+        T *out = this->data_->data();
 
         for (const initializer_list<initializer_list<T>> &matrix : data_3d)
         {
+            if (matrix.size() != m)
+            {
+                throw invalid_argument("Inconsistent shape in nested initializer lists");
+            }
             for (const initializer_list<T> &row : matrix)
             {
-                this->data_->insert(this->data_->end(), row.begin(), row.end());
+                if (row.size() != l)
+                {
+                    throw invalid_argument("Inconsistent shape in nested initializer lists");
+                }
+                out = std::copy(row.begin(), row.end(), out);
             }
         }
         this->compute_contiguous_strides();
@@ -402,18 +1228,30 @@ public:
     {
         const size_t n = data_4d.size(), m = data_4d.begin()->size(), l = data_4d.begin()->begin()->size(), k = data_4d.begin()->begin()->begin()->size();
 
-        this->shape_ = vector<size_t>{n, m, l, k};
+        this->shape_ = DimVector{n, m, l, k};
 
-        this->data_ = make_shared<vector<T>>();
-        this->data_->reserve(n * m * l * k); // Optimize memory allocation
+        this->data_ = make_storage<T>(n * m * l * k);
+        T *out = this->data_->data();
 
         for (const initializer_list<initializer_list<initializer_list<T>>> &tensor : data_4d)
         {
+            if (tensor.size() != m)
+            {
+                throw invalid_argument("Inconsistent shape in nested initializer lists");
+            }
             for (const initializer_list<initializer_list<T>> &matrix : tensor)
             {
+                if (matrix.size() != l)
+                {
+                    throw invalid_argument("Inconsistent shape in nested initializer lists");
+                }
                 for (const initializer_list<T> &row : matrix)
                 {
-                    this->data_->insert(this->data_->end(), row.begin(), row.end());
+                    if (row.size() != k)
+                    {
+                        throw invalid_argument("Inconsistent shape in nested initializer lists");
+                    }
+                    out = std::copy(row.begin(), row.end(), out);
                 }
             }
         }
@@ -421,7 +1259,7 @@ public:
     }
 
     // certin value constructor
-    Tensor(const vector<size_t> &shape, const T &value)
+    Tensor(const DimVector &shape, const T &value)
     {
         this->shape_ = shape;
         size_t size = 1;
@@ -430,14 +1268,15 @@ public:
             size *= dim;
         }
 
-        this->data_ = make_shared<vector<T>>(size, value);
+        this->data_ = make_storage<T>(size, value);
         this->compute_contiguous_strides();
     }
 
     // copy constructor
     // Direct initialization with member initializer lists is more efficient than first default-constructing members and then assigning values.
+    // The data is shared with other, and it is only copied when one of them is mutated (copy-on-write).
     Tensor(const Tensor<T> &other)
-        : data_(make_shared<vector<T>>(*(other.data_))),
+        : data_(other.data_),
           shape_(other.shape_),
           strides_(other.strides_),
           offset_(other.offset_),
@@ -458,29 +1297,40 @@ public:
         other.size_ = -1;
     }
 
+    // Evaluate a lazy expression (see tensor_expr.hpp) into a new tensor, in a single pass
+    template <typename E>
+    Tensor(const TensorExpr<E> &expr)
+    {
+        DimVector shape;
+        expr.self().broadcast_shape(shape);
+
+        *this = Tensor<T>::empty(shape);
+        this->evaluate_expr(expr.self());
+    }
+
     /*
     ====================== Arithmetic operations ======================
     */
 
-    // Add two tensors with same shape, element-wise
+    // Add two tensors with broadcastable shapes, element-wise
     inline Tensor<T> add(const Tensor &other) const
     {
         return arithmetic_operation_impl(ArithmeticOp::ADD, other);
     }
 
-    // Subtract two tensors with same shape, element-wise
+    // Subtract two tensors with broadcastable shapes, element-wise
     inline Tensor<T> sub(const Tensor<T> &other) const
     {
         return arithmetic_operation_impl(ArithmeticOp::SUB, other);
     }
 
-    // Multiply two tensors with same shape, element-wise
+    // Multiply two tensors with broadcastable shapes, element-wise
     inline Tensor<T> mul(const Tensor<T> &other) const
     {
         return arithmetic_operation_impl(ArithmeticOp::MUL, other);
     }
 
-    // Divide two tensors with same shape, element-wise
+    // Divide two tensors with broadcastable shapes, element-wise
     inline Tensor<T> div(const Tensor<T> &other) const
     {
         return arithmetic_operation_impl(ArithmeticOp::DIV, other);
@@ -510,18 +1360,177 @@ public:
         return arithmetic_operation_with_scaler_impl(ArithmeticOp::DIV, scaler);
     }
 
+    /*
+    ====================== In-place operations ======================
+
+    The methods ending with an underscore modify the tensor in place and return a reference to it, without allocating a new tensor.
+    The other operand is broadcast to the shape of the tensor, and the result is written through the strides of the tensor.
+    If the storage is shared with another tensor (a copy or a view), it is copied first (copy-on-write), so the other tensors are not modified.
+    */
+
+    // this = this + alpha * other
+    Tensor<T> &add_(const Tensor<T> &other, const T &alpha = static_cast<T>(1))
+    {
+        if (alpha == static_cast<T>(1))
+        {
+            this->inplace_arithmetic_operation_impl(ArithmeticOp::ADD, other);
+        }
+        else
+        {
+            this->inplace_binary_op_impl(other, [alpha](const T &x, const T &y)
+                                         { return x + alpha * y; });
+        }
+        return *this;
+    }
+
+    // this = this - alpha * other
+    Tensor<T> &sub_(const Tensor<T> &other, const T &alpha = static_cast<T>(1))
+    {
+        if (alpha == static_cast<T>(1))
+        {
+            this->inplace_arithmetic_operation_impl(ArithmeticOp::SUB, other);
+        }
+        else
+        {
+            this->inplace_binary_op_impl(other, [alpha](const T &x, const T &y)
+                                         { return x - alpha * y; });
+        }
+        return *this;
+    }
+
+    // this = this * other
+    Tensor<T> &mul_(const Tensor<T> &other)
+    {
+        this->inplace_arithmetic_operation_impl(ArithmeticOp::MUL, other);
+        return *this;
+    }
+
+    // this = this / other
+    Tensor<T> &div_(const Tensor<T> &other)
+    {
+        this->inplace_arithmetic_operation_impl(ArithmeticOp::DIV, other);
+        return *this;
+    }
+
+    // Add the given scaler to all elements in place
+    Tensor<T> &add_(const T &scaler)
+    {
+        this->inplace_arithmetic_operation_with_scaler_impl(ArithmeticOp::ADD, scaler);
+        return *this;
+    }
+
+    // Subtract the given scaler from all elements in place
+    Tensor<T> &sub_(const T &scaler)
+    {
+        this->inplace_arithmetic_operation_with_scaler_impl(ArithmeticOp::SUB, scaler);
+        return *this;
+    }
+
+    // Multiply all elements by the given scaler in place
+    Tensor<T> &mul_(const T &scaler)
+    {
+        this->inplace_arithmetic_operation_with_scaler_impl(ArithmeticOp::MUL, scaler);
+        return *this;
+    }
+
+    // Divide all elements by the given scaler in place
+    Tensor<T> &div_(const T &scaler)
+    {
+        this->inplace_arithmetic_operation_with_scaler_impl(ArithmeticOp::DIV, scaler);
+        return *this;
+    }
+
+    // Clamp all elements into [min_value, max_value] in place
+    Tensor<T> &clamp_(const T &min_value, const T &max_value)
+    {
+        if (min_value > max_value)
+        {
+            throw invalid_argument("min_value must not be greater than max_value");
+        }
+
+        this->inplace_unary_op_impl([min_value, max_value](const T &x)
+                                    { return x < min_value ? min_value : (x > max_value ? max_value : x); });
+        return *this;
+    }
+
+    // Copy the elements of src (broadcast to the shape of this tensor) into this tensor
+    Tensor<T> &copy_(const Tensor<T> &src)
+    {
+        this->inplace_binary_op_impl(src, [](const T &, const T &y)
+                                     { return y; });
+        return *this;
+    }
+
+    // Set all elements to the given value
+    Tensor<T> &fill_(const T &value)
+    {
+        if (this->data_ == nullptr)
+        {
+            return *this;
+        }
+
+        // The old values are overwritten, so a shared storage is replaced instead of being copied first
+        if (this->data_.use_count() > 1)
+        {
+            *this = Tensor<T>(this->shape_, value);
+            return *this;
+        }
+
+        this->inplace_unary_op_impl([value](const T &)
+                                    { return value; });
+        return *this;
+    }
+
+    // Set all elements to zero
+    inline Tensor<T> &zero_()
+    {
+        return this->fill_(static_cast<T>(0));
+    }
+
+    /*
+    Random fills, drawn from gen (the global generator by default, see random.hpp) by a counter-based generator:
+    the elements are generated in parallel, and the result depends only on the seed and the position of the generator,
+    never on the number of threads. The random numbers are drawn in float, then converted to T.
+    */
+
+    // Fill the tensor with numbers uniformly distributed in [low, high)
+    Tensor<T> &uniform_(float low = 0.0f, float high = 1.0f, rng::Generator &gen = rng::default_generator())
+    {
+        return this->random_fill_impl([&](float *out, size_t n)
+                                      { rng::uniform(gen, out, n, low, high); });
+    }
+
+    // Fill the tensor with normally distributed numbers
+    Tensor<T> &normal_(float mean = 0.0f, float std = 1.0f, rng::Generator &gen = rng::default_generator())
+    {
+        return this->random_fill_impl([&](float *out, size_t n)
+                                      { rng::normal(gen, out, n, mean, std); });
+    }
+
+    // Fill the tensor with 1 with probability p, and 0 otherwise
+    Tensor<T> &bernoulli_(float p = 0.5f, rng::Generator &gen = rng::default_generator())
+    {
+        return this->random_fill_impl([&](float *out, size_t n)
+                                      { rng::bernoulli(gen, out, n, p); });
+    }
+
     /**
      * Matrix multiplication of two tensors.
      *
-     * The two tensors must have at least two dimensions. The leading dimensions (all except last two) must be equal.
-     * The last two dimensions must match the matrix multiplication dimensions.
-     * For example, if the first tensor has shape [a, b, n, m] and the second tensor has shape [a, b, m, p], the result will have shape [a, b, n, p].
+     * The two tensors must have at least two dimensions. The last two dimensions must match the matrix multiplication dimensions.
+     * The leading dimensions (all except last two) are the batch dimensions, and they are broadcast with the NumPy rules.
+     * For example:
+     * - [a, b, n, m] x [a, b, m, p] -> [a, b, n, p]
+     * - [a, b, n, m] x [m, p] -> [a, b, n, p]
+     * - [a, 1, n, m] x [b, m, p] -> [a, b, n, p]
      *
-     * The result is a tensor with the leading dimensions of the first tensor and the matrix multiplication result as the last two dimensions.
+     * The result is a tensor with the broadcast batch dimensions and the matrix multiplication result as the last two dimensions.
      *
-     * The total number of batches is the product of the leading dimensions.
-     *
-     * The matrix multiplication is performed batched, i.e., for each batch, a matrix multiplication is performed.
+     * The batches are walked with a coalesced iterator, so every run of batches with a constant stride is multiplied by one strided-batched call.
+     * Float matrices (and bf16 / fp16 ones, accumulated in float) are multiplied by the packed, multithreaded GEMM engine (see gemm.hpp), which runs
+     * many small matrices in parallel across the batches, and folds a batch multiplied by a shared matrix into a single GEMM.
+     * The operands are read in place through their strides, so a transposed operand (e.g. x.transpose().matmul(y)) is not copied:
+     * the engine packs a column-major operand along its columns instead of its rows.
      *
      * @param other The tensor to multiply with.
      * @return The result of the matrix multiplication.
@@ -536,23 +1545,9 @@ public:
             throw std::runtime_error("Tensors must have at least 2 dimensions for matrix multiplication");
         }
 
-        // Check leading dimensions (all except last two) are equal
         const size_t A_leading_ndim = A_ndim - 2;
         const size_t B_leading_ndim = B_ndim - 2;
 
-        if (A_leading_ndim != B_leading_ndim)
-        {
-            throw std::runtime_error("Number of leading dimensions must match");
-        }
-
-        vector<size_t> A_leading_shape(this->shape_.begin(), this->shape_.end() - 2);
-        vector<size_t> B_leading_shape(other.shape_.begin(), other.shape_.end() - 2);
-
-        if (A_leading_shape != B_leading_shape)
-        {
-            throw invalid_argument("Batch dimensions must match");
-        }
-
         // Extract matrix dimensions
         const size_t n = this->shape_[A_ndim - 2];
         const size_t m = this->shape_[A_ndim - 1];
@@ -564,67 +1559,101 @@ public:
             throw std::invalid_argument("Matrix dimension mismatch: last dimension of first tensor must match second last of second tensor");
         }
 
-        // Determine result shape: leading dimensions + [n, p]
-        vector<size_t> result_shapes = A_leading_shape;
+        DimVector A_leading_shape(this->shape_.begin(), this->shape_.end() - 2);
+        DimVector B_leading_shape(other.shape_.begin(), other.shape_.end() - 2);
+
+        DimVector batch_shape;
+        try
+        {
+            batch_shape = broadcast_shapes(A_leading_shape, B_leading_shape);
+        }
+        catch (const runtime_error &)
+        {
+            throw invalid_argument("Batch dimensions must match or be broadcastable");
+        }
+
+        const size_t batch_ndim = batch_shape.size();
+
+        // Determine result shape: batch dimensions + [n, p]
+        DimVector result_shapes = batch_shape;
         result_shapes.push_back(n);
         result_shapes.push_back(p);
 
-        Tensor<T> result(result_shapes, static_cast<T>(0));
+        // 16-bit floats are multiplied and accumulated in float, and the result is rounded once at the end
+        using Acc = std::conditional_t<is_half_v<T>, float, T>;
 
-        // Compute total number of batches (product of leading dimensions)
-        // may be we can use divisoin in stride to have O(1) time
-        size_t total_batches = 1;
-        for (const size_t &dim : A_leading_shape)
-        {
-            total_batches *= dim;
-        }
+        // Every element is written below, unless the inner dimension is empty
+        Tensor<Acc> result = m > 0 ? Tensor<Acc>::empty(result_shapes) : Tensor<Acc>(result_shapes, static_cast<Acc>(0));
 
-        for (size_t batch = 0; batch < total_batches; ++batch)
-        {
-            // Get multi_dimensional indices for this batch
-            vector<size_t> indices = linear_to_multi_idxs(batch, A_leading_shape);
+        // Strides of the batch dimensions, which are 0 along the broadcast dimensions
+        DimVector A_full_shape = batch_shape, B_full_shape = batch_shape;
+        A_full_shape.insert(A_full_shape.end(), {n, m});
+        B_full_shape.insert(B_full_shape.end(), {m, p});
 
-            // Compute offsets for A, B, and result
-            size_t A_offset = this->offset_;
-            size_t B_offset = other.offset_;
-            size_t result_offset = 0;
+        DimVector A_batch_strides = this->broadcast_strides(A_full_shape);
+        DimVector B_batch_strides = other.broadcast_strides(B_full_shape);
+        DimVector result_batch_strides = result.strides_;
 
-            for (size_t i = 0; i < A_leading_ndim; ++i)
+        A_batch_strides.resize(batch_ndim);
+        B_batch_strides.resize(batch_ndim);
+        result_batch_strides.resize(batch_ndim);
+
+        // Matrix strides of the operands
+        const size_t A_row_stride = this->strides_[A_leading_ndim], A_col_stride = this->strides_[A_leading_ndim + 1];
+        const size_t B_row_stride = other.strides_[B_leading_ndim], B_col_stride = other.strides_[B_leading_ndim + 1];
+
+        const T *A_data = this->data_->data();
+        const T *B_data = other.data_->data();
+        Acc *result_data = result.data_->data();
+
+        const TensorIterator<3> batch_iter(batch_shape,
+                                           {result_batch_strides, A_batch_strides, B_batch_strides},
+                                           {0, this->offset_, other.offset_});
+
+        // Each call covers batch_count batches, which are batch_strides apart in each operand
+        batch_iter.for_each([&](const array<size_t, 3> &offsets, size_t batch_count, const array<size_t, 3> &batch_strides)
+                            {
+            if constexpr (std::is_same_v<T, float> || is_half_v<T>)
             {
-                A_offset += indices[i] * this->strides_[i];
-                B_offset += indices[i] * other.strides_[i];
-                result_offset += indices[i] * result.strides_[i];
+                gemm::sgemm_strided_batched(batch_count, n, p, m,
+                                            1.0f,
+                                            A_data + offsets[1], A_row_stride, A_col_stride, batch_strides[1],
+                                            B_data + offsets[2], B_row_stride, B_col_stride, batch_strides[2],
+                                            0.0f,
+                                            result_data + offsets[0], p, 1, batch_strides[0]);
+                return;
             }
 
-            for (size_t i = 0; i < n; ++i)
+            for (size_t batch = 0; batch < batch_count; ++batch)
             {
-                for (size_t j = 0; j < p; ++j)
-                {
-                    T sum = static_cast<T>(0);
+                const T *A_matrix = A_data + offsets[1] + batch * batch_strides[1];
+                const T *B_matrix = B_data + offsets[2] + batch * batch_strides[2];
+                Acc *result_matrix = result_data + offsets[0] + batch * batch_strides[0];
 
-                    for (size_t k = 0; k < m; ++k)
+                for (size_t i = 0; i < n; ++i)
+                {
+                    for (size_t j = 0; j < p; ++j)
                     {
-                        // Calculate offsets in A and B
-                        size_t a_idx = A_offset +
-                                       i * this->strides_[A_leading_ndim] +
-                                       k * this->strides_[A_leading_ndim + 1];
+                        Acc sum = static_cast<Acc>(0);
 
-                        size_t b_idx = B_offset +
-                                       k * other.strides_[B_leading_ndim] +
-                                       j * other.strides_[B_leading_ndim + 1];
+                        for (size_t k = 0; k < m; ++k)
+                        {
+                            sum += A_matrix[i * A_row_stride + k * A_col_stride] * B_matrix[k * B_row_stride + j * B_col_stride];
+                        }
 
-                        sum += (*this->data_)[a_idx] * (*other.data_)[b_idx];
+                        result_matrix[i * p + j] = sum;
                     }
-                    // Write to result
-                    size_t out_idx = result_offset +
-                                     i * result.strides_[result.ndim() - 2] +
-                                     j * result.strides_.back();
-                    (*result.data_)[out_idx] = sum;
                 }
-            }
-        }
+            } });
 
-        return result;
+        if constexpr (is_half_v<T>)
+        {
+            return result.template dtype<T>();
+        }
+        else
+        {
+            return result;
+        }
     }
 
     /// @brief Transpose the tensor.
@@ -678,7 +1707,7 @@ public:
     template <typename... Dims>
     Tensor<T> permute(Dims... dims) const
     {
-        vector<size_t> perm_dims = {static_cast<size_t>(dims)...};
+        DimVector perm_dims = {static_cast<size_t>(dims)...};
 
         size_t ndim = this->ndim();
 
@@ -701,8 +1730,8 @@ public:
             seen_dims.insert(dim);
         }
 
-        vector<size_t> new_shapes(ndim);
-        vector<size_t> new_strides(ndim);
+        DimVector new_shapes(ndim);
+        DimVector new_strides(ndim);
 
         size_t i = 0;
         for (size_t dim : perm_dims)
@@ -762,7 +1791,7 @@ public:
             throw out_of_range("Flatten dimensions out of range");
         }
 
-        vector<size_t> new_shape;
+        DimVector new_shape;
         new_shape.reserve(this->ndim() - (end_dim - start_dim + 1) + 1);
 
         for (size_t i = 0; i < this->ndim(); ++i)
@@ -784,61 +1813,137 @@ public:
     /// @return a new tensor with the same shape as the original, but with each element replaced by its absolute value
     Tensor<T> abs() const
     {
-        Tensor<T> result = *this;
-
-        for (size_t i = 0; i < this->size(); i++)
+        if constexpr (std::is_same_v<T, float>)
         {
-            (*result.data_)[i] = std::abs((*this->data_)[i]);
+            if (this->is_contiguous())
+            {
+                Tensor<T> result = Tensor<T>::empty(this->shape_);
+                const T *a = this->data_->data() + this->offset_;
+                T *out = result.data_->data();
+
+                parallel_for(0, this->size(), PARALLEL_ELEMENTWISE_NUMEL, [&](size_t begin, size_t end)
+                             { simd::abs(a + begin, out + begin, end - begin); });
+                return result;
+            }
         }
 
-        return result;
+        return this->unary_op_impl([](const T &x)
+                                   { return std::abs(x); });
     }
 
-    /// @brief Filter the tensor with the given function
-    /// @param func a function to test each element of the tensor. It should return true if the element passes the test
-    /// @return a new tensor with the same shape as the original, but all elements that fail the test are set to 0.
-    Tensor<T> filter(bool (*func)(T)) const
+    /**
+     * Filter the tensor with the given predicate.
+     *
+     * @param pred Any callable taking an element and returning true if it passes the test (a lambda, capturing or not, a functor...).
+     *             It is inlined into the element loop, and may be called concurrently from several threads on large tensors.
+     * @return a new tensor with the same shape as the original, but all elements that fail the test are set to 0.
+     */
+    template <typename Pred>
+    Tensor<T> filter(Pred pred) const
     {
-        Tensor<T> result = *this;
+        return this->unary_op_impl([&pred](const T &x)
+                                   { return pred(x) ? x : static_cast<T>(0); });
+    }
 
-        for (size_t i = 0; i < this->size(); i++)
-        {
-            if (!func((*this->data_)[i]))
-            {
-                (*result.data_)[i] = static_cast<T>(0);
-            }
-        }
+    // Overload for a (possibly overloaded) function name, e.g. filter(std::isfinite)
+    Tensor<T> filter(bool (*func)(T)) const
+    {
+        return this->filter<bool (*)(T)>(func);
+    }
 
-        return result;
+    /**
+     * Perform element-wise transformation with a function.
+     *
+     * E.g. x.map([](float v) { return v > 0.0f ? v : 0.01f * v; }), or x.map([alpha](float v) { return alpha * std::tanh(v); })
+     *
+     * @param func Any callable taking an element. It is inlined into the element loop (so simple ones are vectorized by the compiler),
+     *             and may be called concurrently from several threads on large tensors, so it must not modify shared state.
+     * @return a new contiguous tensor with the same shape as the original, holding func of each element. Its type is the return type of func.
+     */
+    template <typename Func, typename U = std::decay_t<std::invoke_result_t<Func &, const T &>>>
+    Tensor<U> map(Func func) const
+    {
+        return this->unary_op_impl<U>(func);
     }
 
-    /// @brief Perform element-wise transformation with a function
-    /// @param func a function to perform element-wise transformation to the tensor
-    /// @return a new tensor with the same shape as the original, but with each element transformed by the given func
+    // Overload for a (possibly overloaded) function name, e.g. map(std::exp)
     Tensor<T> map(T (*func)(T)) const
     {
-        Tensor<T> result = *this;
+        return this->unary_op_impl(func);
+    }
 
-        for (size_t i = 0; i < this->size(); i++)
-        {
-            (*result.data_)[i] = func((*this->data_)[i]);
-        }
+    /**
+     * In-place version of map: each element is replaced by func of itself, through the strides of the tensor (views included).
+     *
+     * @param func Any callable taking an element and returning a value convertible to T (see map).
+     * @return this tensor.
+     */
+    template <typename Func>
+    Tensor<T> &map_(Func func)
+    {
+        this->inplace_unary_op_impl(func);
+        return *this;
+    }
 
-        return result;
+    /**
+     * Combine the elements of two tensors with a function, broadcasting them together with the NumPy rules.
+     *
+     * E.g. a.zip_with(b, [](float x, float y) { return std::max(x, y); })
+     *
+     * @param other The second tensor.
+     * @param func Any callable taking an element of this tensor and an element of other (see map).
+     * @return a new contiguous tensor of the broadcast shape. Its type is the return type of func.
+     */
+    template <typename Func, typename U = std::decay_t<std::invoke_result_t<Func &, const T &, const T &>>>
+    Tensor<U> zip_with(const Tensor<T> &other, Func func) const
+    {
+        return this->binary_op_impl<U>(other, func);
     }
 
-    /// @brief Calculate the sum of all elements in the tensor
-    /// @return The sum of all elements in the tensor, regardless of the dimension
-    T sum() const
+    /**
+     * Calculate the sum of all elements in the tensor, regardless of the dimension.
+     *
+     * A contiguous tensor is summed in parallel by fixed blocks combined with a fixed pairwise tree (see summation.hpp),
+     * so the result is bitwise identical whatever the number of threads. A strided view is summed row by row (each row like a
+     * contiguous tensor), and the sums of the rows are combined with the same tree.
+     *
+     * @param summation PAIRWISE (default), or KAHAN for compensated summation.
+     * @return The sum of all elements in the tensor.
+     */
+    T sum(Summation summation = Summation::PAIRWISE) const
     {
-        T sum = static_cast<T>(0);
+        using Acc = summation::accumulator_t<T>;
+        const T *data = this->data_->data();
 
-        for (size_t i = 0; i < this->size(); i++)
+        if (this->is_contiguous())
         {
-            sum += (*this->data_)[i];
+            return static_cast<T>(summation::sum(data + this->offset_, this->size(), summation));
         }
 
-        return sum;
+        const TensorIterator<1> iter(this->shape_, {this->strides_}, {this->offset_});
+
+        const size_t num_rows = iter.numel() == 0 ? 0 : iter.numel() / iter.inner_size();
+        const shared_ptr<Storage<Acc>> row_sums = make_storage<Acc>(num_rows);
+        const shared_ptr<Storage<T>> row_buffer = make_storage<T>(num_rows == 0 ? 0 : iter.inner_size());
+        size_t row = 0;
+
+        iter.for_each([&](const array<size_t, 1> &offsets, size_t n, const array<size_t, 1> &strides)
+                      {
+            if (strides[0] == 1)
+            {
+                (*row_sums)[row++] = summation::sum(data + offsets[0], n, summation);
+                return;
+            }
+
+            // gathered into a contiguous buffer, so that the row is summed like a contiguous one, with the same summation
+            T *buffer = row_buffer->data();
+            for (size_t i = 0; i < n; ++i)
+            {
+                buffer[i] = data[offsets[0] + i * strides[0]];
+            }
+            (*row_sums)[row++] = summation::sum(buffer, n, summation); });
+
+        return num_rows == 0 ? static_cast<T>(0) : static_cast<T>(summation::combine(row_sums->data(), num_rows, summation));
     }
 
     /// @brief Check if all elements of two tensors are equal
@@ -851,17 +1956,8 @@ public:
             throw runtime_error("Shape mismatch");
         }
 
-        Tensor<T> result(this->shape_, static_cast<T>(0));
-        const vector<size_t> &result_strides = result.strides_;
-
-        for (size_t i = 0; i < this->size(); i++)
-        {
-            auto [a_offset, b_offset] = calculate_tensors_offsets(i, this->ndim(), result_strides, other);
-
-            (*result.data_)[i] = (*this->data_)[a_offset] == (*other.data_)[b_offset];
-        }
-
-        return result.dtype<int>();
+        return this->binary_op_impl<int>(other, [](const T &a, const T &b)
+                                         { return static_cast<int>(a == b); });
     }
 
     /// @brief Check if all elements of two tensors are equal
@@ -874,16 +1970,33 @@ public:
             throw runtime_error("Shape mismatch");
         }
 
-        for (size_t i = 0; i < this->size(); i++)
-        {
-            auto [a_offset, b_offset] = calculate_tensors_offsets(i, this->ndim(), this->strides_, other);
+        const T *a = this->data_->data();
+        const T *b = other.data_->data();
+
+        const TensorIterator<2> iter(this->shape_, {this->strides_, other.strides_}, {this->offset_, other.offset_});
 
-            if ((*this->data_)[a_offset] != (*other.data_)[b_offset])
+        bool is_equal = true;
+
+        iter.for_each([&](const array<size_t, 2> &offsets, size_t n, const array<size_t, 2> &strides)
+                      {
+            if (!is_equal)
             {
-                return false;
+                return;
             }
-        }
-        return true;
+
+            const T *a_row = a + offsets[0];
+            const T *b_row = b + offsets[1];
+
+            for (size_t i = 0; i < n; ++i)
+            {
+                if (a_row[i * strides[0]] != b_row[i * strides[1]])
+                {
+                    is_equal = false;
+                    return;
+                }
+            } });
+
+        return is_equal;
     }
 
     /// @brief Reduce the tensor to the maximum value of all elements
@@ -911,19 +2024,135 @@ public:
     /// @return a tensor with indices of the minimum values for each row
     inline Tensor<size_t> argmin() const
     {
-        return reduce_impl<size_t>(ReduceOp::ARGMIN);
+        return reduce_impl<size_t>(ReduceOp::ARGMIN);
+    }
+
+    /**
+     * Sum of the elements over the given dimensions.
+     *
+     * E.g. for a tensor of shape (B, C, H, W), sum({0, 2, 3}) has shape (C), and sum({0, 2, 3}, true) has shape (1, C, 1, 1).
+     *
+     * @param dims The dimensions to reduce (negative values count from the last dimension). All of them if empty.
+     * @param keepdim Whether the reduced dimensions are kept with size 1, so that the result broadcasts against the tensor.
+     * @return The sums. A full reduction without keepdim gives a tensor of shape (1).
+     * @throws out_of_range if a dimension is out of range, invalid_argument if a dimension is repeated.
+     */
+    Tensor<T> sum(const vector<int64_t> &dims, bool keepdim = false) const
+    {
+        return this->reduce_dims_impl(ReduceOp::SUM, dims, keepdim);
+    }
+
+    Tensor<T> sum(int64_t dim, bool keepdim = false) const
+    {
+        return this->reduce_dims_impl(ReduceOp::SUM, {dim}, keepdim);
+    }
+
+    /// @brief Mean of the elements over the given dimensions (see sum for the parameters)
+    Tensor<T> mean(const vector<int64_t> &dims, bool keepdim = false) const
+    {
+        if constexpr (is_half_v<T>)
+        {
+            return this->template dtype<float>().mean(dims, keepdim).template dtype<T>();
+        }
+
+        const size_t count = ReducePlan(this->shape_, this->strides_, dims, keepdim).reduce_numel;
+
+        Tensor<T> result = this->reduce_dims_impl(ReduceOp::SUM, dims, keepdim);
+        result.div_(static_cast<T>(count));
+        return result;
+    }
+
+    Tensor<T> mean(int64_t dim, bool keepdim = false) const
+    {
+        return this->mean(vector<int64_t>{dim}, keepdim);
+    }
+
+    /**
+     * Variance of the elements over the given dimensions (see sum for the other parameters).
+     *
+     * It is computed in two passes (the mean, then the squared deviations from it), which is accurate even when the mean is large
+     * compared to the spread of the values.
+     *
+     * @param unbiased Whether to divide by N - 1 (Bessel's correction) instead of N, where N is the number of reduced elements.
+     */
+    Tensor<T> var(const vector<int64_t> &dims, bool unbiased = true, bool keepdim = false) const
+    {
+        if constexpr (is_half_v<T>)
+        {
+            return this->template dtype<float>().var(dims, unbiased, keepdim).template dtype<T>();
+        }
+
+        const size_t count = ReducePlan(this->shape_, this->strides_, dims, keepdim).reduce_numel;
+
+        // With keepdim, the means are laid out like the result, so each element of the result reads its own center
+        const Tensor<T> means = this->mean(dims, true);
+
+        Tensor<T> result = this->reduce_dims_impl(ReduceOp::SQUARED_DEVIATION, dims, keepdim, means.data_->data());
+        result.div_(static_cast<T>(count) - static_cast<T>(unbiased ? 1 : 0));
+        return result;
+    }
+
+    Tensor<T> var(int64_t dim, bool unbiased = true, bool keepdim = false) const
+    {
+        return this->var(vector<int64_t>{dim}, unbiased, keepdim);
+    }
+
+    /// @brief Maximum of the elements over the given dimensions (see sum for the parameters)
+    Tensor<T> max(const vector<int64_t> &dims, bool keepdim = false) const
+    {
+        return this->reduce_dims_impl(ReduceOp::MAX, dims, keepdim);
+    }
+
+    Tensor<T> max(int64_t dim, bool keepdim = false) const
+    {
+        return this->reduce_dims_impl(ReduceOp::MAX, {dim}, keepdim);
+    }
+
+    /// @brief Minimum of the elements over the given dimensions (see sum for the parameters)
+    Tensor<T> min(const vector<int64_t> &dims, bool keepdim = false) const
+    {
+        return this->reduce_dims_impl(ReduceOp::MIN, dims, keepdim);
+    }
+
+    Tensor<T> min(int64_t dim, bool keepdim = false) const
+    {
+        return this->reduce_dims_impl(ReduceOp::MIN, {dim}, keepdim);
+    }
+
+    /// @brief Indices of the maximum values along a dimension (the first one in case of ties)
+    /// @param dim The dimension to reduce (negative values count from the last dimension)
+    /// @param keepdim Whether the reduced dimension is kept with size 1
+    Tensor<size_t> argmax(int64_t dim, bool keepdim = false) const
+    {
+        return this->reduce_dims_impl<size_t>(ReduceOp::ARGMAX, {dim}, keepdim);
+    }
+
+    /// @brief Indices of the minimum values along a dimension (the first one in case of ties)
+    Tensor<size_t> argmin(int64_t dim, bool keepdim = false) const
+    {
+        return this->reduce_dims_impl<size_t>(ReduceOp::ARGMIN, {dim}, keepdim);
     }
 
     /// @brief Calculate the square root of each element in the tensor
     /// @return a new tensor with the same shape as the original, but with each element replaced by its square root
     Tensor<> sqrt() const
     {
-        Tensor<> result = *this;
-        for (size_t i = 0; i < this->size(); i++)
+        if constexpr (std::is_same_v<T, float>)
         {
-            (*result.data_)[i] = std::sqrt((*this->data_)[i]);
+            if (this->is_contiguous())
+            {
+                Tensor<> result = Tensor<>::empty(this->shape_);
+                const float *a = this->data_->data() + this->offset_;
+                float *out = result.data_->data();
+
+                parallel_for(0, this->size(), PARALLEL_ELEMENTWISE_NUMEL, [&](size_t begin, size_t end)
+                             { simd::sqrt(a + begin, out + begin, end - begin); });
+                return result;
+            }
         }
-        return result;
+
+        return this->unary_op_impl<float>([](const T &x)
+                                          { return std::sqrt(x); });
     }
 
     /// @brief Convert the tensor to a tensor of a different type.
@@ -941,7 +2170,7 @@ public:
     /// The total number of elements must remain the same; otherwise, an exception is thrown.
     /// @param new_shape The desired shape for the tensor.
     /// @throws runtime_error if the new shape is not compatible with the current number of elements.
-    Tensor<> reshape(const vector<size_t> &new_shape) const
+    Tensor<T> reshape(const DimVector &new_shape) const
     {
         // Calculate total elements for both shapes
         const int64_t current_elements = accumulate(
@@ -954,45 +2183,12 @@ public:
             throw runtime_error("New shape must be compatible with the original shape");
         }
 
-        // Check if the data is stored in a contiguous way
-        vector<size_t> original_strides(this->ndim(), 0);
-        int64_t stride = 1;
-
-        for (int64_t i = this->ndim() - 1; i >= 0; --i)
-        {
-            original_strides[i] = stride;
-            stride *= this->shape_[i];
-        }
-
-        Tensor<T> result;
-
-        // If the data is not stored in a contiguous way, the stride will not be a cumulative product of the shape
-        if (original_strides != this->strides_)
-        {
-            cout << "Clone the tensor" << endl;
-            /*
-            This part is a little bit complicated
-
-            Since the data may not store in a contiguous way, there is a problem when we directly change the shape of the tensor.
-            We will loss the tracking of the strides of the tensor.
-
-            Therefore we have to make the data stored in a contiguous way first, then we can change the shape of the tensor.
-            clone() function will create a new tensor with the same shape and data as the current tensor.
-
-            If we directly use copy constructor, the data will not be stored in a contiguous way.
-            Since I don't rearange the data in the copy constructor.
-
-            Eventully the tensor data is guaranteed to be stored in the contiguous way, so we can directly change the shape of the tensor.
-            */
-
-            // Create a new tensor with contiguous data
-            result = this->clone();
-        }
-        else
+        // The strides of a view are not the cumulative product of its shape, so the elements are copied to a contiguous tensor first
+        if (!this->is_contiguous())
         {
-            // the data is not stored in a contiguous way
-            result = *this;
+            NN_LOG_TRACE(TENSOR, "reshape copies a view of shape " << this->shape_ << " to " << new_shape);
         }
+        Tensor<T> result = this->contiguous();
 
         result.shape_ = new_shape;
         result.compute_contiguous_strides();
@@ -1002,33 +2198,60 @@ public:
 
     /// @brief Return a deep copy of the tensor. The data is copied to a new contiguous storage (and this is the only difference from copy constructor).
     /// @details This function will create a new tensor with the same shape and data as the current tensor.
+    /// Views (transpose, permute, slices, ...) are copied by the copy engine of strided_copy.hpp, which copies transposed dimensions by tiles.
     /// @return a new tensor which is a deep copy of the current tensor
     Tensor<T> clone() const
     {
-        Tensor<T> result;
+        if (this->data_ == nullptr)
+        {
+            return Tensor<T>();
+        }
 
-        result.shape_ = this->shape_;
-        result.data_ = make_shared<vector<T>>(*(this->data_));
-        result.compute_contiguous_strides();
+        Tensor<T> result = Tensor<T>::empty(this->shape_);
+        strided_copy(this->shape_, result.data_->data(), result.strides_, this->data_->data() + this->offset_, this->strides_);
+
+        return result;
+    }
 
-        // Copy data from original tensor's view to the new contiguous storage
-        for (size_t i = 0; i < this->size(); ++i)
+    /// @brief Return the tensor itself (sharing its storage) if it is stored contiguously, otherwise a contiguous copy (see clone()).
+    Tensor<T> contiguous() const
+    {
+        if (this->data_ == nullptr || this->is_contiguous())
         {
-            vector<size_t> indices = linear_to_multi_idxs(i, result.shape_);
-            size_t src_offset = this->offset_;
+            return *this;
+        }
 
-            for (size_t dim = 0; dim < indices.size(); ++dim)
-            {
-                src_offset += indices[dim] * this->strides_[dim];
-            }
+        return this->clone();
+    }
 
-            (*result.data_)[i] = (*this->data_)[src_offset];
-        }
+    /**
+     * Create a contiguous tensor of the given shape without initializing its elements (for trivial types such as float and int).
+     * It saves the pass over the memory of Tensor(shape, value) when every element is written afterwards.
+     */
+    static Tensor<T> empty(const DimVector &shape)
+    {
+        Tensor<T> result;
+        result.shape_ = shape;
+        result.data_ = make_storage<T>(result.size());
+        result.compute_contiguous_strides();
+        return result;
+    }
 
+    /**
+     * Create a contiguous tensor of the given shape viewing the elements at data, which are not copied.
+     * owner is kept alive as long as a tensor uses the elements (e.g. the mapping of a file, see serialization.hpp).
+     * The elements are modified in place by the in-place operations, like the elements of any storage owned by a single tensor.
+     */
+    static Tensor<T> from_blob(T *data, const DimVector &shape, shared_ptr<void> owner)
+    {
+        Tensor<T> result;
+        result.shape_ = shape;
+        result.data_ = make_shared<Storage<T>>(data, result.size(), std::move(owner));
+        result.compute_contiguous_strides();
         return result;
     }
 
-    static Tensor<T> arange(size_t start, size_t end = 0, vector<size_t> shape = {0})
+    static Tensor<T> arange(size_t start, size_t end = 0, DimVector shape = {0})
     {
         if (start == end) // if only one argument is provided
         {
@@ -1047,8 +2270,6 @@ public:
 
         Tensor<T> result(shape, static_cast<T>(0));
 
-        cout << "In arange, weight address: " << &result.data_ << endl;
-
         size_t idx = 0;
         for (size_t i = start; i <= end; i++)
         {
@@ -1059,6 +2280,53 @@ public:
         return result;
     }
 
+    /// @brief Check if the elements of the tensor are stored contiguously in row-major order, so the tensor can be traversed with a flat loop
+    /// @details Dimensions of size 1 are ignored since their stride is never used.
+    bool is_contiguous() const
+    {
+        size_t expected_stride = 1;
+
+        for (int64_t i = this->ndim() - 1; i >= 0; --i)
+        {
+            if (this->shape_[i] != 1 && this->strides_[i] != expected_stride)
+            {
+                return false;
+            }
+            expected_stride *= this->shape_[i];
+        }
+        return true;
+    }
+
+    // Pointer to the first element (nullptr for a tensor without storage). The elements are contiguous if is_contiguous()
+    inline const T *data() const { return this->data_ == nullptr ? nullptr : this->data_->data() + this->offset_; }
+
+    /**
+     * Unchecked access to the elements of a tensor of rank N in the inner loops of the kernels (see tensor_accessor.hpp):
+     *
+     *     const auto in = input.accessor<4>();
+     *     sum += in[b, c, h, w];
+     *
+     * @throws invalid_argument If the tensor is not of rank N.
+     */
+    template <size_t N>
+    TensorAccessor<const T, N> accessor() const
+    {
+        this->check_accessor_rank(N);
+        return TensorAccessor<const T, N>(this->data(), this->shape_.data(), this->strides_.data());
+    }
+
+    /**
+     * Same as above, for writing the elements in place. The storage is copied first if it is shared with another tensor (copy-on-write),
+     * so the tensor must not be copied while the accessor is used.
+     */
+    template <size_t N>
+    TensorAccessor<T, N> accessor()
+    {
+        this->check_accessor_rank(N);
+        this->detach();
+        return TensorAccessor<T, N>(this->data_ == nullptr ? nullptr : this->data_->data() + this->offset_, this->shape_.data(), this->strides_.data());
+    }
+
     // Get the dimension of the tensor
     inline size_t ndim() const
     {
@@ -1083,20 +2351,27 @@ public:
         return this->size_;
     }
 
-    /// @brief Print the tensor to console.
+    /// @brief Print the tensor to console (or to another stream).
     /// @details This function will print the tensor in a nested array style.
-    void print() const
+    void print(ostream &os = cout) const
     {
-        print_recursive_impl(0, 0, 0);
-        cout << endl; // flush the output
+        print_recursive_impl(os, 0, this->offset_, 0);
+        os << endl; // flush the output
         return;
     }
 
+    // Write the tensor in the nested array style of print(), without a new line or a flush (e.g. in a log message)
+    friend ostream &operator<<(ostream &os, const Tensor<T> &tensor)
+    {
+        tensor.print_recursive_impl(os, 0, tensor.offset_, 0);
+        return os;
+    }
+
     /**
      * @brief Get the shape of the tensor. E.g. for a 2x3x4 tensor, the shape is {2, 3, 4}.
      * @return The shape of the tensor.
      */
-    inline const vector<size_t> &shapes() const { return this->shape_; }
+    inline const DimVector &shapes() const { return this->shape_; }
 
     // ========================================operators overloading========================================
     inline Tensor<T> operator+(const Tensor<T> &other) const { return this->arithmetic_operation_impl(ArithmeticOp::ADD, other); } // tensor operation
@@ -1117,6 +2392,7 @@ public:
     Instead of returning a new tensor, we modify the current tensor in place.
 
     Besides, it is slightly different from method clone(), in which it will not modify data_ to make all the elements stored contiguously.
+    The data is shared with other until one of them is mutated (copy-on-write).
     */
     Tensor<T> &operator=(const Tensor<T> &other)
     {
@@ -1124,7 +2400,7 @@ public:
             return *this;
 
         this->shape_ = other.shape_;
-        this->data_ = make_shared<vector<T>>(*(other.data_));
+        this->data_ = other.data_;
         this->strides_ = other.strides_;
         this->offset_ = other.offset_;
         this->size_ = other.size_;
@@ -1154,53 +2430,59 @@ public:
         return *this;
     }
 
-    const Tensor<T> operator+=(const Tensor<T> &other)
-    {
-        *this = this->arithmetic_operation_impl(ArithmeticOp::ADD, other);
-        return *this;
-    }
+    /*
+    Assign a lazy expression (see tensor_expr.hpp), evaluated in a single pass.
 
-    const Tensor<T> operator-=(const Tensor<T> &other)
+    When this tensor already has the shape of the expression, is contiguous, and does not share its storage with any other tensor,
+    the result is written directly into its storage (e.g. m = lazy(m) * beta1 + lazy(grad) * (1 - beta1) does not allocate).
+    Otherwise the expression is evaluated into a new tensor.
+    */
+    template <typename E>
+    Tensor<T> &operator=(const TensorExpr<E> &expr)
     {
-        *this = this->arithmetic_operation_impl(ArithmeticOp::SUB, other);
-        return *this;
-    }
+        const E &e = expr.self();
 
-    const Tensor<T> operator*=(const Tensor<T> &other)
-    {
-        *this = this->arithmetic_operation_impl(ArithmeticOp::MUL, other);
-        return *this;
-    }
+        DimVector shape;
+        e.broadcast_shape(shape);
 
-    const Tensor<T> operator*=(const T &other)
-    {
-        *this = this->arithmetic_operation_with_scaler_impl(ArithmeticOp::MUL, other);
+        if (this->data_ && this->data_.use_count() == 1 && this->shape_ == shape && this->is_contiguous() && !e.overlaps(*this))
+        {
+            this->evaluate_expr(e);
+        }
+        else
+        {
+            // The expression may read this tensor, so it is only replaced after the evaluation
+            *this = Tensor<T>(expr);
+        }
         return *this;
     }
 
-    const Tensor<T> operator/=(const Tensor<T> &other)
-    {
-        *this = this->arithmetic_operation_impl(ArithmeticOp::DIV, other);
-        return *this;
-    }
+    // Compound assignment operators modify the tensor in place (see the in-place operations above)
+    inline Tensor<T> &operator+=(const Tensor<T> &other) { return this->add_(other); }
+    inline Tensor<T> &operator+=(const T &scaler) { return this->add_(scaler); }
 
-    const Tensor<T> operator/=(const T &other)
-    {
-        *this = this->arithmetic_operation_with_scaler_impl(ArithmeticOp::DIV, other);
-        return *this;
-    }
+    inline Tensor<T> &operator-=(const Tensor<T> &other) { return this->sub_(other); }
+    inline Tensor<T> &operator-=(const T &scaler) { return this->sub_(scaler); }
+
+    inline Tensor<T> &operator*=(const Tensor<T> &other) { return this->mul_(other); }
+    inline Tensor<T> &operator*=(const T &scaler) { return this->mul_(scaler); }
+
+    inline Tensor<T> &operator/=(const Tensor<T> &other) { return this->div_(other); }
+    inline Tensor<T> &operator/=(const T &scaler) { return this->div_(scaler); }
 
     // lvalue operator overloading
     template <typename... Indices>
     T &operator[](Indices... indices)
     {
-        vector<size_t> idxs = this->get_idxs(indices...);
+        DimVector idxs = this->get_idxs(indices...);
+        this->detach();
         return (*this->data_)[this->calculate_idx(idxs)];
     }
 
     // Using vector to index the tensor (lvalue)
-    T &operator[](const vector<size_t> &indices)
+    T &operator[](const DimVector &indices)
     {
+        this->detach();
         return (*this->data_)[this->calculate_idx(indices)];
     }
 
@@ -1208,9 +2490,9 @@ public:
      * @brief Linear indexing accessor (lvalue)
      *  
      * This function allows for linear indexing into the tensor.. 
-     * It will directly access the underlying data vector.  
+     * The linear index follows the row-major order of the tensor, so it also works on strided views.  
      * E.g.  
-     * tensor.at(10) = 1.0f; // directly assign the value to the 10th element of the tensor (i.e. this->data_[10])
+     * tensor.at(10) = 1.0f; // directly assign the value to the 10th element of the tensor
      *
      * @param linear_index The linear index of the element to access.
      * @return A reference to the element at the given linear index.
@@ -1223,19 +2505,20 @@ public:
         {
             throw std::out_of_range("Linear index out of range");
         }
-        return (*this->data_)[this->offset_ + linear_index];
+        this->detach();
+        return (*this->data_)[this->linear_to_offset(linear_index)];
     }
 
     // rvalue operator overloading
     template <typename... Indices>
     const T &operator[](Indices... indices) const
     {
-        vector<size_t> idxs = this->get_idxs(indices...);
+        DimVector idxs = this->get_idxs(indices...);
         return (*this->data_)[this->calculate_idx(idxs)];
     }
 
     // Using vector to index the tensor (rvalue)
-    const T &operator[](const vector<size_t> &indices) const
+    const T &operator[](const DimVector &indices) const
     {
         return (*this->data_)[this->calculate_idx(indices)];
     }
@@ -1244,9 +2527,9 @@ public:
      * @brief Linear indexing accessor (rvalue)
      *
      * This function allows for linear indexing into the tensor.
-     * It will directly access the underlying data vector.
+     * The linear index follows the row-major order of the tensor, so it also works on strided views.
      * E.g.
-     * float value = tensor.at(10); // directly assign the value to the 10th element of the tensor (i.e. this->data_[10])
+     * float value = tensor.at(10); // get the value of the 10th element of the tensor
      *
      * @param linear_index The linear index of the element to access.
      * @return A reference to the element at the given linear index.
@@ -1259,118 +2542,397 @@ public:
         {
             throw std::out_of_range("Linear index out of range");
         }
-        return (*this->data_)[this->offset_ + linear_index];
+        return (*this->data_)[this->linear_to_offset(linear_index)];
     }
 
     /**
-     * @brief Advanced indexing using a combination of integers, strings, and slices.
+     * @brief Indexing using a combination of integers, strings, and slices.
      *
      * This function allows for flexible indexing into the tensor, similar to Python's
-     * advanced indexing. It supports integer indices, string-based slices, and the ellipsis
-     * ("...") for automatic dimension completion. The function expands slices and handles
-     * ellipsis to generate the appropriate sub-tensor.
+     * basic indexing. It supports integer indices, string-based slices ("start:stop:step"), Slice objects, and the ellipsis
+     * ("...") for automatic dimension completion. The dimensions after the last index are taken whole.
+     * A dimension indexed by an integer, or by a slice selecting a single element, is removed from the result.
+     *
+     * The result is a strided view sharing the storage of this tensor, so no element is copied.
+     * Since the storage is copy-on-write, writing to the view (or to this tensor) afterwards does not affect the other one.
+     *
+     * E.g.
+     * Tensor<> batch = data.index({"64:128"});        // rows 64 to 127
+     * Tensor<> even_columns = data.index({":", "::2"});
+     * Tensor<> last_step = sequence.index({"...", "-1:"});
+     *
+     * To apply the same index many times, build an IndexPlan once and use index(const IndexPlan &), which skips the parsing.
      *
      * @param indices A vector of indices where each index can be an integer, a string
      *                representing a slice, or a special ellipsis ("...").
-     * @return A new tensor that is indexed from the current tensor according to the given indices.
+     * @return A view of the current tensor according to the given indices.
      *
      * @throw std::invalid_argument if an index type is invalid or if more than one ellipsis is used.
      */
-    using IndexType = variant<size_t, string, Slice>;
+    using IndexType = IndexPlan::IndexType;
     Tensor<T> index(const vector<IndexType> &indices) const
     {
-        vector<vector<size_t>> expanded_indices;
+        return this->index(IndexPlan(indices));
+    }
+
+    /**
+     * @brief Indexing with a precompiled index.
+     *
+     * Same as index(const vector<IndexType> &), but the indices were already parsed. E.g.
+     *
+     * const IndexPlan window({"...", "0:32"});
+     * for (...)
+     *     Tensor<> x = sequence.index(window);
+     *
+     * @param plan The precompiled index.
+     * @return A view of the current tensor according to the plan.
+     */
+    Tensor<T> index(const IndexPlan &plan) const
+    {
+        Tensor<T> result;
+        result.data_ = this->data_;
+        result.offset_ = this->offset_ + plan.apply(this->shape_, this->strides_, result.shape_, result.strides_);
+        return result;
+    }
+
+    /**
+     * View of the elements start, ..., start + length - 1 along a dimension, sharing the storage of this tensor (like index()).
+     *
+     * @throws out_of_range If the dimension or the range is out of the tensor.
+     */
+    Tensor<T> narrow(int64_t dim, size_t start, size_t length) const
+    {
+        const size_t d = this->normalize_dim(dim, "narrow");
+        if (start > this->shape_[d] || length > this->shape_[d] - start)
+        {
+            throw out_of_range("narrow: the range [" + to_string(start) + ", " + to_string(start + length) + ") is out of dimension " +
+                               to_string(d) + " of size " + to_string(this->shape_[d]));
+        }
+
+        Tensor<T> result = *this;
+        result.shape_[d] = length;
+        result.offset_ += start * this->strides_[d];
+        return result;
+    }
+
+    /**
+     * Split the tensor along a dimension into views of split_size elements (the last one may be smaller).
+     * The views share the storage of this tensor, so no element is copied.
+     * E.g. x.split(64) are the mini-batches of 64 rows of x.
+     */
+    vector<Tensor<T>> split(size_t split_size, int64_t dim = 0) const
+    {
+        if (split_size == 0)
+        {
+            throw invalid_argument("split: the split size must be positive");
+        }
+
+        const size_t d = this->normalize_dim(dim, "split");
+        vector<Tensor<T>> result;
+        for (size_t start = 0; start < this->shape_[d]; start += split_size)
+        {
+            result.push_back(this->narrow(d, start, std::min(split_size, this->shape_[d] - start)));
+        }
+        return result;
+    }
+
+    // Split the tensor along a dimension into views of the given sizes, which must add up to the size of the dimension
+    vector<Tensor<T>> split(const vector<size_t> &split_sizes, int64_t dim = 0) const
+    {
+        const size_t d = this->normalize_dim(dim, "split");
+        if (accumulate(split_sizes.begin(), split_sizes.end(), size_t(0)) != this->shape_[d])
+        {
+            throw invalid_argument("split: the sizes must add up to the size " + to_string(this->shape_[d]) + " of dimension " + to_string(d));
+        }
+
+        vector<Tensor<T>> result;
+        size_t start = 0;
+        for (const size_t size : split_sizes)
+        {
+            result.push_back(this->narrow(d, start, size));
+            start += size;
+        }
+        return result;
+    }
+
+    // Split the tensor along a dimension into at most chunks views of the same size (the last one may be smaller), as torch.chunk
+    vector<Tensor<T>> chunk(size_t chunks, int64_t dim = 0) const
+    {
+        if (chunks == 0)
+        {
+            throw invalid_argument("chunk: the number of chunks must be positive");
+        }
+
+        const size_t d = this->normalize_dim(dim, "chunk");
+        return this->split(std::max<size_t>(1, (this->shape_[d] + chunks - 1) / chunks), d);
+    }
 
-        // Handle ellipsis and expand slices
-        // cout << "Start expanding indices" << endl;
-        for (size_t i = 0; i < indices.size(); ++i)
+    /**
+     * Concatenate tensors along an existing dimension. They must have the same rank, and the same sizes in the other dimensions.
+     * E.g. cat({a, b}, 1) of a (B, M) and b (B, N) is (B, M + N).
+     *
+     * Every tensor is copied into its slice of the result by the copy engine of strided_copy.hpp, in parallel, so views are not made contiguous first.
+     */
+    static Tensor<T> cat(const vector<Tensor<T>> &tensors, int64_t dim = 0)
+    {
+        if (tensors.empty())
         {
-            const auto &idx = indices[i];
+            throw invalid_argument("cat expects at least one tensor");
+        }
 
-            if (auto str_idx = get_if<string>(&idx))
+        const Tensor<T> &first = tensors.front();
+        const size_t d = first.normalize_dim(dim, "cat");
+
+        DimVector shape = first.shape_;
+        shape[d] = 0;
+        for (const Tensor<T> &t : tensors)
+        {
+            for (size_t k = 0; k < shape.size(); ++k)
             {
-                Slice slice = Slice::parse(*str_idx);
-                expanded_indices.push_back(apply_slice(slice, this->shape_[i]));
+                if (t.ndim() != shape.size() || (k != d && t.shape_[k] != shape[k]))
+                {
+                    throw invalid_argument("cat expects tensors of the same shape except in dimension " + to_string(d) + ", got " +
+                                           shape_to_string(first.shape_) + " and " + shape_to_string(t.shape_));
+                }
             }
-            else if (auto int_idx = get_if<size_t>(&idx))
+            shape[d] += t.shape_[d];
+        }
+
+        Tensor<T> result = Tensor<T>::empty(shape);
+        T *out = result.data_->data();
+
+        size_t start = 0;
+        for (const Tensor<T> &t : tensors)
+        {
+            if (t.size() > 0)
             {
-                expanded_indices.push_back({normalize_index(*int_idx, this->shape_[i])});
+                strided_copy(t.shape_, out + start * result.strides_[d], result.strides_, t.data_->data() + t.offset_, t.strides_);
             }
-            else if (auto slice_idx = get_if<Slice>(&idx))
+            start += t.shape_[d];
+        }
+
+        return result;
+    }
+
+    /**
+     * Stack tensors of the same shape along a new dimension. E.g. stack of B tensors of shape (N) is (B, N) for dim = 0.
+     * The tensors are copied like by cat(), so a batch is assembled with a single copy of every sample.
+     */
+    static Tensor<T> stack(const vector<Tensor<T>> &tensors, int64_t dim = 0)
+    {
+        if (tensors.empty())
+        {
+            throw invalid_argument("stack expects at least one tensor");
+        }
+
+        const int64_t ndim = static_cast<int64_t>(tensors.front().ndim()) + 1;
+        if (dim < -ndim || dim >= ndim)
+        {
+            throw out_of_range("stack: dimension " + to_string(dim) + " is out of range for a result of " + to_string(ndim) + " dimensions");
+        }
+        const size_t d = static_cast<size_t>(dim < 0 ? dim + ndim : dim);
+
+        // views with a dimension of size 1 inserted at d
+        vector<Tensor<T>> expanded;
+        expanded.reserve(tensors.size());
+        for (const Tensor<T> &t : tensors)
+        {
+            if (!(t.shape_ == tensors.front().shape_))
             {
-                expanded_indices.push_back(apply_slice(*slice_idx, this->shape_[i]));
+                throw invalid_argument("stack expects tensors of the same shape, got " + shape_to_string(tensors.front().shape_) + " and " +
+                                       shape_to_string(t.shape_));
             }
-            else
+
+            Tensor<T> view = t;
+            view.shape_.insert(view.shape_.begin() + d, 1);
+            view.strides_.insert(view.strides_.begin() + d, 0);
+            expanded.push_back(view);
+        }
+
+        return Tensor<T>::cat(expanded, d);
+    }
+
+    /**
+     * The slices at the given indices (which may repeat) along a dimension: out[i][j] = this[indices[i]][j] for dim = 0, out[i][j] = this[i][indices[j]] for dim = 1, ...
+     * E.g. the samples of a mini-batch: data.index_select(0, batch_ids).
+     *
+     * The slices are copied by the copy engine of strided_copy.hpp, and split among the threads.
+     *
+     * @throws out_of_range If an index is out of the dimension.
+     */
+    Tensor<T> index_select(int64_t dim, const vector<size_t> &indices) const
+    {
+        const size_t d = this->normalize_dim(dim, "index_select");
+        for (const size_t i : indices)
+        {
+            if (i >= this->shape_[d])
             {
-                throw std::invalid_argument("Invalid index type");
+                throw out_of_range("index_select: index " + to_string(i) + " is out of dimension " + to_string(d) + " of size " + to_string(this->shape_[d]));
             }
         }
 
-        // Calculate new dimensions
-        vector<size_t> new_dims;
-        for (const vector<size_t> &expanded_idx : expanded_indices)
+        DimVector shape = this->shape_;
+        shape[d] = indices.size();
+        Tensor<T> result = Tensor<T>::empty(shape);
+        if (result.size() == 0)
+        {
+            return result;
+        }
+
+        // every slice has the shape of this tensor with a size of 1 in dimension d
+        DimVector slice_shape = this->shape_;
+        slice_shape[d] = 1;
+        const size_t slice_numel = result.size() / indices.size();
+
+        T *out = result.data_->data();
+        const T *src = this->data_->data() + this->offset_;
+
+        parallel_for(0, indices.size(), std::max<size_t>(1, strided_copy_impl::PARALLEL_COPY_NUMEL / slice_numel), [&](size_t begin, size_t end)
+                     {
+            for (size_t j = begin; j < end; ++j)
+            {
+                strided_copy(slice_shape, out + j * result.strides_[d], result.strides_, src + indices[j] * this->strides_[d], this->strides_);
+            } });
+
+        return result;
+    }
+
+    // Same as above, with the indices in a 1D tensor (e.g. the result of argmax)
+    Tensor<T> index_select(int64_t dim, const Tensor<size_t> &indices) const
+    {
+        if (indices.ndim() != 1)
+        {
+            throw invalid_argument("index_select expects a 1D tensor of indices, got " + to_string(indices.ndim()) + " dimensions");
+        }
+
+        const Tensor<size_t> contiguous_indices = indices.contiguous();
+        return this->index_select(dim, vector<size_t>(contiguous_indices.data(), contiguous_indices.data() + contiguous_indices.size()));
+    }
+
+    /**
+     * Gather the elements along a dimension: out[i][j] = this[index[i][j]][j] for dim = 0, out[i][j] = this[i][index[i][j]] for dim = 1, ...
+     * The result has the shape of index, which must have the rank of this tensor, and no larger sizes in the other dimensions.
+     * E.g. the logits of the labels of a batch of shape (B, M): logits.gather(1, labels) for labels of shape (B, 1).
+     *
+     * @throws invalid_argument If the shape of index does not fit this tensor.
+     * @throws out_of_range If an index is out of the dimension.
+     */
+    Tensor<T> gather(int64_t dim, const Tensor<size_t> &index) const
+    {
+        const size_t d = this->normalize_dim(dim, "gather");
+        this->check_index_tensor(index, d, "gather");
+
+        Tensor<T> result = Tensor<T>::empty(index.shape_);
+        if (result.size() == 0)
         {
-            if (expanded_idx[0] != -1)
-            { // Not None/newaxis
-                if (expanded_idx.size() > 1)
+            return result;
+        }
+
+        const Tensor<size_t> idx = index.contiguous();
+        const size_t *ind = idx.data();
+
+        // the offsets in this tensor of the positions of index before and after dimension d
+        const vector<size_t> outer_offsets = dim_offsets(index.shape_, 0, d, this->strides_);
+        const vector<size_t> inner_offsets = dim_offsets(index.shape_, d + 1, index.ndim(), this->strides_);
+        const size_t inner = inner_offsets.size();
+        const size_t rows = index.shape_[d];
+        const size_t stride = this->strides_[d];
+
+        T *out = result.data_->data();
+        const T *src = this->data_->data() + this->offset_;
+
+        parallel_for(0, outer_offsets.size() * rows, std::max<size_t>(1, PARALLEL_ELEMENTWISE_NUMEL / inner), [&](size_t begin, size_t end)
+                     {
+            for (size_t row = begin; row < end; ++row)
+            {
+                const T *base = src + outer_offsets[row / rows];
+                const size_t *ind_row = ind + row * inner;
+                T *out_row = out + row * inner;
+
+                for (size_t i = 0; i < inner; ++i)
                 {
-                    new_dims.push_back(expanded_idx.size());
+                    out_row[i] = base[ind_row[i] * stride + inner_offsets[i]];
                 }
-            }
-            else
+            } });
+
+        return result;
+    }
+
+    /**
+     * Add the elements of src at the positions given by index along a dimension, in place:
+     * this[index[i][j]][j] += src[i][j] for dim = 0, this[i][index[i][j]] += src[i][j] for dim = 1, ...
+     * index must have the rank of this tensor and no larger sizes in the other dimensions, and src no smaller sizes than index.
+     * E.g. the gradient of the rows of an embedding: grad_weight.scatter_add_(0, ids, grad_rows), with ids repeated along the columns.
+     *
+     * The threads split the positions of index outside of dimension d, which never send to the same element. The elements sent
+     * to the same element are added in the order of index along d, so the result does not depend on the number of threads.
+     *
+     * @throws invalid_argument If the shapes of index or src do not fit this tensor.
+     * @throws out_of_range If an index is out of the dimension.
+     */
+    Tensor<T> &scatter_add_(int64_t dim, const Tensor<size_t> &index, const Tensor<T> &src)
+    {
+        const size_t d = this->normalize_dim(dim, "scatter_add_");
+        this->check_index_tensor(index, d, "scatter_add_");
+
+        if (src.ndim() != index.ndim())
+        {
+            throw invalid_argument("scatter_add_ expects src of the rank of index, got " + shape_to_string(src.shape_) + " and " + shape_to_string(index.shape_));
+        }
+        for (size_t k = 0; k < index.ndim(); ++k)
+        {
+            if (src.shape_[k] < index.shape_[k])
             {
-                new_dims.push_back(1);
+                throw invalid_argument("scatter_add_ expects src no smaller than index, got " + shape_to_string(src.shape_) + " and " + shape_to_string(index.shape_));
             }
         }
 
-        // cout << "Start printing new_dims" << endl;
-        // cout << "new_dims size: " << new_dims.size() << endl;
-        // for (size_t i = 0; i < new_dims.size(); ++i) {
-        //     cout << new_dims[i] << " ";
-        // }
+        if (index.size() == 0)
+        {
+            return *this;
+        }
+
+        this->detach();
 
-        // Create result tensor
-        Tensor<T> result(new_dims, static_cast<T>(0));
+        const Tensor<size_t> idx = index.contiguous();
+        const size_t *ind = idx.data();
 
-        // Fill result tensor
-        vector<size_t> current_indices(expanded_indices.size());
-        vector<size_t> result_indices;
+        const vector<size_t> outer_offsets = dim_offsets(index.shape_, 0, d, this->strides_);
+        const vector<size_t> inner_offsets = dim_offsets(index.shape_, d + 1, index.ndim(), this->strides_);
+        const vector<size_t> src_outer_offsets = dim_offsets(index.shape_, 0, d, src.strides_);
+        const vector<size_t> src_inner_offsets = dim_offsets(index.shape_, d + 1, index.ndim(), src.strides_);
+        const size_t inner = inner_offsets.size();
+        const size_t rows = index.shape_[d];
+        const size_t stride = this->strides_[d];
+        const size_t src_stride = src.strides_[d];
 
-        // Recursive lambda to fill result tensor
-        function<void(size_t)> fill_tensor = [&](size_t depth)
-        {
-            if (depth == expanded_indices.size())
+        T *dst = this->data_->data() + this->offset_;
+        const T *s = src.data_->data() + src.offset_;
+
+        // [begin, end) are positions (o, i) of index outside of dimension d, whose rows j are added row by row
+        parallel_for(0, outer_offsets.size() * inner, std::max<size_t>(1, PARALLEL_ELEMENTWISE_NUMEL / rows), [&](size_t begin, size_t end)
+                     {
+            for (size_t p = begin; p < end;)
             {
-                result_indices.clear();
-                for (int i = 0; i < expanded_indices.size(); ++i)
-                {
-                    if (expanded_indices[i][0] != -1 && expanded_indices[i].size() > 1)
-                    {
-                        result_indices.push_back(current_indices[i]);
-                    }
-                }
+                const size_t o = p / inner;
+                const size_t i_begin = p % inner;
+                const size_t i_end = std::min(inner, i_begin + (end - p));
 
-                vector<size_t> original_indices;
-                for (int i = 0; i < expanded_indices.size(); ++i)
+                for (size_t j = 0; j < rows; ++j)
                 {
-                    if (expanded_indices[i][0] != -1)
+                    const size_t *ind_row = ind + (o * rows + j) * inner;
+                    const T *src_row = s + src_outer_offsets[o] + j * src_stride;
+                    T *dst_base = dst + outer_offsets[o];
+
+                    for (size_t i = i_begin; i < i_end; ++i)
                     {
-                        original_indices.push_back(expanded_indices[i][current_indices[i]]);
+                        dst_base[ind_row[i] * stride + inner_offsets[i]] += src_row[src_inner_offsets[i]];
                     }
                 }
 
-                result[result_indices] = (*this)[original_indices];
-                return;
-            }
-
-            for (int i = 0; i < expanded_indices[depth].size(); ++i)
-            {
-                current_indices[depth] = i;
-                fill_tensor(depth + 1);
-            }
-        };
+                p += i_end - i_begin;
+            } });
 
-        fill_tensor(0);
-        return result;
+        return *this;
     }
 };
\ No newline at end of file
@@ -0,0 +1,354 @@
+#pragma once
+#include <cmath>
+#include <functional>
+#include <type_traits>
+#include <vector>
+#include "tensor_utils.hpp"
+#include "summation.hpp"
+using namespace std;
+
+/*
+Lazy element-wise expressions (expression templates).
+
+By default, every arithmetic operator of Tensor computes and allocates a new tensor, so a chain of N operators
+takes N passes over the memory and N temporaries. Wrapping an operand with lazy() opts in to lazy evaluation instead:
+the operators build an expression tree, and the whole tree is computed by one fused loop when it is assigned to a Tensor.
+
+E.g.
+m = lazy(m) * beta1 + lazy(grad) * (1.0f - beta1);                // one pass, no temporary
+float loss = ((lazy(y) - y_hat) * (lazy(y) - y_hat)).sum();     // one pass, no temporary at all
+
+- Tensors and scalers can be mixed freely with expressions, and the operands are broadcast with the NumPy rules.
+- When the destination already has the shape of the result, is not shared with another tensor, and is contiguous,
+  the result is written directly into its storage (e.g. m above), otherwise a new tensor is allocated.
+- The expression only keeps references to its operands, so it must be assigned (or summed) in the statement that builds it.
+  Do not store an expression in an auto variable.
+*/
+
+template <typename T>
+class Tensor;
+
+// Base class of every expression node (CRTP)
+template <typename Derived>
+struct TensorExpr
+{
+    inline const Derived &self() const { return static_cast<const Derived &>(*this); }
+
+    // Evaluate the expression into a new tensor
+    auto eval() const { return Tensor<typename Derived::value_type>(this->self()); }
+
+    // Sum of the elements of the expression, computed without materializing it (see summation.hpp)
+    auto sum(Summation summation = Summation::PAIRWISE) const;
+};
+
+template <typename E>
+inline constexpr bool is_tensor_expr_v = std::is_base_of_v<TensorExpr<E>, E>;
+
+/*
+Every node provides:
+- value_type
+- broadcast_shape(shape): broadcast its shape into shape
+- is_flat(shape): whether it can be read with a flat index, i.e. every leaf is contiguous with the given shape
+- flat(i): the element at the flat index i
+- bind(shape): prepare the strided traversal of the given (broadcast) shape
+- step(dim) / rewind(dim, n): move the traversal by +1 / -n along dim
+- current(): the element at the current position of the traversal
+- overlaps(tensor): whether a leaf reads the storage of the tensor through a different view (so it cannot be overwritten in place)
+*/
+
+// Leaf: a reference to a tensor
+template <typename T>
+class TensorRef : public TensorExpr<TensorRef<T>>
+{
+public:
+    using value_type = T;
+
+    explicit TensorRef(const Tensor<T> &tensor) : tensor_(tensor) {}
+
+    void broadcast_shape(DimVector &shape) const { shape = broadcast_shapes(shape, this->tensor_.shape_); }
+
+    bool is_flat(const DimVector &shape) const { return this->tensor_.shape_ == shape && this->tensor_.is_contiguous(); }
+
+    inline T flat(size_t i) const { return this->data_[i]; }
+
+    void bind(const DimVector &shape) const
+    {
+        this->data_ = this->tensor_.data_->data() + this->tensor_.offset_;
+        this->strides_ = this->tensor_.broadcast_strides(shape);
+        this->cursor_ = 0;
+    }
+
+    // Pointer to the first element, set by bind() (also used by the flat traversal)
+    void bind_flat() const { this->data_ = this->tensor_.data_->data() + this->tensor_.offset_; }
+
+    inline void step(size_t dim) const { this->cursor_ += this->strides_[dim]; }
+    inline void rewind(size_t dim, size_t n) const { this->cursor_ -= this->strides_[dim] * n; }
+    inline T current() const { return this->data_[this->cursor_]; }
+
+    bool overlaps(const Tensor<T> &dst) const
+    {
+        return this->tensor_.data_ == dst.data_ &&
+               (this->tensor_.offset_ != dst.offset_ || this->tensor_.strides_ != dst.strides_ || this->tensor_.shape_ != dst.shape_);
+    }
+
+private:
+    const Tensor<T> &tensor_;
+    mutable const T *data_ = nullptr;
+    mutable DimVector strides_;
+    mutable size_t cursor_ = 0;
+};
+
+// Leaf: a scaler, broadcast to every element
+template <typename T>
+class ScalerExpr : public TensorExpr<ScalerExpr<T>>
+{
+public:
+    using value_type = T;
+
+    explicit ScalerExpr(const T &value) : value_(value) {}
+
+    void broadcast_shape(DimVector &) const {}
+    bool is_flat(const DimVector &) const { return true; }
+    inline T flat(size_t) const { return this->value_; }
+    void bind(const DimVector &) const {}
+    void bind_flat() const {}
+    inline void step(size_t) const {}
+    inline void rewind(size_t, size_t) const {}
+    inline T current() const { return this->value_; }
+    bool overlaps(const Tensor<T> &) const { return false; }
+
+private:
+    T value_;
+};
+
+template <typename Op, typename E>
+class UnaryExpr : public TensorExpr<UnaryExpr<Op, E>>
+{
+public:
+    using value_type = typename E::value_type;
+
+    UnaryExpr(const E &operand, Op op) : operand_(operand), op_(op) {}
+
+    void broadcast_shape(DimVector &shape) const { this->operand_.broadcast_shape(shape); }
+    bool is_flat(const DimVector &shape) const { return this->operand_.is_flat(shape); }
+    inline value_type flat(size_t i) const { return this->op_(this->operand_.flat(i)); }
+    void bind(const DimVector &shape) const { this->operand_.bind(shape); }
+    void bind_flat() const { this->operand_.bind_flat(); }
+    inline void step(size_t dim) const { this->operand_.step(dim); }
+    inline void rewind(size_t dim, size_t n) const { this->operand_.rewind(dim, n); }
+    inline value_type current() const { return this->op_(this->operand_.current()); }
+    bool overlaps(const Tensor<value_type> &dst) const { return this->operand_.overlaps(dst); }
+
+private:
+    const E operand_;
+    Op op_;
+};
+
+template <typename Op, typename L, typename R>
+class BinaryExpr : public TensorExpr<BinaryExpr<Op, L, R>>
+{
+public:
+    using value_type = typename L::value_type;
+    static_assert(std::is_same_v<value_type, typename R::value_type>, "Both operands of an expression must have the same data type");
+
+    BinaryExpr(const L &lhs, const R &rhs, Op op) : lhs_(lhs), rhs_(rhs), op_(op) {}
+
+    void broadcast_shape(DimVector &shape) const
+    {
+        this->lhs_.broadcast_shape(shape);
+        this->rhs_.broadcast_shape(shape);
+    }
+    bool is_flat(const DimVector &shape) const { return this->lhs_.is_flat(shape) && this->rhs_.is_flat(shape); }
+    inline value_type flat(size_t i) const { return this->op_(this->lhs_.flat(i), this->rhs_.flat(i)); }
+    void bind(const DimVector &shape) const
+    {
+        this->lhs_.bind(shape);
+        this->rhs_.bind(shape);
+    }
+    void bind_flat() const
+    {
+        this->lhs_.bind_flat();
+        this->rhs_.bind_flat();
+    }
+    inline void step(size_t dim) const
+    {
+        this->lhs_.step(dim);
+        this->rhs_.step(dim);
+    }
+    inline void rewind(size_t dim, size_t n) const
+    {
+        this->lhs_.rewind(dim, n);
+        this->rhs_.rewind(dim, n);
+    }
+    inline value_type current() const { return this->op_(this->lhs_.current(), this->rhs_.current()); }
+    bool overlaps(const Tensor<value_type> &dst) const { return this->lhs_.overlaps(dst) || this->rhs_.overlaps(dst); }
+
+private:
+    const L lhs_;
+    const R rhs_;
+    Op op_;
+};
+
+namespace expr_ops
+{
+    struct Sqrt
+    {
+        template <typename T>
+        inline T operator()(const T &x) const { return static_cast<T>(std::sqrt(x)); }
+    };
+
+    struct Abs
+    {
+        template <typename T>
+        inline T operator()(const T &x) const { return static_cast<T>(std::abs(x)); }
+    };
+
+    // Strided traversal of the whole (broadcast) shape, calling fn(value) for every element in row-major order
+    template <typename E, typename Fn>
+    void for_each_element(const E &expr, const DimVector &shape, Fn &&fn)
+    {
+        size_t numel = 1;
+        for (const size_t &dim : shape)
+        {
+            numel *= dim;
+        }
+        if (numel == 0)
+        {
+            return;
+        }
+
+        expr.bind(shape);
+
+        const size_t ndim = shape.size();
+        DimVector counter(ndim, 0);
+
+        for (size_t i = 0; i < numel; ++i)
+        {
+            fn(expr.current());
+
+            // Advance like an odometer, from the innermost dimension
+            for (int64_t dim = static_cast<int64_t>(ndim) - 1; dim >= 0; --dim)
+            {
+                expr.step(dim);
+                if (++counter[dim] < shape[dim])
+                {
+                    break;
+                }
+                expr.rewind(dim, shape[dim]);
+                counter[dim] = 0;
+            }
+        }
+    }
+}
+
+// Opt in to lazy evaluation: wrap a tensor so that the following operators build an expression
+template <typename T>
+inline TensorRef<T> lazy(const Tensor<T> &tensor) { return TensorRef<T>(tensor); }
+
+// Operators between expressions, tensors and scalers. A tensor operand is only wrapped when the other operand is an expression
+#define TENSOR_EXPR_BINARY_OPERATOR(OP, FUNCTOR)                                                                              \
+    template <typename L, typename R>                                                                                         \
+    inline BinaryExpr<FUNCTOR<typename L::value_type>, L, R> operator OP(const TensorExpr<L> &lhs, const TensorExpr<R> &rhs) \
+    {                                                                                                                         \
+        return {lhs.self(), rhs.self(), {}};                                                                                  \
+    }                                                                                                                         \
+    template <typename L>                                                                                                     \
+    inline BinaryExpr<FUNCTOR<typename L::value_type>, L, TensorRef<typename L::value_type>>                                  \
+    operator OP(const TensorExpr<L> &lhs, const Tensor<typename L::value_type> &rhs)                                          \
+    {                                                                                                                         \
+        return {lhs.self(), TensorRef<typename L::value_type>(rhs), {}};                                                      \
+    }                                                                                                                         \
+    template <typename R>                                                                                                     \
+    inline BinaryExpr<FUNCTOR<typename R::value_type>, TensorRef<typename R::value_type>, R>                                  \
+    operator OP(const Tensor<typename R::value_type> &lhs, const TensorExpr<R> &rhs)                                          \
+    {                                                                                                                         \
+        return {TensorRef<typename R::value_type>(lhs), rhs.self(), {}};                                                      \
+    }                                                                                                                         \
+    template <typename L>                                                                                                     \
+    inline BinaryExpr<FUNCTOR<typename L::value_type>, L, ScalerExpr<typename L::value_type>>                                 \
+    operator OP(const TensorExpr<L> &lhs, const typename L::value_type &rhs)                                                  \
+    {                                                                                                                         \
+        return {lhs.self(), ScalerExpr<typename L::value_type>(rhs), {}};                                                     \
+    }                                                                                                                         \
+    template <typename R>                                                                                                     \
+    inline BinaryExpr<FUNCTOR<typename R::value_type>, ScalerExpr<typename R::value_type>, R>                                 \
+    operator OP(const typename R::value_type &lhs, const TensorExpr<R> &rhs)                                                  \
+    {                                                                                                                         \
+        return {ScalerExpr<typename R::value_type>(lhs), rhs.self(), {}};                                                     \
+    }
+
+TENSOR_EXPR_BINARY_OPERATOR(+, std::plus)
+TENSOR_EXPR_BINARY_OPERATOR(-, std::minus)
+TENSOR_EXPR_BINARY_OPERATOR(*, std::multiplies)
+TENSOR_EXPR_BINARY_OPERATOR(/, std::divides)
+
+#undef TENSOR_EXPR_BINARY_OPERATOR
+
+template <typename E>
+inline UnaryExpr<std::negate<typename E::value_type>, E> operator-(const TensorExpr<E> &operand) { return {operand.self(), {}}; }
+
+template <typename E>
+inline UnaryExpr<expr_ops::Sqrt, E> sqrt(const TensorExpr<E> &operand) { return {operand.self(), {}}; }
+
+template <typename E>
+inline UnaryExpr<expr_ops::Abs, E> abs(const TensorExpr<E> &operand) { return {operand.self(), {}}; }
+
+template <typename Derived>
+auto TensorExpr<Derived>::sum(Summation summation) const
+{
+    using T = typename Derived::value_type;
+    const Derived &expr = this->self();
+
+    DimVector shape;
+    expr.broadcast_shape(shape);
+
+    const bool kahan = std::is_floating_point_v<T> && summation == Summation::KAHAN;
+
+    // Sum of the values given to add, with Kahan compensation if requested
+    struct Accumulator
+    {
+        bool kahan;
+        T sum = static_cast<T>(0);
+        T compensation = static_cast<T>(0);
+
+        inline void add(const T &value)
+        {
+            if (!this->kahan)
+            {
+                this->sum += value;
+                return;
+            }
+
+            const T y = value - this->compensation;
+            const T t = this->sum + y;
+            this->compensation = (t - this->sum) - y;
+            this->sum = t;
+        }
+    };
+
+    if (expr.is_flat(shape))
+    {
+        size_t numel = 1;
+        for (const size_t &dim : shape)
+        {
+            numel *= dim;
+        }
+
+        expr.bind_flat();
+
+        // Fixed blocks and a fixed tree, so that the sum does not depend on the number of threads
+        return summation::blocked_sum<T>(numel, summation, [&](size_t begin, size_t end)
+                                         {
+            Accumulator acc{kahan};
+            for (size_t i = begin; i < end; ++i)
+            {
+                acc.add(expr.flat(i));
+            }
+            return acc.sum; });
+    }
+
+    Accumulator acc{kahan};
+    expr_ops::for_each_element(expr, shape, [&](const T &value)
+                               { acc.add(value); });
+    return acc.sum;
+}
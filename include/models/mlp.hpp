@@ -14,6 +14,7 @@ class MLP : public Module {
         virtual Module& eval() override;
 
         inline const Sequential& get_layers() const { return this->layers_; }
+        inline Sequential& get_layers() { return this->layers_; }
         
         /**
          * Get all parameters from the MLP model for optimization
@@ -93,6 +93,15 @@ namespace nn
          */
         Module *get(size_t index) const;
 
+        /**
+         * Replaces the module at a specific index, e.g. by its quantized version.
+         * The container takes the ownership of the new module and deletes the old one.
+         *
+         * @param index The index of the module to replace.
+         * @param module The new module.
+         */
+        void replace(size_t index, Module *module);
+
         /**
          * Get all parameters of contained modules for optimization
          *
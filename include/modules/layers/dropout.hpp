@@ -1,6 +1,5 @@
 #pragma once
 #include "module.hpp"
-#include <random>
 
 namespace nn
 {
@@ -11,12 +10,14 @@ namespace nn
         virtual Tensor<> forward(const Tensor<> &input) override;
         virtual Tensor<> backward(const Tensor<> &grad_output) override;
 
+        // Restart the masks from the given seed. By default, the generator of the layer is seeded from the global generator (see random.hpp)
+        inline void manual_seed(uint64_t seed) { this->gen_.manual_seed(seed); }
+
     private:
         float p_;
         float scale_;
+        // 0 for the dropped elements, 1 / (1 - p) for the kept ones
         Tensor<> mask_cache_;
-        // probability distribution of the dropout
-        bernoulli_distribution pmf_;
-        mt19937 gen_;
+        rng::Generator gen_;
     };
 }
\ No newline at end of file
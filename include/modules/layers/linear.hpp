@@ -1,5 +1,6 @@
 #pragma once
 #include "module.hpp"
+#include "sparse_tensor.hpp"
 
 namespace nn
 {
@@ -12,6 +13,13 @@ namespace nn
         virtual Tensor<> forward(const Tensor<> &input) override;
         virtual Tensor<> backward(const Tensor<> &grad_output) override;
 
+        /**
+         * Forward pass of a sparse batch of shape (batch_size, in_features), in a time proportional to its number of non-zero elements.
+         * The following backward() computes the gradients of the parameters from the sparse input too, and returns an empty tensor
+         * as the gradient of the input (a sparse input is data, not the output of another layer).
+         */
+        Tensor<> forward(const SparseCSR &input);
+
         void reset_parameters();
 
         // setters
@@ -21,6 +29,7 @@ namespace nn
         // getters
         inline const Tensor<> &get_weight() const { return this->weight_; }
         inline const Tensor<> &get_bias() const { return this->bias_; }
+        inline bool has_bias() const { return this->use_bias_; }
         
         // Get parameters for optimization
         virtual void register_parameters(
@@ -36,6 +45,10 @@ namespace nn
         Tensor<> bias_;
         Tensor<> grad_weight_;
         Tensor<> grad_bias_;
+
+        // the input of the last forward pass, if it was sparse (input_cache_ is then empty)
+        SparseCSR sparse_input_cache_;
+        bool sparse_input_ = false;
     };
 
 }
\ No newline at end of file
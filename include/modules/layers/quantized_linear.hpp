@@ -0,0 +1,47 @@
+#pragma once
+#include "module.hpp"
+#include "linear.hpp"
+#include "qtensor.hpp"
+#include "qgemm.hpp"
+
+namespace nn
+{
+
+    /**
+     * Int8 version of a trained Linear layer, for inference.
+     *
+     * The weight is quantized per output channel to [-127, 127] (symmetric, zero point 0) and packed once for the quantized GEMM.
+     * The inputs are quantized per tensor to [0, 127], with the range observed on calibration data (see quantization.hpp).
+     * The products are accumulated in int32, then scaled back to float with the bias added (see qgemm::gemm_u8s8f32).
+     */
+    class QuantizedLinear : public Module
+    {
+    public:
+        /**
+         * @param linear The layer to quantize.
+         * @param input_min, input_max The range of the inputs of the layer.
+         */
+        QuantizedLinear(const Linear &linear, float input_min, float input_max);
+
+        virtual Tensor<> forward(const Tensor<> &input) override;
+
+        // The layer is only used for inference
+        virtual Tensor<> backward(const Tensor<> &grad_output) override;
+
+        // getters
+        inline size_t in_features() const { return this->weight_.rows(); }
+        inline size_t out_features() const { return this->weight_.cols(); }
+        inline const QuantParams &get_input_qparams() const { return this->input_params_; }
+        inline const vector<float> &get_weight_scales() const { return this->weight_scales_; }
+
+        // Size of the quantized weight in bytes (packed integers, column sums and scales)
+        inline size_t weight_bytes() const { return this->weight_.bytes() + this->weight_scales_.size() * sizeof(float); }
+
+    private:
+        QuantParams input_params_;
+        qgemm::PackedMatrix weight_;
+        vector<float> weight_scales_;
+        vector<float> bias_;
+    };
+
+}
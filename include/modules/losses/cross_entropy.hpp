@@ -12,6 +12,7 @@ class CrossEntropyLoss : public Loss {
 
     private:
         Tensor<> softmax_Y_hat_cache_;
+        Tensor<size_t> label_index_cache_; // the labels as a (B, 1) index for gather and scatter_add_
         Softmax softmax_;
     };
 
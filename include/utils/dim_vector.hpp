@@ -0,0 +1,154 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+using namespace std;
+
+/*
+Shape or strides of a tensor, stored inline in a fixed-capacity array instead of on the heap.
+
+A tensor has at most MAX_DIMS dimensions, so creating, copying or broadcasting the metadata of a tensor does not allocate.
+It has the interface of a vector<size_t> (size, [], push_back, resize, insert, iterators...), converts implicitly from and to
+vector<size_t>, and compares equal to a vector<size_t> with the same elements.
+*/
+class DimVector
+{
+public:
+    static constexpr size_t MAX_DIMS = 8;
+
+    using value_type = size_t;
+    using size_type = size_t;
+    using reference = size_t &;
+    using const_reference = const size_t &;
+    using iterator = size_t *;
+    using const_iterator = const size_t *;
+
+    DimVector() = default;
+
+    explicit DimVector(size_t size, size_t value = 0)
+    {
+        this->resize(size, value);
+    }
+
+    DimVector(initializer_list<size_t> dims)
+        : DimVector(dims.begin(), dims.end())
+    {
+    }
+
+    template <typename It, typename = std::enable_if_t<!std::is_integral_v<It>>>
+    DimVector(It first, It last)
+    {
+        check_size(static_cast<size_t>(std::distance(first, last)));
+        for (; first != last; ++first)
+        {
+            this->data_[this->size_++] = static_cast<size_t>(*first);
+        }
+    }
+
+    DimVector(const vector<size_t> &dims)
+        : DimVector(dims.begin(), dims.end())
+    {
+    }
+
+    operator vector<size_t>() const { return vector<size_t>(this->begin(), this->end()); }
+
+    inline size_t size() const { return this->size_; }
+    inline bool empty() const { return this->size_ == 0; }
+    static constexpr size_t capacity() { return MAX_DIMS; }
+
+    inline size_t &operator[](size_t i) { return this->data_[i]; }
+    inline const size_t &operator[](size_t i) const { return this->data_[i]; }
+
+    inline size_t *data() { return this->data_; }
+    inline const size_t *data() const { return this->data_; }
+
+    inline iterator begin() { return this->data_; }
+    inline iterator end() { return this->data_ + this->size_; }
+    inline const_iterator begin() const { return this->data_; }
+    inline const_iterator end() const { return this->data_ + this->size_; }
+
+    inline size_t &front() { return this->data_[0]; }
+    inline const size_t &front() const { return this->data_[0]; }
+    inline size_t &back() { return this->data_[this->size_ - 1]; }
+    inline const size_t &back() const { return this->data_[this->size_ - 1]; }
+
+    inline void push_back(size_t value)
+    {
+        check_size(this->size_ + 1);
+        this->data_[this->size_++] = value;
+    }
+
+    inline void pop_back() { --this->size_; }
+
+    inline void clear() { this->size_ = 0; }
+
+    // Nothing to reserve, the capacity is fixed
+    inline void reserve(size_t size) const { check_size(size); }
+
+    void resize(size_t size, size_t value = 0)
+    {
+        check_size(size);
+        for (size_t i = this->size_; i < size; ++i)
+        {
+            this->data_[i] = value;
+        }
+        this->size_ = size;
+    }
+
+    template <typename It, typename = std::enable_if_t<!std::is_integral_v<It>>>
+    iterator insert(const_iterator pos, It first, It last)
+    {
+        const size_t index = static_cast<size_t>(pos - this->begin());
+        const size_t count = static_cast<size_t>(std::distance(first, last));
+        check_size(this->size_ + count);
+
+        std::copy_backward(this->begin() + index, this->end(), this->end() + count);
+        std::copy(first, last, this->begin() + index);
+        this->size_ += count;
+        return this->begin() + index;
+    }
+
+    iterator insert(const_iterator pos, initializer_list<size_t> dims) { return this->insert(pos, dims.begin(), dims.end()); }
+
+    iterator insert(const_iterator pos, size_t value) { return this->insert(pos, &value, &value + 1); }
+
+    iterator erase(const_iterator pos)
+    {
+        const size_t index = static_cast<size_t>(pos - this->begin());
+        std::copy(this->begin() + index + 1, this->end(), this->begin() + index);
+        --this->size_;
+        return this->begin() + index;
+    }
+
+    friend bool operator==(const DimVector &a, const DimVector &b) { return std::equal(a.begin(), a.end(), b.begin(), b.end()); }
+    friend bool operator==(const DimVector &a, const vector<size_t> &b) { return std::equal(a.begin(), a.end(), b.begin(), b.end()); }
+    friend bool operator==(const vector<size_t> &a, const DimVector &b) { return b == a; }
+
+    friend ostream &operator<<(ostream &os, const DimVector &dims)
+    {
+        os << "[";
+        for (size_t i = 0; i < dims.size(); ++i)
+        {
+            os << (i > 0 ? ", " : "") << dims[i];
+        }
+        return os << "]";
+    }
+
+private:
+    size_t data_[MAX_DIMS] = {};
+    size_t size_ = 0;
+
+    static void check_size(size_t size)
+    {
+        if (size > MAX_DIMS)
+        {
+            throw invalid_argument("A tensor can have at most " + to_string(MAX_DIMS) + " dimensions");
+        }
+    }
+};
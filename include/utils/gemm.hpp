@@ -0,0 +1,94 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include "half.hpp"
+using namespace std;
+
+/*
+General matrix multiplication for float matrices.
+
+    C = alpha * A * B + beta * C
+
+where A is M x K, B is K x N and C is M x N. Every matrix is described by a pointer to its first element,
+its row stride and its column stride (in elements), so views (e.g. a slice of a bigger tensor) are multiplied in place.
+
+The implementation follows the BLIS / GotoBLAS design:
+- the loops over N, K and M are tiled by NC, KC and MC, so that a KC x NC panel of B stays in the L3 cache,
+  a MC x KC block of A stays in the L2 cache, and a KC x NR sliver of B stays in the L1 cache
+- the blocks are packed into contiguous buffers, in the order the micro-kernel reads them
+- the micro-kernel keeps a MR x NR tile of C in registers and updates it with one rank-1 update per k
+- the MC x NC blocks of C are split among the threads of the thread pool (see parallel.hpp)
+
+The micro-kernel is selected from the instruction set of the simd kernels (AVX-512, AVX2 + FMA, or a portable one).
+
+A and B may also be bf16 or fp16 matrices (see half.hpp). They are converted to float while being packed, so the micro-kernels,
+the accumulation and C stay in float: the products and sums are as accurate as for float inputs, and only the inputs are rounded.
+*/
+namespace gemm
+{
+    /**
+     * C = alpha * A * B + beta * C
+     *
+     * @param M The number of rows of A and C.
+     * @param N The number of columns of B and C.
+     * @param K The number of columns of A and rows of B.
+     * @param rsa, csa The row and column strides of A.
+     * @param rsb, csb The row and column strides of B.
+     * @param rsc, csc The row and column strides of C. C must not overlap A or B.
+     *
+     * When beta is 0, C does not need to be initialized.
+     */
+    void sgemm(size_t M, size_t N, size_t K,
+               float alpha,
+               const float *A, size_t rsa, size_t csa,
+               const float *B, size_t rsb, size_t csb,
+               float beta,
+               float *C, size_t rsc, size_t csc);
+
+    // Mixed precision: bf16 or fp16 inputs, float accumulation and output
+    void sgemm(size_t M, size_t N, size_t K,
+               float alpha,
+               const bf16 *A, size_t rsa, size_t csa,
+               const bf16 *B, size_t rsb, size_t csb,
+               float beta,
+               float *C, size_t rsc, size_t csc);
+
+    void sgemm(size_t M, size_t N, size_t K,
+               float alpha,
+               const fp16 *A, size_t rsa, size_t csa,
+               const fp16 *B, size_t rsb, size_t csb,
+               float beta,
+               float *C, size_t rsc, size_t csc);
+
+    /**
+     * Strided-batched GEMM: C_b = alpha * A_b * B_b + beta * C_b for b in [0, batch_count),
+     * where the matrices of batch b start at A + b * stride_a, B + b * stride_b and C + b * stride_c.
+     *
+     * A stride of 0 shares the same matrix between all the batches (broadcasting).
+     * When the matrices are small, the batches are split among the threads, each thread running whole GEMMs.
+     * When B is shared and the batches of A and C are stacked rows, the batch is folded into a single GEMM with batch_count * M rows.
+     */
+    void sgemm_strided_batched(size_t batch_count, size_t M, size_t N, size_t K,
+                               float alpha,
+                               const float *A, size_t rsa, size_t csa, size_t stride_a,
+                               const float *B, size_t rsb, size_t csb, size_t stride_b,
+                               float beta,
+                               float *C, size_t rsc, size_t csc, size_t stride_c);
+
+    void sgemm_strided_batched(size_t batch_count, size_t M, size_t N, size_t K,
+                               float alpha,
+                               const bf16 *A, size_t rsa, size_t csa, size_t stride_a,
+                               const bf16 *B, size_t rsb, size_t csb, size_t stride_b,
+                               float beta,
+                               float *C, size_t rsc, size_t csc, size_t stride_c);
+
+    void sgemm_strided_batched(size_t batch_count, size_t M, size_t N, size_t K,
+                               float alpha,
+                               const fp16 *A, size_t rsa, size_t csa, size_t stride_a,
+                               const fp16 *B, size_t rsb, size_t csb, size_t stride_b,
+                               float beta,
+                               float *C, size_t rsc, size_t csc, size_t stride_c);
+
+    // Name of the micro-kernel in use, e.g. "avx2 6x16"
+    string kernel_name();
+}
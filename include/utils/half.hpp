@@ -0,0 +1,170 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+using namespace std;
+
+/*
+16-bit floating-point element types.
+
+- bf16 (bfloat16): 8 exponent bits and 7 mantissa bits. The range of float, with about 3 significant digits.
+- fp16 (IEEE 754 half precision): 5 exponent bits and 10 mantissa bits. Up to 65504, with about 3.3 significant digits.
+
+They halve the memory and the bandwidth of float tensors. They are storage types: they convert implicitly from and to float,
+and the arithmetic is done in float, then rounded back to 16 bits when the result is stored:
+
+    Tensor<bf16> weight = Tensor<>({256, 256}, 0.5f).dtype<bf16>();
+    Tensor<bf16> y = x.matmul(weight);  // accumulated in float (see gemm.hpp)
+
+The conversions from float round to the nearest even value. bf16 flushes the subnormal floats (below 1.2e-38) to zero, as the
+AVX-512 BF16 instruction does, so that every instruction set gives the same bits (see simd::convert for the vectorized conversions).
+*/
+
+namespace half_bits
+{
+    inline uint32_t float_bits(float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    inline float bits_float(uint32_t bits)
+    {
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    inline uint16_t float_to_bf16(float value)
+    {
+        const uint32_t bits = float_bits(value);
+
+        // NaN: keep the sign and the upper bits of the payload, and make it quiet
+        if ((bits & 0x7fffffffu) > 0x7f800000u)
+        {
+            return static_cast<uint16_t>((bits >> 16) | 0x0040u);
+        }
+
+        // Zero and subnormals: signed zero
+        if ((bits & 0x7f800000u) == 0)
+        {
+            return static_cast<uint16_t>((bits >> 16) & 0x8000u);
+        }
+
+        // Round to nearest even (a carry into the exponent gives the next power of two, or infinity)
+        return static_cast<uint16_t>((bits + 0x7fffu + ((bits >> 16) & 1u)) >> 16);
+    }
+
+    inline float bf16_to_float(uint16_t bits)
+    {
+        return bits_float(static_cast<uint32_t>(bits) << 16);
+    }
+
+    inline uint16_t float_to_fp16(float value)
+    {
+        uint32_t bits = float_bits(value);
+        const uint32_t sign = bits & 0x80000000u;
+        bits ^= sign;
+
+        uint32_t result;
+
+        if (bits >= 0x47800000u) // 65536 and above, infinity and NaN
+        {
+            // NaN: keep the upper bits of the payload, and make it quiet
+            result = bits > 0x7f800000u ? 0x7e00u | ((bits >> 13) & 0x3ffu) : 0x7c00u;
+        }
+        else if (bits < 0x38800000u) // below 2^-14, the result is subnormal or zero
+        {
+            // Adding 0.5 aligns the mantissa to the subnormal step of fp16, and the float addition rounds it to nearest even
+            result = float_bits(bits_float(bits) + 0.5f) - 0x3f000000u;
+        }
+        else
+        {
+            // Rebias the exponent, and round the 13 dropped mantissa bits to nearest even
+            const uint32_t mantissa_odd = (bits >> 13) & 1u;
+            result = (bits + 0xc8000fffu + mantissa_odd) >> 13;
+        }
+
+        return static_cast<uint16_t>(result | (sign >> 16));
+    }
+
+    inline float fp16_to_float(uint16_t half)
+    {
+        const uint32_t sign = static_cast<uint32_t>(half & 0x8000u) << 16;
+        const uint32_t exponent = half & 0x7c00u;
+        uint32_t bits = static_cast<uint32_t>(half & 0x7fffu) << 13;
+
+        if (exponent == 0x7c00u) // infinity and NaN
+        {
+            bits |= 0x7f800000u;
+            if (bits & 0x007fffffu)
+            {
+                bits |= 0x00400000u;
+            }
+        }
+        else if (exponent == 0) // zero and subnormals: the value is the mantissa times 2^-24
+        {
+            bits = float_bits(bits_float(bits + 0x38800000u) - bits_float(0x38800000u));
+        }
+        else
+        {
+            bits += 0x38000000u; // rebias the exponent
+        }
+
+        return bits_float(bits | sign);
+    }
+}
+
+// bfloat16
+struct bf16
+{
+    uint16_t bits;
+
+    bf16() = default;
+    bf16(float value) : bits(half_bits::float_to_bf16(value)) {}
+
+    operator float() const { return half_bits::bf16_to_float(this->bits); }
+
+    static bf16 from_bits(uint16_t bits)
+    {
+        bf16 result;
+        result.bits = bits;
+        return result;
+    }
+
+    bf16 &operator+=(float value) { return *this = static_cast<float>(*this) + value; }
+    bf16 &operator-=(float value) { return *this = static_cast<float>(*this) - value; }
+    bf16 &operator*=(float value) { return *this = static_cast<float>(*this) * value; }
+    bf16 &operator/=(float value) { return *this = static_cast<float>(*this) / value; }
+};
+
+// IEEE 754 half precision
+struct fp16
+{
+    uint16_t bits;
+
+    fp16() = default;
+    fp16(float value) : bits(half_bits::float_to_fp16(value)) {}
+
+    operator float() const { return half_bits::fp16_to_float(this->bits); }
+
+    static fp16 from_bits(uint16_t bits)
+    {
+        fp16 result;
+        result.bits = bits;
+        return result;
+    }
+
+    fp16 &operator+=(float value) { return *this = static_cast<float>(*this) + value; }
+    fp16 &operator-=(float value) { return *this = static_cast<float>(*this) - value; }
+    fp16 &operator*=(float value) { return *this = static_cast<float>(*this) * value; }
+    fp16 &operator/=(float value) { return *this = static_cast<float>(*this) / value; }
+};
+
+static_assert(sizeof(bf16) == 2 && std::is_trivial_v<bf16>, "bf16 must be a trivial 16-bit type");
+static_assert(sizeof(fp16) == 2 && std::is_trivial_v<fp16>, "fp16 must be a trivial 16-bit type");
+
+// Check if T is one of the 16-bit floating-point types
+template <typename T>
+inline constexpr bool is_half_v = std::is_same_v<T, bf16> || std::is_same_v<T, fp16>;
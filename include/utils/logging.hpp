@@ -0,0 +1,190 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <sstream>
+#include <string>
+using namespace std;
+
+/*
+Logging and tracing of the library.
+
+    NN_LOG_DEBUG(CONV, "output shape: " << output_height << " x " << output_width);
+    NN_TRACE_SCOPE(CONV, "Conv2d::backward"); // logs the time spent until the end of the scope
+
+Every message has a level (TRACE < DEBUG < INFO < WARN < ERROR) and a subsystem. It is filtered twice:
+
+- At compile time: the statements below NEURALNET_LOG_LEVEL (the CMake option of the same name, INFO by default) are removed
+  by the preprocessor, their arguments are not even compiled. Configure with -DNEURALNET_LOG_LEVEL=TRACE to keep all of them.
+
+- At runtime, per subsystem (INFO by default): the message is only formatted when its level is enabled, so a disabled statement
+  costs one relaxed atomic load. The levels are set with set_level(), configure(), or the environment variable
+  NEURALNET_LOG="debug" or NEURALNET_LOG="warn,conv=trace" (a level for all the subsystems, then levels for some of them).
+
+A message is formatted into a string and written with a single call to the sink: stderr by default, without flushing the streams.
+*/
+namespace logging
+{
+    enum class Level
+    {
+        TRACE,
+        DEBUG,
+        INFO,
+        WARN,
+        ERROR,
+        OFF
+    };
+
+    enum class Subsystem
+    {
+        TENSOR,
+        MODULES,
+        CONV,
+        OPTIMIZER,
+        DATASET,
+        QUANTIZATION,
+        COUNT // number of subsystems, not a subsystem
+    };
+
+    // Function receiving the enabled messages, without a new line
+    using Sink = function<void(Level, Subsystem, const string &)>;
+
+    namespace detail
+    {
+        // Runtime level of every subsystem
+        extern atomic<int> thresholds[static_cast<size_t>(Subsystem::COUNT)];
+    }
+
+    // Check if the messages of the given level are enabled at runtime for the subsystem
+    inline bool is_enabled(Level level, Subsystem subsystem)
+    {
+        return static_cast<int>(level) >= detail::thresholds[static_cast<size_t>(subsystem)].load(memory_order_relaxed);
+    }
+
+    // Set the runtime level of every subsystem
+    void set_level(Level level);
+
+    // Set the runtime level of one subsystem
+    void set_level(Subsystem subsystem, Level level);
+
+    Level get_level(Subsystem subsystem);
+
+    /**
+     * Set the runtime levels from a specification such as "warn,conv=trace,dataset=info", read from left to right.
+     * It is the syntax of the environment variable NEURALNET_LOG, which is applied at startup.
+     *
+     * @throws invalid_argument If a level or a subsystem is unknown.
+     */
+    void configure(const string &spec);
+
+    // Send the messages to the sink instead of stderr. An empty sink restores stderr
+    void set_sink(Sink sink);
+
+    // Give a message to the sink. It is called by the NN_LOG_* macros once the level is known to be enabled
+    void write(Level level, Subsystem subsystem, const string &message);
+
+    // Lower case names, as in NEURALNET_LOG
+    string level_name(Level level);
+    string subsystem_name(Subsystem subsystem);
+
+    // Parse a name of level or subsystem (case insensitive). Throws invalid_argument if it is unknown
+    Level parse_level(const string &name);
+    Subsystem parse_subsystem(const string &name);
+
+    /*
+    Log the time between the construction and the destruction at TRACE level, if it is enabled at construction.
+    Use NN_TRACE_SCOPE, which is removed at compile time with the TRACE statements.
+    */
+    class ScopedTrace
+    {
+    private:
+        Subsystem subsystem_;
+        const char *name_;
+        bool enabled_;
+        chrono::steady_clock::time_point start_;
+
+    public:
+        ScopedTrace(Subsystem subsystem, const char *name)
+            : subsystem_(subsystem), name_(name), enabled_(is_enabled(Level::TRACE, subsystem))
+        {
+            if (this->enabled_)
+            {
+                this->start_ = chrono::steady_clock::now();
+            }
+        }
+
+        ~ScopedTrace()
+        {
+            if (this->enabled_)
+            {
+                const chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - this->start_;
+                ostringstream message;
+                message << this->name_ << " took " << elapsed.count() << " ms";
+                write(Level::TRACE, this->subsystem_, message.str());
+            }
+        }
+
+        ScopedTrace(const ScopedTrace &) = delete;
+        ScopedTrace &operator=(const ScopedTrace &) = delete;
+    };
+}
+
+// Compile-time levels, compared with NEURALNET_LOG_LEVEL
+#define NEURALNET_LOG_LEVEL_TRACE 0
+#define NEURALNET_LOG_LEVEL_DEBUG 1
+#define NEURALNET_LOG_LEVEL_INFO 2
+#define NEURALNET_LOG_LEVEL_WARN 3
+#define NEURALNET_LOG_LEVEL_ERROR 4
+#define NEURALNET_LOG_LEVEL_OFF 5
+
+#ifndef NEURALNET_LOG_LEVEL
+#define NEURALNET_LOG_LEVEL NEURALNET_LOG_LEVEL_INFO
+#endif
+
+// message is anything that can be streamed into an ostream, e.g. "size " << size
+#define NN_LOG_IMPL(level, subsystem, message)                                          \
+    do                                                                                  \
+    {                                                                                   \
+        if (logging::is_enabled(level, logging::Subsystem::subsystem))                  \
+        {                                                                               \
+            ostringstream nn_log_stream_;                                               \
+            nn_log_stream_ << message;                                                  \
+            logging::write(level, logging::Subsystem::subsystem, nn_log_stream_.str()); \
+        }                                                                               \
+    } while (false)
+
+#define NN_LOG_CONCAT_IMPL(a, b) a##b
+#define NN_LOG_CONCAT(a, b) NN_LOG_CONCAT_IMPL(a, b)
+
+#if NEURALNET_LOG_LEVEL <= NEURALNET_LOG_LEVEL_TRACE
+#define NN_LOG_TRACE(subsystem, message) NN_LOG_IMPL(logging::Level::TRACE, subsystem, message)
+#define NN_TRACE_SCOPE(subsystem, name) logging::ScopedTrace NN_LOG_CONCAT(nn_trace_scope_, __LINE__)(logging::Subsystem::subsystem, name)
+#else
+#define NN_LOG_TRACE(subsystem, message) ((void)0)
+#define NN_TRACE_SCOPE(subsystem, name) ((void)0)
+#endif
+
+#if NEURALNET_LOG_LEVEL <= NEURALNET_LOG_LEVEL_DEBUG
+#define NN_LOG_DEBUG(subsystem, message) NN_LOG_IMPL(logging::Level::DEBUG, subsystem, message)
+#else
+#define NN_LOG_DEBUG(subsystem, message) ((void)0)
+#endif
+
+#if NEURALNET_LOG_LEVEL <= NEURALNET_LOG_LEVEL_INFO
+#define NN_LOG_INFO(subsystem, message) NN_LOG_IMPL(logging::Level::INFO, subsystem, message)
+#else
+#define NN_LOG_INFO(subsystem, message) ((void)0)
+#endif
+
+#if NEURALNET_LOG_LEVEL <= NEURALNET_LOG_LEVEL_WARN
+#define NN_LOG_WARN(subsystem, message) NN_LOG_IMPL(logging::Level::WARN, subsystem, message)
+#else
+#define NN_LOG_WARN(subsystem, message) ((void)0)
+#endif
+
+#if NEURALNET_LOG_LEVEL <= NEURALNET_LOG_LEVEL_ERROR
+#define NN_LOG_ERROR(subsystem, message) NN_LOG_IMPL(logging::Level::ERROR, subsystem, message)
+#else
+#define NN_LOG_ERROR(subsystem, message) ((void)0)
+#endif
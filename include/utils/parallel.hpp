@@ -0,0 +1,53 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+using namespace std;
+
+/*
+Shared thread pool used by the compute kernels (GEMM, copies, reductions...).
+
+The number of threads defaults to the number of hardware threads, and can be set with the environment variable
+NEURALNET_NUM_THREADS or with set_num_threads(). A parallel region started from inside another parallel region runs serially on the calling thread.
+*/
+
+// Number of threads used by parallel_for (including the calling thread)
+size_t get_num_threads();
+
+// Set the number of threads used by parallel_for. 0 means the number of hardware threads
+void set_num_threads(size_t num_threads);
+
+// Check if the calling thread is currently running inside a parallel region
+bool in_parallel_region();
+
+/**
+ * Split [begin, end) into contiguous chunks and call fn(chunk_begin, chunk_end) for each of them, in parallel.
+ *
+ * The range is split into at most get_num_threads() chunks of at least grain_size elements, so small ranges run on the calling thread only.
+ * The call returns once every chunk is done. If fn throws, the first exception is rethrown on the calling thread.
+ *
+ * @param begin The first index.
+ * @param end The index past the last one.
+ * @param grain_size The minimum number of indices of a chunk.
+ * @param fn The function called for each chunk.
+ */
+void parallel_for(size_t begin, size_t end, size_t grain_size, const function<void(size_t, size_t)> &fn);
+
+/**
+ * Same as above, for a callable of any type. A range of at most grain_size indices calls fn directly on the calling thread,
+ * so the small element-wise operations do not pay for the type erasure of std::function.
+ */
+template <typename Fn>
+void parallel_for(size_t begin, size_t end, size_t grain_size, Fn &&fn)
+{
+    if (end <= begin + grain_size)
+    {
+        if (begin < end)
+        {
+            fn(begin, end);
+        }
+        return;
+    }
+
+    const function<void(size_t, size_t)> erased = std::ref(fn);
+    parallel_for(begin, end, grain_size, erased);
+}
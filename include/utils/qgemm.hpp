@@ -0,0 +1,86 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+using namespace std;
+
+/*
+Quantized matrix multiplication: uint8 x int8 -> int32.
+
+    C = A * B
+
+where A is a M x K matrix of uint8 (the quantized activations) and B a K x N matrix of int8 (the quantized weights).
+B is packed once (PackedMatrix), since the weights of a layer do not change during inference.
+
+The kernels multiply groups of 4 consecutive k at once: VPDPBUSD on CPUs with AVX-512 VNNI, otherwise PMADDUBSW + PMADDWD
+(AVX-512 BW, AVX2), or a portable loop. PMADDUBSW adds pairs of products into int16 with saturation, so the values are restricted to
+A in [0, 127] and B in [-127, 127]: the sum of a pair is then at most 2 * 127 * 127 = 32258, it never saturates, and every kernel
+gives exactly the same result.
+*/
+namespace qgemm
+{
+    // Number of columns of a packed panel of B, and of the tiles of C computed by the kernels
+    constexpr size_t PANEL_COLS = 16;
+
+    // Largest value of A, and largest magnitude of B, for which the kernels cannot saturate
+    constexpr int32_t A_MAX = 127;
+    constexpr int32_t B_MAX = 127;
+
+    /*
+    A K x N int8 matrix packed for the kernels: panels of PANEL_COLS columns, in which each group of 4 consecutive k of a column
+    is contiguous. The last panel and the last group are padded with zeros.
+    */
+    class PackedMatrix
+    {
+    public:
+        PackedMatrix() = default;
+
+        // Pack the K x N matrix B with row stride rsb and column stride csb. Its values must be in [-B_MAX, B_MAX]
+        PackedMatrix(const int8_t *B, size_t K, size_t N, size_t rsb, size_t csb);
+
+        inline size_t rows() const { return this->K_; }
+        inline size_t cols() const { return this->N_; }
+
+        // Number of groups of 4 rows (K rounded up to a multiple of 4, divided by 4)
+        inline size_t groups() const { return (this->K_ + 3) / 4; }
+
+        // Packed panel of the columns [panel * PANEL_COLS, (panel + 1) * PANEL_COLS)
+        inline const int8_t *panel(size_t panel) const { return this->data_.data() + panel * this->groups() * 4 * PANEL_COLS; }
+
+        // Sums of the columns of B, used to subtract the zero point of A
+        inline const vector<int32_t> &column_sums() const { return this->column_sums_; }
+
+        // Size of the packed matrix in bytes
+        inline size_t bytes() const { return this->data_.size() + this->column_sums_.size() * sizeof(int32_t); }
+
+    private:
+        size_t K_ = 0;
+        size_t N_ = 0;
+        vector<int8_t> data_;
+        vector<int32_t> column_sums_;
+    };
+
+    /**
+     * C = A * B, with int32 accumulation.
+     *
+     * @param A M x K row-major matrix with leading dimension lda. Its values must be in [0, A_MAX].
+     * @param C M x N row-major matrix with leading dimension ldc. It does not need to be initialized.
+     */
+    void gemm_u8s8s32(size_t M, const uint8_t *A, size_t lda, const PackedMatrix &B, int32_t *C, size_t ldc);
+
+    /**
+     * Quantized GEMM with a float output, for a layer whose activations have the zero point a_zero_point:
+     *
+     *     C[i][j] = scales[j] * (sum_k A[i][k] * B[k][j] - a_zero_point * sum_k B[k][j]) + bias[j]
+     *
+     * scales[j] is the product of the scales of A and of the column j of B. bias may be null.
+     * The int32 tiles are dequantized while they are still in the L1 cache.
+     */
+    void gemm_u8s8f32(size_t M, const uint8_t *A, size_t lda, int32_t a_zero_point, const PackedMatrix &B,
+                      const float *scales, const float *bias, float *C, size_t ldc);
+
+    // Name of the kernel in use, e.g. "avx512 vnni 8x16"
+    string kernel_name();
+}
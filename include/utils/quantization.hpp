@@ -0,0 +1,62 @@
+#pragma once
+#include <vector>
+#include "tensor.hpp"
+#include "qtensor.hpp"
+#include "sequential.hpp"
+#include "mlp.hpp"
+#include "mnist.hpp"
+using namespace std;
+
+/*
+Post-training quantization of the Linear layers of a trained model, for inference on CPUs.
+
+    MLP model(784, {128, 64, 10});
+    // ... train the model
+    nn::quantize_linear_layers(model, train_loader, 16); // calibrate on 16 batches
+
+1. Calibration: the calibration inputs are passed through the model in evaluation mode, and the range of the inputs of every Linear layer
+   is recorded by a MinMaxObserver.
+2. Conversion: every Linear layer is replaced by a QuantizedLinear layer (see quantized_linear.hpp), which quantizes its inputs with the
+   observed range and its weights per output channel.
+
+The quantized model can only be used for inference.
+*/
+namespace nn
+{
+
+    // Track the minimum and maximum of the values it observes
+    class MinMaxObserver
+    {
+    public:
+        void observe(const Tensor<> &x);
+
+        inline bool empty() const { return this->count_ == 0; }
+        inline float min() const { return this->min_; }
+        inline float max() const { return this->max_; }
+
+        // The quantization parameters of the observed range (see choose_qparams)
+        QuantParams qparams(int32_t qmin, int32_t qmax, bool symmetric = false) const;
+
+    private:
+        float min_ = 0.0f;
+        float max_ = 0.0f;
+        size_t count_ = 0;
+    };
+
+    /**
+     * Calibrate on the inputs and replace the Linear layers of the model (including the ones of nested Sequential containers and MLPs)
+     * by QuantizedLinear layers. The model is set to evaluation mode.
+     *
+     * @param calibration_inputs Batches of representative inputs of the model.
+     * @return The number of layers replaced.
+     */
+    size_t quantize_linear_layers(Sequential &model, const vector<Tensor<>> &calibration_inputs);
+    size_t quantize_linear_layers(MLP &model, const vector<Tensor<>> &calibration_inputs);
+
+    /**
+     * Calibrate on the first num_batches batches of the loader (which is reset afterwards).
+     */
+    size_t quantize_linear_layers(Sequential &model, MNIST &loader, size_t num_batches);
+    size_t quantize_linear_layers(MLP &model, MNIST &loader, size_t num_batches);
+
+}
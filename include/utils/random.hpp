@@ -0,0 +1,61 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+using namespace std;
+
+/*
+Counter-based random number generation with Philox4x32-10 (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3").
+
+A Philox generator has no state to update from one number to the next. Block c of the stream of a seed is philox(seed, c), four 32-bit numbers
+computed by 10 rounds of multiplications and xors. A fill of n elements reserves the next blocks of the generator (n / 4, rounded up to a batch
+of 64 blocks), and element i is computed from the index i and the first reserved block alone. The elements are therefore split among the threads
+freely, and the result is identical for any number of threads.
+
+The global generator is seeded from the environment variable NEURALNET_SEED if it is set, or from random_device otherwise, and can be reseeded
+with manual_seed(). A module can own its generator (e.g. Dropout::manual_seed), so that its random numbers do not depend on the other modules.
+*/
+namespace rng
+{
+    class Generator
+    {
+    private:
+        uint64_t seed_;
+        atomic<uint64_t> offset_ = 0; // index of the next unused block
+
+    public:
+        explicit Generator(uint64_t seed);
+        Generator(const Generator &other);
+        Generator &operator=(const Generator &other);
+
+        // Restart the stream of the given seed
+        void manual_seed(uint64_t seed);
+
+        inline uint64_t seed() const { return this->seed_; }
+        inline uint64_t offset() const { return this->offset_.load(memory_order_relaxed); }
+
+        // Reserve the next num_blocks blocks of the stream, and return the index of the first one. Safe to call from several threads
+        uint64_t reserve(uint64_t num_blocks);
+
+        // 64 random bits (e.g. the seed of another generator)
+        uint64_t next_u64();
+    };
+
+    // The generator used when none is given
+    Generator &default_generator();
+
+    // Reseed the global generator
+    void manual_seed(uint64_t seed);
+
+    // One block of Philox4x32-10: four 32-bit numbers from a 128-bit counter and a 64-bit key
+    void philox4x32(const uint32_t counter[4], const uint32_t key[2], uint32_t out[4]);
+
+    // n numbers uniformly distributed in [low, high)
+    void uniform(Generator &gen, float *out, size_t n, float low = 0.0f, float high = 1.0f);
+
+    // n numbers normally distributed (Box-Muller transform of the uniform numbers of each block)
+    void normal(Generator &gen, float *out, size_t n, float mean = 0.0f, float std = 1.0f);
+
+    // n numbers which are 1 with probability p, and 0 otherwise
+    void bernoulli(Generator &gen, float *out, size_t n, float p = 0.5f);
+}
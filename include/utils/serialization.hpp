@@ -0,0 +1,222 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include "tensor.hpp"
+#include "module.hpp"
+using namespace std;
+
+/*
+Binary format of named tensors, in the spirit of safetensors: a small header describing the tensors, followed by their raw data.
+
+    offset 0     "NNTENSOR"                      magic, 8 bytes
+                 u32 version, u32 count          (version 1)
+                 u64 data_start                  offset of the first tensor
+                 count x entry:
+                     u32 name_size, name         (not null terminated)
+                     u8 dtype, u8 ndim
+                     ndim x u64 shape
+                     u64 offset, u64 nbytes      offset of the data from the beginning of the file
+    data_start   the data of every tensor, contiguous in row-major order, at an offset that is a multiple of ALIGNMENT
+
+The integers and the elements are little-endian.
+
+A TensorFile maps the file in memory (mmap) and the tensors it returns are backed by the mapping, so loading copies nothing:
+the pages are read from the OS page cache the first time they are touched, and are shared by all the processes mapping the same file.
+The mapping is private: writing to a loaded tensor (e.g. an optimizer step) copies the written pages only, and never modifies the file.
+
+    serialization::TensorWriter writer;
+    writer.add("weight", weight);
+    writer.write("weights.nnt");
+
+    serialization::TensorFile file("weights.nnt");
+    Tensor<> weight = file.get<float>("weight");
+*/
+namespace serialization
+{
+    // Alignment of the data of every tensor in the file, in bytes (the alignment of the tensor storage)
+    constexpr size_t ALIGNMENT = memory::ALIGNMENT;
+
+    enum class DType : uint8_t
+    {
+        FLOAT32,
+        FLOAT64,
+        BFLOAT16,
+        FLOAT16,
+        INT8,
+        UINT8,
+        INT32,
+        INT64
+    };
+
+    template <typename T>
+    constexpr DType dtype_of()
+    {
+        if constexpr (is_same_v<T, float>)
+            return DType::FLOAT32;
+        else if constexpr (is_same_v<T, double>)
+            return DType::FLOAT64;
+        else if constexpr (is_same_v<T, bf16>)
+            return DType::BFLOAT16;
+        else if constexpr (is_same_v<T, fp16>)
+            return DType::FLOAT16;
+        else if constexpr (is_same_v<T, int8_t>)
+            return DType::INT8;
+        else if constexpr (is_same_v<T, uint8_t>)
+            return DType::UINT8;
+        else if constexpr (is_same_v<T, int32_t>)
+            return DType::INT32;
+        else if constexpr (is_same_v<T, int64_t>)
+            return DType::INT64;
+        else
+            static_assert(!is_same_v<T, T>, "The tensor type cannot be serialized");
+    }
+
+    // Size of an element, in bytes
+    size_t dtype_size(DType dtype);
+
+    string dtype_name(DType dtype);
+
+    // Collects tensors, then writes them to a file
+    class TensorWriter
+    {
+    private:
+        struct Entry
+        {
+            string name;
+            DType dtype;
+            DimVector shape;
+            shared_ptr<const void> tensor; // keeps the contiguous elements alive
+            const void *data;
+            size_t nbytes;
+        };
+
+        vector<Entry> entries_;
+
+        void add_entry(Entry entry);
+
+    public:
+        /**
+         * Add a tensor, which is written contiguously (a view is copied). The tensor is not copied otherwise,
+         * so it must not be modified until write() is called.
+         *
+         * @throws invalid_argument If a tensor of the same name was added, or if the tensor has no storage.
+         */
+        template <typename T>
+        void add(const string &name, const Tensor<T> &tensor)
+        {
+            const shared_ptr<const Tensor<T>> contiguous = make_shared<const Tensor<T>>(tensor.contiguous());
+
+            if (contiguous->data() == nullptr)
+            {
+                throw invalid_argument("Cannot serialize the tensor " + name + " without storage");
+            }
+
+            this->add_entry({name, dtype_of<T>(), tensor.shapes(), contiguous, contiguous->data(), contiguous->size() * sizeof(T)});
+        }
+
+        inline size_t size() const { return this->entries_.size(); }
+
+        /**
+         * Write the tensors in the order in which they were added. The file is written next to path and renamed,
+         * so a reader never sees a partially written file.
+         *
+         * @throws runtime_error If the file cannot be written.
+         */
+        void write(const string &path) const;
+    };
+
+    struct MappedFile;
+
+    // Tensors of a file, backed by a memory mapping of the file
+    class TensorFile
+    {
+    private:
+        struct Entry
+        {
+            string name;
+            DType dtype;
+            DimVector shape;
+            size_t offset;
+            size_t nbytes;
+        };
+
+        shared_ptr<MappedFile> file_;
+        char *base_ = nullptr; // first byte of the file
+        vector<Entry> entries_;
+        unordered_map<string, size_t> index_;
+
+        const Entry &entry(const string &name) const;
+
+    public:
+        /**
+         * Map the file and read its header. The data of the tensors is not read.
+         *
+         * @throws runtime_error If the file cannot be opened, or if it is not a valid tensor file.
+         */
+        explicit TensorFile(const string &path);
+
+        // Names of the tensors, in the order of the file
+        vector<string> names() const;
+
+        inline size_t size() const { return this->entries_.size(); }
+        inline bool contains(const string &name) const { return this->index_.count(name) > 0; }
+
+        DType dtype(const string &name) const;
+        const DimVector &shape(const string &name) const;
+
+        // Check if the file is memory mapped (it is read into memory on platforms without mmap)
+        bool is_mapped() const;
+
+        /**
+         * Get a tensor, backed by the mapping: nothing is copied. The mapping stays alive as long as the tensor uses it,
+         * even after the TensorFile is destroyed.
+         *
+         * @throws out_of_range If there is no tensor of this name.
+         * @throws invalid_argument If the tensor is not of type T.
+         */
+        template <typename T>
+        Tensor<T> get(const string &name) const
+        {
+            const Entry &e = this->entry(name);
+
+            if (e.dtype != dtype_of<T>())
+            {
+                throw invalid_argument("The tensor " + name + " is of type " + dtype_name(e.dtype) + ", not " + dtype_name(dtype_of<T>()));
+            }
+
+            return Tensor<T>::from_blob(reinterpret_cast<T *>(this->base_ + e.offset), e.shape, this->file_);
+        }
+    };
+
+    // Write float tensors, in the order of their names
+    void save(const string &path, const map<string, Tensor<>> &tensors);
+
+    // Get all the tensors of a file of float tensors, backed by its mapping
+    map<string, Tensor<>> load(const string &path);
+}
+
+namespace nn
+{
+    /**
+     * Save the parameters of a module, under the names given by register_parameters (e.g. "layer0.linear.weight").
+     */
+    void save_state_dict(const Module &module, const string &path);
+
+    /**
+     * Replace the parameters of a module by the tensors of a file written by save_state_dict. The parameters are backed by the mapping
+     * of the file, so the weights are not copied, and the processes loading the same file share its pages.
+     *
+     * Nothing is modified if the file does not match the module.
+     *
+     * @param strict If true, every parameter must be in the file, and every tensor of the file must be a parameter.
+     * Otherwise, the parameters missing from the file are left unchanged and the other tensors of the file are ignored.
+     * @throws runtime_error If a tensor is missing, unexpected, or has a different shape or type than its parameter.
+     */
+    void load_state_dict(Module &module, const string &path, bool strict = true);
+}
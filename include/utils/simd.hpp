@@ -0,0 +1,153 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <functional>
+#include <type_traits>
+#include "half.hpp"
+#include "tensor_utils.hpp"
+using namespace std;
+
+/*
+Vectorized kernels for contiguous float arrays (and the 16-bit floating-point types, which are computed in float).
+
+Every kernel is implemented once for each instruction set (scalar, SSE4.2, AVX2, AVX-512).
+The best instruction set supported by the CPU is detected once at startup (cpuid), so the same binary runs on every x86 machine.
+The detection can be overridden with the environment variable NEURALNET_SIMD=scalar|sse4.2|avx2|avx512.
+
+All the pointers may be unaligned. The output may alias an input.
+*/
+namespace simd
+{
+    enum class ISA
+    {
+        SCALAR,
+        SSE42,
+        AVX2,
+        AVX512
+    };
+
+    // Best instruction set supported by the CPU and the OS
+    ISA detect_isa();
+
+    // Instruction set used by the kernels
+    ISA active_isa();
+
+    // Select the instruction set used by the kernels (e.g. for benchmarks). Throws if the CPU does not support it
+    void set_isa(ISA isa);
+
+    // Check if the CPU supports the given instruction set
+    bool is_supported(ISA isa);
+
+    string isa_name(ISA isa);
+
+    // out[i] = a[i] op b[i]
+    void binary(ArithmeticOp op, const float *a, const float *b, float *out, size_t n);
+
+    // out[i] = a[i] op scaler
+    void binary_scalar(ArithmeticOp op, const float *a, float scaler, float *out, size_t n);
+
+    // out[i] = scaler op b[i]
+    void scalar_binary(ArithmeticOp op, float scaler, const float *b, float *out, size_t n);
+
+    // out[i] = sqrt(a[i])
+    void sqrt(const float *a, float *out, size_t n);
+
+    // out[i] = |a[i]|
+    void abs(const float *a, float *out, size_t n);
+
+    /*
+    Sum of n elements.
+
+    The sum is accumulated in 16 fixed lanes (element i goes to lane i % 16), which are then combined with a fixed pairwise tree.
+    Every instruction set uses the same lanes and the same tree, so the result is bitwise identical on every machine.
+    */
+    float sum(const float *a, size_t n);
+
+    /*
+    Sum of n elements with Kahan compensation: each lane also accumulates the rounding error of its additions, and subtracts it
+    from the next one. The error no longer grows with n, for about twice the cost of sum(). Bitwise identical on every machine as well.
+    */
+    float sum_kahan(const float *a, size_t n);
+
+    // Maximum / minimum of n > 0 elements
+    float max(const float *a, size_t n);
+    float min(const float *a, size_t n);
+
+    /*
+    Conversions between float and the 16-bit floating-point types, rounding to nearest even (see half.hpp).
+    They use F16C on AVX2 and AVX-512, and the VCVTNEPS2BF16 instruction when the CPU supports AVX-512 BF16.
+    The result is bitwise identical on every instruction set.
+    */
+    void convert(const bf16 *a, float *out, size_t n);
+    void convert(const float *a, bf16 *out, size_t n);
+    void convert(const fp16 *a, float *out, size_t n);
+    void convert(const float *a, fp16 *out, size_t n);
+
+    // Element-wise operations on 16-bit floats: the operands are converted to float by blocks, and the results rounded back
+    void binary(ArithmeticOp op, const bf16 *a, const bf16 *b, bf16 *out, size_t n);
+    void binary(ArithmeticOp op, const fp16 *a, const fp16 *b, fp16 *out, size_t n);
+    void binary_scalar(ArithmeticOp op, const bf16 *a, float scaler, bf16 *out, size_t n);
+    void binary_scalar(ArithmeticOp op, const fp16 *a, float scaler, fp16 *out, size_t n);
+    void scalar_binary(ArithmeticOp op, float scaler, const bf16 *b, bf16 *out, size_t n);
+    void scalar_binary(ArithmeticOp op, float scaler, const fp16 *b, fp16 *out, size_t n);
+
+    // Number of blocks computed by philox_batch
+    constexpr size_t PHILOX_BATCH = 64;
+
+    /*
+    The blocks first, ..., first + PHILOX_BATCH - 1 of the Philox4x32-10 stream of a key (see random.hpp), in structure-of-arrays layout:
+    the number j of block b is numbers[j * PHILOX_BATCH + b]. The counter of block c is (low 32 bits of c, high 32 bits of c, 0, 0).
+    Integer arithmetic only, so the numbers are the same on every instruction set.
+    */
+    void philox_batch(uint64_t key, uint64_t first, uint32_t *numbers);
+
+    // Element types with vectorized arithmetic kernels
+    template <typename T>
+    inline constexpr bool has_kernels_v = std::is_same_v<T, float> || is_half_v<T>;
+
+    // Element types with vectorized conversion kernels from From to To
+    template <typename From, typename To>
+    inline constexpr bool has_conversion_v = (std::is_same_v<From, float> && is_half_v<To>) || (is_half_v<From> && std::is_same_v<To, float>);
+
+    // Maps the functor of an arithmetic operation to its ArithmeticOp
+    template <typename Op>
+    struct arithmetic_op_of : std::false_type
+    {
+        static constexpr ArithmeticOp op = ArithmeticOp::ADD;
+    };
+
+    template <typename T>
+    struct arithmetic_op_of<std::plus<T>> : std::true_type
+    {
+        static constexpr ArithmeticOp op = ArithmeticOp::ADD;
+    };
+
+    template <typename T>
+    struct arithmetic_op_of<std::minus<T>> : std::true_type
+    {
+        static constexpr ArithmeticOp op = ArithmeticOp::SUB;
+    };
+
+    template <typename T>
+    struct arithmetic_op_of<std::multiplies<T>> : std::true_type
+    {
+        static constexpr ArithmeticOp op = ArithmeticOp::MUL;
+    };
+
+    template <typename T>
+    struct arithmetic_op_of<std::divides<T>> : std::true_type
+    {
+        static constexpr ArithmeticOp op = ArithmeticOp::DIV;
+    };
+
+    /*
+    Maps the functor of an element-wise operation to its vectorized kernel, if there is one.
+    E.g. vectorized_op<float, float, std::plus<float>>::op is ArithmeticOp::ADD.
+    */
+    template <typename T, typename U, typename Op>
+    struct vectorized_op : std::bool_constant<has_kernels_v<T> && std::is_same_v<T, U> && arithmetic_op_of<Op>::value>
+    {
+        static constexpr ArithmeticOp op = arithmetic_op_of<Op>::op;
+    };
+}
@@ -0,0 +1,176 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include "dim_vector.hpp"
+#include "parallel.hpp"
+#include "tensor_iterator.hpp"
+using namespace std;
+
+/*
+Copy engine used to make tensors contiguous (clone(), contiguous(), reshape() of a view).
+
+    strided_copy(shape, dst, dst_strides, src, src_strides)
+
+copies every element of the strided source to the strided destination. There are two cases:
+
+- The destination and the source are traversed in the same direction: after the dimensions are coalesced (see TensorIterator),
+  the copy is a sequence of rows, copied with std::copy when both are contiguous (e.g. the channels of permute(1, 0, 2, 3)).
+
+- The source is transposed: its contiguous dimension is not the contiguous dimension of the destination (e.g. transpose(),
+  or permute(0, 2, 3, 1)). Copying row by row would read the source with a large stride, loading a whole cache line for
+  each element. Instead, the two dimensions form a matrix that is copied by square tiles of TILE x TILE elements:
+  the TILE cache lines of the source and of the destination of a tile stay in the L1 cache, so every line is loaded once.
+
+The tiles (and the matrices of the other dimensions) are split among the threads of the thread pool.
+*/
+
+namespace strided_copy_impl
+{
+    // Side of the square tiles of a transposing copy. 64 x 64 floats read 64 lines of the source and write 64 lines of the destination
+    constexpr size_t TILE = 64;
+
+    // Minimum number of elements copied by a task
+    constexpr size_t PARALLEL_COPY_NUMEL = 1 << 15;
+
+    struct Dim
+    {
+        size_t size;
+        size_t dst_stride;
+        size_t src_stride;
+    };
+
+    /*
+    Copy a tile of the matrix: element (i, j) is at dst + i * dst_i + j * dst_j and at src + i * src_i + j * src_j,
+    where the destination is contiguous along i and the source along j.
+    */
+    template <typename T>
+    inline void copy_tile(T *dst, size_t dst_i, size_t dst_j, const T *src, size_t src_i, size_t src_j, size_t n_i, size_t n_j)
+    {
+        for (size_t j = 0; j < n_j; ++j)
+        {
+            T *dst_col = dst + j * dst_j;
+            const T *src_col = src + j * src_j;
+
+            for (size_t i = 0; i < n_i; ++i)
+            {
+                dst_col[i * dst_i] = src_col[i * src_i];
+            }
+        }
+    }
+}
+
+template <typename T>
+void strided_copy(const DimVector &shape, T *dst, const DimVector &dst_strides, const T *src, const DimVector &src_strides)
+{
+    using namespace strided_copy_impl;
+
+    size_t numel = 1;
+    for (const size_t &dim_size : shape)
+    {
+        numel *= dim_size;
+    }
+    if (numel == 0)
+    {
+        return;
+    }
+
+    // Dimensions of size > 1, from the innermost to the outermost, merged when they are contiguous with each other for both tensors
+    DimVector sizes, dst_s, src_s;
+    for (int64_t dim = static_cast<int64_t>(shape.size()) - 1; dim >= 0; --dim)
+    {
+        if (shape[dim] == 1)
+        {
+            continue;
+        }
+
+        if (!sizes.empty() && dst_strides[dim] == dst_s.back() * sizes.back() && src_strides[dim] == src_s.back() * sizes.back())
+        {
+            sizes.back() *= shape[dim];
+            continue;
+        }
+
+        sizes.push_back(shape[dim]);
+        dst_s.push_back(dst_strides[dim]);
+        src_s.push_back(src_strides[dim]);
+    }
+
+    // The dimension along which the destination is contiguous, and the one along which the source is
+    size_t dst_inner = 0, src_inner = 0;
+    for (size_t d = 0; d < sizes.size(); ++d)
+    {
+        if (dst_s[d] < dst_s[dst_inner])
+            dst_inner = d;
+        if (src_s[d] < src_s[src_inner])
+            src_inner = d;
+    }
+
+    const bool transposed = sizes.size() >= 2 && dst_inner != src_inner && src_s[src_inner] < src_s[dst_inner];
+
+    if (!transposed)
+    {
+        const TensorIterator<2> iter(shape, {dst_strides, src_strides}, {0, 0});
+
+        iter.parallel_for_each([&](const array<size_t, 2> &offsets, size_t n, const array<size_t, 2> &strides)
+                               {
+            T *dst_row = dst + offsets[0];
+            const T *src_row = src + offsets[1];
+
+            if (strides[0] == 1 && strides[1] == 1)
+            {
+                std::copy(src_row, src_row + n, dst_row);
+                return;
+            }
+
+            for (size_t i = 0; i < n; ++i)
+            {
+                dst_row[i * strides[0]] = src_row[i * strides[1]];
+            } }, PARALLEL_COPY_NUMEL);
+        return;
+    }
+
+    // Transposing copy: a matrix whose dimension i is the contiguous dimension of the destination and j the one of the source.
+    // The other dimensions are a batch of matrices
+    const Dim dim_i = {sizes[dst_inner], dst_s[dst_inner], src_s[dst_inner]};
+    const Dim dim_j = {sizes[src_inner], dst_s[src_inner], src_s[src_inner]};
+
+    DimVector batch_sizes, batch_dst_s, batch_src_s;
+    for (size_t d = 0; d < sizes.size(); ++d)
+    {
+        if (d != dst_inner && d != src_inner)
+        {
+            batch_sizes.push_back(sizes[d]);
+            batch_dst_s.push_back(dst_s[d]);
+            batch_src_s.push_back(src_s[d]);
+        }
+    }
+
+    const size_t tiles_i = (dim_i.size + TILE - 1) / TILE;
+    const size_t tiles_j = (dim_j.size + TILE - 1) / TILE;
+    const size_t tiles = tiles_i * tiles_j;
+    const size_t num_tasks = (numel / (dim_i.size * dim_j.size)) * tiles;
+
+    parallel_for(0, num_tasks, std::max<size_t>(1, PARALLEL_COPY_NUMEL / (TILE * TILE)), [&](size_t task_begin, size_t task_end)
+                 {
+        for (size_t task = task_begin; task < task_end; ++task)
+        {
+            // Position of the matrix in the batch
+            size_t matrix = task / tiles;
+            size_t dst_offset = 0, src_offset = 0;
+            for (size_t d = 0; d < batch_sizes.size(); ++d)
+            {
+                const size_t idx = matrix % batch_sizes[d];
+                matrix /= batch_sizes[d];
+                dst_offset += idx * batch_dst_s[d];
+                src_offset += idx * batch_src_s[d];
+            }
+
+            // Position of the tile in the matrix
+            const size_t i = (task % tiles) / tiles_j * TILE;
+            const size_t j = (task % tiles) % tiles_j * TILE;
+
+            copy_tile(dst + dst_offset + i * dim_i.dst_stride + j * dim_j.dst_stride, dim_i.dst_stride, dim_j.dst_stride,
+                      src + src_offset + i * dim_i.src_stride + j * dim_j.src_stride, dim_i.src_stride, dim_j.src_stride,
+                      std::min(TILE, dim_i.size - i), std::min(TILE, dim_j.size - j));
+        } });
+}
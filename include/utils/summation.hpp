@@ -0,0 +1,159 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include "parallel.hpp"
+#include "simd.hpp"
+#include "storage.hpp"
+using namespace std;
+
+/*
+Deterministic parallel summation.
+
+A long sum is cut into blocks of SUM_BLOCK elements. The boundaries of the blocks only depend on the number of elements, never on
+the number of threads: the threads of parallel_for sum whole blocks, and the sums of the blocks are then combined with a fixed
+pairwise tree. So the result is bitwise identical whatever the number of threads (and, with the fixed SIMD lanes of simd::sum,
+whatever the instruction set), and a training run can be reproduced exactly.
+
+The pairwise tree also keeps the rounding error small: it grows with log(n) instead of n for a left-to-right sum.
+Summation::KAHAN additionally compensates the rounding error of every addition, for about twice the cost.
+*/
+
+enum class Summation
+{
+    PAIRWISE, // SIMD lanes within the blocks, pairwise tree across the blocks
+    KAHAN     // Kahan compensated summation within and across the blocks
+};
+
+// Number of elements of a block. Fixed, so that the result does not depend on the number of threads
+constexpr size_t SUM_BLOCK = 1 << 13;
+
+// Minimum number of blocks summed by a thread
+constexpr size_t SUM_BLOCKS_PER_TASK = 8;
+
+// Number of 16-bit floats converted at once when summing them in float
+constexpr size_t SUM_HALF_BLOCK = 256;
+
+namespace summation
+{
+    // Type in which the values of type T are accumulated: float for the 16-bit floating-point types, T otherwise
+    template <typename T>
+    using accumulator_t = std::conditional_t<is_half_v<T>, float, T>;
+
+    // Sum of a contiguous row of n elements
+    template <typename T>
+    accumulator_t<T> sum_row(const T *data, size_t n, Summation summation = Summation::PAIRWISE)
+    {
+        if constexpr (std::is_same_v<T, float>)
+        {
+            return summation == Summation::KAHAN ? simd::sum_kahan(data, n) : simd::sum(data, n);
+        }
+        else if constexpr (is_half_v<T>)
+        {
+            // Accumulate in float: the 16-bit floats are converted by blocks, whose sums are added up (with compensation for KAHAN)
+            float block[SUM_HALF_BLOCK];
+            float sum = 0.0f, compensation = 0.0f;
+            for (size_t i = 0; i < n; i += SUM_HALF_BLOCK)
+            {
+                const size_t len = std::min(SUM_HALF_BLOCK, n - i);
+                simd::convert(data + i, block, len);
+
+                if (summation == Summation::KAHAN)
+                {
+                    const float y = simd::sum_kahan(block, len) - compensation;
+                    const float t = sum + y;
+                    compensation = (t - sum) - y;
+                    sum = t;
+                }
+                else
+                {
+                    sum += simd::sum(block, len);
+                }
+            }
+            return sum;
+        }
+        else
+        {
+            T sum = static_cast<T>(0);
+
+            if constexpr (std::is_floating_point_v<T>)
+            {
+                if (summation == Summation::KAHAN)
+                {
+                    T compensation = static_cast<T>(0);
+                    for (size_t i = 0; i < n; ++i)
+                    {
+                        const T y = data[i] - compensation;
+                        const T t = sum + y;
+                        compensation = (t - sum) - y;
+                        sum = t;
+                    }
+                    return sum;
+                }
+            }
+
+            for (size_t i = 0; i < n; ++i)
+            {
+                sum += data[i];
+            }
+            return sum;
+        }
+    }
+
+    // Combine the partial sums with a fixed tree: partials[i] += partials[i + width] for width = 1, 2, 4...
+    template <typename T>
+    T combine(T *partials, size_t n, Summation summation)
+    {
+        if constexpr (std::is_floating_point_v<T>)
+        {
+            if (summation == Summation::KAHAN)
+            {
+                return sum_row(partials, n, summation);
+            }
+        }
+
+        for (size_t width = 1; width < n; width *= 2)
+        {
+            for (size_t i = 0; i + width < n; i += 2 * width)
+            {
+                partials[i] += partials[i + width];
+            }
+        }
+        return partials[0];
+    }
+
+    /**
+     * Sum of the n values of a sequence, computed block by block.
+     *
+     * @param block_sum block_sum(begin, end) returns the sum of the values in [begin, end). It is called once per block,
+     *                  possibly from several threads at once.
+     */
+    template <typename T, typename BlockSum>
+    T blocked_sum(size_t n, Summation summation, BlockSum &&block_sum)
+    {
+        if (n <= SUM_BLOCK)
+        {
+            return block_sum(size_t(0), n);
+        }
+
+        const size_t num_blocks = (n + SUM_BLOCK - 1) / SUM_BLOCK;
+        const shared_ptr<Storage<T>> partials = make_storage<T>(num_blocks);
+
+        parallel_for(0, num_blocks, SUM_BLOCKS_PER_TASK, [&](size_t begin, size_t end)
+                     {
+            for (size_t b = begin; b < end; ++b)
+            {
+                (*partials)[b] = block_sum(b * SUM_BLOCK, std::min(n, (b + 1) * SUM_BLOCK));
+            } });
+
+        return combine(partials->data(), num_blocks, summation);
+    }
+
+    // Sum of a contiguous array of n elements
+    template <typename T>
+    accumulator_t<T> sum(const T *data, size_t n, Summation summation = Summation::PAIRWISE)
+    {
+        return blocked_sum<accumulator_t<T>>(n, summation, [&](size_t begin, size_t end)
+                              { return sum_row(data + begin, end - begin, summation); });
+    }
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+using namespace std;
+
+/*
+Element access of a tensor of rank N known at compile time, for the inner loops of the kernels:
+
+    const TensorAccessor<const float, 4> in = input.accessor<4>();
+    TensorAccessor<float, 4> out = output.accessor<4>();
+    out[b, c, h, w] = in[b, c, h, w];
+
+The sizes and the strides are copied into the accessor (so the compiler keeps them in registers), and an element is found
+with pointer arithmetic: no vector, no normalization of negative indices, no loop over the dimensions.
+
+The indices are checked against the sizes in debug builds only (or when NEURALNET_BOUNDS_CHECK is defined), since Tensor::operator[]
+remains the checked access. The accessor does not keep the storage alive: the tensor must outlive it.
+*/
+
+#if !defined(NDEBUG) || defined(NEURALNET_BOUNDS_CHECK)
+#define NEURALNET_ACCESSOR_CHECKS 1
+#endif
+
+template <typename T, size_t N>
+class TensorAccessor
+{
+    static_assert(N > 0, "A tensor accessor needs at least one dimension");
+
+private:
+    T *data_;
+    array<size_t, N> sizes_;
+    array<size_t, N> strides_;
+
+    template <typename... Indices, size_t... Dims>
+    inline size_t offset(index_sequence<Dims...>, Indices... indices) const
+    {
+#ifdef NEURALNET_ACCESSOR_CHECKS
+        ((static_cast<size_t>(indices) >= this->sizes_[Dims]
+              ? throw out_of_range("Index " + to_string(static_cast<size_t>(indices)) + " is out of bounds for dimension " +
+                                   to_string(Dims) + " of size " + to_string(this->sizes_[Dims]))
+              : void()),
+         ...);
+#endif
+        return ((static_cast<size_t>(indices) * this->strides_[Dims]) + ...);
+    }
+
+public:
+    // The element at data + sum(index[d] * strides[d]), for 0 <= index[d] < sizes[d]
+    TensorAccessor(T *data, const size_t *sizes, const size_t *strides) : data_(data)
+    {
+        for (size_t d = 0; d < N; ++d)
+        {
+            this->sizes_[d] = sizes[d];
+            this->strides_[d] = strides[d];
+        }
+    }
+
+    // Read-only accessor of the elements of a writable one
+    template <typename U, typename = enable_if_t<is_same_v<const U, T> && !is_same_v<U, T>>>
+    TensorAccessor(const TensorAccessor<U, N> &other) : data_(other.data())
+    {
+        for (size_t d = 0; d < N; ++d)
+        {
+            this->sizes_[d] = other.size(d);
+            this->strides_[d] = other.stride(d);
+        }
+    }
+
+    template <typename... Indices>
+    inline T &operator[](Indices... indices) const
+    {
+        static_assert(sizeof...(Indices) == N, "The number of indices must be the rank of the accessor");
+        return this->data_[this->offset(make_index_sequence<N>(), indices...)];
+    }
+
+    // Pointer to an element, e.g. the beginning of a row whose elements are stride(N - 1) apart
+    template <typename... Indices>
+    inline T *ptr(Indices... indices) const
+    {
+        static_assert(sizeof...(Indices) == N, "The number of indices must be the rank of the accessor");
+        return this->data_ + this->offset(make_index_sequence<N>(), indices...);
+    }
+
+    inline T *data() const { return this->data_; }
+    inline size_t size(size_t dim) const { return this->sizes_[dim]; }
+    inline size_t stride(size_t dim) const { return this->strides_[dim]; }
+};
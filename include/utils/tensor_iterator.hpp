@@ -0,0 +1,225 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <vector>
+#include <cstddef>
+#include "dim_vector.hpp"
+#include "parallel.hpp"
+using namespace std;
+
+/**
+ * N-D strided iterator over NArgs operands that share the same (broadcast) shape.
+ *
+ * Each operand is described by its strides and its base offset (in elements) into its own buffer.
+ * The iterator walks all the operands together, and calls the given function once for every innermost row:
+ *
+ *     fn(offsets, n, inner_strides)
+ *
+ * where offsets[k] is the offset of the first element of the row in operand k, n is the length of the row,
+ * and inner_strides[k] is the stride of operand k along the row.
+ *
+ * Before iterating, the dimensions are coalesced:
+ * - dimensions of size 1 are dropped
+ * - two adjacent dimensions are merged if they are contiguous with each other for every operand
+ *
+ * So contiguous operands collapse into a single row of size numel(), and the function is called exactly once.
+ * For the remaining outer dimensions, the offsets are advanced by stride increments (an odometer),
+ * so there is no division or modulo per element.
+ */
+template <size_t NArgs>
+class TensorIterator
+{
+public:
+    using Offsets = array<size_t, NArgs>;
+
+    TensorIterator(const DimVector &shape, const array<DimVector, NArgs> &strides, const Offsets &offsets)
+        : offsets_(offsets)
+    {
+        // Store the dimensions from the innermost to the outermost, which is the order we iterate in
+        for (int64_t dim = static_cast<int64_t>(shape.size()) - 1; dim >= 0; --dim)
+        {
+            const size_t dim_size = shape[dim];
+
+            if (dim_size == 0)
+            {
+                this->numel_ = 0;
+            }
+
+            if (dim_size == 1)
+            {
+                continue;
+            }
+
+            // Try to merge this dimension into the previous (inner) one
+            if (!this->shape_.empty())
+            {
+                const size_t inner = this->shape_.size() - 1;
+                bool mergeable = true;
+
+                for (size_t k = 0; k < NArgs; ++k)
+                {
+                    if (strides[k][dim] != this->strides_[k][inner] * this->shape_[inner])
+                    {
+                        mergeable = false;
+                        break;
+                    }
+                }
+
+                if (mergeable)
+                {
+                    this->shape_[inner] *= dim_size;
+                    continue;
+                }
+            }
+
+            this->shape_.push_back(dim_size);
+            for (size_t k = 0; k < NArgs; ++k)
+            {
+                this->strides_[k].push_back(strides[k][dim]);
+            }
+        }
+
+        if (this->numel_ != 0)
+        {
+            for (const size_t &dim_size : this->shape_)
+            {
+                this->numel_ *= dim_size;
+            }
+        }
+    }
+
+    // Number of dimensions after coalescing
+    inline size_t ndim() const { return this->shape_.size(); }
+
+    // Total number of elements to iterate
+    inline size_t numel() const { return this->numel_; }
+
+    // Length of the rows given to the function
+    inline size_t inner_size() const { return this->shape_.empty() ? 1 : this->shape_[0]; }
+
+    // Check if every operand is traversed contiguously, i.e. the whole iteration is a single row with unit strides
+    bool is_contiguous() const
+    {
+        if (this->shape_.size() > 1)
+        {
+            return false;
+        }
+
+        for (size_t k = 0; k < NArgs; ++k)
+        {
+            if (!this->shape_.empty() && this->strides_[k][0] != 1)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    template <typename Fn>
+    void for_each(Fn &&fn) const
+    {
+        if (this->numel_ == 0)
+        {
+            return;
+        }
+
+        if (this->shape_.empty())
+        {
+            // All dimensions are of size 1, there is a single element
+            fn(this->offsets_, static_cast<size_t>(1), Offsets{});
+            return;
+        }
+
+        this->for_each_outer(fn, 0, this->shape_.back());
+    }
+
+    /**
+     * Same as for_each, but the iteration is split across the threads of parallel_for when there are more than grain_size elements.
+     * The split is along the outermost dimension (or along the row if there is a single one), so fn is called concurrently
+     * for disjoint rows or disjoint parts of a row.
+     */
+    template <typename Fn>
+    void parallel_for_each(Fn &&fn, size_t grain_size) const
+    {
+        if (this->numel_ <= grain_size || this->shape_.empty())
+        {
+            this->for_each(fn);
+            return;
+        }
+
+        const size_t outer_size = this->shape_.back();
+        const size_t outer_numel = this->numel_ / outer_size;
+
+        parallel_for(0, outer_size, std::max<size_t>(1, grain_size / outer_numel), [&](size_t begin, size_t end)
+                     { this->for_each_outer(fn, begin, end); });
+    }
+
+private:
+    // Iterate the rows whose index along the outermost dimension is in [begin, end). With a single dimension, the row is [begin, end)
+    template <typename Fn>
+    void for_each_outer(Fn &fn, size_t begin, size_t end) const
+    {
+        if (begin >= end)
+        {
+            return;
+        }
+
+        const size_t ndim = this->shape_.size();
+        const size_t outer = ndim - 1;
+
+        Offsets inner_strides{};
+        Offsets offsets = this->offsets_;
+        for (size_t k = 0; k < NArgs; ++k)
+        {
+            inner_strides[k] = this->strides_[k][0];
+            offsets[k] += begin * this->strides_[k][outer];
+        }
+
+        if (ndim == 1)
+        {
+            fn(offsets, end - begin, inner_strides);
+            return;
+        }
+
+        const size_t inner_size = this->shape_[0];
+
+        DimVector counter(ndim, 0);
+        counter[outer] = begin;
+
+        while (true)
+        {
+            fn(offsets, inner_size, inner_strides);
+
+            // Advance the outer dimensions like an odometer
+            size_t dim = 1;
+            for (; dim < ndim; ++dim)
+            {
+                for (size_t k = 0; k < NArgs; ++k)
+                {
+                    offsets[k] += this->strides_[k][dim];
+                }
+
+                if (++counter[dim] < (dim == outer ? end : this->shape_[dim]))
+                {
+                    break;
+                }
+
+                for (size_t k = 0; k < NArgs; ++k)
+                {
+                    offsets[k] -= this->strides_[k][dim] * this->shape_[dim];
+                }
+                counter[dim] = 0;
+            }
+
+            if (dim == ndim)
+            {
+                break;
+            }
+        }
+    }
+
+    DimVector shape_;                 // coalesced shape, innermost dimension first
+    array<DimVector, NArgs> strides_; // coalesced strides of each operand, innermost dimension first
+    Offsets offsets_;                 // base offset of each operand
+    size_t numel_ = 1;
+};
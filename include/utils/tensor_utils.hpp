@@ -15,6 +15,8 @@
 #include <type_traits>
 #include <memory>
 #include <unordered_set>
+#include "storage.hpp"
+#include "dim_vector.hpp"
 
 using namespace std;
 
@@ -27,13 +29,15 @@ class Tensor;
 template <typename U, typename V>
 Tensor<V> dtype_impl(const Tensor<U> &tensor);
 
-// for max, min ,argmax, argmin reduction
+// for sum, max, min ,argmax, argmin reduction
 enum class ReduceOp
 {
+    SUM,
     MAX,
     MIN,
     ARGMAX,
-    ARGMIN
+    ARGMIN,
+    SQUARED_DEVIATION // sum of the squared deviations from a given center (for var)
 };
 
 // for add, subtract, multiply, divide
@@ -60,11 +64,116 @@ struct Slice
 // Helper function to convert negative indices to positive
 size_t normalize_index(int idx, size_t dim_size);
 
+// The indices selected by a slice on a dimension: start, start + step, ..., (length of them)
+struct SliceRange
+{
+    size_t start;
+    size_t step;
+    size_t length;
+};
+
+// Helper function to resolve a slice on a dimension, without expanding its indices
+SliceRange resolve_slice(const Slice &slice, size_t dim_size);
+
 // Helper function to apply slice to a dimension
 vector<size_t> apply_slice(const Slice &slice, size_t dim_size);
 
+/**
+ * Precompiled index of Tensor::index.
+ *
+ * The indices (integers, slice strings such as "1:10:2", Slice objects, and at most one ellipsis "...") are parsed once
+ * when the plan is built. Applying the plan to a shape is then only a few integer operations per dimension,
+ * so the same plan can be reused every iteration (e.g. to take a mini-batch window) without parsing any string.
+ *
+ * E.g.
+ * const IndexPlan last_step({"...", "-1:"});
+ * Tensor<> window = sequence.index(last_step);
+ */
+class IndexPlan
+{
+public:
+    using IndexType = variant<size_t, string, Slice>;
+
+    explicit IndexPlan(const vector<IndexType> &indices);
+
+    /**
+     * Compute the strided view selected by the plan.
+     *
+     * The dimensions not covered by the indices are taken whole, as if indexed with ":".
+     * A dimension is dropped from the view when it is indexed by an integer, or when its slice selects a single element.
+     *
+     * @param shape, strides The shape and the strides of the indexed tensor.
+     * @param view_shape, view_strides The shape and the strides of the view (output).
+     * @return The offset of the first element of the view, relative to the first element of the indexed tensor.
+     *
+     * @throw std::out_of_range if an index is out of range.
+     * @throw std::invalid_argument if there are more indices than dimensions.
+     */
+    size_t apply(const DimVector &shape, const DimVector &strides, DimVector &view_shape, DimVector &view_strides) const;
+
+private:
+    enum class Kind
+    {
+        INTEGER,
+        SLICE,
+        ELLIPSIS
+    };
+
+    struct Item
+    {
+        Kind kind;
+        size_t integer;
+        Slice slice;
+    };
+
+    vector<Item> items_;
+    size_t ellipsis_pos_ = SIZE_MAX; // position of the ellipsis in items_, if any
+};
+
 // Helper function to calculate the offset of the tensor given a single index
-vector<size_t> linear_to_multi_idxs(size_t idx, const vector<size_t> &shape);
+DimVector linear_to_multi_idxs(size_t idx, const DimVector &shape);
+
+// Helper function to calculate the shape of two tensors broadcast together (NumPy-style broadcasting)
+DimVector broadcast_shapes(const DimVector &shape_a, const DimVector &shape_b);
+
+/**
+ * Layout of the reduction of a strided tensor over a set of dimensions.
+ *
+ * The dimensions are split into the kept ones (which index the result) and the reduced ones, both sorted from the outermost
+ * to the innermost in memory (by decreasing stride), so the reduction walks the input in memory order whatever the view.
+ * Dimensions of size 1 are dropped, and adjacent dimensions of the same kind which are contiguous with each other are merged,
+ * e.g. reducing a contiguous (N, C, H, W) tensor over (0, 2, 3) gives kept = (C) and reduced = (N, H * W).
+ *
+ * The result is a contiguous tensor of shape out_shape, and kept_out_strides are the strides of the kept dimensions in it.
+ */
+struct ReducePlan
+{
+    DimVector out_shape;
+
+    DimVector kept_shape;
+    DimVector kept_strides;
+    DimVector kept_out_strides;
+
+    DimVector reduced_shape;
+    DimVector reduced_strides;
+
+    size_t out_numel = 1;    // number of elements of the result
+    size_t reduce_numel = 1; // number of elements reduced into each of them
+
+    // The innermost dimension is reduced, so each element of the result is reduced from contiguous rows.
+    // Otherwise the innermost dimension is kept, and the rows of the input are accumulated into rows of the result
+    bool inner = true;
+
+    /**
+     * @param shape, strides The shape and the strides of the reduced tensor.
+     * @param dims The dimensions to reduce (negative values count from the last dimension). All of them if empty.
+     * @param keepdim Whether the reduced dimensions are kept in out_shape with size 1.
+     *
+     * @throw std::out_of_range if a dimension is out of range.
+     * @throw std::invalid_argument if a dimension is repeated.
+     */
+    ReducePlan(const DimVector &shape, const DimVector &strides, const vector<int64_t> &dims, bool keepdim);
+};
 
 // Type trait to check if a type is a std::vector
 template <typename>
@@ -93,18 +202,5 @@ struct is_initializer_list<std::initializer_list<T>> : public std::true_type
 template <typename U, typename V>
 Tensor<V> dtype_impl(const Tensor<U> &tensor)
 {
-    Tensor<V> result;
-
-    result.shape_ = tensor.shape_;
-    result.data_ = make_shared<vector<V>>();
-    result.data_->resize(tensor.data_->size());
-    result.strides_ = tensor.strides_;
-    result.offset_ = tensor.offset_;
-    result.size_ = tensor.size_;
-
-    std::transform(tensor.data_->begin(), tensor.data_->end(), result.data_->begin(),
-                   [](const U &val)
-                   { return static_cast<V>(val); });
-
-    return result;
+    return tensor.template convert_impl<V>();
 }
\ No newline at end of file
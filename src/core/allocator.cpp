@@ -0,0 +1,474 @@
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdlib>
+#include <new>
+#include <unordered_map>
+#include "allocator.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define NEURALNET_HAS_MMAP 1
+#endif
+
+namespace memory
+{
+    namespace
+    {
+        bool huge_pages_from_env()
+        {
+            const char *env = getenv("NEURALNET_HUGE_PAGES");
+            return env == nullptr || string(env) != "0";
+        }
+
+        atomic<bool> huge_pages{huge_pages_from_env()};
+
+        atomic<Allocator *> current_allocator{nullptr};
+
+        inline size_t round_up(size_t n, size_t multiple)
+        {
+            return (n + multiple - 1) / multiple * multiple;
+        }
+
+        // Ask the kernel to back [ptr, ptr + nbytes) with transparent huge pages
+        void advise_huge_pages(void *ptr, size_t nbytes)
+        {
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+            if (nbytes >= HUGE_PAGE_SIZE && huge_pages.load(memory_order_relaxed))
+            {
+                madvise(ptr, nbytes, MADV_HUGEPAGE); // only a hint, a failure is not an error
+            }
+#else
+            (void)ptr;
+            (void)nbytes;
+#endif
+        }
+
+        // The alignment only depends on the size, so deallocate() finds the same one as allocate()
+        inline size_t alignment_of(size_t nbytes)
+        {
+            return nbytes >= HUGE_PAGE_SIZE ? HUGE_PAGE_SIZE : ALIGNMENT;
+        }
+
+        inline size_t size_class(size_t nbytes)
+        {
+            return std::bit_width(std::max(nbytes, ALIGNMENT) - 1);
+        }
+
+        // Free blocks of the caching allocator, by block size
+        struct FreeBlocks
+        {
+            unordered_map<size_t, vector<void *>> blocks;
+
+            void *pop(size_t size)
+            {
+                auto it = this->blocks.find(size);
+                if (it == this->blocks.end() || it->second.empty())
+                {
+                    return nullptr;
+                }
+                void *ptr = it->second.back();
+                it->second.pop_back();
+                return ptr;
+            }
+
+            // Give every block back to the system, and return the number of bytes freed
+            size_t release()
+            {
+                size_t freed = 0;
+                for (auto &[size, list] : this->blocks)
+                {
+                    for (void *ptr : list)
+                    {
+                        default_allocator()->deallocate(ptr, size);
+                    }
+                    freed += size * list.size();
+                }
+                this->blocks.clear();
+                return freed;
+            }
+        };
+
+        struct ThreadCache;
+
+        // Never destroyed, so tensors with static storage duration can still free their memory at exit
+        struct CacheState
+        {
+            mutex mutex_; // guards shared and threads
+            FreeBlocks shared;
+            vector<ThreadCache *> threads;
+
+            atomic<size_t> allocations{0}, hits{0}, misses{0}, bytes_in_use{0}, bytes_cached{0};
+        };
+
+        CacheState &cache_state()
+        {
+            static CacheState *state = new CacheState();
+            return *state;
+        }
+
+        // Set once the cache of the thread is destroyed (at thread exit), after which the thread uses the shared cache
+        thread_local bool thread_cache_destroyed = false;
+
+        struct ThreadCache
+        {
+            mutex mutex_; // only contended by empty_cache()
+            FreeBlocks local;
+
+            ThreadCache()
+            {
+                CacheState &state = cache_state();
+                lock_guard<mutex> lock(state.mutex_);
+                state.threads.push_back(this);
+            }
+
+            ~ThreadCache()
+            {
+                CacheState &state = cache_state();
+                lock_guard<mutex> lock(state.mutex_);
+                lock_guard<mutex> local_lock(this->mutex_);
+
+                // hand the blocks over to the other threads
+                for (auto &[size, list] : this->local.blocks)
+                {
+                    vector<void *> &shared_list = state.shared.blocks[size];
+                    shared_list.insert(shared_list.end(), list.begin(), list.end());
+                }
+                this->local.blocks.clear();
+
+                state.threads.erase(std::find(state.threads.begin(), state.threads.end(), this));
+                thread_cache_destroyed = true;
+            }
+        };
+
+        ThreadCache *thread_cache()
+        {
+            if (thread_cache_destroyed)
+            {
+                return nullptr;
+            }
+            thread_local ThreadCache cache;
+            return &cache;
+        }
+
+        Allocator *initial_allocator()
+        {
+            static Allocator *allocator = [] () -> Allocator *
+            {
+                const char *env = getenv("NEURALNET_CACHING_ALLOCATOR");
+                if (env != nullptr && string(env) == "0")
+                {
+                    return default_allocator();
+                }
+                return caching_allocator();
+            }();
+            return allocator;
+        }
+    }
+
+    // ================================================DefaultAllocator================================================
+
+    void *DefaultAllocator::allocate(size_t nbytes)
+    {
+        const size_t alignment = alignment_of(nbytes);
+        void *ptr = ::operator new(round_up(nbytes, alignment), align_val_t(alignment));
+        advise_huge_pages(ptr, nbytes);
+        return ptr;
+    }
+
+    void DefaultAllocator::deallocate(void *ptr, size_t nbytes)
+    {
+        ::operator delete(ptr, align_val_t(alignment_of(nbytes)));
+    }
+
+    // ================================================PoolAllocator================================================
+
+    PoolAllocator::PoolAllocator(size_t max_block_size)
+        : max_block_size_(max_block_size), free_lists_(sizeof(size_t) * 8)
+    {
+    }
+
+    PoolAllocator::~PoolAllocator()
+    {
+        this->release();
+    }
+
+    void *PoolAllocator::allocate(size_t nbytes)
+    {
+        if (nbytes > this->max_block_size_)
+        {
+            return default_allocator()->allocate(nbytes);
+        }
+
+        const size_t cls = size_class(nbytes);
+        {
+            lock_guard<mutex> lock(this->mutex_);
+            vector<void *> &free_list = this->free_lists_[cls];
+            if (!free_list.empty())
+            {
+                void *ptr = free_list.back();
+                free_list.pop_back();
+                return ptr;
+            }
+        }
+
+        return default_allocator()->allocate(size_t(1) << cls);
+    }
+
+    void PoolAllocator::deallocate(void *ptr, size_t nbytes)
+    {
+        if (nbytes > this->max_block_size_)
+        {
+            default_allocator()->deallocate(ptr, nbytes);
+            return;
+        }
+
+        lock_guard<mutex> lock(this->mutex_);
+        this->free_lists_[size_class(nbytes)].push_back(ptr);
+    }
+
+    void PoolAllocator::release()
+    {
+        lock_guard<mutex> lock(this->mutex_);
+        for (size_t cls = 0; cls < this->free_lists_.size(); ++cls)
+        {
+            for (void *ptr : this->free_lists_[cls])
+            {
+                default_allocator()->deallocate(ptr, size_t(1) << cls);
+            }
+            this->free_lists_[cls].clear();
+        }
+    }
+
+    // ================================================ArenaAllocator================================================
+
+    ArenaAllocator::ArenaAllocator(size_t chunk_size) : chunk_size_(round_up(chunk_size, ALIGNMENT)) {}
+
+    ArenaAllocator::~ArenaAllocator()
+    {
+        for (const Chunk &chunk : this->chunks_)
+        {
+            default_allocator()->deallocate(chunk.data, chunk.size);
+        }
+    }
+
+    void *ArenaAllocator::allocate(size_t nbytes)
+    {
+        nbytes = round_up(std::max(nbytes, size_t(1)), ALIGNMENT);
+
+        lock_guard<mutex> lock(this->mutex_);
+
+        // Move to the next chunk that is big enough, allocating a new one at the end if needed
+        while (this->current_ < this->chunks_.size() && this->used_ + nbytes > this->chunks_[this->current_].size)
+        {
+            ++this->current_;
+            this->used_ = 0;
+        }
+
+        if (this->current_ == this->chunks_.size())
+        {
+            const size_t size = std::max(this->chunk_size_, nbytes);
+            this->chunks_.push_back({static_cast<char *>(default_allocator()->allocate(size)), size});
+            this->used_ = 0;
+        }
+
+        void *ptr = this->chunks_[this->current_].data + this->used_;
+        this->used_ += nbytes;
+        return ptr;
+    }
+
+    void ArenaAllocator::reset()
+    {
+        lock_guard<mutex> lock(this->mutex_);
+        this->current_ = 0;
+        this->used_ = 0;
+    }
+
+    size_t ArenaAllocator::capacity() const
+    {
+        lock_guard<mutex> lock(this->mutex_);
+        size_t capacity = 0;
+        for (const Chunk &chunk : this->chunks_)
+        {
+            capacity += chunk.size;
+        }
+        return capacity;
+    }
+
+    // ================================================MmapAllocator================================================
+
+    void *MmapAllocator::allocate(size_t nbytes)
+    {
+#ifdef NEURALNET_HAS_MMAP
+        const size_t size = round_up(std::max(nbytes, size_t(1)), static_cast<size_t>(sysconf(_SC_PAGESIZE)));
+        void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED)
+        {
+            throw bad_alloc();
+        }
+        advise_huge_pages(ptr, size);
+        return ptr;
+#else
+        return default_allocator()->allocate(nbytes);
+#endif
+    }
+
+    void MmapAllocator::deallocate(void *ptr, size_t nbytes)
+    {
+#ifdef NEURALNET_HAS_MMAP
+        munmap(ptr, round_up(std::max(nbytes, size_t(1)), static_cast<size_t>(sysconf(_SC_PAGESIZE))));
+#else
+        default_allocator()->deallocate(ptr, nbytes);
+#endif
+    }
+
+    // ================================================CachingAllocator================================================
+
+    size_t CachingAllocator::round_size(size_t nbytes)
+    {
+        if (nbytes <= ALIGNMENT)
+        {
+            return ALIGNMENT;
+        }
+
+        // 4 classes between 2^(p-1) and 2^p
+        const size_t p = std::bit_width(nbytes - 1);
+        const size_t step = std::max(size_t(1) << (p - 3), ALIGNMENT);
+        return round_up(nbytes, step);
+    }
+
+    void *CachingAllocator::allocate(size_t nbytes)
+    {
+        CacheState &state = cache_state();
+        const size_t size = round_size(nbytes);
+
+        state.allocations.fetch_add(1, memory_order_relaxed);
+
+        void *ptr = nullptr;
+
+        if (ThreadCache *cache = thread_cache())
+        {
+            lock_guard<mutex> lock(cache->mutex_);
+            ptr = cache->local.pop(size);
+        }
+
+        if (ptr == nullptr)
+        {
+            lock_guard<mutex> lock(state.mutex_);
+            ptr = state.shared.pop(size);
+        }
+
+        if (ptr != nullptr)
+        {
+            state.hits.fetch_add(1, memory_order_relaxed);
+            state.bytes_cached.fetch_sub(size, memory_order_relaxed);
+        }
+        else
+        {
+            state.misses.fetch_add(1, memory_order_relaxed);
+            ptr = default_allocator()->allocate(size);
+        }
+
+        state.bytes_in_use.fetch_add(size, memory_order_relaxed);
+        return ptr;
+    }
+
+    void CachingAllocator::deallocate(void *ptr, size_t nbytes)
+    {
+        CacheState &state = cache_state();
+        const size_t size = round_size(nbytes);
+
+        if (ThreadCache *cache = thread_cache())
+        {
+            lock_guard<mutex> lock(cache->mutex_);
+            cache->local.blocks[size].push_back(ptr);
+        }
+        else
+        {
+            lock_guard<mutex> lock(state.mutex_);
+            state.shared.blocks[size].push_back(ptr);
+        }
+
+        state.bytes_in_use.fetch_sub(size, memory_order_relaxed);
+        state.bytes_cached.fetch_add(size, memory_order_relaxed);
+    }
+
+    void CachingAllocator::empty_cache()
+    {
+        CacheState &state = cache_state();
+        lock_guard<mutex> lock(state.mutex_);
+
+        size_t freed = state.shared.release();
+        for (ThreadCache *cache : state.threads)
+        {
+            lock_guard<mutex> local_lock(cache->mutex_);
+            freed += cache->local.release();
+        }
+
+        state.bytes_cached.fetch_sub(freed, memory_order_relaxed);
+    }
+
+    CacheStats CachingAllocator::stats() const
+    {
+        const CacheState &state = cache_state();
+
+        CacheStats stats;
+        stats.allocations = state.allocations.load(memory_order_relaxed);
+        stats.hits = state.hits.load(memory_order_relaxed);
+        stats.misses = state.misses.load(memory_order_relaxed);
+        stats.bytes_in_use = state.bytes_in_use.load(memory_order_relaxed);
+        stats.bytes_cached = state.bytes_cached.load(memory_order_relaxed);
+        return stats;
+    }
+
+    void CachingAllocator::reset_stats()
+    {
+        CacheState &state = cache_state();
+        state.allocations.store(0, memory_order_relaxed);
+        state.hits.store(0, memory_order_relaxed);
+        state.misses.store(0, memory_order_relaxed);
+    }
+
+    CachingAllocator *caching_allocator()
+    {
+        // Never destroyed, like the cache itself
+        static CachingAllocator *allocator = new CachingAllocator();
+        return allocator;
+    }
+
+    void empty_cache()
+    {
+        caching_allocator()->empty_cache();
+    }
+
+    // ================================================Selection================================================
+
+    Allocator *default_allocator()
+    {
+        // Never destroyed, so tensors with static storage duration can still free their memory at exit
+        static DefaultAllocator *allocator = new DefaultAllocator();
+        return allocator;
+    }
+
+    Allocator *get_allocator()
+    {
+        Allocator *allocator = current_allocator.load(memory_order_acquire);
+        return allocator != nullptr ? allocator : initial_allocator();
+    }
+
+    void set_allocator(Allocator *allocator)
+    {
+        current_allocator.store(allocator, memory_order_release);
+    }
+
+    void set_huge_pages(bool enabled)
+    {
+        huge_pages.store(enabled, memory_order_relaxed);
+    }
+
+    bool huge_pages_enabled()
+    {
+        return huge_pages.load(memory_order_relaxed);
+    }
+}
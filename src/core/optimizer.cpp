@@ -14,11 +14,11 @@ void Optimizer::zero_grad()
     for (auto &[name, grad] : this->grads_)
     {
         if (grad == nullptr) {
-            cout << "Warning: Null gradient pointer for parameter " << name << endl;
+            NN_LOG_WARN(OPTIMIZER, "Null gradient pointer for parameter " << name);
             continue;
         }
         
-        // Create a zero tensor with the same shape and assign it
-        *grad = Tensor<>(grad->shapes(), 0.0f);
+        // Overwrite the existing storage, no tensor is allocated
+        grad->zero_();
     }
 }
\ No newline at end of file
@@ -0,0 +1,376 @@
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include "sparse_tensor.hpp"
+#include "parallel.hpp"
+
+/*
+Please refer to include/core/sparse_tensor.hpp
+*/
+
+namespace
+{
+    // Multiply-adds per chunk of parallel_for in the products with dense matrices
+    constexpr size_t PARALLEL_SPMM_WORK = 1 << 15;
+
+    void check_matrix(const Tensor<> &dense, const char *name)
+    {
+        if (dense.ndim() != 2)
+        {
+            throw invalid_argument(string(name) + " expects a 2D tensor, got " + to_string(dense.ndim()) + " dimensions");
+        }
+    }
+
+    string shape_string(size_t rows, size_t cols)
+    {
+        return "(" + to_string(rows) + ", " + to_string(cols) + ")";
+    }
+
+    // c[j] += a * b[j] for 0 <= j < n. The loop is vectorized by the compiler
+    inline void axpy(float a, const float *__restrict b, float *__restrict c, size_t n)
+    {
+        for (size_t j = 0; j < n; ++j)
+        {
+            c[j] += a * b[j];
+        }
+    }
+}
+
+// ---------------------------------------------------------------- SparseCOO
+
+SparseCOO::SparseCOO(size_t rows, size_t cols) : rows_(rows), cols_(cols) {}
+
+SparseCOO::SparseCOO(size_t rows, size_t cols, vector<size_t> row_indices, vector<size_t> col_indices, vector<float> values)
+    : rows_(rows), cols_(cols), row_indices_(std::move(row_indices)), col_indices_(std::move(col_indices)), values_(std::move(values))
+{
+    if (this->row_indices_.size() != this->values_.size() || this->col_indices_.size() != this->values_.size())
+    {
+        throw invalid_argument("The row indices, the column indices and the values of a sparse matrix must be of the same size");
+    }
+
+    for (size_t i = 0; i < this->values_.size(); ++i)
+    {
+        this->check_index(this->row_indices_[i], this->col_indices_[i]);
+    }
+}
+
+void SparseCOO::check_index(size_t row, size_t col) const
+{
+    if (row >= this->rows_ || col >= this->cols_)
+    {
+        throw out_of_range("Index " + shape_string(row, col) + " is out of bounds for a sparse matrix of shape " +
+                           shape_string(this->rows_, this->cols_));
+    }
+}
+
+SparseCOO SparseCOO::from_dense(const Tensor<> &dense)
+{
+    return SparseCSR::from_dense(dense).to_coo();
+}
+
+void SparseCOO::push_back(size_t row, size_t col, float value)
+{
+    this->check_index(row, col);
+
+    this->row_indices_.push_back(row);
+    this->col_indices_.push_back(col);
+    this->values_.push_back(value);
+}
+
+void SparseCOO::reserve(size_t nnz)
+{
+    this->row_indices_.reserve(nnz);
+    this->col_indices_.reserve(nnz);
+    this->values_.reserve(nnz);
+}
+
+SparseCOO SparseCOO::coalesce() const
+{
+    vector<size_t> order(this->nnz());
+    iota(order.begin(), order.end(), 0);
+
+    // stable, so that the duplicates are summed in the order in which they were added
+    stable_sort(order.begin(), order.end(), [this](size_t a, size_t b)
+                { return this->row_indices_[a] != this->row_indices_[b] ? this->row_indices_[a] < this->row_indices_[b]
+                                                                        : this->col_indices_[a] < this->col_indices_[b]; });
+
+    SparseCOO result(this->rows_, this->cols_);
+    result.reserve(this->nnz());
+
+    for (const size_t i : order)
+    {
+        const size_t row = this->row_indices_[i];
+        const size_t col = this->col_indices_[i];
+
+        if (result.nnz() > 0 && result.row_indices_.back() == row && result.col_indices_.back() == col)
+        {
+            result.values_.back() += this->values_[i];
+        }
+        else
+        {
+            result.row_indices_.push_back(row);
+            result.col_indices_.push_back(col);
+            result.values_.push_back(this->values_[i]);
+        }
+    }
+
+    return result;
+}
+
+SparseCSR SparseCOO::to_csr() const
+{
+    const SparseCOO coalesced = this->coalesce();
+
+    vector<size_t> row_ptr(this->rows_ + 1, 0);
+    for (const size_t row : coalesced.row_indices_)
+    {
+        ++row_ptr[row + 1];
+    }
+    partial_sum(row_ptr.begin(), row_ptr.end(), row_ptr.begin());
+
+    return SparseCSR(this->rows_, this->cols_, std::move(row_ptr), coalesced.col_indices_, coalesced.values_);
+}
+
+Tensor<> SparseCOO::to_dense() const
+{
+    Tensor<> result({this->rows_, this->cols_}, 0.0f);
+    const TensorAccessor<float, 2> out = result.accessor<2>();
+
+    for (size_t i = 0; i < this->nnz(); ++i)
+    {
+        out[this->row_indices_[i], this->col_indices_[i]] += this->values_[i];
+    }
+
+    return result;
+}
+
+// ---------------------------------------------------------------- SparseCSR
+
+SparseCSR::SparseCSR(size_t rows, size_t cols, vector<size_t> row_ptr, vector<size_t> col_indices, vector<float> values)
+    : rows_(rows), cols_(cols), row_ptr_(std::move(row_ptr)), col_indices_(std::move(col_indices)), values_(std::move(values))
+{
+    if (this->col_indices_.size() != this->values_.size())
+    {
+        throw invalid_argument("The column indices and the values of a sparse matrix must be of the same size");
+    }
+
+    if (this->row_ptr_.size() != this->rows_ + 1 || this->row_ptr_.front() != 0 || this->row_ptr_.back() != this->values_.size() ||
+        !is_sorted(this->row_ptr_.begin(), this->row_ptr_.end()))
+    {
+        throw invalid_argument("The row pointers of a sparse matrix with " + to_string(this->rows_) + " rows must be " + to_string(this->rows_ + 1) +
+                               " non-decreasing offsets from 0 to the number of elements");
+    }
+
+    for (const size_t col : this->col_indices_)
+    {
+        if (col >= this->cols_)
+        {
+            throw out_of_range("Column " + to_string(col) + " is out of bounds for a sparse matrix with " + to_string(this->cols_) + " columns");
+        }
+    }
+}
+
+SparseCSR SparseCSR::from_dense(const Tensor<> &dense)
+{
+    check_matrix(dense, "SparseCSR::from_dense");
+
+    const TensorAccessor<const float, 2> in = dense.accessor<2>();
+    const size_t rows = dense.shapes()[0];
+    const size_t cols = dense.shapes()[1];
+
+    vector<size_t> row_ptr(rows + 1, 0);
+    vector<size_t> col_indices;
+    vector<float> values;
+
+    for (size_t i = 0; i < rows; ++i)
+    {
+        for (size_t j = 0; j < cols; ++j)
+        {
+            if (in[i, j] != 0.0f)
+            {
+                col_indices.push_back(j);
+                values.push_back(in[i, j]);
+            }
+        }
+        row_ptr[i + 1] = values.size();
+    }
+
+    return SparseCSR(rows, cols, std::move(row_ptr), std::move(col_indices), std::move(values));
+}
+
+Tensor<> SparseCSR::to_dense() const
+{
+    Tensor<> result({this->rows_, this->cols_}, 0.0f);
+    const TensorAccessor<float, 2> out = result.accessor<2>();
+
+    for (size_t i = 0; i < this->rows_; ++i)
+    {
+        for (size_t p = this->row_ptr_[i]; p < this->row_ptr_[i + 1]; ++p)
+        {
+            out[i, this->col_indices_[p]] += this->values_[p];
+        }
+    }
+
+    return result;
+}
+
+SparseCOO SparseCSR::to_coo() const
+{
+    vector<size_t> row_indices(this->nnz());
+    for (size_t i = 0; i < this->rows_; ++i)
+    {
+        fill(row_indices.begin() + this->row_ptr_[i], row_indices.begin() + this->row_ptr_[i + 1], i);
+    }
+
+    return SparseCOO(this->rows_, this->cols_, std::move(row_indices), this->col_indices_, this->values_);
+}
+
+SparseCSR SparseCSR::transpose() const
+{
+    // counting sort of the elements by column: the rows of the transpose are visited in increasing order, so its columns are sorted
+    vector<size_t> row_ptr(this->cols_ + 1, 0);
+    for (const size_t col : this->col_indices_)
+    {
+        ++row_ptr[col + 1];
+    }
+    partial_sum(row_ptr.begin(), row_ptr.end(), row_ptr.begin());
+
+    vector<size_t> next(row_ptr.begin(), row_ptr.end() - 1);
+    vector<size_t> col_indices(this->nnz());
+    vector<float> values(this->nnz());
+
+    for (size_t i = 0; i < this->rows_; ++i)
+    {
+        for (size_t p = this->row_ptr_[i]; p < this->row_ptr_[i + 1]; ++p)
+        {
+            const size_t q = next[this->col_indices_[p]]++;
+            col_indices[q] = i;
+            values[q] = this->values_[p];
+        }
+    }
+
+    return SparseCSR(this->cols_, this->rows_, std::move(row_ptr), std::move(col_indices), std::move(values));
+}
+
+Tensor<> SparseCSR::matmul(const Tensor<> &dense) const
+{
+    check_matrix(dense, "SparseCSR::matmul");
+    if (dense.shapes()[0] != this->cols_)
+    {
+        throw invalid_argument("Cannot multiply a sparse matrix of shape " + shape_string(this->rows_, this->cols_) +
+                               " by a tensor of shape " + shape_string(dense.shapes()[0], dense.shapes()[1]));
+    }
+
+    const size_t n = dense.shapes()[1];
+    const Tensor<> b = dense.contiguous();
+    Tensor<> result({this->rows_, n}, 0.0f);
+
+    const float *B = b.data();
+    float *C = result.accessor<2>().data();
+
+    // row i of the result is the sum of the rows of B selected by the columns of row i, scaled by the values
+    const size_t work_per_row = max<size_t>(1, this->nnz() / max<size_t>(1, this->rows_) * n);
+    parallel_for(0, this->rows_, max<size_t>(1, PARALLEL_SPMM_WORK / work_per_row), [&](size_t begin, size_t end)
+                 {
+        for (size_t i = begin; i < end; ++i)
+        {
+            float *c = C + i * n;
+            for (size_t p = this->row_ptr_[i]; p < this->row_ptr_[i + 1]; ++p)
+            {
+                axpy(this->values_[p], B + this->col_indices_[p] * n, c, n);
+            }
+        } });
+
+    return result;
+}
+
+Tensor<> SparseCSR::transposed_matmul(const Tensor<> &dense) const
+{
+    check_matrix(dense, "SparseCSR::transposed_matmul");
+    if (dense.shapes()[0] != this->rows_)
+    {
+        throw invalid_argument("Cannot multiply the transpose of a sparse matrix of shape " + shape_string(this->rows_, this->cols_) +
+                               " by a tensor of shape " + shape_string(dense.shapes()[0], dense.shapes()[1]));
+    }
+
+    /*
+    Row i of the matrix scatters B[i, :] * value into the rows of the result selected by its columns, all over the result.
+    The rows of the transpose gather them instead, so every row of the result is written once and the threads never write
+    to the same row. Transposing costs O(nnz + cols), less than a pass over the (cols, N) result.
+    */
+    return this->transpose().matmul(dense);
+}
+
+vector<float> SparseCSR::gather(const Tensor<> &dense) const
+{
+    check_matrix(dense, "SparseCSR::multiply");
+
+    const DimVector &shape = dense.shapes();
+    if ((shape[0] != this->rows_ && shape[0] != 1) || (shape[1] != this->cols_ && shape[1] != 1))
+    {
+        throw invalid_argument("Cannot broadcast a tensor of shape " + shape_string(shape[0], shape[1]) + " to the shape " +
+                               shape_string(this->rows_, this->cols_) + " of the sparse matrix");
+    }
+
+    // a dimension of size 1 is broadcast with a stride of 0
+    const TensorAccessor<const float, 2> full = dense.accessor<2>();
+    const size_t sizes[2] = {this->rows_, this->cols_};
+    const size_t strides[2] = {shape[0] == 1 ? 0 : full.stride(0), shape[1] == 1 ? 0 : full.stride(1)};
+    const TensorAccessor<const float, 2> in(full.data(), sizes, strides);
+
+    vector<float> result(this->nnz());
+    for (size_t i = 0; i < this->rows_; ++i)
+    {
+        for (size_t p = this->row_ptr_[i]; p < this->row_ptr_[i + 1]; ++p)
+        {
+            result[p] = in[i, this->col_indices_[p]];
+        }
+    }
+
+    return result;
+}
+
+SparseCSR SparseCSR::multiply(const Tensor<> &dense) const
+{
+    vector<float> values = this->gather(dense);
+    for (size_t p = 0; p < values.size(); ++p)
+    {
+        values[p] *= this->values_[p];
+    }
+
+    return SparseCSR(this->rows_, this->cols_, this->row_ptr_, this->col_indices_, std::move(values));
+}
+
+Tensor<> SparseCSR::add(const Tensor<> &dense) const
+{
+    check_matrix(dense, "SparseCSR::add");
+    if (!(dense.shapes() == this->shapes()))
+    {
+        throw invalid_argument("Cannot add a tensor of shape " + shape_string(dense.shapes()[0], dense.shapes()[1]) + " to a sparse matrix of shape " +
+                               shape_string(this->rows_, this->cols_));
+    }
+
+    Tensor<> result = dense.clone();
+    const TensorAccessor<float, 2> out = result.accessor<2>();
+
+    for (size_t i = 0; i < this->rows_; ++i)
+    {
+        for (size_t p = this->row_ptr_[i]; p < this->row_ptr_[i + 1]; ++p)
+        {
+            out[i, this->col_indices_[p]] += this->values_[p];
+        }
+    }
+
+    return result;
+}
+
+SparseCSR SparseCSR::operator*(float scaler) const
+{
+    vector<float> values(this->values_);
+    for (float &value : values)
+    {
+        value *= scaler;
+    }
+
+    return SparseCSR(this->rows_, this->cols_, this->row_ptr_, this->col_indices_, std::move(values));
+}
@@ -1,4 +1,5 @@
 #include "mnist.hpp"
+#include "logging.hpp"
 
 bool MNIST::load_data(const string& image_file, const string& label_file) {
     if (!this->read_images(image_file) || !this->read_labels(label_file)) {
@@ -9,10 +10,8 @@ bool MNIST::load_data(const string& image_file, const string& label_file) {
     this->num_batches = (this->images.size() + this->batch_size - 1) / this->batch_size;
     
     if (this->verbose) {
-        cout << "Dataset loaded successfully:\n";
-        cout << "Total images: " << images.size() << "\n";
-        cout << "Batch size: " << this->batch_size << "\n";
-        cout << "Number of batches: " << num_batches << "\n";
+        NN_LOG_INFO(DATASET, "Dataset loaded successfully: " << images.size() << " images, batch size " << this->batch_size
+                             << ", " << num_batches << " batches");
     }
     
     return true;
@@ -57,7 +56,7 @@ float MNIST::normalize(float value) {
 bool MNIST::read_images(const string& path) {
     ifstream file(path, ios::binary);
     if(!file.is_open()) {
-        cerr << "Failed to open file: " << path << endl;
+        NN_LOG_ERROR(DATASET, "Failed to open file: " << path);
         return false;
     }
 
@@ -89,7 +88,7 @@ bool MNIST::read_images(const string& path) {
 bool MNIST::read_labels(const string& path) {
     ifstream file(path, ios::binary);
     if(!file.is_open()) {
-        cerr << "Failed to open file: " << path << endl;
+        NN_LOG_ERROR(DATASET, "Failed to open file: " << path);
         return false;
     }
 
@@ -113,7 +112,13 @@ bool MNIST::read_labels(const string& path) {
 }
 
 tuple<Tensor<>, Tensor<>> Batch::to_tensor() {
-    Tensor<> data = this->batch_data;
+    // the rows are viewed in place and stacked with a single copy, instead of going through the nested vector constructor
+    vector<Tensor<>> rows;
+    rows.reserve(this->batch_data.size());
+    for (vector<float>& row : this->batch_data) {
+        rows.push_back(Tensor<>::from_blob(row.data(), {row.size()}, nullptr));
+    }
+    Tensor<> data = rows.empty() ? Tensor<>(this->batch_data) : Tensor<>::stack(rows);
     Tensor<> labels = this->batch_labels;
 
     return make_tuple(data, labels);
@@ -1,13 +1,13 @@
 #include "accuracy.hpp"
 
 float metrics::accuracy(const Tensor<>& output, const Tensor<>& target) {
-    Tensor<size_t> output_argmax = output.argmax();
+    Tensor<size_t> output_argmax = output.argmax(-1);
 
     Tensor<size_t> target_argmax;
 
     if (target.ndim() == 2) {
         // since target are a matrix of one hot vectors
-        target_argmax = target.argmax();
+        target_argmax = target.argmax(-1);
     }
     else if (target.ndim() == 1) {
         target_argmax = target.dtype<size_t>();
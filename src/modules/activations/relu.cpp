@@ -6,21 +6,12 @@ Tensor<> ReLU::forward(const Tensor<>& input) {
     The forward process of ReLU is very similar to dropout with different criteria to select active units
     */
 
-    // Initialize the mask cache with the same shape as input, filled with zeros
-    this->mask_cache_ = Tensor<>(input.shapes(), 0.0f);
-
-    // Create result tensor with the same shape as input, filled with zeros
-    Tensor<> result(input.shapes(), 0.0f);
-    
-    // Process all elements regardless of tensor dimensions
-    for (size_t i = 0; i < input.size(); i++) {
-        // Use linear indexing with at() to access tensor elements
-        if (input.at(i) > 0.0f) {
-            result.at(i) = input.at(i);
-            this->mask_cache_.at(i) = 1.0f;
-        }
-        // No need for else case as tensors are already initialized with zeros
-    }
+    // The mask is 1 where the input is positive and 0 elsewhere. Both are element-wise maps, vectorized and parallel
+    this->mask_cache_ = input.map([](const float &x)
+                                  { return x > 0.0f ? 1.0f : 0.0f; });
+
+    Tensor<> result = input.map([](const float &x)
+                                { return x > 0.0f ? x : 0.0f; });
 
     return result;
 }
@@ -4,8 +4,7 @@ using namespace nn;
 
 Softmax::Softmax()
 {
-    cout << "Starting Softmax" << endl;
-    cout << "Softmax initialized" << endl;
+    NN_LOG_DEBUG(MODULES, "Softmax initialized");
 }
 
 Tensor<> Softmax::softmax_helper(const Tensor<> &input)
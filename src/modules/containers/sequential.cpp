@@ -69,6 +69,17 @@ Module* Sequential::get(size_t index) const {
     return this->modules_[index];
 }
 
+// Replace the module at index
+void Sequential::replace(size_t index, Module* module) {
+    if (index >= this->modules_.size()) {
+        throw std::out_of_range("Index out of range");
+    }
+    if (module != this->modules_[index]) {
+        delete this->modules_[index];
+        this->modules_[index] = module;
+    }
+}
+
 // Move assignment operator
 Sequential& Sequential::operator=(Sequential&& other) noexcept {
     if (this != &other) {
@@ -102,7 +113,7 @@ void Sequential::register_parameters(
     for (size_t i = 0; i < this->modules_.size(); ++i)
     {
         string module_prefix = prefix.empty() ? "layer" + to_string(i) : prefix + ".layer" + to_string(i);
-        cout << "Getting parameters for " << module_prefix << endl;
+        NN_LOG_DEBUG(MODULES, "Getting parameters for " << module_prefix);
 
         this->modules_[i]->register_parameters(params, grads, module_prefix);
     }
@@ -1,4 +1,3 @@
-#include <random>
 #include <cmath>
 #include "conv2d.hpp"
 using namespace nn;
@@ -75,6 +74,8 @@ Conv2d::Conv2d(size_t in_channels,
 
 Tensor<> Conv2d::forward(const Tensor<> &input)
 {
+    NN_TRACE_SCOPE(CONV, "Conv2d::forward");
+
     Tensor<> input_data = input;
     this->original_input_shape_ = input.shapes();
 
@@ -93,62 +94,40 @@ Tensor<> Conv2d::forward(const Tensor<> &input)
 
 Tensor<> Conv2d::backward(const Tensor<> &grad_output)
 {
+    NN_TRACE_SCOPE(CONV, "Conv2d::backward");
+
     /*
 
     */
     // dL_dY = grad_output
 
     // dL_dW = conv(input_data, dL_dY)
-    Tensor<> permuted_input = this->input_cache_.permute(1, 0, 2, 3);
-    Tensor<> permuted_grad_output = grad_output.permute(1, 0, 2, 3);
+    // The permuted views are materialized once (each H x W plane is copied as a row), so the convolution reads contiguous planes
+    Tensor<> permuted_input = this->input_cache_.permute(1, 0, 2, 3).contiguous();
+    Tensor<> permuted_grad_output = grad_output.permute(1, 0, 2, 3).contiguous();
 
     // The grad weight shape is initially permuted
     const vector<size_t> permuted_grad_weight_shape = {this->in_channels_, this->out_channels_, this->kernel_size_.first, this->kernel_size_.second};
 
     this->grad_weight_ = convolution(this->dilation_, this->stride_, permuted_grad_weight_shape, permuted_input, permuted_grad_output, Tensor<>(), false);
 
-    cout << "grad_weight: " << endl;
-    this->grad_weight_.print();
-    cout << endl;
+    NN_LOG_TRACE(CONV, "grad_weight: " << this->grad_weight_);
 
     // The grad weight shape is permuted back to the original shape
-    this->grad_weight_ = this->grad_weight_.permute(1, 0, 2, 3);
+    this->grad_weight_ = this->grad_weight_.permute(1, 0, 2, 3).contiguous();
 
     // dL_dB = sum(dL_dY, dims=(0, 2, 3))
     if (this->use_bias_)
     {
-        this->grad_bias_ = Tensor<>({this->out_channels_}, 0.0);
-        for (size_t i = 0; i < grad_output.shapes()[0]; i++)
-        {
-            for (size_t j = 0; j < grad_output.shapes()[1]; j++)
-            {
-                for (size_t k = 0; k < grad_output.shapes()[2]; k++)
-                {
-                    for (size_t l = 0; l < grad_output.shapes()[3]; l++)
-                    {
-                        this->grad_bias_[j] += grad_output[i, j, k, l];
-                    }
-                }
-            }
-        }
+        this->grad_bias_ = grad_output.sum({0, 2, 3});
 
-        cout << "grad_bias: " << endl;
-        this->grad_bias_.print();
-        cout << endl;
+        NN_LOG_TRACE(CONV, "grad_bias: " << this->grad_bias_);
     }
 
     // dL_dX = fullconv(dL_dY, W)
     Tensor<> flipped_weight = flip_vertical_and_horizontal(this->weight_);
-    cout << "flipped_weight: " << endl;
-    flipped_weight.print();
-    cout << endl;
-
     Tensor<> permuted_flipped_weight = flipped_weight.permute(1, 0, 2, 3);
 
-    cout << "permuted_flipped_weight: " << endl;
-    permuted_flipped_weight.print();
-    cout << endl;
-
     Tensor<> copy_grad_output = grad_output;
 
     if (this->stride_.first > 1 || this->stride_.second > 1)
@@ -196,31 +175,12 @@ void Conv2d::reset_parameters()
 
     const float stdv = 1.0 / sqrt(n);
 
-    // Set up the random number generator
-    random_device rd;
-    mt19937 gen(rd());
-    uniform_real_distribution<float> dis(-stdv, stdv);
-
-    for (size_t i = 0; i < this->out_channels_; i++)
-    {
-        for (size_t j = 0; j < this->in_channels_; j++)
-        {
-            for (size_t k = 0; k < this->kernel_size_.first; k++)
-            {
-                for (size_t l = 0; l < this->kernel_size_.second; l++)
-                {
-                    this->weight_[i, j, k, l] = dis(gen);
-                }
-            }
-        }
-    }
+    // from the global generator (see random.hpp)
+    this->weight_.uniform_(-stdv, stdv);
 
     if (this->use_bias_)
     {
-        for (size_t i = 0; i < this->out_channels_; i++)
-        {
-            this->bias_[i] = dis(gen);
-        }
+        this->bias_.uniform_(-stdv, stdv);
     }
 }
 
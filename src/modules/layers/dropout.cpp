@@ -1,7 +1,7 @@
 #include "dropout.hpp"
 using namespace nn;
 
-Dropout::Dropout(float p) {
+Dropout::Dropout(float p) : gen_(rng::default_generator().next_u64()) {
     if (p < 0 || p > 1) {
         throw runtime_error("Dropout probability must be between 0 and 1");
     }
@@ -10,37 +10,19 @@ Dropout::Dropout(float p) {
     // It is inverted dropout
     this->p_ = p;
     this->scale_ = 1.0f / (1 - p);
-    this->pmf_ = bernoulli_distribution(1 - p);
-
-    // Set up the random number generator
-    random_device rd;
-    this->gen_ = mt19937(rd());
 }
 
 Tensor<> Dropout::forward(const Tensor<>& input) {
-    // no need to cache input. Instead, we have to cache the mask for backprop
-    this->mask_cache_ = Tensor<>(input.shapes(), 0.0f);
-
     if (!this->training) {
         return input;
     }
 
-    Tensor<> result(input.shapes(), 0.0f);
+    // no need to cache input. Instead, we have to cache the mask for backprop.
+    // The scale is applied to the mask, so that the forward and the backward pass are a single product each
+    this->mask_cache_ = Tensor<>::empty(input.shapes());
+    this->mask_cache_.bernoulli_(1 - this->p_, this->gen_).mul_(this->scale_);
 
-    for (size_t i = 0; i < input.shapes()[0]; i++) {
-        for (size_t j = 0; j < input.shapes()[1]; j++) {
-            bool is_active = this->pmf_(this->gen_);
-
-            if (is_active) {
-                result[i, j] = input[i, j];
-                this->mask_cache_[i, j] = 1.0f;
-            } else {
-                result[i, j] = 0.0f;
-            }
-        }
-    }
-
-    return result * this->scale_;
+    return input * this->mask_cache_;
 }
 
 Tensor<> Dropout::backward(const Tensor<>& grad_output) {
@@ -53,12 +35,13 @@ Tensor<> Dropout::backward(const Tensor<>& grad_output) {
 
     dL/dY = dL/dZ * dZ/dY
           = grad_output * MASK * 1 / (1 - p)
+
+    mask_cache_ already holds MASK * 1 / (1 - p)
     */
 
     if (!this->training) {
         return grad_output;
     }
 
-    return grad_output * this->mask_cache_ * this->scale_;
-
+    return grad_output * this->mask_cache_;
 }
\ No newline at end of file
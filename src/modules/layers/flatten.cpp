@@ -3,7 +3,7 @@ using namespace nn;
 
 Flatten::Flatten(int64_t start_dim, int64_t end_dim) : start_dim_(start_dim), end_dim_(end_dim)
 {
-    cout << "Flatten layer initialized with start_dim = " << start_dim << " and end_dim = " << end_dim << endl;
+    NN_LOG_DEBUG(MODULES, "Flatten layer initialized with start_dim = " << start_dim << " and end_dim = " << end_dim);
 }
 
 Tensor<> Flatten::forward(const Tensor<> &input)
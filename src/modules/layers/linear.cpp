@@ -1,28 +1,28 @@
-#include <random>
 #include <cmath>
 #include "linear.hpp"
 using namespace nn;
 
 Linear::Linear(size_t in_features, size_t out_features, bool bias) : in_features_(in_features), out_features_(out_features), use_bias_(bias)
 {
-    this->weight_ = Tensor<>({in_features, out_features}, 0.0f);
+    // every element is initialized by reset_parameters()
+    this->weight_ = Tensor<>::empty({in_features, out_features});
 
     if (this->use_bias_)
     {
-        this->bias_ = Tensor<>({out_features, 1}, 0.0f);
+        this->bias_ = Tensor<>::empty({out_features, 1});
     }
 
     // randomize the weights and bias based on PyTorch implementation
     this->reset_parameters();
 
-    cout << "Linear layer initialized with in_features = " << in_features << " and out_features = " << out_features << endl;
-    cout << &this->input_cache_ << endl;
+    NN_LOG_DEBUG(MODULES, "Linear layer initialized with in_features = " << in_features << " and out_features = " << out_features);
 }
 
 Tensor<> Linear::forward(const Tensor<> &input)
 {
     this->input_cache_ = input;
-    size_t batchSize = input.shapes()[0];
+    this->sparse_input_cache_ = SparseCSR();
+    this->sparse_input_ = false;
 
     const Tensor<> &XW = input.matmul(this->weight_);
 
@@ -31,23 +31,47 @@ Tensor<> Linear::forward(const Tensor<> &input)
         return XW;
     }
 
-    Tensor<> biases_repeated = Tensor<>({batchSize, this->out_features_}, 0.0f);
+    // bias is of shape (out_features, 1), its transpose (1, out_features) is broadcast to every row of XW
+    return XW + this->bias_.transpose();
+}
 
-    for (size_t i = 0; i < batchSize; i++)
+Tensor<> Linear::forward(const SparseCSR &input)
+{
+    if (input.cols() != this->in_features_)
     {
-        for (size_t j = 0; j < this->out_features_; j++)
-        {
-            biases_repeated[i, j] = this->bias_[j, 0];
-        }
+        throw invalid_argument("Linear layer expects " + to_string(this->in_features_) + " input features, got a sparse input with " +
+                               to_string(input.cols()) + " columns");
+    }
+
+    this->input_cache_ = Tensor<>();
+    this->sparse_input_cache_ = input;
+    this->sparse_input_ = true;
+
+    const Tensor<> XW = input.matmul(this->weight_);
+
+    if (!this->use_bias_)
+    {
+        return XW;
     }
 
-    return XW + biases_repeated;
+    return XW + this->bias_.transpose();
 }
 
 Tensor<> Linear::backward(const Tensor<> &grad_output)
 {
     // dL/dY = grad_output
 
+    if (this->sparse_input_)
+    {
+        // dL/dW = X^T * dL/dY, and no dL/dX for a sparse input
+        this->grad_weight_ = this->sparse_input_cache_.transposed_matmul(grad_output);
+
+        if (this->use_bias_)
+            this->grad_bias_ = grad_output.sum(0).reshape({grad_output.shapes()[1], 1});
+
+        return Tensor<>();
+    }
+
     // dL/dW = X^T * dL/dY
     this->grad_weight_ = this->input_cache_.transpose().matmul(grad_output);
 
@@ -55,11 +79,10 @@ Tensor<> Linear::backward(const Tensor<> &grad_output)
     Tensor<> grad_input = grad_output.matmul(this->weight_.transpose());
 
     /*
-    dL/db = dL/dY^T * 1_B (1_B is a vector of ones of size batchSize)
-    dL/db = dL/dY.sum(axis=0)
+    dL/db = dL/dY.sum(axis=0), reshaped to the (out_features, 1) shape of the bias
     */
     if (this->use_bias_)
-        this->grad_bias_ = grad_output.transpose().matmul(Tensor<>({grad_output.shapes()[0], 1}, 1.0f));
+        this->grad_bias_ = grad_output.sum(0).reshape({grad_output.shapes()[1], 1});
 
     return grad_input;
 }
@@ -78,26 +101,12 @@ void Linear::reset_parameters()
     // Calculate the limit for the uniform distribution
     const float stdv = 1.0 / sqrt(this->weight_.shapes()[0]); // since the weight is transposed
 
-    // Set up the random number generator
-    random_device rd;
-    mt19937 gen(rd());
-    uniform_real_distribution<float> dis(-stdv, stdv);
-
-    // Xavier initialization
-    for (size_t i = 0; i < this->in_features_; i++)
-    {
-        for (size_t j = 0; j < this->out_features_; j++)
-        {
-            this->weight_[i, j] = dis(gen);
-        }
-    }
+    // Xavier initialization, from the global generator (see random.hpp)
+    this->weight_.uniform_(-stdv, stdv);
 
     if (this->use_bias_)
     {
-        for (size_t i = 0; i < this->out_features_; i++)
-        {
-            this->bias_[i, 0] = dis(gen);
-        }
+        this->bias_.uniform_(-stdv, stdv);
     }
 }
 
@@ -0,0 +1,46 @@
+#include <stdexcept>
+#include "quantized_linear.hpp"
+using namespace nn;
+
+QuantizedLinear::QuantizedLinear(const Linear &linear, float input_min, float input_max)
+{
+    const Tensor<> &weight = linear.get_weight(); // (in_features, out_features)
+    const size_t in_features = weight.shapes()[0];
+    const size_t out_features = weight.shapes()[1];
+
+    this->input_params_ = choose_qparams(input_min, input_max, 0, qgemm::A_MAX);
+
+    // One scale per output channel, i.e. per column of the weight
+    const Tensor<> weight_amax = weight.abs().max(0);
+    vector<float> scales(out_features);
+    for (size_t j = 0; j < out_features; ++j)
+    {
+        scales[j] = choose_qparams(-weight_amax[j], weight_amax[j], -qgemm::B_MAX, qgemm::B_MAX, true).scale;
+    }
+
+    const QTensor<int8_t> q_weight = QTensor<int8_t>::quantize_per_channel(weight, scales, vector<int32_t>(out_features, 0), 1, -qgemm::B_MAX, qgemm::B_MAX);
+    this->weight_ = qgemm::PackedMatrix(q_weight.data(), in_features, out_features, out_features, 1);
+    this->weight_scales_ = scales;
+
+    if (linear.has_bias())
+    {
+        const Tensor<> &bias = linear.get_bias(); // (out_features, 1)
+        this->bias_.resize(out_features);
+        for (size_t j = 0; j < out_features; ++j)
+        {
+            this->bias_[j] = bias[j, 0];
+        }
+    }
+}
+
+Tensor<> QuantizedLinear::forward(const Tensor<> &input)
+{
+    const QTensor<uint8_t> q_input = QTensor<uint8_t>::quantize(input, this->input_params_, 0, qgemm::A_MAX);
+
+    return q_input.linear(this->weight_, this->weight_scales_, this->bias_);
+}
+
+Tensor<> QuantizedLinear::backward(const Tensor<> &)
+{
+    throw runtime_error("QuantizedLinear only supports inference, train the Linear layer before quantizing it");
+}
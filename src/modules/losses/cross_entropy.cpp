@@ -5,8 +5,7 @@ using namespace nn;
 
 CrossEntropyLoss::CrossEntropyLoss()
 {
-    cout << "Starting CrossEntropyLoss" << endl;
-    cout << "CrossEntropyLoss initialized" << endl;
+    NN_LOG_DEBUG(MODULES, "CrossEntropyLoss initialized");
 }
 
 float CrossEntropyLoss::forward(const Tensor<> &Y_hat, const Tensor<> &Y)
@@ -43,13 +42,18 @@ float CrossEntropyLoss::forward(const Tensor<> &Y_hat, const Tensor<> &Y)
     Tensor<> softmax_Y_hat = this->softmax_(Y_hat);
     this->softmax_Y_hat_cache_ = softmax_Y_hat;
 
+    // the probabilities of the correct labels, softmax(Y_hat)_{i, Y_i}, gathered in one pass
+    this->label_index_cache_ = this->Y_cache_.dtype<size_t>().reshape({B, 1});
+    const Tensor<> picked = softmax_Y_hat.gather(1, this->label_index_cache_);
+
     // sum up all the elements
     float loss_without_factor = 0.0f;
 
-    for (int i = 0; i < B; ++i)
+    const float *p = picked.data();
+    for (size_t i = 0; i < B; ++i)
     {
         // Y_{ij} * log(softmax(Y_hat_{ij}))
-        loss_without_factor += log(softmax_Y_hat[i, static_cast<int>(this->Y_cache_[i])]);
+        loss_without_factor += log(p[i]);
     }
 
     return loss_without_factor * factor;
@@ -76,10 +80,7 @@ Tensor<> CrossEntropyLoss::backward()
     Since Y is a matrix of one-hot vectors, only the correct label is 1 and the rest are 0
     */
 
-    for (int i = 0; i < B; ++i)
-    {
-        grad_output[i, static_cast<int>(this->Y_cache_[i])] -= 1.0f;
-    }
+    grad_output.scatter_add_(1, this->label_index_cache_, Tensor<>({B, 1}, -1.0f));
 
     grad_output /= B;
 
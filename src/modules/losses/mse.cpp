@@ -16,10 +16,8 @@ float MSE::forward(const Tensor<>& Y_hat, const Tensor<>& Y) {
         throw runtime_error("Shape mismatch");
     }
 
-    Tensor<> diff = Y - Y_hat;
-    diff *= diff;
-
-    float loss_without_factor = diff.sum();
+    // fused into a single pass, without materializing Y - Y_hat
+    float loss_without_factor = ((lazy(Y) - Y_hat) * (lazy(Y) - Y_hat)).sum();
 
     return loss_without_factor / (B * M);
 }
@@ -32,9 +30,7 @@ Tensor<> MSE::backward() {
     const size_t B = this->Y_cache_.shapes()[0], M = this->Y_cache_.shapes()[1];
     const float factor = 2.0f / (B * M);
 
-    Tensor<> diff = this->Y_cache_ - this->Y_hat_cache_;
-
-    Tensor<> grad_output = diff * factor;
+    Tensor<> grad_output = (lazy(this->Y_cache_) - this->Y_hat_cache_) * factor;
 
     return grad_output;
 }
\ No newline at end of file
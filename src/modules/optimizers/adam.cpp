@@ -41,21 +41,15 @@ void Adam::step()
         // Apply weight decay
         if (this->weight_decay_ > 0.0f)
         {
-            grad = grad + *param * this->weight_decay_;
+            grad = lazy(grad) + lazy(*param) * this->weight_decay_;
         }
 
         // Update biased first and second moment estimates
-        m = m * this->beta1_ + grad * (1.0f - this->beta1_);
-        v = v * this->beta2_ + (grad * grad) * (1.0f - this->beta2_);
+        // Each update is fused into a single pass that writes directly into the buffers (see tensor_expr.hpp)
+        m = lazy(m) * this->beta1_ + lazy(grad) * (1.0f - this->beta1_);
+        v = lazy(v) * this->beta2_ + (lazy(grad) * grad) * (1.0f - this->beta2_);
 
-        // Compute bias-corrected moment estimates
-        Tensor<> m_corrected = m / beta1_correction;
-        Tensor<> v_corrected = v / beta2_correction;
-
-        // Update parameters
-        Tensor<> v_sqrt_eps = v_corrected.sqrt() + this->epsilon_;
-
-        Tensor<> update = m_corrected / v_sqrt_eps;
-        *param = *param - update * this->learning_rate_;
+        // Update parameters with the bias-corrected moment estimates
+        *param = lazy(*param) - (lazy(m) / beta1_correction) / (sqrt(lazy(v) / beta2_correction) + this->epsilon_) * this->learning_rate_;
     }
 }
\ No newline at end of file
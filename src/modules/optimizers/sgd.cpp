@@ -20,16 +20,16 @@ void SGD::step() {
         
         // Apply weight decay
         if (weight_decay_ > 0.0f) {
-            grad = grad + (*param) * weight_decay_;
+            grad = lazy(grad) + lazy(*param) * weight_decay_;
         }
         
         // Apply momentum if needed
         if (momentum_ > 0.0f) {
             Tensor<>& v = velocity_[name];
-            v = v * momentum_ + grad * (1.0f - momentum_);
-            *param = *param - v * learning_rate_;
+            v = lazy(v) * momentum_ + lazy(grad) * (1.0f - momentum_);
+            *param = lazy(*param) - lazy(v) * learning_rate_;
         } else {
-            *param = *param - grad * learning_rate_;
+            *param = lazy(*param) - lazy(grad) * learning_rate_;
         }
     }
 }
\ No newline at end of file
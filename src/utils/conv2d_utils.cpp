@@ -1,4 +1,5 @@
 #include "conv2d_utils.hpp"
+#include "logging.hpp"
 
 Tensor<> Padding::pad(const Tensor<> &input, const size_tp2 &padding) const
 {
@@ -14,7 +15,7 @@ Tensor<> Padding::pad(const Tensor<> &input, const size_tp2 &padding) const
 
 Tensor<> Padding::zero_pad(const Tensor<> &input, const size_tp2 &padding) const
 {
-    const vector<size_t> &input_shape = input.shapes();
+    const DimVector &input_shape = input.shapes();
 
     if (input_shape.size() != 4)
     {
@@ -31,6 +32,9 @@ Tensor<> Padding::zero_pad(const Tensor<> &input, const size_tp2 &padding) const
 
     Tensor<> padded_output({B, C, padded_H, padded_W}, 0.0);
 
+    const TensorAccessor<const float, 4> in = input.accessor<4>();
+    const TensorAccessor<float, 4> out = padded_output.accessor<4>();
+
     for (size_t b = 0; b < B; ++b)
     {
         for (size_t c = 0; c < C; ++c)
@@ -39,7 +43,7 @@ Tensor<> Padding::zero_pad(const Tensor<> &input, const size_tp2 &padding) const
             {
                 for (size_t w = 0; w < W; ++w)
                 {
-                    padded_output[b, c, h + padding.first, w + padding.second] = input[b, c, h, w];
+                    out[b, c, h + padding.first, w + padding.second] = in[b, c, h, w];
                 }
             }
         }
@@ -50,8 +54,8 @@ Tensor<> Padding::zero_pad(const Tensor<> &input, const size_tp2 &padding) const
 
 Tensor<> convolution(const size_tp2 &stride, const size_tp2 &dilation, const vector<size_t> &output_shape, const Tensor<> &input, const Tensor<> &kernel, const Tensor<> &bias, bool use_bias)
 {
-    const vector<size_t> &input_shape = input.shapes();
-    const vector<size_t> &kernel_shape = kernel.shapes();
+    const DimVector &input_shape = input.shapes();
+    const DimVector &kernel_shape = kernel.shapes();
 
     if (output_shape.size() != 4)
     {
@@ -78,7 +82,17 @@ Tensor<> convolution(const size_tp2 &stride, const size_tp2 &dilation, const vec
     const size_t K_H = kernel_shape[2];
     const size_t K_W = kernel_shape[3];
 
-    Tensor<> output(output_shape, 0.0);
+    // The elements are read without bounds checks below
+    if (input_shape[0] != B || kernel_shape[0] != C_out || kernel_shape[1] != C_in)
+    {
+        throw std::invalid_argument("The shapes of the input, the kernel and the output do not match");
+    }
+
+    Tensor<> output = Tensor<>::empty(output_shape);
+
+    const TensorAccessor<const float, 4> in = input.accessor<4>();
+    const TensorAccessor<const float, 4> weight = kernel.accessor<4>();
+    const TensorAccessor<float, 4> out = output.accessor<4>();
 
     /*
     The logic behind is that
@@ -106,35 +120,47 @@ Tensor<> convolution(const size_tp2 &stride, const size_tp2 &dilation, const vec
             {
                 for (size_t w = 0; w < W_out; ++w)
                 {
-                    size_t h_start = h * stride.first;
-                    size_t w_start = w * stride.second;
+                    const size_t h_start = h * stride.first;
+                    const size_t w_start = w * stride.second;
+
+                    // The sum is accumulated in a register and stored once
+                    float sum = 0.0f;
 
                     for (size_t ic = 0; ic < C_in; ++ic)
                     {
                         for (size_t kh = 0; kh < K_H; ++kh)
                         {
-                            for (size_t kw = 0; kw < K_W; ++kw)
+                            const size_t h_in = h_start + kh * dilation.first;
+                            if (h_in >= H_in)
                             {
-                                size_t h_in = h_start + kh * dilation.first;
-                                size_t w_in = w_start + kw * dilation.second;
+                                break;
+                            }
 
-                                if (h_in >= 0 && h_in < H_in && w_in >= 0 && w_in < W_in)
+                            for (size_t kw = 0; kw < K_W; ++kw)
+                            {
+                                const size_t w_in = w_start + kw * dilation.second;
+                                if (w_in >= W_in)
                                 {
-                                    output[b, c, h, w] += input[b, ic, h_in, w_in] * kernel[c, ic, kh, kw];
+                                    break;
                                 }
+
+                                sum += in[b, ic, h_in, w_in] * weight[c, ic, kh, kw];
                             }
                         }
                     }
 
-                    if (use_bias)
-                    {
-                        output[b, c, h, w] += bias[c];
-                    }
+                    out[b, c, h, w] = sum;
                 }
             }
         }
     }
 
+    if (use_bias)
+    {
+        // bias of shape (C_out) is broadcast to (B, C_out, H_out, W_out), in place
+        output.add_(bias.reshape({1, C_out, 1, 1}));
+    }
+
     return output;
 }
 
@@ -167,14 +193,11 @@ const vector<size_t> calculate_output_shape(const vector<size_t> &input_shape, c
     const size_t H_in = input_shape[2];
     const size_t W_in = input_shape[3];
 
-    cout << "Btach Size : " << B << endl;
-    cout << "H_in : " << H_in << endl;
-    cout << "W_in : " << W_in << endl;
-    cout << "Out Channel : " << out_channel << endl;
-    cout << "Kernel Size : " << kernel_size.first << ", " << kernel_size.second << endl;
-    cout << "Stride : " << stride.first << ", " << stride.second << endl;
-    cout << "Padding : " << padding.first << ", " << padding.second << endl;
-    cout << "Dilation : " << dilation.first << ", " << dilation.second << endl;
+    NN_LOG_DEBUG(CONV, "Output shape of batch size " << B << ", H_in " << H_in << ", W_in " << W_in << ", out channels " << out_channel
+                                                      << ", kernel size (" << kernel_size.first << ", " << kernel_size.second << ")"
+                                                      << ", stride (" << stride.first << ", " << stride.second << ")"
+                                                      << ", padding (" << padding.first << ", " << padding.second << ")"
+                                                      << ", dilation (" << dilation.first << ", " << dilation.second << ")");
 
     const int64_t H_out = (H_in + 2 * padding.first - dilation.first * (kernel_size.first - 1) - 1) / stride.first + 1;
     const int64_t W_out = (W_in + 2 * padding.second - dilation.second * (kernel_size.second - 1) - 1) / stride.second + 1;
@@ -194,35 +217,26 @@ Tensor<> flip_vertical_and_horizontal(const Tensor<> &input)
         throw std::invalid_argument("Input shape must be 4D");
     }
 
-    Tensor<> output = input;
-
     const size_t B = input.shapes()[0];
     const size_t C = input.shapes()[1];
     const size_t H = input.shapes()[2];
     const size_t W = input.shapes()[3];
 
-    float cache;
+    // Every element is written once, at its flipped position, instead of swapping in a copy of the input
+    Tensor<> output = Tensor<>::empty(input.shapes());
+
+    const TensorAccessor<const float, 4> in = input.accessor<4>();
+    const TensorAccessor<float, 4> out = output.accessor<4>();
 
     for (size_t b = 0; b < B; ++b)
     {
         for (size_t c = 0; c < C; ++c)
         {
-            for (size_t h = 0; h < H / 2; ++h)
-            {
-                for (size_t w = 0; w < W; ++w)
-                {
-                    cache = output[b, c, h, w];
-                    output[b, c, h, w] = output[b, c, H - h - 1, w];
-                    output[b, c, H - h - 1, w] = cache;
-                }
-            }
             for (size_t h = 0; h < H; ++h)
             {
-                for (size_t w = 0; w < W / 2; ++w)
+                for (size_t w = 0; w < W; ++w)
                 {
-                    cache = output[b, c, h, w];
-                    output[b, c, h, w] = output[b, c, h, W - w - 1];
-                    output[b, c, h, W - w - 1] = cache;
+                    out[b, c, h, w] = in[b, c, H - h - 1, W - w - 1];
                 }
             }
         }
@@ -247,6 +261,9 @@ Tensor<> dilate_input(const Tensor<> &input, const size_tp2 &dilation)
 
     Tensor<> dilated_input({B, C, H_dilated, W_dilated}, 0.0);
 
+    const TensorAccessor<const float, 4> in = input.accessor<4>();
+    const TensorAccessor<float, 4> out = dilated_input.accessor<4>();
+
     for (size_t b = 0; b < B; ++b)
     {
         for (size_t c = 0; c < C; ++c)
@@ -255,7 +272,7 @@ Tensor<> dilate_input(const Tensor<> &input, const size_tp2 &dilation)
             {
                 for (size_t w = 0; w < W; ++w)
                 {
-                    dilated_input[b, c, h * dilation.first, w * dilation.second] = input[b, c, h, w];
+                    out[b, c, h * dilation.first, w * dilation.second] = in[b, c, h, w];
                 }
             }
         }
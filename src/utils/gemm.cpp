@@ -0,0 +1,569 @@
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include "gemm.hpp"
+#include "gemm_kernels.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+
+namespace gemm
+{
+    namespace
+    {
+        // Problems with fewer multiply-adds than this are computed directly, without packing
+        constexpr size_t SMALL_GEMM_FLOPS = 32 * 32 * 32;
+
+        // Problems with fewer multiply-adds than this run on the calling thread only
+        constexpr size_t PARALLEL_GEMM_FLOPS = 64 * 64 * 64;
+
+        constexpr size_t GENERIC_MR = 4;
+        constexpr size_t GENERIC_NR = 8;
+
+        void kernel_4x8(size_t k, const float *a, const float *b, float *c, size_t ldc)
+        {
+            float acc[GENERIC_MR][GENERIC_NR] = {};
+
+            for (size_t p = 0; p < k; ++p)
+            {
+                for (size_t i = 0; i < GENERIC_MR; ++i)
+                {
+                    for (size_t j = 0; j < GENERIC_NR; ++j)
+                    {
+                        acc[i][j] += a[i] * b[j];
+                    }
+                }
+                a += GENERIC_MR;
+                b += GENERIC_NR;
+            }
+
+            for (size_t i = 0; i < GENERIC_MR; ++i)
+            {
+                for (size_t j = 0; j < GENERIC_NR; ++j)
+                {
+                    c[i * ldc + j] += acc[i][j];
+                }
+            }
+        }
+
+        const MicroKernel &select_kernel()
+        {
+            switch (simd::active_isa())
+            {
+#ifdef NEURALNET_X86_SIMD
+            case simd::ISA::AVX512:
+                return avx512_kernel();
+            case simd::ISA::AVX2:
+                return avx2_kernel();
+#endif
+            default:
+                return generic_kernel();
+            }
+        }
+
+        // Growable 64-byte aligned scratch buffer. The content is not initialized
+        class PackBuffer
+        {
+        public:
+            float *get(size_t size)
+            {
+                if (size > this->capacity_)
+                {
+                    const size_t bytes = ((size * sizeof(float) + 63) / 64) * 64;
+                    float *data = static_cast<float *>(std::aligned_alloc(64, bytes));
+                    if (data == nullptr)
+                    {
+                        throw bad_alloc();
+                    }
+                    this->data_.reset(data);
+                    this->capacity_ = size;
+                }
+                return this->data_.get();
+            }
+
+        private:
+            struct Free
+            {
+                void operator()(float *p) const { std::free(p); }
+            };
+
+            unique_ptr<float[], Free> data_;
+            size_t capacity_ = 0;
+        };
+
+        // Each thread packs its blocks of A into its own buffer. The panel of B is packed by the thread calling sgemm
+        thread_local PackBuffer a_buffer;
+        thread_local PackBuffer b_buffer;
+
+        // Copy n contiguous elements to float. The 16-bit floats are converted with the vectorized kernels
+        inline void copy_to_float(const float *src, size_t n, float *dst)
+        {
+            std::copy(src, src + n, dst);
+        }
+
+        template <typename Half>
+        inline void copy_to_float(const Half *src, size_t n, float *dst)
+        {
+            simd::convert(src, dst, n);
+        }
+
+        /*
+        Pack a mc x kc block of A into micro-panels of mr rows, scaled by alpha. The last micro-panel is padded with zeros.
+
+        The packed layout does not depend on the layout (or the type) of A, so the same micro-kernel serves every case. Only the
+        order of the reads changes, so that A is always read along its unit stride:
+        - row-major A (csa == 1, e.g. A itself): row by row
+        - column-major A (rsa == 1, e.g. X^T for a row-major X): column by column, each column of the panel is a contiguous copy
+        */
+        template <typename In>
+        void pack_A(size_t mc, size_t kc, const In *A, size_t rsa, size_t csa, float alpha, size_t mr, float *buffer)
+        {
+            for (size_t ir = 0; ir < mc; ir += mr)
+            {
+                const size_t rows = std::min(mr, mc - ir);
+                float *panel = buffer + ir * kc;
+                const In *A_panel = A + ir * rsa;
+
+                if (rsa == 1 && csa != 1)
+                {
+                    for (size_t p = 0; p < kc; ++p)
+                    {
+                        const In *a_col = A_panel + p * csa;
+                        float *packed_col = panel + p * mr;
+
+                        for (size_t i = 0; i < rows; ++i)
+                        {
+                            packed_col[i] = alpha * static_cast<float>(a_col[i]);
+                        }
+                        for (size_t i = rows; i < mr; ++i)
+                        {
+                            packed_col[i] = 0.0f;
+                        }
+                    }
+                    continue;
+                }
+
+                for (size_t i = 0; i < rows; ++i)
+                {
+                    const In *a_row = A_panel + i * rsa;
+                    for (size_t p = 0; p < kc; ++p)
+                    {
+                        panel[p * mr + i] = alpha * static_cast<float>(a_row[p * csa]);
+                    }
+                }
+                for (size_t i = rows; i < mr; ++i)
+                {
+                    for (size_t p = 0; p < kc; ++p)
+                    {
+                        panel[p * mr + i] = 0.0f;
+                    }
+                }
+            }
+        }
+
+        /*
+        Pack the slivers [sliver_begin, sliver_end) of nr columns of a kc x nc panel of B. The last sliver is padded with zeros.
+
+        As for A, B is read along its unit stride:
+        - row-major B (csb == 1): each row of the sliver is a contiguous copy (a vectorized conversion for 16-bit floats)
+        - column-major B (rsb == 1, e.g. W^T for a row-major W): column by column
+        */
+        template <typename In>
+        void pack_B(size_t kc, size_t nc, const In *B, size_t rsb, size_t csb, size_t nr, float *buffer, size_t sliver_begin, size_t sliver_end)
+        {
+            for (size_t sliver = sliver_begin; sliver < sliver_end; ++sliver)
+            {
+                const size_t jr = sliver * nr;
+                const size_t cols = std::min(nr, nc - jr);
+                float *packed = buffer + jr * kc;
+                const In *B_sliver = B + jr * csb;
+
+                if (rsb == 1 && csb != 1)
+                {
+                    for (size_t j = 0; j < cols; ++j)
+                    {
+                        const In *b_col = B_sliver + j * csb;
+                        for (size_t p = 0; p < kc; ++p)
+                        {
+                            packed[p * nr + j] = static_cast<float>(b_col[p]);
+                        }
+                    }
+                    for (size_t p = 0; p < kc; ++p)
+                    {
+                        std::fill(packed + p * nr + cols, packed + (p + 1) * nr, 0.0f);
+                    }
+                    continue;
+                }
+
+                for (size_t p = 0; p < kc; ++p)
+                {
+                    const In *b_row = B_sliver + p * rsb;
+                    float *packed_row = packed + p * nr;
+
+                    if (csb == 1)
+                    {
+                        copy_to_float(b_row, cols, packed_row);
+                    }
+                    else
+                    {
+                        for (size_t j = 0; j < cols; ++j)
+                        {
+                            packed_row[j] = static_cast<float>(b_row[j * csb]);
+                        }
+                    }
+                    std::fill(packed_row + cols, packed_row + nr, 0.0f);
+                }
+            }
+        }
+
+        /*
+        Multiply a packed mc x kc block of A with the slivers [sliver_begin, sliver_end) of a packed kc x nc panel of B,
+        and accumulate into the corresponding block of C.
+        */
+        void macro_kernel(const MicroKernel &uk, size_t mc, size_t nc, size_t kc,
+                          const float *a_packed, const float *b_packed,
+                          float *C, size_t rsc, size_t csc,
+                          size_t sliver_begin, size_t sliver_end)
+        {
+            // Edge tiles (and C with a column stride) go through a temporary tile
+            float tile[32 * 32];
+
+            for (size_t sliver = sliver_begin; sliver < sliver_end; ++sliver)
+            {
+                const size_t jr = sliver * uk.nr;
+                const size_t cols = std::min(uk.nr, nc - jr);
+
+                for (size_t ir = 0; ir < mc; ir += uk.mr)
+                {
+                    const size_t rows = std::min(uk.mr, mc - ir);
+                    float *c_tile = C + ir * rsc + jr * csc;
+
+                    if (rows == uk.mr && cols == uk.nr && csc == 1)
+                    {
+                        uk.kernel(kc, a_packed + ir * kc, b_packed + jr * kc, c_tile, rsc);
+                        continue;
+                    }
+
+                    std::fill(tile, tile + uk.mr * uk.nr, 0.0f);
+                    uk.kernel(kc, a_packed + ir * kc, b_packed + jr * kc, tile, uk.nr);
+
+                    for (size_t i = 0; i < rows; ++i)
+                    {
+                        for (size_t j = 0; j < cols; ++j)
+                        {
+                            c_tile[i * rsc + j * csc] += tile[i * uk.nr + j];
+                        }
+                    }
+                }
+            }
+        }
+
+        // 4 floats in a register, with the GCC / Clang vector extension, so the tiles of the direct computation stay in registers on every target
+        typedef float float4 __attribute__((vector_size(16)));
+
+        inline float4 load4(const float *p)
+        {
+            float4 v;
+            __builtin_memcpy(&v, p, sizeof(v));
+            return v;
+        }
+
+        template <typename Half>
+        inline float4 load4(const Half *p)
+        {
+            return float4{static_cast<float>(p[0]), static_cast<float>(p[1]), static_cast<float>(p[2]), static_cast<float>(p[3])};
+        }
+
+        /*
+        Direct computation for small problems, where packing would cost more than it saves.
+        When the rows of B are dense, C is computed by 4 x 8 tiles held in registers, the rest column by column.
+        */
+        template <typename In>
+        void small_gemm(size_t M, size_t N, size_t K, float alpha,
+                        const In *A, size_t rsa, size_t csa,
+                        const In *B, size_t rsb, size_t csb,
+                        float *C, size_t rsc, size_t csc)
+        {
+            size_t j = 0;
+
+            if (csb == 1)
+            {
+                for (; j + 8 <= N; j += 8)
+                {
+                    size_t i = 0;
+                    for (; i + 4 <= M; i += 4)
+                    {
+                        float4 acc[4][2] = {};
+
+                        for (size_t p = 0; p < K; ++p)
+                        {
+                            const float4 b0 = load4(B + p * rsb + j);
+                            const float4 b1 = load4(B + p * rsb + j + 4);
+
+                            for (size_t r = 0; r < 4; ++r)
+                            {
+                                const float a = static_cast<float>(A[(i + r) * rsa + p * csa]);
+                                acc[r][0] += a * b0;
+                                acc[r][1] += a * b1;
+                            }
+                        }
+
+                        for (size_t r = 0; r < 4; ++r)
+                        {
+                            float *c_row = C + (i + r) * rsc + j * csc;
+                            for (size_t jj = 0; jj < 4; ++jj)
+                            {
+                                c_row[jj * csc] += alpha * acc[r][0][jj];
+                                c_row[(jj + 4) * csc] += alpha * acc[r][1][jj];
+                            }
+                        }
+                    }
+
+                    for (; i < M; ++i)
+                    {
+                        float4 acc0 = {}, acc1 = {};
+
+                        for (size_t p = 0; p < K; ++p)
+                        {
+                            const float a = static_cast<float>(A[i * rsa + p * csa]);
+                            acc0 += a * load4(B + p * rsb + j);
+                            acc1 += a * load4(B + p * rsb + j + 4);
+                        }
+
+                        float *c_row = C + i * rsc + j * csc;
+                        for (size_t jj = 0; jj < 4; ++jj)
+                        {
+                            c_row[jj * csc] += alpha * acc0[jj];
+                            c_row[(jj + 4) * csc] += alpha * acc1[jj];
+                        }
+                    }
+                }
+            }
+
+            // Remaining columns
+            for (; j < N; ++j)
+            {
+                for (size_t i = 0; i < M; ++i)
+                {
+                    float sum = 0.0f;
+                    for (size_t p = 0; p < K; ++p)
+                    {
+                        sum += static_cast<float>(A[i * rsa + p * csa]) * static_cast<float>(B[p * rsb + j * csb]);
+                    }
+                    C[i * rsc + j * csc] += alpha * sum;
+                }
+            }
+        }
+
+        // C = beta * C, where beta = 0 overwrites C (even if it holds NaN)
+        void scale_C(size_t M, size_t N, float beta, float *C, size_t rsc, size_t csc)
+        {
+            if (beta == 1.0f)
+            {
+                return;
+            }
+
+            for (size_t i = 0; i < M; ++i)
+            {
+                float *c_row = C + i * rsc;
+                if (beta == 0.0f)
+                {
+                    for (size_t j = 0; j < N; ++j)
+                    {
+                        c_row[j * csc] = 0.0f;
+                    }
+                }
+                else
+                {
+                    for (size_t j = 0; j < N; ++j)
+                    {
+                        c_row[j * csc] *= beta;
+                    }
+                }
+            }
+        }
+
+        template <typename In>
+        void gemm_impl(size_t M, size_t N, size_t K,
+                       float alpha,
+                       const In *A, size_t rsa, size_t csa,
+                       const In *B, size_t rsb, size_t csb,
+                       float beta,
+                       float *C, size_t rsc, size_t csc)
+        {
+            if (M == 0 || N == 0)
+            {
+                return;
+            }
+
+            scale_C(M, N, beta, C, rsc, csc);
+
+            if (K == 0 || alpha == 0.0f)
+            {
+                return;
+            }
+
+            const size_t flops = M * N * K;
+
+            if (flops < SMALL_GEMM_FLOPS || N == 1)
+            {
+                small_gemm(M, N, K, alpha, A, rsa, csa, B, rsb, csb, C, rsc, csc);
+                return;
+            }
+
+            const MicroKernel &uk = select_kernel();
+            const size_t num_threads = (flops < PARALLEL_GEMM_FLOPS) ? 1 : get_num_threads();
+
+            const size_t nc_max = std::min(uk.nc, ((N + uk.nr - 1) / uk.nr) * uk.nr);
+            const size_t kc_max = std::min(uk.kc, K);
+            float *b_packed = b_buffer.get(nc_max * kc_max);
+
+            for (size_t jc = 0; jc < N; jc += uk.nc)
+            {
+                const size_t nc = std::min(uk.nc, N - jc);
+                const size_t num_slivers = (nc + uk.nr - 1) / uk.nr;
+
+                for (size_t pc = 0; pc < K; pc += uk.kc)
+                {
+                    const size_t kc = std::min(uk.kc, K - pc);
+
+                    // Pack the panel of B, split by slivers among the threads
+                    const In *B_panel = B + pc * rsb + jc * csb;
+                    parallel_for(0, num_slivers, (num_threads == 1) ? num_slivers : 4, [&](size_t begin, size_t end)
+                                 { pack_B(kc, nc, B_panel, rsb, csb, uk.nr, b_packed, begin, end); });
+
+                    /*
+                    Split the work into (blocks of A) x (groups of slivers of B). There are enough blocks of A to keep
+                    every thread busy when M is large, otherwise the slivers of B are split as well (e.g. a small batch in Linear).
+                    */
+                    const size_t num_m_blocks = (M + uk.mc - 1) / uk.mc;
+                    const size_t num_n_groups = std::min(num_slivers, (num_threads + num_m_blocks - 1) / num_m_blocks);
+                    const size_t num_tasks = num_m_blocks * num_n_groups;
+
+                    parallel_for(0, num_tasks, (num_threads == 1) ? num_tasks : 1, [&](size_t task_begin, size_t task_end)
+                                 {
+                        for (size_t task = task_begin; task < task_end; ++task)
+                        {
+                            const size_t m_block = task / num_n_groups;
+                            const size_t n_group = task % num_n_groups;
+
+                            const size_t ic = m_block * uk.mc;
+                            const size_t mc = std::min(uk.mc, M - ic);
+
+                            const size_t sliver_begin = n_group * num_slivers / num_n_groups;
+                            const size_t sliver_end = (n_group + 1) * num_slivers / num_n_groups;
+
+                            float *a_packed = a_buffer.get(((mc + uk.mr - 1) / uk.mr) * uk.mr * kc);
+                            pack_A(mc, kc, A + ic * rsa + pc * csa, rsa, csa, alpha, uk.mr, a_packed);
+
+                            macro_kernel(uk, mc, nc, kc, a_packed, b_packed, C + ic * rsc + jc * csc, rsc, csc, sliver_begin, sliver_end);
+                        } });
+                }
+            }
+        }
+
+        template <typename In>
+        void gemm_strided_batched_impl(size_t batch_count, size_t M, size_t N, size_t K,
+                                       float alpha,
+                                       const In *A, size_t rsa, size_t csa, size_t stride_a,
+                                       const In *B, size_t rsb, size_t csb, size_t stride_b,
+                                       float beta,
+                                       float *C, size_t rsc, size_t csc, size_t stride_c)
+        {
+            if (batch_count == 0)
+            {
+                return;
+            }
+
+            // A shared B with the batches of A and C laid out as consecutive rows, e.g. [batch, M, K] x [K, N]
+            if (batch_count == 1 || (stride_b == 0 && stride_a == M * rsa && stride_c == M * rsc))
+            {
+                gemm_impl(batch_count * M, N, K, alpha, A, rsa, csa, B, rsb, csb, beta, C, rsc, csc);
+                return;
+            }
+
+            const size_t flops = M * N * K;
+
+            // Large matrices are parallelized inside each GEMM, small ones across the batches
+            const size_t grain_size = (flops >= PARALLEL_GEMM_FLOPS) ? batch_count : std::max<size_t>(1, PARALLEL_GEMM_FLOPS / std::max<size_t>(flops, 1));
+
+            parallel_for(0, batch_count, grain_size, [&](size_t begin, size_t end)
+                         {
+                for (size_t b = begin; b < end; ++b)
+                {
+                    gemm_impl(M, N, K, alpha, A + b * stride_a, rsa, csa, B + b * stride_b, rsb, csb, beta, C + b * stride_c, rsc, csc);
+                } });
+        }
+    }
+
+    const MicroKernel &generic_kernel()
+    {
+        static const MicroKernel kernel = {"generic 4x8", GENERIC_MR, GENERIC_NR, 64, 256, 2048, kernel_4x8};
+        return kernel;
+    }
+
+    string kernel_name()
+    {
+        return select_kernel().name;
+    }
+
+    void sgemm(size_t M, size_t N, size_t K,
+               float alpha,
+               const float *A, size_t rsa, size_t csa,
+               const float *B, size_t rsb, size_t csb,
+               float beta,
+               float *C, size_t rsc, size_t csc)
+    {
+        gemm_impl(M, N, K, alpha, A, rsa, csa, B, rsb, csb, beta, C, rsc, csc);
+    }
+
+    void sgemm(size_t M, size_t N, size_t K,
+               float alpha,
+               const bf16 *A, size_t rsa, size_t csa,
+               const bf16 *B, size_t rsb, size_t csb,
+               float beta,
+               float *C, size_t rsc, size_t csc)
+    {
+        gemm_impl(M, N, K, alpha, A, rsa, csa, B, rsb, csb, beta, C, rsc, csc);
+    }
+
+    void sgemm(size_t M, size_t N, size_t K,
+               float alpha,
+               const fp16 *A, size_t rsa, size_t csa,
+               const fp16 *B, size_t rsb, size_t csb,
+               float beta,
+               float *C, size_t rsc, size_t csc)
+    {
+        gemm_impl(M, N, K, alpha, A, rsa, csa, B, rsb, csb, beta, C, rsc, csc);
+    }
+
+    void sgemm_strided_batched(size_t batch_count, size_t M, size_t N, size_t K,
+                               float alpha,
+                               const float *A, size_t rsa, size_t csa, size_t stride_a,
+                               const float *B, size_t rsb, size_t csb, size_t stride_b,
+                               float beta,
+                               float *C, size_t rsc, size_t csc, size_t stride_c)
+    {
+        gemm_strided_batched_impl(batch_count, M, N, K, alpha, A, rsa, csa, stride_a, B, rsb, csb, stride_b, beta, C, rsc, csc, stride_c);
+    }
+
+    void sgemm_strided_batched(size_t batch_count, size_t M, size_t N, size_t K,
+                               float alpha,
+                               const bf16 *A, size_t rsa, size_t csa, size_t stride_a,
+                               const bf16 *B, size_t rsb, size_t csb, size_t stride_b,
+                               float beta,
+                               float *C, size_t rsc, size_t csc, size_t stride_c)
+    {
+        gemm_strided_batched_impl(batch_count, M, N, K, alpha, A, rsa, csa, stride_a, B, rsb, csb, stride_b, beta, C, rsc, csc, stride_c);
+    }
+
+    void sgemm_strided_batched(size_t batch_count, size_t M, size_t N, size_t K,
+                               float alpha,
+                               const fp16 *A, size_t rsa, size_t csa, size_t stride_a,
+                               const fp16 *B, size_t rsb, size_t csb, size_t stride_b,
+                               float beta,
+                               float *C, size_t rsc, size_t csc, size_t stride_c)
+    {
+        gemm_strided_batched_impl(batch_count, M, N, K, alpha, A, rsa, csa, stride_a, B, rsb, csb, stride_b, beta, C, rsc, csc, stride_c);
+    }
+}
@@ -0,0 +1,75 @@
+#include <immintrin.h>
+#include "gemm_kernels.hpp"
+
+/*
+AVX2 + FMA micro-kernel. This file is compiled with -mavx2 -mfma.
+
+The 6 x 16 tile of C takes 12 of the 16 ymm registers, 2 more hold the current row of the B sliver,
+and one holds the broadcast element of A.
+*/
+namespace gemm
+{
+    namespace
+    {
+        constexpr size_t MR = 6;
+        constexpr size_t NR = 16;
+
+        void kernel_6x16(size_t k, const float *a, const float *b, float *c, size_t ldc)
+        {
+            __m256 c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps();
+            __m256 c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+            __m256 c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps();
+            __m256 c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+            __m256 c40 = _mm256_setzero_ps(), c41 = _mm256_setzero_ps();
+            __m256 c50 = _mm256_setzero_ps(), c51 = _mm256_setzero_ps();
+
+            for (size_t p = 0; p < k; ++p)
+            {
+                const __m256 b0 = _mm256_loadu_ps(b);
+                const __m256 b1 = _mm256_loadu_ps(b + 8);
+
+                __m256 ai = _mm256_broadcast_ss(a + 0);
+                c00 = _mm256_fmadd_ps(ai, b0, c00);
+                c01 = _mm256_fmadd_ps(ai, b1, c01);
+
+                ai = _mm256_broadcast_ss(a + 1);
+                c10 = _mm256_fmadd_ps(ai, b0, c10);
+                c11 = _mm256_fmadd_ps(ai, b1, c11);
+
+                ai = _mm256_broadcast_ss(a + 2);
+                c20 = _mm256_fmadd_ps(ai, b0, c20);
+                c21 = _mm256_fmadd_ps(ai, b1, c21);
+
+                ai = _mm256_broadcast_ss(a + 3);
+                c30 = _mm256_fmadd_ps(ai, b0, c30);
+                c31 = _mm256_fmadd_ps(ai, b1, c31);
+
+                ai = _mm256_broadcast_ss(a + 4);
+                c40 = _mm256_fmadd_ps(ai, b0, c40);
+                c41 = _mm256_fmadd_ps(ai, b1, c41);
+
+                ai = _mm256_broadcast_ss(a + 5);
+                c50 = _mm256_fmadd_ps(ai, b0, c50);
+                c51 = _mm256_fmadd_ps(ai, b1, c51);
+
+                a += MR;
+                b += NR;
+            }
+
+            const __m256 rows[MR][2] = {{c00, c01}, {c10, c11}, {c20, c21}, {c30, c31}, {c40, c41}, {c50, c51}};
+            for (size_t i = 0; i < MR; ++i)
+            {
+                float *c_row = c + i * ldc;
+                _mm256_storeu_ps(c_row, _mm256_add_ps(_mm256_loadu_ps(c_row), rows[i][0]));
+                _mm256_storeu_ps(c_row + 8, _mm256_add_ps(_mm256_loadu_ps(c_row + 8), rows[i][1]));
+            }
+        }
+    }
+
+    const MicroKernel &avx2_kernel()
+    {
+        // A block: 72 x 256 floats = 72 KB, B sliver: 256 x 16 floats = 16 KB, B panel: 256 x 4080 floats = 4 MB
+        static const MicroKernel kernel = {"avx2 6x16", MR, NR, 72, 256, 4080, kernel_6x16};
+        return kernel;
+    }
+}
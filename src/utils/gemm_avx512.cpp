@@ -0,0 +1,61 @@
+#include <immintrin.h>
+#include "gemm_kernels.hpp"
+
+/*
+AVX-512 micro-kernel. This file is compiled with -mavx512f.
+
+The 8 x 32 tile of C takes 16 of the 32 zmm registers, 2 more hold the current row of the B sliver,
+and one holds the broadcast element of A.
+*/
+namespace gemm
+{
+    namespace
+    {
+        constexpr size_t MR = 8;
+        constexpr size_t NR = 32;
+
+        void kernel_8x32(size_t k, const float *a, const float *b, float *c, size_t ldc)
+        {
+            __m512 acc[MR][2];
+
+#pragma GCC unroll 8
+            for (size_t i = 0; i < MR; ++i)
+            {
+                acc[i][0] = _mm512_setzero_ps();
+                acc[i][1] = _mm512_setzero_ps();
+            }
+
+            for (size_t p = 0; p < k; ++p)
+            {
+                const __m512 b0 = _mm512_loadu_ps(b);
+                const __m512 b1 = _mm512_loadu_ps(b + 16);
+
+#pragma GCC unroll 8
+                for (size_t i = 0; i < MR; ++i)
+                {
+                    const __m512 ai = _mm512_set1_ps(a[i]);
+                    acc[i][0] = _mm512_fmadd_ps(ai, b0, acc[i][0]);
+                    acc[i][1] = _mm512_fmadd_ps(ai, b1, acc[i][1]);
+                }
+
+                a += MR;
+                b += NR;
+            }
+
+#pragma GCC unroll 8
+            for (size_t i = 0; i < MR; ++i)
+            {
+                float *c_row = c + i * ldc;
+                _mm512_storeu_ps(c_row, _mm512_add_ps(_mm512_loadu_ps(c_row), acc[i][0]));
+                _mm512_storeu_ps(c_row + 16, _mm512_add_ps(_mm512_loadu_ps(c_row + 16), acc[i][1]));
+            }
+        }
+    }
+
+    const MicroKernel &avx512_kernel()
+    {
+        // A block: 96 x 256 floats = 96 KB, B sliver: 256 x 32 floats = 32 KB, B panel: 256 x 4096 floats = 4 MB
+        static const MicroKernel kernel = {"avx512 8x32", MR, NR, 96, 256, 4096, kernel_8x32};
+        return kernel;
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+
+/*
+Micro-kernels of the GEMM, one per instruction set.
+
+A micro-kernel computes C += A_panel * B_sliver for one MR x NR tile of C, where
+- A_panel is a packed MR x k panel of A, stored column by column (a[p * MR + i] = A(i, p))
+- B_sliver is a packed k x NR sliver of B, stored row by row (b[p * NR + j] = B(p, j))
+- C is row-major with leading dimension ldc
+
+The block sizes are chosen per kernel from the register count and the cache sizes they are tuned for.
+*/
+namespace gemm
+{
+    struct MicroKernel
+    {
+        const char *name;
+        size_t mr; // rows of the register tile
+        size_t nr; // columns of the register tile
+        size_t mc; // rows of a packed block of A (L2), multiple of mr
+        size_t kc; // depth of the packed blocks (L1)
+        size_t nc; // columns of a packed panel of B (L3), multiple of nr
+        void (*kernel)(size_t k, const float *a, const float *b, float *c, size_t ldc);
+    };
+
+    const MicroKernel &generic_kernel();
+    const MicroKernel &avx2_kernel();
+    const MicroKernel &avx512_kernel();
+}
@@ -0,0 +1,189 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "logging.hpp"
+
+namespace logging
+{
+    namespace detail
+    {
+        // Constant initialized, so the levels are valid before the static constructors run
+        atomic<int> thresholds[static_cast<size_t>(Subsystem::COUNT)] = {
+            static_cast<int>(Level::INFO), static_cast<int>(Level::INFO), static_cast<int>(Level::INFO),
+            static_cast<int>(Level::INFO), static_cast<int>(Level::INFO), static_cast<int>(Level::INFO)};
+    }
+
+    namespace
+    {
+        constexpr const char *LEVEL_NAMES[] = {"trace", "debug", "info", "warn", "error", "off"};
+        constexpr const char *LEVEL_TAGS[] = {"TRACE", "DEBUG", "INFO", "WARN", "ERROR", "OFF"};
+        constexpr const char *SUBSYSTEM_NAMES[] = {"tensor", "modules", "conv", "optimizer", "dataset", "quantization"};
+
+        static_assert(size(SUBSYSTEM_NAMES) == static_cast<size_t>(Subsystem::COUNT), "Every subsystem needs a name");
+
+        mutex sink_mutex;
+        Sink sink;
+
+        string to_lower(string text)
+        {
+            std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c)
+                           { return static_cast<char>(std::tolower(c)); });
+            return text;
+        }
+
+        string trim(const string &text)
+        {
+            const size_t begin = text.find_first_not_of(" \t");
+            if (begin == string::npos)
+            {
+                return "";
+            }
+            return text.substr(begin, text.find_last_not_of(" \t") - begin + 1);
+        }
+
+        // Apply NEURALNET_LOG once at startup. An invalid value is reported and ignored, as an exception cannot be caught here
+        struct EnvironmentConfiguration
+        {
+            EnvironmentConfiguration()
+            {
+                const char *env = std::getenv("NEURALNET_LOG");
+                if (env == nullptr)
+                {
+                    return;
+                }
+
+                try
+                {
+                    configure(env);
+                }
+                catch (const invalid_argument &e)
+                {
+                    const string message = string("[neuralnet] Ignoring NEURALNET_LOG: ") + e.what() + "\n";
+                    std::fwrite(message.data(), 1, message.size(), stderr);
+                }
+            }
+        } environment_configuration;
+    }
+
+    void set_level(Level level)
+    {
+        for (atomic<int> &threshold : detail::thresholds)
+        {
+            threshold.store(static_cast<int>(level), memory_order_relaxed);
+        }
+    }
+
+    void set_level(Subsystem subsystem, Level level)
+    {
+        detail::thresholds[static_cast<size_t>(subsystem)].store(static_cast<int>(level), memory_order_relaxed);
+    }
+
+    Level get_level(Subsystem subsystem)
+    {
+        return static_cast<Level>(detail::thresholds[static_cast<size_t>(subsystem)].load(memory_order_relaxed));
+    }
+
+    void configure(const string &spec)
+    {
+        // Parse everything first, so that an invalid specification changes nothing
+        vector<pair<int, Level>> settings; // subsystem (-1 for all of them) and level
+
+        size_t begin = 0;
+        while (begin <= spec.size())
+        {
+            const size_t end = std::min(spec.find(',', begin), spec.size());
+            const string entry = trim(spec.substr(begin, end - begin));
+            begin = end + 1;
+
+            if (entry.empty())
+            {
+                continue;
+            }
+
+            const size_t equal = entry.find('=');
+            if (equal == string::npos)
+            {
+                settings.emplace_back(-1, parse_level(entry));
+            }
+            else
+            {
+                const Subsystem subsystem = parse_subsystem(trim(entry.substr(0, equal)));
+                settings.emplace_back(static_cast<int>(subsystem), parse_level(trim(entry.substr(equal + 1))));
+            }
+        }
+
+        for (const auto &[subsystem, level] : settings)
+        {
+            if (subsystem < 0)
+            {
+                set_level(level);
+            }
+            else
+            {
+                set_level(static_cast<Subsystem>(subsystem), level);
+            }
+        }
+    }
+
+    void set_sink(Sink new_sink)
+    {
+        lock_guard<mutex> lock(sink_mutex);
+        sink = std::move(new_sink);
+    }
+
+    void write(Level level, Subsystem subsystem, const string &message)
+    {
+        lock_guard<mutex> lock(sink_mutex);
+
+        if (sink)
+        {
+            sink(level, subsystem, message);
+            return;
+        }
+
+        // One write per message, so that the lines of several threads are not interleaved. stderr is not buffered
+        const string line = string("[") + LEVEL_TAGS[static_cast<size_t>(level)] + "][" + subsystem_name(subsystem) + "] " + message + "\n";
+        std::fwrite(line.data(), 1, line.size(), stderr);
+    }
+
+    string level_name(Level level)
+    {
+        return LEVEL_NAMES[static_cast<size_t>(level)];
+    }
+
+    string subsystem_name(Subsystem subsystem)
+    {
+        return SUBSYSTEM_NAMES[static_cast<size_t>(subsystem)];
+    }
+
+    Level parse_level(const string &name)
+    {
+        const string lower = to_lower(name);
+        for (size_t i = 0; i < size(LEVEL_NAMES); ++i)
+        {
+            if (lower == LEVEL_NAMES[i])
+            {
+                return static_cast<Level>(i);
+            }
+        }
+        throw invalid_argument("Unknown log level: " + name);
+    }
+
+    Subsystem parse_subsystem(const string &name)
+    {
+        const string lower = to_lower(name);
+        for (size_t i = 0; i < size(SUBSYSTEM_NAMES); ++i)
+        {
+            if (lower == SUBSYSTEM_NAMES[i])
+            {
+                return static_cast<Subsystem>(i);
+            }
+        }
+        throw invalid_argument("Unknown log subsystem: " + name);
+    }
+}
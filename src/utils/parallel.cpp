@@ -0,0 +1,246 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "parallel.hpp"
+
+namespace
+{
+    thread_local bool in_parallel = false;
+
+    /*
+    Fixed set of worker threads. run() hands out the tasks 0..num_tasks-1 to the workers and the calling thread,
+    and blocks until all of them are done.
+    */
+    class ThreadPool
+    {
+    public:
+        explicit ThreadPool(size_t num_threads) : num_threads_(num_threads)
+        {
+            for (size_t i = 1; i < num_threads; ++i)
+            {
+                this->workers_.emplace_back([this]
+                                            { this->worker_loop(); });
+            }
+        }
+
+        ~ThreadPool()
+        {
+            {
+                lock_guard<mutex> lock(this->mutex_);
+                this->stop_ = true;
+            }
+            this->work_cv_.notify_all();
+
+            for (thread &worker : this->workers_)
+            {
+                worker.join();
+            }
+        }
+
+        inline size_t num_threads() const { return this->num_threads_; }
+
+        void run(size_t num_tasks, const function<void(size_t)> &task)
+        {
+            // Only one parallel region at a time, if several user threads start one concurrently
+            lock_guard<mutex> run_lock(this->run_mutex_);
+
+            {
+                lock_guard<mutex> lock(this->mutex_);
+                this->task_ = &task;
+                this->num_tasks_ = num_tasks;
+                this->next_task_ = 0;
+                this->remaining_ = num_tasks;
+                this->error_ = nullptr;
+                ++this->generation_;
+            }
+            this->work_cv_.notify_all();
+
+            // The calling thread works as well
+            this->execute_tasks();
+
+            unique_lock<mutex> lock(this->mutex_);
+            this->done_cv_.wait(lock, [this]
+                                { return this->remaining_ == 0; });
+            this->task_ = nullptr;
+
+            if (this->error_)
+            {
+                rethrow_exception(this->error_);
+            }
+        }
+
+    private:
+        void worker_loop()
+        {
+            size_t seen_generation = 0;
+
+            while (true)
+            {
+                {
+                    unique_lock<mutex> lock(this->mutex_);
+                    this->work_cv_.wait(lock, [&]
+                                        { return this->stop_ || this->generation_ != seen_generation; });
+                    if (this->stop_)
+                    {
+                        return;
+                    }
+                    seen_generation = this->generation_;
+                }
+
+                this->execute_tasks();
+            }
+        }
+
+        void execute_tasks()
+        {
+            in_parallel = true;
+
+            size_t done = 0;
+            while (true)
+            {
+                const size_t task = this->next_task_.fetch_add(1);
+                if (task >= this->num_tasks_)
+                {
+                    break;
+                }
+
+                try
+                {
+                    (*this->task_)(task);
+                }
+                catch (...)
+                {
+                    lock_guard<mutex> lock(this->mutex_);
+                    if (!this->error_)
+                    {
+                        this->error_ = current_exception();
+                    }
+                }
+                ++done;
+            }
+
+            in_parallel = false;
+
+            if (done > 0)
+            {
+                lock_guard<mutex> lock(this->mutex_);
+                this->remaining_ -= done;
+                if (this->remaining_ == 0)
+                {
+                    this->done_cv_.notify_one();
+                }
+            }
+        }
+
+        const size_t num_threads_;
+        vector<thread> workers_;
+
+        mutex run_mutex_;
+        mutex mutex_;
+        condition_variable work_cv_;
+        condition_variable done_cv_;
+
+        const function<void(size_t)> *task_ = nullptr;
+        size_t num_tasks_ = 0;
+        atomic<size_t> next_task_{0};
+        size_t remaining_ = 0;
+        size_t generation_ = 0;
+        bool stop_ = false;
+        exception_ptr error_;
+    };
+
+    size_t default_num_threads()
+    {
+        const char *env = std::getenv("NEURALNET_NUM_THREADS");
+        if (env != nullptr)
+        {
+            const long num_threads = std::atol(env);
+            if (num_threads > 0)
+            {
+                return static_cast<size_t>(num_threads);
+            }
+        }
+        return std::max<size_t>(1, thread::hardware_concurrency());
+    }
+
+    mutex pool_mutex;
+    unique_ptr<ThreadPool> pool;
+
+    ThreadPool &get_pool()
+    {
+        lock_guard<mutex> lock(pool_mutex);
+        if (!pool)
+        {
+            pool = make_unique<ThreadPool>(default_num_threads());
+        }
+        return *pool;
+    }
+}
+
+size_t get_num_threads()
+{
+    return get_pool().num_threads();
+}
+
+void set_num_threads(size_t num_threads)
+{
+    if (num_threads == 0)
+    {
+        num_threads = std::max<size_t>(1, thread::hardware_concurrency());
+    }
+
+    lock_guard<mutex> lock(pool_mutex);
+    if (!pool || pool->num_threads() != num_threads)
+    {
+        pool.reset(); // join the old workers first
+        pool = make_unique<ThreadPool>(num_threads);
+    }
+}
+
+bool in_parallel_region()
+{
+    return in_parallel;
+}
+
+void parallel_for(size_t begin, size_t end, size_t grain_size, const function<void(size_t, size_t)> &fn)
+{
+    if (begin >= end)
+    {
+        return;
+    }
+
+    const size_t n = end - begin;
+    grain_size = std::max<size_t>(grain_size, 1);
+
+    if (in_parallel || n <= grain_size)
+    {
+        fn(begin, end);
+        return;
+    }
+
+    ThreadPool &thread_pool = get_pool();
+    const size_t num_chunks = std::min(thread_pool.num_threads(), (n + grain_size - 1) / grain_size);
+
+    if (num_chunks <= 1)
+    {
+        fn(begin, end);
+        return;
+    }
+
+    // Spread the remainder over the first chunks, so the chunk sizes differ by at most one
+    const size_t chunk_size = n / num_chunks;
+    const size_t remainder = n % num_chunks;
+
+    thread_pool.run(num_chunks, [&](size_t chunk)
+                    {
+        const size_t chunk_begin = begin + chunk * chunk_size + std::min(chunk, remainder);
+        const size_t chunk_end = chunk_begin + chunk_size + (chunk < remainder ? 1 : 0);
+        fn(chunk_begin, chunk_end); });
+}
@@ -0,0 +1,169 @@
+#include <algorithm>
+#include <stdexcept>
+#include "qgemm.hpp"
+#include "qgemm_kernels.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+
+namespace qgemm
+{
+    namespace
+    {
+        // Rows of A multiplied with a panel of B by a task. A block of rows (64 x K bytes) stays in the L2 cache across the panels
+        constexpr size_t ROW_BLOCK = 64;
+
+        // Problems with fewer multiply-adds than this run on the calling thread only
+        constexpr size_t PARALLEL_QGEMM_OPS = 64 * 64 * 64;
+
+        constexpr size_t SCALAR_MR = 4;
+
+        void kernel_4x16(size_t rows, size_t K, const uint8_t *A, size_t lda, const int8_t *panel, int32_t *c)
+        {
+            std::fill(c, c + rows * PANEL_COLS, 0);
+
+            for (size_t r = 0; r < rows; ++r)
+            {
+                const uint8_t *a_row = A + r * lda;
+                int32_t *c_row = c + r * PANEL_COLS;
+
+                for (size_t k = 0; k < K; ++k)
+                {
+                    const int32_t a = a_row[k];
+                    const int8_t *b = panel + (k / 4) * 4 * PANEL_COLS + k % 4;
+
+                    for (size_t j = 0; j < PANEL_COLS; ++j)
+                    {
+                        c_row[j] += a * b[j * 4];
+                    }
+                }
+            }
+        }
+
+        const QKernel &select_kernel()
+        {
+            switch (simd::active_isa())
+            {
+#ifdef NEURALNET_X86_SIMD
+            case simd::ISA::AVX512:
+                if (__builtin_cpu_supports("avx512bw"))
+                {
+                    return __builtin_cpu_supports("avx512vnni") ? avx512_vnni_kernel() : avx512_kernel();
+                }
+                return avx2_kernel();
+            case simd::ISA::AVX2:
+                return avx2_kernel();
+#endif
+            default:
+                return scalar_kernel();
+            }
+        }
+
+        /*
+        Compute C = A * B tile by tile, and give every tile to store(row, col, rows, cols, tile), where tile is a rows x PANEL_COLS
+        row-major block of int32 of which the first cols columns are valid.
+
+        The tasks are (block of rows) x (panel of B), split among the threads of the thread pool.
+        */
+        template <typename Store>
+        void compute_tiles(size_t M, const uint8_t *A, size_t lda, const PackedMatrix &B, Store &&store)
+        {
+            const size_t N = B.cols(), K = B.rows();
+
+            if (M == 0 || N == 0)
+            {
+                return;
+            }
+
+            const QKernel &uk = select_kernel();
+
+            const size_t num_panels = (N + PANEL_COLS - 1) / PANEL_COLS;
+            const size_t num_row_blocks = (M + ROW_BLOCK - 1) / ROW_BLOCK;
+            const size_t num_tasks = num_row_blocks * num_panels;
+
+            parallel_for(0, num_tasks, (M * N * K < PARALLEL_QGEMM_OPS) ? num_tasks : 1, [&](size_t task_begin, size_t task_end)
+                         {
+                int32_t tile[MAX_MR * PANEL_COLS];
+
+                for (size_t task = task_begin; task < task_end; ++task)
+                {
+                    const size_t row_begin = (task / num_panels) * ROW_BLOCK;
+                    const size_t row_end = std::min(M, row_begin + ROW_BLOCK);
+                    const size_t panel = task % num_panels;
+                    const size_t col = panel * PANEL_COLS;
+                    const size_t cols = std::min(PANEL_COLS, N - col);
+
+                    for (size_t row = row_begin; row < row_end; row += uk.mr)
+                    {
+                        const size_t rows = std::min(uk.mr, row_end - row);
+                        uk.kernel(rows, K, A + row * lda, lda, B.panel(panel), tile);
+                        store(row, col, rows, cols, tile);
+                    }
+                } });
+        }
+    }
+
+    const QKernel &scalar_kernel()
+    {
+        static const QKernel kernel = {"scalar 4x16", SCALAR_MR, kernel_4x16};
+        return kernel;
+    }
+
+    PackedMatrix::PackedMatrix(const int8_t *B, size_t K, size_t N, size_t rsb, size_t csb)
+        : K_(K), N_(N), column_sums_(N, 0)
+    {
+        const size_t num_panels = (N + PANEL_COLS - 1) / PANEL_COLS;
+        this->data_.assign(num_panels * this->groups() * 4 * PANEL_COLS, 0);
+
+        for (size_t k = 0; k < K; ++k)
+        {
+            for (size_t j = 0; j < N; ++j)
+            {
+                const int8_t b = B[k * rsb + j * csb];
+                if (b < -B_MAX)
+                {
+                    throw invalid_argument("The values of a packed matrix must be in [-127, 127]");
+                }
+
+                const size_t panel = j / PANEL_COLS;
+                int8_t *packed = this->data_.data() + panel * this->groups() * 4 * PANEL_COLS;
+                packed[(k / 4) * 4 * PANEL_COLS + (j % PANEL_COLS) * 4 + k % 4] = b;
+                this->column_sums_[j] += b;
+            }
+        }
+    }
+
+    void gemm_u8s8s32(size_t M, const uint8_t *A, size_t lda, const PackedMatrix &B, int32_t *C, size_t ldc)
+    {
+        compute_tiles(M, A, lda, B, [&](size_t row, size_t col, size_t rows, size_t cols, const int32_t *tile)
+                      {
+            for (size_t i = 0; i < rows; ++i)
+            {
+                std::copy(tile + i * PANEL_COLS, tile + i * PANEL_COLS + cols, C + (row + i) * ldc + col);
+            } });
+    }
+
+    void gemm_u8s8f32(size_t M, const uint8_t *A, size_t lda, int32_t a_zero_point, const PackedMatrix &B,
+                      const float *scales, const float *bias, float *C, size_t ldc)
+    {
+        const int32_t *column_sums = B.column_sums().data();
+
+        compute_tiles(M, A, lda, B, [&](size_t row, size_t col, size_t rows, size_t cols, const int32_t *tile)
+                      {
+            for (size_t i = 0; i < rows; ++i)
+            {
+                const int32_t *tile_row = tile + i * PANEL_COLS;
+                float *c_row = C + (row + i) * ldc + col;
+
+                for (size_t j = 0; j < cols; ++j)
+                {
+                    const int32_t acc = tile_row[j] - a_zero_point * column_sums[col + j];
+                    c_row[j] = scales[col + j] * static_cast<float>(acc) + (bias != nullptr ? bias[col + j] : 0.0f);
+                }
+            } });
+    }
+
+    string kernel_name()
+    {
+        return select_kernel().name;
+    }
+}
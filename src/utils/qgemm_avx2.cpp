@@ -0,0 +1,97 @@
+#include <immintrin.h>
+#include "qgemm_kernels.hpp"
+
+/*
+AVX2 quantized kernel. This file is compiled with -mavx2.
+
+For each group of 4 k, PMADDUBSW multiplies the 4 bytes of A (broadcast) with the 4 bytes of each of the 16 columns of the panel
+and adds the pairs into int16, then PMADDWD adds the two pairs into int32. The 4 x 16 tile of C takes 8 ymm registers.
+*/
+namespace qgemm
+{
+    namespace
+    {
+        constexpr size_t MR = 4;
+
+        template <size_t ROWS>
+        void kernel_rows(size_t K, const uint8_t *A, size_t lda, const int8_t *panel, int32_t *c)
+        {
+            __m256i acc[ROWS][2];
+
+#pragma GCC unroll 4
+            for (size_t r = 0; r < ROWS; ++r)
+            {
+                acc[r][0] = _mm256_setzero_si256();
+                acc[r][1] = _mm256_setzero_si256();
+            }
+
+            const __m256i ones = _mm256_set1_epi16(1);
+
+            auto accumulate = [&](__m256i &acc_r, __m256i a, __m256i b)
+            {
+                acc_r = _mm256_add_epi32(acc_r, _mm256_madd_epi16(_mm256_maddubs_epi16(a, b), ones));
+            };
+
+            for (size_t g = 0; g < K / 4; ++g)
+            {
+                const __m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(panel + g * 4 * PANEL_COLS));
+                const __m256i b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(panel + g * 4 * PANEL_COLS + 32));
+
+#pragma GCC unroll 4
+                for (size_t r = 0; r < ROWS; ++r)
+                {
+                    const __m256i a = _mm256_set1_epi32(load_group(A + r * lda + 4 * g));
+                    accumulate(acc[r][0], a, b0);
+                    accumulate(acc[r][1], a, b1);
+                }
+            }
+
+#pragma GCC unroll 4
+            for (size_t r = 0; r < ROWS; ++r)
+            {
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(c + r * PANEL_COLS), acc[r][0]);
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(c + r * PANEL_COLS + 8), acc[r][1]);
+            }
+
+            // The last group, zero-padded (the padding of the panel is zero too), is added to the stored tile (see the AVX-512 kernels)
+            if (K % 4 != 0)
+            {
+                const size_t g = K / 4;
+                const __m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(panel + g * 4 * PANEL_COLS));
+                const __m256i b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(panel + g * 4 * PANEL_COLS + 32));
+
+                for (size_t r = 0; r < ROWS; ++r)
+                {
+                    __m256i *c_r = reinterpret_cast<__m256i *>(c + r * PANEL_COLS);
+                    const __m256i a = _mm256_set1_epi32(load_partial_group(A + r * lda + 4 * g, K % 4));
+                    __m256i c0 = _mm256_loadu_si256(c_r), c1 = _mm256_loadu_si256(c_r + 1);
+                    accumulate(c0, a, b0);
+                    accumulate(c1, a, b1);
+                    _mm256_storeu_si256(c_r, c0);
+                    _mm256_storeu_si256(c_r + 1, c1);
+                }
+            }
+        }
+
+        void kernel_4x16(size_t rows, size_t K, const uint8_t *A, size_t lda, const int8_t *panel, int32_t *c)
+        {
+            switch (rows)
+            {
+            case 1:
+                return kernel_rows<1>(K, A, lda, panel, c);
+            case 2:
+                return kernel_rows<2>(K, A, lda, panel, c);
+            case 3:
+                return kernel_rows<3>(K, A, lda, panel, c);
+            default:
+                return kernel_rows<MR>(K, A, lda, panel, c);
+            }
+        }
+    }
+
+    const QKernel &avx2_kernel()
+    {
+        static const QKernel kernel = {"avx2 4x16", MR, kernel_4x16};
+        return kernel;
+    }
+}
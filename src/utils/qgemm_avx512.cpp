@@ -0,0 +1,127 @@
+#include <immintrin.h>
+#include "qgemm_kernels.hpp"
+
+/*
+AVX-512 quantized kernels. This file is compiled with -mavx512f -mavx512bw, and the VNNI kernel is compiled for avx512vnni
+(it is only selected when the CPU supports it).
+
+A zmm register holds a whole row of a tile (16 int32). For each group of 4 k, the 4 bytes of A are broadcast and multiplied with
+the 4 bytes of each column of the panel:
+- AVX-512 BW: PMADDUBSW + PMADDWD, as for AVX2
+- AVX-512 VNNI: a single VPDPBUSD, which also accumulates
+*/
+namespace qgemm
+{
+    namespace
+    {
+        constexpr size_t MR = 8;
+
+        struct MaddAccumulate
+        {
+            static inline __m512i apply(__m512i acc, __m512i a, __m512i b)
+            {
+                return _mm512_add_epi32(acc, _mm512_madd_epi16(_mm512_maddubs_epi16(a, b), _mm512_set1_epi16(1)));
+            }
+        };
+
+#pragma GCC push_options
+#pragma GCC target("avx512vnni")
+        struct DotAccumulate
+        {
+            static inline __m512i apply(__m512i acc, __m512i a, __m512i b)
+            {
+                return _mm512_dpbusd_epi32(acc, a, b);
+            }
+        };
+#pragma GCC pop_options
+
+        template <typename Accumulate, size_t ROWS>
+        inline void kernel_rows(size_t K, const uint8_t *A, size_t lda, const int8_t *panel, int32_t *c)
+        {
+            __m512i acc[ROWS];
+
+#pragma GCC unroll 8
+            for (size_t r = 0; r < ROWS; ++r)
+            {
+                acc[r] = _mm512_setzero_si512();
+            }
+
+            for (size_t g = 0; g < K / 4; ++g)
+            {
+                const __m512i b = _mm512_loadu_si512(panel + g * 4 * PANEL_COLS);
+
+#pragma GCC unroll 8
+                for (size_t r = 0; r < ROWS; ++r)
+                {
+                    acc[r] = Accumulate::apply(acc[r], _mm512_set1_epi32(load_group(A + r * lda + 4 * g)), b);
+                }
+            }
+
+#pragma GCC unroll 8
+            for (size_t r = 0; r < ROWS; ++r)
+            {
+                _mm512_storeu_si512(c + r * PANEL_COLS, acc[r]);
+            }
+
+            // The last group, zero-padded (the padding of the panel is zero too), is added to the stored tile.
+            // Accumulating it in registers after the loop makes GCC copy the accumulators at every iteration
+            if (K % 4 != 0)
+            {
+                const size_t g = K / 4;
+                const __m512i b = _mm512_loadu_si512(panel + g * 4 * PANEL_COLS);
+
+                for (size_t r = 0; r < ROWS; ++r)
+                {
+                    const __m512i c_r = _mm512_loadu_si512(c + r * PANEL_COLS);
+                    _mm512_storeu_si512(c + r * PANEL_COLS, Accumulate::apply(c_r, _mm512_set1_epi32(load_partial_group(A + r * lda + 4 * g, K % 4)), b));
+                }
+            }
+        }
+
+        template <typename Accumulate>
+        inline void kernel_8x16(size_t rows, size_t K, const uint8_t *A, size_t lda, const int8_t *panel, int32_t *c)
+        {
+            switch (rows)
+            {
+            case 1:
+                return kernel_rows<Accumulate, 1>(K, A, lda, panel, c);
+            case 2:
+                return kernel_rows<Accumulate, 2>(K, A, lda, panel, c);
+            case 3:
+                return kernel_rows<Accumulate, 3>(K, A, lda, panel, c);
+            case 4:
+                return kernel_rows<Accumulate, 4>(K, A, lda, panel, c);
+            case 5:
+                return kernel_rows<Accumulate, 5>(K, A, lda, panel, c);
+            case 6:
+                return kernel_rows<Accumulate, 6>(K, A, lda, panel, c);
+            case 7:
+                return kernel_rows<Accumulate, 7>(K, A, lda, panel, c);
+            default:
+                return kernel_rows<Accumulate, MR>(K, A, lda, panel, c);
+            }
+        }
+
+        void kernel_8x16_bw(size_t rows, size_t K, const uint8_t *A, size_t lda, const int8_t *panel, int32_t *c)
+        {
+            kernel_8x16<MaddAccumulate>(rows, K, A, lda, panel, c);
+        }
+
+        __attribute__((target("avx512vnni"), flatten)) void kernel_8x16_vnni(size_t rows, size_t K, const uint8_t *A, size_t lda, const int8_t *panel, int32_t *c)
+        {
+            kernel_8x16<DotAccumulate>(rows, K, A, lda, panel, c);
+        }
+    }
+
+    const QKernel &avx512_kernel()
+    {
+        static const QKernel kernel = {"avx512 8x16", MR, kernel_8x16_bw};
+        return kernel;
+    }
+
+    const QKernel &avx512_vnni_kernel()
+    {
+        static const QKernel kernel = {"avx512 vnni 8x16", MR, kernel_8x16_vnni};
+        return kernel;
+    }
+}
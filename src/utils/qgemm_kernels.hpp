@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "qgemm.hpp"
+
+/*
+Kernels of the quantized GEMM, one per instruction set.
+
+A kernel computes a rows x PANEL_COLS tile of C = A * B, where rows <= MR:
+- A points to the first of the rows, which are lda bytes apart
+- panel is a packed panel of B (see PackedMatrix), with the groups of 4 rows of B covering K
+- c is the tile, row-major with PANEL_COLS columns. Every element of the tile is overwritten
+*/
+namespace qgemm
+{
+    struct QKernel
+    {
+        const char *name;
+        size_t mr; // maximum number of rows of a tile
+        void (*kernel)(size_t rows, size_t K, const uint8_t *A, size_t lda, const int8_t *panel, int32_t *c);
+    };
+
+    // Largest MR of the kernels
+    constexpr size_t MAX_MR = 8;
+
+    const QKernel &scalar_kernel();
+    const QKernel &avx2_kernel();
+    const QKernel &avx512_kernel();
+    const QKernel &avx512_vnni_kernel();
+
+    // The 4 bytes of a group of A as an int32 (as laid out in memory)
+    inline int32_t load_group(const uint8_t *a)
+    {
+        int32_t group;
+        memcpy(&group, a, 4);
+        return group;
+    }
+
+    // The n < 4 bytes of the last group of A, zero-padded
+    inline int32_t load_partial_group(const uint8_t *a, size_t n)
+    {
+        uint8_t bytes[4] = {};
+        for (size_t t = 0; t < n; ++t)
+        {
+            bytes[t] = a[t];
+        }
+        return load_group(bytes);
+    }
+}
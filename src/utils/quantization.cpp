@@ -0,0 +1,150 @@
+#include <stdexcept>
+#include <unordered_map>
+#include "quantization.hpp"
+#include "linear.hpp"
+#include "quantized_linear.hpp"
+
+namespace nn
+{
+    namespace
+    {
+        using Observers = unordered_map<const Module *, MinMaxObserver>;
+
+        // The Sequential container of a module, if it has one
+        Sequential *as_sequential(Module *module)
+        {
+            if (Sequential *sequential = dynamic_cast<Sequential *>(module))
+            {
+                return sequential;
+            }
+            if (MLP *mlp = dynamic_cast<MLP *>(module))
+            {
+                return &mlp->get_layers();
+            }
+            return nullptr;
+        }
+
+        // Forward the input through the modules, observing the inputs of the Linear layers
+        Tensor<> observe_forward(Sequential &model, const Tensor<> &input, Observers &observers)
+        {
+            Tensor<> x = input;
+
+            for (size_t i = 0; i < model.size(); ++i)
+            {
+                Module *module = model.get(i);
+
+                if (Sequential *nested = as_sequential(module))
+                {
+                    x = observe_forward(*nested, x, observers);
+                    continue;
+                }
+
+                if (dynamic_cast<Linear *>(module) != nullptr)
+                {
+                    observers[module].observe(x);
+                }
+
+                x = module->forward(x);
+            }
+
+            return x;
+        }
+
+        size_t convert(Sequential &model, const Observers &observers)
+        {
+            size_t replaced = 0;
+
+            for (size_t i = 0; i < model.size(); ++i)
+            {
+                Module *module = model.get(i);
+
+                if (Sequential *nested = as_sequential(module))
+                {
+                    replaced += convert(*nested, observers);
+                    continue;
+                }
+
+                const Linear *linear = dynamic_cast<const Linear *>(module);
+                const auto observer = observers.find(module);
+
+                if (linear != nullptr && observer != observers.end())
+                {
+                    NN_LOG_DEBUG(QUANTIZATION, "Quantizing a Linear layer " << linear->get_weight().shapes() << " with the input range ["
+                                                                             << observer->second.min() << ", " << observer->second.max() << "]");
+                    model.replace(i, new QuantizedLinear(*linear, observer->second.min(), observer->second.max()));
+                    ++replaced;
+                }
+            }
+
+            return replaced;
+        }
+
+        vector<Tensor<>> calibration_batches(MNIST &loader, size_t num_batches)
+        {
+            vector<Tensor<>> inputs;
+            num_batches = std::min(num_batches, loader.get_num_batches());
+
+            loader.reset();
+            for (size_t b = 0; b < num_batches; ++b)
+            {
+                inputs.push_back(get<0>(loader.get_next_batch().to_tensor()));
+            }
+            loader.reset();
+
+            return inputs;
+        }
+    }
+
+    void MinMaxObserver::observe(const Tensor<> &x)
+    {
+        if (x.size() == 0)
+        {
+            return;
+        }
+
+        const float x_min = x.min(vector<int64_t>{})[0];
+        const float x_max = x.max(vector<int64_t>{})[0];
+
+        this->min_ = this->empty() ? x_min : std::min(this->min_, x_min);
+        this->max_ = this->empty() ? x_max : std::max(this->max_, x_max);
+        this->count_ += x.size();
+    }
+
+    QuantParams MinMaxObserver::qparams(int32_t qmin, int32_t qmax, bool symmetric) const
+    {
+        return choose_qparams(this->min_, this->max_, qmin, qmax, symmetric);
+    }
+
+    size_t quantize_linear_layers(Sequential &model, const vector<Tensor<>> &calibration_inputs)
+    {
+        if (calibration_inputs.empty())
+        {
+            throw invalid_argument("The quantization needs at least one calibration input");
+        }
+
+        model.eval();
+
+        Observers observers;
+        for (const Tensor<> &input : calibration_inputs)
+        {
+            observe_forward(model, input, observers);
+        }
+
+        return convert(model, observers);
+    }
+
+    size_t quantize_linear_layers(MLP &model, const vector<Tensor<>> &calibration_inputs)
+    {
+        return quantize_linear_layers(model.get_layers(), calibration_inputs);
+    }
+
+    size_t quantize_linear_layers(Sequential &model, MNIST &loader, size_t num_batches)
+    {
+        return quantize_linear_layers(model, calibration_batches(loader, num_batches));
+    }
+
+    size_t quantize_linear_layers(MLP &model, MNIST &loader, size_t num_batches)
+    {
+        return quantize_linear_layers(model.get_layers(), calibration_batches(loader, num_batches));
+    }
+}
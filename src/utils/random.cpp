@@ -0,0 +1,217 @@
+#include <cmath>
+#include <cstdlib>
+#include <numbers>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include "random.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+
+namespace rng
+{
+    namespace
+    {
+        /*
+        Blocks computed together by simd::philox_batch, in structure-of-arrays layout.
+        Element r of a batch is made of numbers[r], so the elements are written by contiguous loops.
+        */
+        constexpr size_t BATCH = simd::PHILOX_BATCH;
+        constexpr size_t BATCH_NUMBERS = 4 * BATCH;
+
+        // Batches per chunk of parallel_for
+        constexpr size_t PARALLEL_BATCHES = 64;
+
+        // 2^-24: the 24 high bits of a 32-bit number make a float in [0, 1) with every value equally likely
+        constexpr float UNIT = 1.0f / 16777216.0f;
+
+        /*
+        Reserve the blocks of n elements, and call fn(numbers, first_element, count) for every batch, in parallel: the elements
+        first_element, ..., first_element + count - 1 are made of numbers[0], ..., numbers[count - 1].
+        The batches do not depend on the chunks of parallel_for, so neither do the elements.
+        */
+        template <typename Fn>
+        void fill_batches(Generator &gen, size_t n, Fn &&fn)
+        {
+            if (n == 0)
+            {
+                return;
+            }
+
+            const size_t num_batches = (n + BATCH_NUMBERS - 1) / BATCH_NUMBERS;
+            const uint64_t key = gen.seed();
+            const uint64_t first = gen.reserve(num_batches * BATCH);
+
+            parallel_for(0, num_batches, PARALLEL_BATCHES, [&](size_t begin, size_t end)
+                         {
+                alignas(64) uint32_t numbers[BATCH_NUMBERS];
+                for (size_t batch = begin; batch < end; ++batch)
+                {
+                    simd::philox_batch(key, first + batch * BATCH, numbers);
+                    fn(numbers, batch * BATCH_NUMBERS, std::min(BATCH_NUMBERS, n - batch * BATCH_NUMBERS));
+                } });
+        }
+
+        uint64_t initial_seed()
+        {
+            if (const char *env = std::getenv("NEURALNET_SEED"))
+            {
+                try
+                {
+                    return std::stoull(env);
+                }
+                catch (const exception &)
+                {
+                    // an invalid value falls back to a random seed, as an exception cannot be caught at startup
+                }
+            }
+
+            random_device rd;
+            return (static_cast<uint64_t>(rd()) << 32) | rd();
+        }
+    }
+
+    Generator::Generator(uint64_t seed) : seed_(seed) {}
+
+    Generator::Generator(const Generator &other) : seed_(other.seed_), offset_(other.offset()) {}
+
+    Generator &Generator::operator=(const Generator &other)
+    {
+        this->seed_ = other.seed_;
+        this->offset_.store(other.offset(), memory_order_relaxed);
+        return *this;
+    }
+
+    void Generator::manual_seed(uint64_t seed)
+    {
+        this->seed_ = seed;
+        this->offset_.store(0, memory_order_relaxed);
+    }
+
+    uint64_t Generator::reserve(uint64_t num_blocks)
+    {
+        return this->offset_.fetch_add(num_blocks, memory_order_relaxed);
+    }
+
+    uint64_t Generator::next_u64()
+    {
+        const uint64_t block = this->reserve(1);
+
+        const uint32_t counter[4] = {static_cast<uint32_t>(block), static_cast<uint32_t>(block >> 32), 0, 0};
+        const uint32_t key[2] = {static_cast<uint32_t>(this->seed_), static_cast<uint32_t>(this->seed_ >> 32)};
+        uint32_t out[4];
+        philox4x32(counter, key, out);
+
+        return (static_cast<uint64_t>(out[1]) << 32) | out[0];
+    }
+
+    Generator &default_generator()
+    {
+        static Generator generator(initial_seed());
+        return generator;
+    }
+
+    void manual_seed(uint64_t seed)
+    {
+        default_generator().manual_seed(seed);
+    }
+
+    void philox4x32(const uint32_t counter[4], const uint32_t key[2], uint32_t out[4])
+    {
+        // same rounds as the batches of simd::philox_batch, for any 128-bit counter
+        constexpr uint32_t PHILOX_M0 = 0xD2511F53, PHILOX_M1 = 0xCD9E8D57;
+        constexpr uint32_t PHILOX_W0 = 0x9E3779B9, PHILOX_W1 = 0xBB67AE85;
+        constexpr int PHILOX_ROUNDS = 10;
+
+        uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+        uint32_t k0 = key[0], k1 = key[1];
+
+        for (int round = 0; round < PHILOX_ROUNDS; ++round)
+        {
+            const uint64_t p0 = static_cast<uint64_t>(PHILOX_M0) * c0;
+            const uint64_t p1 = static_cast<uint64_t>(PHILOX_M1) * c2;
+
+            const uint32_t n0 = static_cast<uint32_t>(p1 >> 32) ^ c1 ^ k0;
+            const uint32_t n2 = static_cast<uint32_t>(p0 >> 32) ^ c3 ^ k1;
+            c1 = static_cast<uint32_t>(p1);
+            c3 = static_cast<uint32_t>(p0);
+            c0 = n0;
+            c2 = n2;
+
+            k0 += PHILOX_W0;
+            k1 += PHILOX_W1;
+        }
+
+        out[0] = c0;
+        out[1] = c1;
+        out[2] = c2;
+        out[3] = c3;
+    }
+
+    void uniform(Generator &gen, float *out, size_t n, float low, float high)
+    {
+        if (!(low <= high))
+        {
+            throw invalid_argument("uniform expects low <= high, got [" + to_string(low) + ", " + to_string(high) + ")");
+        }
+
+        const float range = high - low;
+        fill_batches(gen, n, [&](const uint32_t *numbers, size_t first, size_t count)
+                     {
+            float *dst = out + first;
+            for (size_t i = 0; i < count; ++i)
+            {
+                dst[i] = low + range * (static_cast<float>(static_cast<int32_t>(numbers[i] >> 8)) * UNIT);
+            } });
+    }
+
+    void normal(Generator &gen, float *out, size_t n, float mean, float std)
+    {
+        if (!(std >= 0.0f))
+        {
+            throw invalid_argument("normal expects a non-negative standard deviation, got " + to_string(std));
+        }
+
+        constexpr float TWO_PI = 2.0f * numbers::pi_v<float>;
+
+        fill_batches(gen, n, [&](const uint32_t *numbers, size_t first, size_t count)
+                     {
+            alignas(64) float values[BATCH_NUMBERS];
+
+            // the numbers i and i + BATCH_NUMBERS / 2 give the two normal numbers i and i + BATCH_NUMBERS / 2
+            constexpr size_t HALF = BATCH_NUMBERS / 2;
+            for (size_t i = 0; i < HALF; ++i)
+            {
+                // u1 in (0, 1], so that the logarithm is finite
+                const float u1 = static_cast<float>((numbers[i] >> 8) + 1) * UNIT;
+                const float u2 = static_cast<float>(numbers[i + HALF] >> 8) * UNIT;
+                const float radius = std::sqrt(-2.0f * std::log(u1));
+                values[i] = radius * std::cos(TWO_PI * u2);
+                values[i + HALF] = radius * std::sin(TWO_PI * u2);
+            }
+
+            float *dst = out + first;
+            for (size_t i = 0; i < count; ++i)
+            {
+                dst[i] = mean + std * values[i];
+            } });
+    }
+
+    void bernoulli(Generator &gen, float *out, size_t n, float p)
+    {
+        if (!(p >= 0.0f && p <= 1.0f))
+        {
+            throw invalid_argument("bernoulli expects a probability in [0, 1], got " + to_string(p));
+        }
+
+        // x >> 8 is uniform in [0, 2^24), and x >> 8 < p * 2^24 with probability p (exact for p = 0 and p = 1)
+        const uint32_t threshold = static_cast<uint32_t>(std::ldexp(static_cast<double>(p), 24));
+        fill_batches(gen, n, [&](const uint32_t *numbers, size_t first, size_t count)
+                     {
+            float *dst = out + first;
+            for (size_t i = 0; i < count; ++i)
+            {
+                dst[i] = (numbers[i] >> 8) < threshold ? 1.0f : 0.0f;
+            } });
+    }
+}
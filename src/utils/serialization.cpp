@@ -0,0 +1,480 @@
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include "serialization.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define NEURALNET_HAS_MMAP 1
+#endif
+
+namespace serialization
+{
+    namespace
+    {
+        constexpr char MAGIC[8] = {'N', 'N', 'T', 'E', 'N', 'S', 'O', 'R'};
+        constexpr uint32_t VERSION = 1;
+
+        static_assert(std::endian::native == std::endian::little, "The tensor files are little-endian");
+
+        inline size_t round_up(size_t n, size_t multiple)
+        {
+            return (n + multiple - 1) / multiple * multiple;
+        }
+
+        template <typename I>
+        void append(string &buffer, I value)
+        {
+            buffer.append(reinterpret_cast<const char *>(&value), sizeof(I));
+        }
+
+        // Reads the header, checking that it does not go past the end of the file
+        class HeaderReader
+        {
+        private:
+            const char *data_;
+            size_t size_;
+            size_t pos_ = 0;
+
+            void require(size_t n) const
+            {
+                if (n > this->size_ - this->pos_)
+                {
+                    throw runtime_error("Truncated tensor file header");
+                }
+            }
+
+        public:
+            HeaderReader(const char *data, size_t size) : data_(data), size_(size) {}
+
+            template <typename I>
+            I read()
+            {
+                this->require(sizeof(I));
+                I value;
+                std::memcpy(&value, this->data_ + this->pos_, sizeof(I));
+                this->pos_ += sizeof(I);
+                return value;
+            }
+
+            string read_string(size_t n)
+            {
+                this->require(n);
+                string value(this->data_ + this->pos_, n);
+                this->pos_ += n;
+                return value;
+            }
+
+            inline size_t position() const { return this->pos_; }
+        };
+    }
+
+    /*
+    The bytes of a file: mapped with mmap, or read into a buffer where mmap is not available.
+    The mapping is private and writable, so the tensors backed by it can be modified without modifying the file.
+    */
+    struct MappedFile
+    {
+        char *data = nullptr;
+        size_t size = 0;
+        bool mapped = false;
+        vector<char> buffer;
+
+        explicit MappedFile(const string &path)
+        {
+#ifdef NEURALNET_HAS_MMAP
+            const int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+            {
+                throw runtime_error("Failed to open the tensor file " + path);
+            }
+
+            struct stat st;
+            if (::fstat(fd, &st) != 0)
+            {
+                ::close(fd);
+                throw runtime_error("Failed to read the size of the tensor file " + path);
+            }
+            this->size = static_cast<size_t>(st.st_size);
+
+            if (this->size > 0)
+            {
+                void *ptr = ::mmap(nullptr, this->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+                if (ptr == MAP_FAILED)
+                {
+                    ::close(fd);
+                    throw runtime_error("Failed to map the tensor file " + path);
+                }
+                this->data = static_cast<char *>(ptr);
+                this->mapped = true;
+            }
+
+            ::close(fd); // the mapping stays valid
+#else
+            ifstream file(path, ios::binary | ios::ate);
+            if (!file.is_open())
+            {
+                throw runtime_error("Failed to open the tensor file " + path);
+            }
+            this->size = static_cast<size_t>(file.tellg());
+            // The buffer is over-allocated, so that the data can start at an aligned address
+            this->buffer.resize(this->size + ALIGNMENT);
+            this->data = this->buffer.data() + (ALIGNMENT - reinterpret_cast<uintptr_t>(this->buffer.data()) % ALIGNMENT) % ALIGNMENT;
+            file.seekg(0);
+            file.read(this->data, static_cast<streamsize>(this->size));
+#endif
+        }
+
+        ~MappedFile()
+        {
+#ifdef NEURALNET_HAS_MMAP
+            if (this->mapped)
+            {
+                ::munmap(this->data, this->size);
+            }
+#endif
+        }
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+    };
+
+    size_t dtype_size(DType dtype)
+    {
+        switch (dtype)
+        {
+        case DType::FLOAT32:
+        case DType::INT32:
+            return 4;
+        case DType::FLOAT64:
+        case DType::INT64:
+            return 8;
+        case DType::BFLOAT16:
+        case DType::FLOAT16:
+            return 2;
+        case DType::INT8:
+        case DType::UINT8:
+            return 1;
+        }
+        throw invalid_argument("Unknown tensor type");
+    }
+
+    string dtype_name(DType dtype)
+    {
+        switch (dtype)
+        {
+        case DType::FLOAT32:
+            return "float32";
+        case DType::FLOAT64:
+            return "float64";
+        case DType::BFLOAT16:
+            return "bfloat16";
+        case DType::FLOAT16:
+            return "float16";
+        case DType::INT8:
+            return "int8";
+        case DType::UINT8:
+            return "uint8";
+        case DType::INT32:
+            return "int32";
+        case DType::INT64:
+            return "int64";
+        }
+        throw invalid_argument("Unknown tensor type");
+    }
+
+    // ================================================TensorWriter================================================
+
+    void TensorWriter::add_entry(Entry entry)
+    {
+        for (const Entry &e : this->entries_)
+        {
+            if (e.name == entry.name)
+            {
+                throw invalid_argument("A tensor named " + entry.name + " was already added");
+            }
+        }
+        this->entries_.push_back(std::move(entry));
+    }
+
+    void TensorWriter::write(const string &path) const
+    {
+        // Offsets of the tensors in the data section
+        size_t data_size = 0;
+        vector<size_t> offsets;
+
+        for (const Entry &e : this->entries_)
+        {
+            data_size = round_up(data_size, ALIGNMENT);
+            offsets.push_back(data_size);
+            data_size += e.nbytes;
+        }
+
+        // The size of the header does not depend on the offsets
+        size_t header_size = sizeof(MAGIC) + 2 * sizeof(uint32_t) + sizeof(uint64_t);
+        for (const Entry &e : this->entries_)
+        {
+            header_size += sizeof(uint32_t) + e.name.size() + 2 * sizeof(uint8_t) + (e.shape.size() + 2) * sizeof(uint64_t);
+        }
+        const size_t data_start = round_up(header_size, ALIGNMENT);
+
+        string header(MAGIC, sizeof(MAGIC));
+        append<uint32_t>(header, VERSION);
+        append<uint32_t>(header, static_cast<uint32_t>(this->entries_.size()));
+        append<uint64_t>(header, data_start);
+
+        for (size_t i = 0; i < this->entries_.size(); ++i)
+        {
+            const Entry &e = this->entries_[i];
+            append<uint32_t>(header, static_cast<uint32_t>(e.name.size()));
+            header += e.name;
+            append<uint8_t>(header, static_cast<uint8_t>(e.dtype));
+            append<uint8_t>(header, static_cast<uint8_t>(e.shape.size()));
+            for (const size_t &dim : e.shape)
+            {
+                append<uint64_t>(header, dim);
+            }
+            append<uint64_t>(header, data_start + offsets[i]);
+            append<uint64_t>(header, e.nbytes);
+        }
+        header.resize(data_start, '\0');
+
+        const string tmp_path = path + ".tmp";
+        {
+            ofstream file(tmp_path, ios::binary | ios::trunc);
+            if (!file.is_open())
+            {
+                throw runtime_error("Failed to open " + tmp_path + " for writing");
+            }
+
+            file.write(header.data(), static_cast<streamsize>(header.size()));
+
+            const char padding[ALIGNMENT] = {};
+            size_t written = 0;
+            for (size_t i = 0; i < this->entries_.size(); ++i)
+            {
+                file.write(padding, static_cast<streamsize>(offsets[i] - written));
+                file.write(static_cast<const char *>(this->entries_[i].data), static_cast<streamsize>(this->entries_[i].nbytes));
+                written = offsets[i] + this->entries_[i].nbytes;
+            }
+
+            if (!file.good())
+            {
+                file.close();
+                std::remove(tmp_path.c_str());
+                throw runtime_error("Failed to write the tensor file " + path);
+            }
+        }
+
+        if (std::rename(tmp_path.c_str(), path.c_str()) != 0)
+        {
+            std::remove(tmp_path.c_str());
+            throw runtime_error("Failed to write the tensor file " + path);
+        }
+    }
+
+    // ================================================TensorFile================================================
+
+    TensorFile::TensorFile(const string &path)
+        : file_(make_shared<MappedFile>(path))
+    {
+        this->base_ = this->file_->data;
+
+        HeaderReader reader(this->base_, this->file_->size);
+
+        if (reader.read_string(sizeof(MAGIC)) != string(MAGIC, sizeof(MAGIC)))
+        {
+            throw runtime_error(path + " is not a tensor file");
+        }
+        const uint32_t version = reader.read<uint32_t>();
+        if (version != VERSION)
+        {
+            throw runtime_error("Unsupported version " + to_string(version) + " of the tensor file " + path);
+        }
+
+        const uint32_t count = reader.read<uint32_t>();
+        const uint64_t data_start = reader.read<uint64_t>();
+
+        this->entries_.reserve(count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            Entry e;
+            e.name = reader.read_string(reader.read<uint32_t>());
+
+            const uint8_t dtype = reader.read<uint8_t>();
+            if (dtype > static_cast<uint8_t>(DType::INT64))
+            {
+                throw runtime_error("Unknown type of the tensor " + e.name + " in " + path);
+            }
+            e.dtype = static_cast<DType>(dtype);
+
+            const uint8_t ndim = reader.read<uint8_t>();
+            if (ndim > DimVector::MAX_DIMS)
+            {
+                throw runtime_error("Invalid shape of the tensor " + e.name + " in " + path);
+            }
+
+            // the sizes come from the file, so the number of elements and of bytes must not overflow
+            bool overflow = false;
+            size_t numel = 1;
+            for (uint8_t d = 0; d < ndim; ++d)
+            {
+                const uint64_t dim = reader.read<uint64_t>();
+                overflow = overflow || (dim != 0 && numel > SIZE_MAX / dim);
+                e.shape.push_back(dim);
+                numel *= dim;
+            }
+            overflow = overflow || numel > SIZE_MAX / dtype_size(e.dtype);
+
+            e.offset = reader.read<uint64_t>();
+            e.nbytes = reader.read<uint64_t>();
+
+            if (overflow || e.nbytes != numel * dtype_size(e.dtype) || e.offset < data_start || e.offset % ALIGNMENT != 0 ||
+                e.offset > this->file_->size || e.nbytes > this->file_->size - e.offset)
+            {
+                throw runtime_error("Invalid data of the tensor " + e.name + " in " + path);
+            }
+            if (this->index_.count(e.name) > 0)
+            {
+                throw runtime_error("Duplicate tensor " + e.name + " in " + path);
+            }
+
+            this->index_[e.name] = this->entries_.size();
+            this->entries_.push_back(std::move(e));
+        }
+
+        if (reader.position() > data_start)
+        {
+            throw runtime_error("Invalid header of the tensor file " + path);
+        }
+    }
+
+    const TensorFile::Entry &TensorFile::entry(const string &name) const
+    {
+        const auto it = this->index_.find(name);
+        if (it == this->index_.end())
+        {
+            throw out_of_range("No tensor named " + name);
+        }
+        return this->entries_[it->second];
+    }
+
+    vector<string> TensorFile::names() const
+    {
+        vector<string> names;
+        names.reserve(this->entries_.size());
+        for (const Entry &e : this->entries_)
+        {
+            names.push_back(e.name);
+        }
+        return names;
+    }
+
+    DType TensorFile::dtype(const string &name) const
+    {
+        return this->entry(name).dtype;
+    }
+
+    const DimVector &TensorFile::shape(const string &name) const
+    {
+        return this->entry(name).shape;
+    }
+
+    bool TensorFile::is_mapped() const
+    {
+        return this->file_->mapped;
+    }
+
+    void save(const string &path, const map<string, Tensor<>> &tensors)
+    {
+        TensorWriter writer;
+        for (const auto &[name, tensor] : tensors)
+        {
+            writer.add(name, tensor);
+        }
+        writer.write(path);
+    }
+
+    map<string, Tensor<>> load(const string &path)
+    {
+        const TensorFile file(path);
+
+        map<string, Tensor<>> tensors;
+        for (const string &name : file.names())
+        {
+            tensors[name] = file.get<float>(name);
+        }
+        return tensors;
+    }
+}
+
+namespace nn
+{
+    void save_state_dict(const Module &module, const string &path)
+    {
+        unordered_map<string, Tensor<> *> params, grads;
+        module.register_parameters(params, grads);
+
+        map<string, Tensor<>> tensors;
+        for (const auto &[name, param] : params)
+        {
+            tensors[name] = *param;
+        }
+        serialization::save(path, tensors);
+    }
+
+    void load_state_dict(Module &module, const string &path, bool strict)
+    {
+        unordered_map<string, Tensor<> *> params, grads;
+        module.register_parameters(params, grads);
+
+        const serialization::TensorFile file(path);
+
+        if (strict)
+        {
+            for (const string &name : file.names())
+            {
+                if (params.count(name) == 0)
+                {
+                    throw runtime_error("Unexpected tensor " + name + " in " + path);
+                }
+            }
+        }
+
+        // Everything is checked before the first parameter is replaced
+        vector<pair<Tensor<> *, Tensor<>>> loaded;
+        for (const auto &[name, param] : params)
+        {
+            if (!file.contains(name))
+            {
+                if (strict)
+                {
+                    throw runtime_error("Missing parameter " + name + " in " + path);
+                }
+                continue;
+            }
+
+            if (file.dtype(name) != serialization::DType::FLOAT32)
+            {
+                throw runtime_error("The parameter " + name + " is of type " + serialization::dtype_name(file.dtype(name)) + " in " + path);
+            }
+            if (file.shape(name) != param->shapes())
+            {
+                throw runtime_error("Shape mismatch of the parameter " + name + " in " + path);
+            }
+
+            loaded.emplace_back(param, file.get<float>(name));
+        }
+
+        for (auto &[param, tensor] : loaded)
+        {
+            *param = std::move(tensor);
+        }
+    }
+}
@@ -0,0 +1,304 @@
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+#include "simd.hpp"
+#include "simd_kernels.hpp"
+
+namespace simd
+{
+    namespace
+    {
+        // Scalar "register" holding a single float, used when no vector instruction set is available
+        struct ScalarVec
+        {
+            using reg = float;
+            static constexpr size_t width = 1;
+
+            static inline reg load(const float *p) { return *p; }
+            static inline void store(float *p, reg v) { *p = v; }
+            static inline reg set1(float v) { return v; }
+            static inline reg add(reg a, reg b) { return a + b; }
+            static inline reg sub(reg a, reg b) { return a - b; }
+            static inline reg mul(reg a, reg b) { return a * b; }
+            static inline reg div(reg a, reg b) { return a / b; }
+            static inline reg sqrt(reg a) { return std::sqrt(a); }
+            static inline reg abs(reg a) { return std::fabs(a); }
+            static inline reg max(reg a, reg b) { return a > b ? a : b; }
+            static inline reg min(reg a, reg b) { return a < b ? a : b; }
+            static inline reg load_half(const bf16 *p) { return *p; }
+            static inline reg load_half(const fp16 *p) { return *p; }
+            static inline void store_half(bf16 *p, reg v) { *p = v; }
+            static inline void store_half(fp16 *p, reg v) { *p = v; }
+        };
+
+        ISA parse_isa(const string &name)
+        {
+            if (name == "scalar")
+                return ISA::SCALAR;
+            if (name == "sse4.2")
+                return ISA::SSE42;
+            if (name == "avx2")
+                return ISA::AVX2;
+            if (name == "avx512")
+                return ISA::AVX512;
+            throw invalid_argument("Unknown instruction set " + name + ", expected one of scalar, sse4.2, avx2, avx512");
+        }
+
+        const KernelTable &kernels_of(ISA isa)
+        {
+            switch (isa)
+            {
+#ifdef NEURALNET_X86_SIMD
+            case ISA::SSE42:
+                return sse42_kernels();
+            case ISA::AVX2:
+                return avx2_kernels();
+            case ISA::AVX512:
+                return avx512_kernels();
+#endif
+            default:
+                return scalar_kernels();
+            }
+        }
+
+        ISA initial_isa()
+        {
+            const char *env = std::getenv("NEURALNET_SIMD");
+            if (env != nullptr)
+            {
+                const ISA isa = parse_isa(env);
+                if (is_supported(isa))
+                {
+                    return isa;
+                }
+            }
+            return detect_isa();
+        }
+
+        // The kernels are selected once, the first time a kernel is called
+        struct Dispatch
+        {
+            ISA isa;
+            const KernelTable *table;
+
+            Dispatch() : isa(initial_isa()), table(&kernels_of(isa)) {}
+        };
+
+        Dispatch &dispatch()
+        {
+            static Dispatch instance;
+            return instance;
+        }
+
+        // Number of elements of the float buffers used to compute on 16-bit floats
+        constexpr size_t HALF_BLOCK = 256;
+
+        // The 16-bit floats are converted to float by blocks, computed with the float kernels, and rounded back
+        template <typename Half>
+        void half_binary(ArithmeticOp op, const Half *a, const Half *b, Half *out, size_t n)
+        {
+            float a_block[HALF_BLOCK], b_block[HALF_BLOCK];
+            for (size_t i = 0; i < n; i += HALF_BLOCK)
+            {
+                const size_t len = std::min(HALF_BLOCK, n - i);
+                convert(a + i, a_block, len);
+                convert(b + i, b_block, len);
+                binary(op, a_block, b_block, a_block, len);
+                convert(a_block, out + i, len);
+            }
+        }
+
+        template <typename Half>
+        void half_binary_scalar(ArithmeticOp op, const Half *a, float scaler, Half *out, size_t n)
+        {
+            float block[HALF_BLOCK];
+            for (size_t i = 0; i < n; i += HALF_BLOCK)
+            {
+                const size_t len = std::min(HALF_BLOCK, n - i);
+                convert(a + i, block, len);
+                binary_scalar(op, block, scaler, block, len);
+                convert(block, out + i, len);
+            }
+        }
+
+        template <typename Half>
+        void half_scalar_binary(ArithmeticOp op, float scaler, const Half *b, Half *out, size_t n)
+        {
+            float block[HALF_BLOCK];
+            for (size_t i = 0; i < n; i += HALF_BLOCK)
+            {
+                const size_t len = std::min(HALF_BLOCK, n - i);
+                convert(b + i, block, len);
+                scalar_binary(op, scaler, block, block, len);
+                convert(block, out + i, len);
+            }
+        }
+    }
+
+    const KernelTable &scalar_kernels()
+    {
+        static const KernelTable table = make_kernel_table<ScalarVec>();
+        return table;
+    }
+
+    bool is_supported(ISA isa)
+    {
+        switch (isa)
+        {
+        case ISA::SCALAR:
+            return true;
+#ifdef NEURALNET_X86_SIMD
+        case ISA::SSE42:
+            return __builtin_cpu_supports("sse4.2");
+        case ISA::AVX2:
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("f16c");
+        case ISA::AVX512:
+            return __builtin_cpu_supports("avx512f");
+#endif
+        default:
+            return false;
+        }
+    }
+
+    ISA detect_isa()
+    {
+        for (ISA isa : {ISA::AVX512, ISA::AVX2, ISA::SSE42})
+        {
+            if (is_supported(isa))
+            {
+                return isa;
+            }
+        }
+        return ISA::SCALAR;
+    }
+
+    ISA active_isa()
+    {
+        return dispatch().isa;
+    }
+
+    void set_isa(ISA isa)
+    {
+        if (!is_supported(isa))
+        {
+            throw runtime_error("Instruction set " + isa_name(isa) + " is not supported by this CPU");
+        }
+        dispatch().isa = isa;
+        dispatch().table = &kernels_of(isa);
+    }
+
+    string isa_name(ISA isa)
+    {
+        switch (isa)
+        {
+        case ISA::SSE42:
+            return "sse4.2";
+        case ISA::AVX2:
+            return "avx2";
+        case ISA::AVX512:
+            return "avx512";
+        default:
+            return "scalar";
+        }
+    }
+
+    void binary(ArithmeticOp op, const float *a, const float *b, float *out, size_t n)
+    {
+        dispatch().table->binary[static_cast<size_t>(op)](a, b, out, n);
+    }
+
+    void binary_scalar(ArithmeticOp op, const float *a, float scaler, float *out, size_t n)
+    {
+        dispatch().table->binary_scalar[static_cast<size_t>(op)](a, scaler, out, n);
+    }
+
+    void scalar_binary(ArithmeticOp op, float scaler, const float *b, float *out, size_t n)
+    {
+        dispatch().table->scalar_binary[static_cast<size_t>(op)](scaler, b, out, n);
+    }
+
+    void sqrt(const float *a, float *out, size_t n)
+    {
+        dispatch().table->sqrt(a, out, n);
+    }
+
+    void abs(const float *a, float *out, size_t n)
+    {
+        dispatch().table->abs(a, out, n);
+    }
+
+    float sum(const float *a, size_t n)
+    {
+        return dispatch().table->sum(a, n);
+    }
+
+    float sum_kahan(const float *a, size_t n)
+    {
+        return dispatch().table->sum_kahan(a, n);
+    }
+
+    float max(const float *a, size_t n)
+    {
+        return dispatch().table->max(a, n);
+    }
+
+    float min(const float *a, size_t n)
+    {
+        return dispatch().table->min(a, n);
+    }
+
+    void convert(const bf16 *a, float *out, size_t n)
+    {
+        dispatch().table->bf16_to_float(a, out, n);
+    }
+
+    void convert(const float *a, bf16 *out, size_t n)
+    {
+        dispatch().table->float_to_bf16(a, out, n);
+    }
+
+    void convert(const fp16 *a, float *out, size_t n)
+    {
+        dispatch().table->fp16_to_float(a, out, n);
+    }
+
+    void convert(const float *a, fp16 *out, size_t n)
+    {
+        dispatch().table->float_to_fp16(a, out, n);
+    }
+
+    void binary(ArithmeticOp op, const bf16 *a, const bf16 *b, bf16 *out, size_t n)
+    {
+        half_binary(op, a, b, out, n);
+    }
+
+    void binary(ArithmeticOp op, const fp16 *a, const fp16 *b, fp16 *out, size_t n)
+    {
+        half_binary(op, a, b, out, n);
+    }
+
+    void binary_scalar(ArithmeticOp op, const bf16 *a, float scaler, bf16 *out, size_t n)
+    {
+        half_binary_scalar(op, a, scaler, out, n);
+    }
+
+    void binary_scalar(ArithmeticOp op, const fp16 *a, float scaler, fp16 *out, size_t n)
+    {
+        half_binary_scalar(op, a, scaler, out, n);
+    }
+
+    void scalar_binary(ArithmeticOp op, float scaler, const bf16 *b, bf16 *out, size_t n)
+    {
+        half_scalar_binary(op, scaler, b, out, n);
+    }
+
+    void scalar_binary(ArithmeticOp op, float scaler, const fp16 *b, fp16 *out, size_t n)
+    {
+        half_scalar_binary(op, scaler, b, out, n);
+    }
+
+    void philox_batch(uint64_t key, uint64_t first, uint32_t *numbers)
+    {
+        dispatch().table->philox_batch(key, first, numbers);
+    }
+}
@@ -0,0 +1,135 @@
+#include <immintrin.h>
+#include "simd_kernels.hpp"
+
+/*
+AVX2 kernels. This file is compiled with -mavx2 -mfma -mf16c.
+*/
+namespace simd
+{
+    namespace
+    {
+        struct AVX2Vec
+        {
+            using reg = __m256;
+            static constexpr size_t width = 8;
+
+            static inline reg load(const float *p) { return _mm256_loadu_ps(p); }
+            static inline void store(float *p, reg v) { _mm256_storeu_ps(p, v); }
+            static inline reg set1(float v) { return _mm256_set1_ps(v); }
+            static inline reg add(reg a, reg b) { return _mm256_add_ps(a, b); }
+            static inline reg sub(reg a, reg b) { return _mm256_sub_ps(a, b); }
+            static inline reg mul(reg a, reg b) { return _mm256_mul_ps(a, b); }
+            static inline reg div(reg a, reg b) { return _mm256_div_ps(a, b); }
+            static inline reg sqrt(reg a) { return _mm256_sqrt_ps(a); }
+            static inline reg abs(reg a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+            static inline reg max(reg a, reg b) { return _mm256_max_ps(a, b); }
+            static inline reg min(reg a, reg b) { return _mm256_min_ps(a, b); }
+
+            static inline reg load_half(const bf16 *p)
+            {
+                const __m256i bits = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+                return _mm256_castsi256_ps(_mm256_slli_epi32(bits, 16));
+            }
+
+            static inline void store_half(bf16 *p, reg v)
+            {
+                const __m256i bits = _mm256_castps_si256(v);
+                const __m256i abs = _mm256_and_si256(bits, _mm256_set1_epi32(0x7fffffff));
+
+                // Round to nearest even, quiet the NaNs and flush the subnormals to signed zero (see half_bits::float_to_bf16)
+                const __m256i lsb = _mm256_and_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(1));
+                __m256i result = _mm256_srli_epi32(_mm256_add_epi32(_mm256_add_epi32(bits, _mm256_set1_epi32(0x7fff)), lsb), 16);
+                const __m256i nan = _mm256_or_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(0x40));
+                const __m256i zero = _mm256_and_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(0x8000));
+                result = _mm256_blendv_epi8(result, nan, _mm256_cmpgt_epi32(abs, _mm256_set1_epi32(0x7f800000)));
+                result = _mm256_blendv_epi8(result, zero, _mm256_cmpeq_epi32(_mm256_and_si256(bits, _mm256_set1_epi32(0x7f800000)), _mm256_setzero_si256()));
+
+                // packus packs within the 128-bit halves, the permutation gathers the 8 results in the low half
+                const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(result, result), 0b1000);
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(p), _mm256_castsi256_si128(packed));
+            }
+
+            static inline reg load_half(const fp16 *p)
+            {
+                return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+            }
+
+            static inline void store_half(fp16 *p, reg v)
+            {
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(p), _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+            }
+        };
+    }
+
+    namespace
+    {
+        // Low and high 32 bits of the products of the 8 lanes of a by m
+        inline void mulhilo(__m256i a, __m256i m, __m256i &lo, __m256i &hi)
+        {
+            const __m256i even = _mm256_mul_epu32(a, m);                        // 64-bit products of the lanes 0, 2, 4, 6
+            const __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), m); // 64-bit products of the lanes 1, 3, 5, 7
+            lo = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0b10101010);
+            hi = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0b10101010);
+        }
+
+        // Same blocks as philox_kernel, 8 at a time with the state in registers
+        void philox_avx2(uint64_t key, uint64_t first, uint32_t *numbers)
+        {
+            const __m256i m0 = _mm256_set1_epi32(static_cast<int>(PHILOX_M0));
+            const __m256i m1 = _mm256_set1_epi32(static_cast<int>(PHILOX_M1));
+            const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+            // the low 32 bits of the counters are incremented without carry, so a batch crossing a multiple of 2^32 takes the generic path
+            if (static_cast<uint32_t>(first) > UINT32_MAX - (PHILOX_BATCH - 1))
+            {
+                philox_kernel(key, first, numbers);
+                return;
+            }
+
+            for (size_t b = 0; b < PHILOX_BATCH; b += 8)
+            {
+                const uint64_t counter = first + b;
+                __m256i c0 = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(static_cast<uint32_t>(counter))), lane);
+                __m256i c1 = _mm256_set1_epi32(static_cast<int>(static_cast<uint32_t>(counter >> 32)));
+                __m256i c2 = _mm256_setzero_si256();
+                __m256i c3 = _mm256_setzero_si256();
+
+                uint32_t k0 = static_cast<uint32_t>(key);
+                uint32_t k1 = static_cast<uint32_t>(key >> 32);
+
+                for (int round = 0; round < PHILOX_ROUNDS; ++round)
+                {
+                    __m256i lo0, hi0, lo1, hi1;
+                    mulhilo(c0, m0, lo0, hi0);
+                    mulhilo(c2, m1, lo1, hi1);
+
+                    c0 = _mm256_xor_si256(_mm256_xor_si256(hi1, c1), _mm256_set1_epi32(static_cast<int>(k0)));
+                    c1 = lo1;
+                    c2 = _mm256_xor_si256(_mm256_xor_si256(hi0, c3), _mm256_set1_epi32(static_cast<int>(k1)));
+                    c3 = lo0;
+
+                    k0 += PHILOX_W0;
+                    k1 += PHILOX_W1;
+                }
+
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(numbers + b), c0);
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(numbers + PHILOX_BATCH + b), c1);
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(numbers + 2 * PHILOX_BATCH + b), c2);
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(numbers + 3 * PHILOX_BATCH + b), c3);
+            }
+        }
+
+        KernelTable make_avx2_kernel_table()
+        {
+            KernelTable table = make_kernel_table<AVX2Vec>();
+            table.philox_batch = philox_avx2;
+            return table;
+        }
+    }
+
+    const KernelTable &avx2_kernels()
+    {
+        static const KernelTable table = make_avx2_kernel_table();
+        return table;
+    }
+}
@@ -0,0 +1,149 @@
+#include <immintrin.h>
+#include "simd_kernels.hpp"
+
+/*
+AVX-512 kernels. This file is compiled with -mavx512f.
+*/
+namespace simd
+{
+    namespace
+    {
+        struct AVX512Vec
+        {
+            using reg = __m512;
+            static constexpr size_t width = 16;
+
+            static inline reg load(const float *p) { return _mm512_loadu_ps(p); }
+            static inline void store(float *p, reg v) { _mm512_storeu_ps(p, v); }
+            static inline reg set1(float v) { return _mm512_set1_ps(v); }
+            static inline reg add(reg a, reg b) { return _mm512_add_ps(a, b); }
+            static inline reg sub(reg a, reg b) { return _mm512_sub_ps(a, b); }
+            static inline reg mul(reg a, reg b) { return _mm512_mul_ps(a, b); }
+            static inline reg div(reg a, reg b) { return _mm512_div_ps(a, b); }
+            static inline reg sqrt(reg a) { return _mm512_sqrt_ps(a); }
+            static inline reg abs(reg a) { return _mm512_abs_ps(a); }
+            static inline reg max(reg a, reg b) { return _mm512_max_ps(a, b); }
+            static inline reg min(reg a, reg b) { return _mm512_min_ps(a, b); }
+
+            static inline reg load_half(const bf16 *p)
+            {
+                const __m512i bits = _mm512_cvtepu16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)));
+                return _mm512_castsi512_ps(_mm512_slli_epi32(bits, 16));
+            }
+
+            static inline void store_half(bf16 *p, reg v)
+            {
+                const __m512i bits = _mm512_castps_si512(v);
+                const __m512i high = _mm512_srli_epi32(bits, 16);
+
+                // Round to nearest even, quiet the NaNs and flush the subnormals to signed zero (see half_bits::float_to_bf16)
+                const __m512i lsb = _mm512_and_si512(high, _mm512_set1_epi32(1));
+                __m512i result = _mm512_srli_epi32(_mm512_add_epi32(_mm512_add_epi32(bits, _mm512_set1_epi32(0x7fff)), lsb), 16);
+                const __mmask16 nan = _mm512_cmpgt_epu32_mask(_mm512_and_si512(bits, _mm512_set1_epi32(0x7fffffff)), _mm512_set1_epi32(0x7f800000));
+                const __mmask16 zero = _mm512_testn_epi32_mask(bits, _mm512_set1_epi32(0x7f800000));
+                result = _mm512_mask_or_epi32(result, nan, high, _mm512_set1_epi32(0x40));
+                result = _mm512_mask_and_epi32(result, zero, high, _mm512_set1_epi32(0x8000));
+
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), _mm512_cvtepi32_epi16(result));
+            }
+
+            static inline reg load_half(const fp16 *p)
+            {
+                return _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)));
+            }
+
+            static inline void store_half(fp16 *p, reg v)
+            {
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), _mm512_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+            }
+        };
+
+        // VCVTNEPS2BF16 rounds to nearest even, quiets the NaNs and flushes the subnormals like the emulation above
+        __attribute__((target("avx512bf16"))) void float_to_bf16_native(const float *a, bf16 *out, size_t n)
+        {
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16)
+            {
+                const __m256bh packed = _mm512_cvtneps_pbh(_mm512_loadu_ps(a + i));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), (__m256i)packed);
+            }
+            for (; i < n; ++i)
+            {
+                out[i] = a[i];
+            }
+        }
+
+        // Low and high 32 bits of the products of the 16 lanes of a by m
+        inline void mulhilo(__m512i a, __m512i m, __m512i &lo, __m512i &hi)
+        {
+            const __m512i even = _mm512_mul_epu32(a, m);                        // 64-bit products of the even lanes
+            const __m512i odd = _mm512_mul_epu32(_mm512_srli_epi64(a, 32), m); // 64-bit products of the odd lanes
+            lo = _mm512_mask_blend_epi32(0xAAAA, even, _mm512_slli_epi64(odd, 32));
+            hi = _mm512_mask_blend_epi32(0xAAAA, _mm512_srli_epi64(even, 32), odd);
+        }
+
+        // Same blocks as philox_kernel, 16 at a time with the state in registers
+        void philox_avx512(uint64_t key, uint64_t first, uint32_t *numbers)
+        {
+            const __m512i m0 = _mm512_set1_epi32(static_cast<int>(PHILOX_M0));
+            const __m512i m1 = _mm512_set1_epi32(static_cast<int>(PHILOX_M1));
+            const __m512i lane = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+
+            // the low 32 bits of the counters are incremented without carry, so a batch crossing a multiple of 2^32 takes the generic path
+            if (static_cast<uint32_t>(first) > UINT32_MAX - (PHILOX_BATCH - 1))
+            {
+                philox_kernel(key, first, numbers);
+                return;
+            }
+
+            for (size_t b = 0; b < PHILOX_BATCH; b += 16)
+            {
+                const uint64_t counter = first + b;
+                __m512i c0 = _mm512_add_epi32(_mm512_set1_epi32(static_cast<int>(static_cast<uint32_t>(counter))), lane);
+                __m512i c1 = _mm512_set1_epi32(static_cast<int>(static_cast<uint32_t>(counter >> 32)));
+                __m512i c2 = _mm512_setzero_si512();
+                __m512i c3 = _mm512_setzero_si512();
+
+                uint32_t k0 = static_cast<uint32_t>(key);
+                uint32_t k1 = static_cast<uint32_t>(key >> 32);
+
+                for (int round = 0; round < PHILOX_ROUNDS; ++round)
+                {
+                    __m512i lo0, hi0, lo1, hi1;
+                    mulhilo(c0, m0, lo0, hi0);
+                    mulhilo(c2, m1, lo1, hi1);
+
+                    c0 = _mm512_xor_si512(_mm512_xor_si512(hi1, c1), _mm512_set1_epi32(static_cast<int>(k0)));
+                    c1 = lo1;
+                    c2 = _mm512_xor_si512(_mm512_xor_si512(hi0, c3), _mm512_set1_epi32(static_cast<int>(k1)));
+                    c3 = lo0;
+
+                    k0 += PHILOX_W0;
+                    k1 += PHILOX_W1;
+                }
+
+                _mm512_storeu_si512(numbers + b, c0);
+                _mm512_storeu_si512(numbers + PHILOX_BATCH + b, c1);
+                _mm512_storeu_si512(numbers + 2 * PHILOX_BATCH + b, c2);
+                _mm512_storeu_si512(numbers + 3 * PHILOX_BATCH + b, c3);
+            }
+        }
+
+        KernelTable make_avx512_kernel_table()
+        {
+            KernelTable table = make_kernel_table<AVX512Vec>();
+            table.philox_batch = philox_avx512;
+            if (__builtin_cpu_supports("avx512bf16"))
+            {
+                table.float_to_bf16 = float_to_bf16_native;
+            }
+            return table;
+        }
+    }
+
+    const KernelTable &avx512_kernels()
+    {
+        static const KernelTable table = make_avx512_kernel_table();
+        return table;
+    }
+}
@@ -0,0 +1,384 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include "simd.hpp"
+
+/*
+Generic kernels shared by all the instruction sets.
+
+This header is included by one translation unit per instruction set, each compiled with its own target flags
+(e.g. -mavx2 for simd_avx2.cpp). V is a thin wrapper around the vector register of that instruction set, providing:
+
+    reg, width, load, store, set1, add, sub, mul, div, sqrt, abs, max, min
+    load_half, store_half (conversions from and to bf16 and fp16, with the rounding of half.hpp)
+
+Everything is in an anonymous namespace, so the instantiations of different translation units never get mixed up by the linker.
+*/
+namespace simd
+{
+    // Table of kernels of one instruction set
+    struct KernelTable
+    {
+        void (*binary[4])(const float *, const float *, float *, size_t);
+        void (*binary_scalar[4])(const float *, float, float *, size_t);
+        void (*scalar_binary[4])(float, const float *, float *, size_t);
+        void (*sqrt)(const float *, float *, size_t);
+        void (*abs)(const float *, float *, size_t);
+        float (*sum)(const float *, size_t);
+        float (*sum_kahan)(const float *, size_t);
+        float (*max)(const float *, size_t);
+        float (*min)(const float *, size_t);
+        void (*bf16_to_float)(const bf16 *, float *, size_t);
+        void (*float_to_bf16)(const float *, bf16 *, size_t);
+        void (*fp16_to_float)(const fp16 *, float *, size_t);
+        void (*float_to_fp16)(const float *, fp16 *, size_t);
+        void (*philox_batch)(uint64_t, uint64_t, uint32_t *);
+    };
+
+    const KernelTable &scalar_kernels();
+    const KernelTable &sse42_kernels();
+    const KernelTable &avx2_kernels();
+    const KernelTable &avx512_kernels();
+
+    // Constants of Philox4x32-10: the multipliers of the rounds, and the increments of the key between the rounds
+    constexpr uint32_t PHILOX_M0 = 0xD2511F53;
+    constexpr uint32_t PHILOX_M1 = 0xCD9E8D57;
+    constexpr uint32_t PHILOX_W0 = 0x9E3779B9;
+    constexpr uint32_t PHILOX_W1 = 0xBB67AE85;
+    constexpr int PHILOX_ROUNDS = 10;
+
+    // Number of accumulator lanes of sum(). It must be a multiple of the widest register (16 floats for AVX-512)
+    constexpr size_t SUM_LANES = 16;
+
+    namespace
+    {
+        struct Add
+        {
+            template <typename V>
+            static typename V::reg vec(typename V::reg a, typename V::reg b) { return V::add(a, b); }
+            static float scalar(float a, float b) { return a + b; }
+        };
+
+        struct Sub
+        {
+            template <typename V>
+            static typename V::reg vec(typename V::reg a, typename V::reg b) { return V::sub(a, b); }
+            static float scalar(float a, float b) { return a - b; }
+        };
+
+        struct Mul
+        {
+            template <typename V>
+            static typename V::reg vec(typename V::reg a, typename V::reg b) { return V::mul(a, b); }
+            static float scalar(float a, float b) { return a * b; }
+        };
+
+        struct Div
+        {
+            template <typename V>
+            static typename V::reg vec(typename V::reg a, typename V::reg b) { return V::div(a, b); }
+            static float scalar(float a, float b) { return a / b; }
+        };
+
+        template <typename V, typename Op>
+        void binary_kernel(const float *a, const float *b, float *out, size_t n)
+        {
+            size_t i = 0;
+            for (; i + V::width <= n; i += V::width)
+            {
+                V::store(out + i, Op::template vec<V>(V::load(a + i), V::load(b + i)));
+            }
+            for (; i < n; ++i)
+            {
+                out[i] = Op::scalar(a[i], b[i]);
+            }
+        }
+
+        template <typename V, typename Op>
+        void binary_scalar_kernel(const float *a, float scaler, float *out, size_t n)
+        {
+            const typename V::reg s = V::set1(scaler);
+
+            size_t i = 0;
+            for (; i + V::width <= n; i += V::width)
+            {
+                V::store(out + i, Op::template vec<V>(V::load(a + i), s));
+            }
+            for (; i < n; ++i)
+            {
+                out[i] = Op::scalar(a[i], scaler);
+            }
+        }
+
+        template <typename V, typename Op>
+        void scalar_binary_kernel(float scaler, const float *b, float *out, size_t n)
+        {
+            const typename V::reg s = V::set1(scaler);
+
+            size_t i = 0;
+            for (; i + V::width <= n; i += V::width)
+            {
+                V::store(out + i, Op::template vec<V>(s, V::load(b + i)));
+            }
+            for (; i < n; ++i)
+            {
+                out[i] = Op::scalar(scaler, b[i]);
+            }
+        }
+
+        template <typename V>
+        void sqrt_kernel(const float *a, float *out, size_t n)
+        {
+            size_t i = 0;
+            for (; i + V::width <= n; i += V::width)
+            {
+                V::store(out + i, V::sqrt(V::load(a + i)));
+            }
+            for (; i < n; ++i)
+            {
+                out[i] = std::sqrt(a[i]);
+            }
+        }
+
+        template <typename V>
+        void abs_kernel(const float *a, float *out, size_t n)
+        {
+            size_t i = 0;
+            for (; i + V::width <= n; i += V::width)
+            {
+                V::store(out + i, V::abs(V::load(a + i)));
+            }
+            for (; i < n; ++i)
+            {
+                out[i] = std::fabs(a[i]);
+            }
+        }
+
+        // Combine the lanes with a fixed pairwise tree: lane i += lane i + 8, then i + 4, i + 2, i + 1
+        inline float combine_lanes(float *lanes)
+        {
+            for (size_t width = SUM_LANES / 2; width > 0; width /= 2)
+            {
+                for (size_t i = 0; i < width; ++i)
+                {
+                    lanes[i] += lanes[i + width];
+                }
+            }
+            return lanes[0];
+        }
+
+        template <typename V>
+        float sum_kernel(const float *a, size_t n)
+        {
+            constexpr size_t REGS = SUM_LANES / V::width;
+
+            typename V::reg acc[REGS];
+            for (size_t r = 0; r < REGS; ++r)
+            {
+                acc[r] = V::set1(0.0f);
+            }
+
+            size_t i = 0;
+            for (; i + SUM_LANES <= n; i += SUM_LANES)
+            {
+                for (size_t r = 0; r < REGS; ++r)
+                {
+                    acc[r] = V::add(acc[r], V::load(a + i + r * V::width));
+                }
+            }
+
+            float lanes[SUM_LANES];
+            for (size_t r = 0; r < REGS; ++r)
+            {
+                V::store(lanes + r * V::width, acc[r]);
+            }
+
+            // The tail goes to the same lanes as if it was a full block
+            for (size_t j = 0; i + j < n; ++j)
+            {
+                lanes[j] += a[i + j];
+            }
+
+            return combine_lanes(lanes);
+        }
+
+        template <typename V>
+        float sum_kahan_kernel(const float *a, size_t n)
+        {
+            constexpr size_t REGS = SUM_LANES / V::width;
+
+            // The true sum of a lane is sum - compensation
+            typename V::reg sum[REGS], compensation[REGS];
+            for (size_t r = 0; r < REGS; ++r)
+            {
+                sum[r] = V::set1(0.0f);
+                compensation[r] = V::set1(0.0f);
+            }
+
+            size_t i = 0;
+            for (; i + SUM_LANES <= n; i += SUM_LANES)
+            {
+                for (size_t r = 0; r < REGS; ++r)
+                {
+                    const typename V::reg y = V::sub(V::load(a + i + r * V::width), compensation[r]);
+                    const typename V::reg t = V::add(sum[r], y);
+                    compensation[r] = V::sub(V::sub(t, sum[r]), y);
+                    sum[r] = t;
+                }
+            }
+
+            float lanes[SUM_LANES], lane_compensations[SUM_LANES];
+            for (size_t r = 0; r < REGS; ++r)
+            {
+                V::store(lanes + r * V::width, sum[r]);
+                V::store(lane_compensations + r * V::width, compensation[r]);
+            }
+
+            // The tail goes to the same lanes as if it was a full block
+            for (size_t j = 0; i + j < n; ++j)
+            {
+                const float y = a[i + j] - lane_compensations[j];
+                const float t = lanes[j] + y;
+                lane_compensations[j] = (t - lanes[j]) - y;
+                lanes[j] = t;
+            }
+
+            for (size_t j = 0; j < SUM_LANES; ++j)
+            {
+                lanes[j] -= lane_compensations[j];
+            }
+
+            return combine_lanes(lanes);
+        }
+
+        template <typename V, bool IsMax>
+        float extreme_kernel(const float *a, size_t n)
+        {
+            float result = a[0];
+
+            size_t i = 0;
+            if (n >= V::width)
+            {
+                typename V::reg acc = V::load(a);
+                for (i = V::width; i + V::width <= n; i += V::width)
+                {
+                    acc = IsMax ? V::max(acc, V::load(a + i)) : V::min(acc, V::load(a + i));
+                }
+
+                float lanes[V::width];
+                V::store(lanes, acc);
+
+                result = lanes[0];
+                for (size_t j = 1; j < V::width; ++j)
+                {
+                    result = IsMax ? (lanes[j] > result ? lanes[j] : result) : (lanes[j] < result ? lanes[j] : result);
+                }
+            }
+
+            for (; i < n; ++i)
+            {
+                result = IsMax ? (a[i] > result ? a[i] : result) : (a[i] < result ? a[i] : result);
+            }
+            return result;
+        }
+
+        template <typename V, typename Half>
+        void half_to_float_kernel(const Half *a, float *out, size_t n)
+        {
+            size_t i = 0;
+            for (; i + V::width <= n; i += V::width)
+            {
+                V::store(out + i, V::load_half(a + i));
+            }
+            for (; i < n; ++i)
+            {
+                out[i] = static_cast<float>(a[i]);
+            }
+        }
+
+        template <typename V, typename Half>
+        void float_to_half_kernel(const float *a, Half *out, size_t n)
+        {
+            size_t i = 0;
+            for (; i + V::width <= n; i += V::width)
+            {
+                V::store_half(out + i, V::load(a + i));
+            }
+            for (; i < n; ++i)
+            {
+                out[i] = Half(a[i]);
+            }
+        }
+
+        // Philox rounds applied to the whole batch in turn, vectorized by the compiler (AVX2 and AVX-512 replace it with their intrinsics)
+        void philox_kernel(uint64_t key, uint64_t first, uint32_t *numbers)
+        {
+            uint32_t *c0 = numbers, *c1 = numbers + PHILOX_BATCH, *c2 = numbers + 2 * PHILOX_BATCH, *c3 = numbers + 3 * PHILOX_BATCH;
+            for (size_t b = 0; b < PHILOX_BATCH; ++b)
+            {
+                const uint64_t counter = first + b;
+                c0[b] = static_cast<uint32_t>(counter);
+                c1[b] = static_cast<uint32_t>(counter >> 32);
+                c2[b] = 0;
+                c3[b] = 0;
+            }
+
+            uint32_t k0 = static_cast<uint32_t>(key);
+            uint32_t k1 = static_cast<uint32_t>(key >> 32);
+
+            for (int round = 0; round < PHILOX_ROUNDS; ++round)
+            {
+                for (size_t b = 0; b < PHILOX_BATCH; ++b)
+                {
+                    const uint64_t p0 = static_cast<uint64_t>(PHILOX_M0) * c0[b];
+                    const uint64_t p1 = static_cast<uint64_t>(PHILOX_M1) * c2[b];
+
+                    const uint32_t n0 = static_cast<uint32_t>(p1 >> 32) ^ c1[b] ^ k0;
+                    const uint32_t n2 = static_cast<uint32_t>(p0 >> 32) ^ c3[b] ^ k1;
+                    c1[b] = static_cast<uint32_t>(p1);
+                    c3[b] = static_cast<uint32_t>(p0);
+                    c0[b] = n0;
+                    c2[b] = n2;
+                }
+                k0 += PHILOX_W0;
+                k1 += PHILOX_W1;
+            }
+        }
+
+        template <typename V>
+        KernelTable make_kernel_table()
+        {
+            KernelTable table;
+
+            table.binary[static_cast<size_t>(ArithmeticOp::ADD)] = binary_kernel<V, Add>;
+            table.binary[static_cast<size_t>(ArithmeticOp::SUB)] = binary_kernel<V, Sub>;
+            table.binary[static_cast<size_t>(ArithmeticOp::MUL)] = binary_kernel<V, Mul>;
+            table.binary[static_cast<size_t>(ArithmeticOp::DIV)] = binary_kernel<V, Div>;
+
+            table.binary_scalar[static_cast<size_t>(ArithmeticOp::ADD)] = binary_scalar_kernel<V, Add>;
+            table.binary_scalar[static_cast<size_t>(ArithmeticOp::SUB)] = binary_scalar_kernel<V, Sub>;
+            table.binary_scalar[static_cast<size_t>(ArithmeticOp::MUL)] = binary_scalar_kernel<V, Mul>;
+            table.binary_scalar[static_cast<size_t>(ArithmeticOp::DIV)] = binary_scalar_kernel<V, Div>;
+
+            table.scalar_binary[static_cast<size_t>(ArithmeticOp::ADD)] = scalar_binary_kernel<V, Add>;
+            table.scalar_binary[static_cast<size_t>(ArithmeticOp::SUB)] = scalar_binary_kernel<V, Sub>;
+            table.scalar_binary[static_cast<size_t>(ArithmeticOp::MUL)] = scalar_binary_kernel<V, Mul>;
+            table.scalar_binary[static_cast<size_t>(ArithmeticOp::DIV)] = scalar_binary_kernel<V, Div>;
+
+            table.sqrt = sqrt_kernel<V>;
+            table.abs = abs_kernel<V>;
+            table.sum = sum_kernel<V>;
+            table.sum_kahan = sum_kahan_kernel<V>;
+            table.max = extreme_kernel<V, true>;
+            table.min = extreme_kernel<V, false>;
+            table.bf16_to_float = half_to_float_kernel<V, bf16>;
+            table.float_to_bf16 = float_to_half_kernel<V, bf16>;
+            table.fp16_to_float = half_to_float_kernel<V, fp16>;
+            table.float_to_fp16 = float_to_half_kernel<V, fp16>;
+            table.philox_batch = philox_kernel;
+
+            return table;
+        }
+    }
+}
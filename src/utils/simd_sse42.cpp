@@ -0,0 +1,73 @@
+#include <immintrin.h>
+#include "simd_kernels.hpp"
+
+/*
+SSE4.2 kernels. This file is compiled with -msse4.2.
+*/
+namespace simd
+{
+    namespace
+    {
+        struct SSE42Vec
+        {
+            using reg = __m128;
+            static constexpr size_t width = 4;
+
+            static inline reg load(const float *p) { return _mm_loadu_ps(p); }
+            static inline void store(float *p, reg v) { _mm_storeu_ps(p, v); }
+            static inline reg set1(float v) { return _mm_set1_ps(v); }
+            static inline reg add(reg a, reg b) { return _mm_add_ps(a, b); }
+            static inline reg sub(reg a, reg b) { return _mm_sub_ps(a, b); }
+            static inline reg mul(reg a, reg b) { return _mm_mul_ps(a, b); }
+            static inline reg div(reg a, reg b) { return _mm_div_ps(a, b); }
+            static inline reg sqrt(reg a) { return _mm_sqrt_ps(a); }
+            static inline reg abs(reg a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+            static inline reg max(reg a, reg b) { return _mm_max_ps(a, b); }
+            static inline reg min(reg a, reg b) { return _mm_min_ps(a, b); }
+
+            static inline reg load_half(const bf16 *p)
+            {
+                const __m128i bits = _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)));
+                return _mm_castsi128_ps(_mm_slli_epi32(bits, 16));
+            }
+
+            static inline void store_half(bf16 *p, reg v)
+            {
+                const __m128i bits = _mm_castps_si128(v);
+                const __m128i abs = _mm_and_si128(bits, _mm_set1_epi32(0x7fffffff));
+
+                // Round to nearest even, quiet the NaNs and flush the subnormals to signed zero (see half_bits::float_to_bf16)
+                const __m128i lsb = _mm_and_si128(_mm_srli_epi32(bits, 16), _mm_set1_epi32(1));
+                __m128i result = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(bits, _mm_set1_epi32(0x7fff)), lsb), 16);
+                const __m128i nan = _mm_or_si128(_mm_srli_epi32(bits, 16), _mm_set1_epi32(0x40));
+                const __m128i zero = _mm_and_si128(_mm_srli_epi32(bits, 16), _mm_set1_epi32(0x8000));
+                result = _mm_blendv_epi8(result, nan, _mm_cmpgt_epi32(abs, _mm_set1_epi32(0x7f800000)));
+                result = _mm_blendv_epi8(result, zero, _mm_cmpeq_epi32(_mm_and_si128(bits, _mm_set1_epi32(0x7f800000)), _mm_setzero_si128()));
+
+                _mm_storel_epi64(reinterpret_cast<__m128i *>(p), _mm_packus_epi32(result, result));
+            }
+
+            // There is no fp16 conversion instruction before F16C, the lanes are converted one by one
+            static inline reg load_half(const fp16 *p)
+            {
+                return _mm_setr_ps(p[0], p[1], p[2], p[3]);
+            }
+
+            static inline void store_half(fp16 *p, reg v)
+            {
+                alignas(16) float lanes[width];
+                _mm_store_ps(lanes, v);
+                for (size_t i = 0; i < width; ++i)
+                {
+                    p[i] = lanes[i];
+                }
+            }
+        };
+    }
+
+    const KernelTable &sse42_kernels()
+    {
+        static const KernelTable table = make_kernel_table<SSE42Vec>();
+        return table;
+    }
+}
@@ -45,26 +45,223 @@ size_t normalize_index(int idx, size_t dim_size) {
     return idx;
 }
 
-// Helper function to apply slice to a dimension
-vector<size_t> apply_slice(const Slice& slice, size_t dim_size) {
-    vector<size_t> indices;
-    // cout << "In apply_slice, start: " << slice.start << " stop: " << slice.stop << " step: " << slice.step << endl;
+SliceRange resolve_slice(const Slice& slice, size_t dim_size) {
+    if (slice.step <= 0) {
+        throw std::invalid_argument("Slice step must be positive");
+    }
+
     size_t start = normalize_index(slice.start, dim_size);
     size_t stop = slice.stop == INT_MAX ? dim_size : normalize_index(slice.stop - 1, dim_size) + 1;
     size_t step = slice.step;
-    
-    // cout << "start applying slice" << endl;
-    for (size_t i = start; i < stop; i += step) {
-        indices.push_back(i);
+
+    size_t length = start < stop ? (stop - start + step - 1) / step : 0;
+    return {start, step, length};
+}
+
+// Helper function to apply slice to a dimension
+vector<size_t> apply_slice(const Slice& slice, size_t dim_size) {
+    SliceRange range = resolve_slice(slice, dim_size);
+
+    vector<size_t> indices(range.length);
+    for (size_t i = 0; i < range.length; ++i) {
+        indices[i] = range.start + i * range.step;
     }
     return indices;
 }
 
-vector<size_t> linear_to_multi_idxs(size_t idx, const vector<size_t>& shape) {
-    vector<size_t> indices(shape.size());
+IndexPlan::IndexPlan(const vector<IndexType>& indices) {
+    this->items_.reserve(indices.size());
+
+    for (const IndexType& idx : indices) {
+        if (auto str_idx = get_if<string>(&idx)) {
+            if (*str_idx == "...") {
+                if (this->ellipsis_pos_ != SIZE_MAX) {
+                    throw std::invalid_argument("An index can only have a single ellipsis ('...')");
+                }
+                this->ellipsis_pos_ = this->items_.size();
+                this->items_.push_back({Kind::ELLIPSIS, 0, Slice()});
+            } else {
+                this->items_.push_back({Kind::SLICE, 0, Slice::parse(*str_idx)});
+            }
+        } else if (auto int_idx = get_if<size_t>(&idx)) {
+            this->items_.push_back({Kind::INTEGER, *int_idx, Slice()});
+        } else if (auto slice_idx = get_if<Slice>(&idx)) {
+            this->items_.push_back({Kind::SLICE, 0, *slice_idx});
+        } else {
+            throw std::invalid_argument("Invalid index type");
+        }
+    }
+}
+
+size_t IndexPlan::apply(const DimVector& shape, const DimVector& strides, DimVector& view_shape, DimVector& view_strides) const {
+    const size_t ndim = shape.size();
+    const size_t num_indexed = this->ellipsis_pos_ == SIZE_MAX ? this->items_.size() : this->items_.size() - 1;
+
+    if (num_indexed > ndim) {
+        throw std::invalid_argument("Too many indices for a tensor of " + to_string(ndim) + " dimensions");
+    }
+
+    // Number of dimensions covered by the ellipsis
+    const size_t ellipsis_ndim = ndim - num_indexed;
+
+    view_shape.clear();
+    view_strides.clear();
+    size_t offset = 0;
+    size_t dim = 0;
+
+    for (const Item& item : this->items_) {
+        switch (item.kind) {
+            case Kind::ELLIPSIS:
+                for (size_t i = 0; i < ellipsis_ndim; ++i, ++dim) {
+                    view_shape.push_back(shape[dim]);
+                    view_strides.push_back(strides[dim]);
+                }
+                break;
+
+            case Kind::INTEGER:
+                offset += normalize_index(item.integer, shape[dim]) * strides[dim];
+                ++dim;
+                break;
+
+            case Kind::SLICE: {
+                SliceRange range = resolve_slice(item.slice, shape[dim]);
+                offset += range.start * strides[dim];
+
+                // a slice selecting a single element drops the dimension, like an integer index
+                if (range.length != 1) {
+                    view_shape.push_back(range.length);
+                    view_strides.push_back(range.step * strides[dim]);
+                }
+                ++dim;
+                break;
+            }
+        }
+    }
+
+    // The remaining dimensions are taken whole
+    for (; dim < ndim; ++dim) {
+        view_shape.push_back(shape[dim]);
+        view_strides.push_back(strides[dim]);
+    }
+
+    return offset;
+}
+
+DimVector linear_to_multi_idxs(size_t idx, const DimVector& shape) {
+    DimVector indices(shape.size());
     for (int64_t i = shape.size() - 1; i >= 0; --i) {
         indices[i] = idx % shape[i];
         idx /= shape[i];
     }
     return indices;
+}
+
+ReducePlan::ReducePlan(const DimVector& shape, const DimVector& strides, const vector<int64_t>& dims, bool keepdim) {
+    const size_t ndim = shape.size();
+
+    bool reduced[DimVector::MAX_DIMS] = {};
+
+    for (int64_t dim : dims) {
+        if (dim < 0) {
+            dim += ndim;
+        }
+
+        if (dim < 0 || dim >= static_cast<int64_t>(ndim)) {
+            throw std::out_of_range("Reduction dimension out of range");
+        }
+
+        if (reduced[dim]) {
+            throw std::invalid_argument("Duplicate dimension in reduction");
+        }
+        reduced[dim] = true;
+    }
+
+    if (dims.empty()) {
+        fill(reduced, reduced + ndim, true);
+    }
+
+    // Strides of the result with the reduced dimensions kept (as 1), which are also the strides without them
+    DimVector out_strides(ndim, 0);
+    size_t stride = 1;
+    for (int64_t i = ndim - 1; i >= 0; --i) {
+        if (!reduced[i]) {
+            out_strides[i] = stride;
+            stride *= shape[i];
+        }
+    }
+
+    for (size_t i = 0; i < ndim; ++i) {
+        if (!reduced[i]) {
+            this->out_shape.push_back(shape[i]);
+            this->out_numel *= shape[i];
+        }
+        else {
+            if (keepdim) {
+                this->out_shape.push_back(1);
+            }
+            this->reduce_numel *= shape[i];
+        }
+    }
+
+    // A full reduction gives a single element, like the other scalar results
+    if (this->out_shape.empty()) {
+        this->out_shape.push_back(1);
+    }
+
+    // Visit the dimensions from the outermost to the innermost in memory
+    DimVector order(ndim);
+    for (size_t i = 0; i < ndim; ++i) {
+        order[i] = i;
+    }
+    stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return strides[a] > strides[b]; });
+
+    for (size_t dim : order) {
+        if (shape[dim] == 1) {
+            continue;
+        }
+
+        DimVector& group_shape = reduced[dim] ? this->reduced_shape : this->kept_shape;
+        DimVector& group_strides = reduced[dim] ? this->reduced_strides : this->kept_strides;
+
+        // Merge into the previous dimension if it is of the same kind and contiguous with this one
+        const bool same_kind = !group_shape.empty() && this->inner == reduced[dim];
+        if (same_kind && group_strides.back() == strides[dim] * shape[dim] &&
+            (reduced[dim] || this->kept_out_strides.back() == out_strides[dim] * shape[dim])) {
+            group_shape.back() *= shape[dim];
+            group_strides.back() = strides[dim];
+            if (!reduced[dim]) {
+                this->kept_out_strides.back() = out_strides[dim];
+            }
+            continue;
+        }
+
+        group_shape.push_back(shape[dim]);
+        group_strides.push_back(strides[dim]);
+        if (!reduced[dim]) {
+            this->kept_out_strides.push_back(out_strides[dim]);
+        }
+        this->inner = reduced[dim];
+    }
+
+    // Nothing left to iterate but a single element (every dimension is of size 1)
+    if (this->kept_shape.empty() && this->reduced_shape.empty()) {
+        this->inner = true;
+    }
+}
+
+DimVector broadcast_shapes(const DimVector& shape_a, const DimVector& shape_b) {
+    const size_t ndim = max(shape_a.size(), shape_b.size());
+    DimVector result(ndim);
+
+    // align the shapes from the last dimension, missing leading dimensions are treated as 1
+    for (size_t i = 0; i < ndim; ++i) {
+        const size_t dim_a = i < ndim - shape_a.size() ? 1 : shape_a[i - (ndim - shape_a.size())];
+        const size_t dim_b = i < ndim - shape_b.size() ? 1 : shape_b[i - (ndim - shape_b.size())];
+
+        if (dim_a != dim_b && dim_a != 1 && dim_b != 1) {
+            throw runtime_error("Shape mismatch in arithmetic operation");
+        }
+        result[i] = dim_a == 1 ? dim_b : dim_a;
+    }
+    return result;
 }
\ No newline at end of file
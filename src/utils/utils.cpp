@@ -13,5 +13,5 @@ void print_stats_line(int batch, float loss, float accuracy)
     cout << "Batch " << setw(4) << batch << " "
          << "Loss: " << fixed << setprecision(5) << setw(8) << loss << " "
          << "Accuracy: " << fixed << setprecision(2) << setw(6) << accuracy * 100 << "%"
-         << endl;
+         << "\n"; // no flush: the line is written with the next ones
 }
\ No newline at end of file
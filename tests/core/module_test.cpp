@@ -1,6 +1,16 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest.h"
 #include "module.hpp"
+#include "linear.hpp"
+#include "dropout.hpp"
+#include "cross_entropy.hpp"
+#include "relu.hpp"
+#include "quantized_linear.hpp"
+#include "quantization.hpp"
+#include "sequential.hpp"
+#include "logging.hpp"
+#include "serialization.hpp"
+#include <filesystem>
 
 namespace nn {
 
@@ -68,4 +78,272 @@ TEST_CASE("ModuleTest - Train Mode") {
     CHECK_FALSE(module.is_training());
 }
 
+TEST_CASE("ModuleTest - Quantized Linear") {
+    Linear linear(96, 40);
+    const Tensor<> input = (Tensor<>::arange(0, 16 * 96 - 1) * 0.173f).map([](const float &v) { return std::fmod(v, 4.0f); }).reshape({16, 96});
+
+    QuantizedLinear quantized(linear, 0.0f, 4.0f);
+    CHECK(quantized.in_features() == 96);
+    CHECK(quantized.out_features() == 40);
+    CHECK(quantized.get_input_qparams().zero_point == 0);
+
+    // the weight is about 4 times smaller
+    CHECK(quantized.weight_bytes() * 3 < 96 * 40 * sizeof(float));
+
+    const Tensor<> expected = linear.forward(input);
+    const Tensor<> output = quantized.forward(input);
+    CHECK(output.shapes() == expected.shapes());
+    CHECK((output - expected).abs().max(vector<int64_t>{})[0] < 0.05f);
+
+    CHECK_THROWS(quantized.backward(output));
+}
+
+TEST_CASE("ModuleTest - Post-training Quantization") {
+    MLP model(64, {48, 32, 10});
+    const Sequential &layers = model.get_layers();
+
+    vector<Tensor<>> calibration;
+    for (size_t b = 0; b < 4; ++b) {
+        calibration.push_back((Tensor<>::arange(0, 8 * 64 - 1) * (0.37f + 0.1f * b)).map([](const float &v) { return std::sin(v); }).reshape({8, 64}));
+    }
+
+    model.eval();
+    const Tensor<> expected = model.forward(calibration[1]);
+
+    size_t float_bytes = 0;
+    for (size_t i = 0; i < layers.size(); ++i) {
+        if (const Linear *linear = dynamic_cast<const Linear *>(layers.get(i))) {
+            float_bytes += linear->get_weight().size() * sizeof(float);
+        }
+    }
+
+    CHECK(quantize_linear_layers(model, calibration) == 3);
+    CHECK_FALSE(layers.is_training());
+
+    size_t quantized_bytes = 0;
+    for (size_t i = 0; i < layers.size(); ++i) {
+        CHECK(dynamic_cast<const Linear *>(layers.get(i)) == nullptr);
+        if (const QuantizedLinear *quantized = dynamic_cast<const QuantizedLinear *>(layers.get(i))) {
+            quantized_bytes += quantized->weight_bytes();
+        }
+    }
+    CHECK(quantized_bytes * 3 < float_bytes);
+
+    // the ReLU outputs are quantized with a zero point of 0
+    CHECK(dynamic_cast<const QuantizedLinear *>(layers.get(2))->get_input_qparams().zero_point == 0);
+
+    const Tensor<> output = model.forward(calibration[1]);
+    CHECK(output.shapes() == expected.shapes());
+    CHECK((output - expected).abs().max(vector<int64_t>{})[0] < 0.05f);
+
+    // nothing left to quantize
+    CHECK(quantize_linear_layers(model, calibration) == 0);
+    CHECK_THROWS(quantize_linear_layers(model, vector<Tensor<>>{}));
+}
+
+TEST_CASE("ModuleTest - Logging") {
+    vector<tuple<logging::Level, logging::Subsystem, string>> messages;
+    logging::set_sink([&](logging::Level level, logging::Subsystem subsystem, const string &message) {
+        messages.emplace_back(level, subsystem, message);
+    });
+
+    SUBCASE("Runtime levels") {
+        logging::set_level(logging::Level::WARN);
+        NN_LOG_INFO(MODULES, "filtered");
+        NN_LOG_WARN(MODULES, "kept " << 42);
+        NN_LOG_ERROR(DATASET, "kept too");
+
+        REQUIRE(messages.size() == 2);
+        CHECK(get<0>(messages[0]) == logging::Level::WARN);
+        CHECK(get<1>(messages[0]) == logging::Subsystem::MODULES);
+        CHECK(get<2>(messages[0]) == "kept 42");
+        CHECK(get<1>(messages[1]) == logging::Subsystem::DATASET);
+    }
+
+    SUBCASE("Per subsystem configuration") {
+        logging::configure("off, conv=info,Dataset=WARN");
+        CHECK(logging::get_level(logging::Subsystem::CONV) == logging::Level::INFO);
+        CHECK(logging::get_level(logging::Subsystem::DATASET) == logging::Level::WARN);
+        CHECK(logging::get_level(logging::Subsystem::MODULES) == logging::Level::OFF);
+
+        NN_LOG_ERROR(MODULES, "filtered");
+        NN_LOG_INFO(CONV, "kept");
+        CHECK(messages.size() == 1);
+
+        // an invalid specification changes nothing
+        CHECK_THROWS_AS(logging::configure("debug,conv=loud"), std::invalid_argument);
+        CHECK_THROWS_AS(logging::configure("kernels=debug"), std::invalid_argument);
+        CHECK(logging::get_level(logging::Subsystem::MODULES) == logging::Level::OFF);
+    }
+
+    SUBCASE("Modules are silent by default") {
+        logging::set_level(logging::Level::INFO);
+        Sequential model({new Linear(4, 3), new ReLU()});
+        unordered_map<string, Tensor<> *> params, grads;
+        model.register_parameters(params, grads);
+        model.forward(Tensor<>({2, 4}, 1.0f));
+        CHECK(messages.empty());
+    }
+
+    SUBCASE("Tensors in messages") {
+        logging::set_level(logging::Level::INFO);
+        NN_LOG_INFO(TENSOR, "t = " << Tensor<>({{1.0f, 2.0f}, {3.0f, 4.0f}}));
+        REQUIRE(messages.size() == 1);
+        CHECK(get<2>(messages[0]) == "t = [\n  [1, 2],\n  [3, 4]\n]");
+    }
+
+    logging::set_sink({});
+    logging::set_level(logging::Level::INFO);
+}
+
+TEST_CASE("ModuleTest - State Dict") {
+    const string path = (std::filesystem::temp_directory_path() / "neuralnet_module_test.nnt").string();
+    const Tensor<> input = Tensor<>::arange(0, 4 * 16 - 1).reshape({4, 16}) * 0.01f;
+
+    MLP trained(16, {12, 4});
+    trained.eval();
+    save_state_dict(trained, path);
+
+    SUBCASE("Loaded parameters are backed by the file") {
+        MLP model(16, {12, 4});
+        model.eval();
+        CHECK_FALSE(model.forward(input) == trained.forward(input));
+
+        load_state_dict(model, path);
+        CHECK(model.forward(input) == trained.forward(input));
+
+        // the parameters can be updated in place without modifying the file
+        unordered_map<string, Tensor<> *> params, grads;
+        model.register_parameters(params, grads);
+        for (auto &[name, param] : params) {
+            param->fill_(0.0f);
+        }
+        load_state_dict(model, path);
+        CHECK(model.forward(input) == trained.forward(input));
+    }
+
+    SUBCASE("Mismatched modules") {
+        MLP wider(16, {20, 4});
+        wider.eval();
+        const Tensor<> expected = wider.forward(input);
+
+        // nothing is replaced if one of the parameters does not match
+        CHECK_THROWS_AS(load_state_dict(wider, path), std::runtime_error);
+        CHECK_THROWS_AS(load_state_dict(wider, path, false), std::runtime_error);
+        CHECK(wider.forward(input) == expected);
+
+        // the names of the file are "mlp.layer0.linear.weight", ...
+        Linear linear(16, 12);
+        const Tensor<> weight = linear.get_weight().clone();
+        CHECK_THROWS_AS(load_state_dict(linear, path), std::runtime_error);
+        load_state_dict(linear, path, false);
+        CHECK(linear.get_weight() == weight);
+    }
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("ModuleTest - Linear with Sparse Input") {
+    // a batch of 8 samples with 3 active features out of 40
+    Tensor<> dense({8, 40}, 0.0f);
+    for (size_t i = 0; i < 8; ++i) {
+        for (size_t k = 0; k < 3; ++k) {
+            dense[i, (i * 7 + k * 13) % 40] = 0.5f * (k + 1);
+        }
+    }
+    const SparseCSR sparse = SparseCSR::from_dense(dense);
+    const Tensor<> grad_output = Tensor<>::arange(0, 8 * 5 - 1).reshape({8, 5}) * 0.1f - 2.0f;
+
+    Linear linear(40, 5);
+
+    const Tensor<> expected_output = linear.forward(dense);
+    linear.backward(grad_output);
+    unordered_map<string, Tensor<> *> params, grads;
+    linear.register_parameters(params, grads, "");
+    const Tensor<> expected_grad_weight = grads["linear.weight"]->clone();
+    const Tensor<> expected_grad_bias = grads["linear.bias"]->clone();
+
+    const Tensor<> output = linear.forward(sparse);
+    const Tensor<> grad_input = linear.backward(grad_output);
+
+    for (size_t i = 0; i < 8; ++i) {
+        for (size_t j = 0; j < 5; ++j) {
+            CHECK(output[i, j] == doctest::Approx(expected_output[i, j]).epsilon(1e-5));
+        }
+    }
+    for (size_t i = 0; i < 40; ++i) {
+        for (size_t j = 0; j < 5; ++j) {
+            CHECK((*grads["linear.weight"])[i, j] == doctest::Approx(expected_grad_weight[i, j]).epsilon(1e-5));
+        }
+    }
+    CHECK(*grads["linear.bias"] == expected_grad_bias);
+
+    // no gradient flows into a sparse input
+    CHECK(grad_input.data() == nullptr);
+
+    // a dense batch after a sparse one uses the dense path again
+    CHECK(linear.forward(dense) == expected_output);
+    CHECK(linear.backward(grad_output).shapes() == DimVector{8, 40});
+
+    CHECK_THROWS_AS(linear.forward(SparseCSR::from_dense(Tensor<>({8, 39}, 0.0f))), std::invalid_argument);
+}
+
+TEST_CASE("ModuleTest - Dropout") {
+    const Tensor<> input = Tensor<>::arange(1, 64 * 32).reshape({64, 32});
+    const Tensor<> grad_output({64, 32}, 1.0f);
+
+    Dropout dropout(0.25f);
+    dropout.manual_seed(99);
+    const Tensor<> output = dropout.forward(input);
+    const Tensor<> grad_input = dropout.backward(grad_output);
+
+    // every element is either dropped or scaled by 1 / (1 - p), and the gradient uses the same mask
+    size_t kept = 0;
+    for (size_t i = 0; i < 64; ++i) {
+        for (size_t j = 0; j < 32; ++j) {
+            if (output[i, j] == 0.0f) {
+                CHECK(grad_input[i, j] == 0.0f);
+            } else {
+                CHECK(output[i, j] == doctest::Approx(input[i, j] / 0.75f));
+                CHECK(grad_input[i, j] == doctest::Approx(1.0f / 0.75f));
+                ++kept;
+            }
+        }
+    }
+    CHECK(kept == doctest::Approx(0.75 * 64 * 32).epsilon(0.1));
+
+    // the same seed gives the same masks, and the next batch gets another mask
+    CHECK_FALSE(dropout.forward(input) == output);
+    dropout.manual_seed(99);
+    CHECK(dropout.forward(input) == output);
+
+    dropout.eval();
+    CHECK(dropout.forward(input) == input);
+    CHECK(dropout.backward(grad_output) == grad_output);
+}
+
+TEST_CASE("ModuleTest - Cross Entropy Loss") {
+    const Tensor<> logits = {{0.0f, 0.0f, 0.0f, 0.0f}, {2.0f, 0.0f, 0.0f, -1.0f}};
+    const Tensor<> labels = {3.0f, 0.0f};
+
+    CrossEntropyLoss loss;
+    const float value = loss.forward(logits, labels);
+
+    // the softmax of the second row is e^x / (e^2 + 2 + e^-1)
+    const float denominator = std::exp(2.0f) + 2.0f + std::exp(-1.0f);
+    CHECK(value == doctest::Approx(-(std::log(0.25f) + 2.0f - std::log(denominator)) / 2.0f));
+
+    // (softmax - one_hot) / B
+    const Tensor<> grad = loss.backward();
+    CHECK(grad[0, 0] == doctest::Approx(0.125f));
+    CHECK(grad[0, 3] == doctest::Approx(-0.375f));
+    CHECK(grad[1, 0] == doctest::Approx((std::exp(2.0f) / denominator - 1.0f) / 2.0f));
+    CHECK(grad[1, 3] == doctest::Approx(std::exp(-1.0f) / denominator / 2.0f));
+
+    // one-hot labels give the same loss
+    const Tensor<> one_hot = {{0.0f, 0.0f, 0.0f, 1.0f}, {1.0f, 0.0f, 0.0f, 0.0f}};
+    CHECK(loss.forward(logits, one_hot) == doctest::Approx(value));
+    CHECK(loss.backward() == grad);
+}
+
 } // namespace nn
\ No newline at end of file
@@ -1,7 +1,16 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest.h"
 #include "tensor.hpp"
+#include "qtensor.hpp"
+#include "serialization.hpp"
+#include "sparse_tensor.hpp"
+#include "random.hpp"
 #include "math.h"
+#include "parallel.hpp"
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <thread>
 
 TEST_CASE("TensorTest - Constructor and Destructor")
 {
@@ -277,6 +286,36 @@ TEST_CASE("TensorTest - Move Constructor")
     CHECK(test_tensor[1, 1, 1] == 8.0f);
 }
 
+TEST_CASE("TensorTest - Copy-on-write")
+{
+    Tensor<> tensor = {{1.0f, 2.0f}, {3.0f, 4.0f}};
+
+    // Mutating a copy does not affect the original tensor
+    Tensor<> copied_tensor = tensor;
+    copied_tensor[0, 0] = 10.0f;
+    CHECK(copied_tensor[0, 0] == 10.0f);
+    CHECK(tensor[0, 0] == 1.0f);
+
+    // Mutating the original tensor does not affect its copy
+    Tensor<> assigned_tensor;
+    assigned_tensor = tensor;
+    tensor[1, 1] = 40.0f;
+    CHECK(assigned_tensor[1, 1] == 4.0f);
+    CHECK(tensor[1, 1] == 40.0f);
+
+    // Mutating a transposed view keeps its strides semantics
+    Tensor<> transposed_tensor = assigned_tensor.transpose();
+    transposed_tensor[0, 1] = 30.0f;
+    CHECK(transposed_tensor[0, 1] == 30.0f);
+    CHECK(transposed_tensor[1, 0] == 2.0f);
+    CHECK(assigned_tensor[1, 0] == 3.0f);
+
+    // Scaler operations on a view do not modify the shared buffer
+    Tensor<> scaled_tensor = assigned_tensor.transpose() * 2.0f;
+    CHECK(scaled_tensor[0, 1] == 6.0f);
+    CHECK(assigned_tensor[0, 1] == 2.0f);
+}
+
 TEST_CASE("TensorTest - Certain Value Constructor")
 {
     Tensor<> tensor_1d({1}, 0.0f);
@@ -406,6 +445,62 @@ TEST_CASE("TensorTest - Indexing Operator - Normal Slicing")
     CHECK(sliced_tensor_2d_1[1, 1] == 4.0f);
 }
 
+TEST_CASE("TensorTest - Indexing Operator - Views")
+{
+    Tensor<> tensor_3d({4, 3, 5}, 0.0f);
+    for (size_t i = 0; i < 4; ++i)
+        for (size_t j = 0; j < 3; ++j)
+            for (size_t k = 0; k < 5; ++k)
+                tensor_3d[i, j, k] = static_cast<float>(i * 100 + j * 10 + k);
+
+    // trailing dimensions are taken whole
+    Tensor<> batch = tensor_3d.index({"1:3"});
+    CHECK(batch.shapes() == vector<size_t>{2, 3, 5});
+    CHECK(batch.is_contiguous());
+    CHECK(batch[0, 0, 0] == 100.0f);
+    CHECK(batch[1, 2, 4] == 224.0f);
+    CHECK(batch.sum() == doctest::Approx(30.0f * 150.0f + 2 * (15 * 10 + 3 * 10)));
+
+    // steps, integers and negative slices
+    Tensor<> strided = tensor_3d.index({"::2", 1u, "-3:"});
+    CHECK(strided.shapes() == vector<size_t>{2, 3});
+    CHECK_FALSE(strided.is_contiguous());
+    CHECK(strided[0, 0] == 12.0f);
+    CHECK(strided[1, 2] == 214.0f);
+    CHECK(strided.at(4) == 213.0f);
+
+    // ellipsis
+    Tensor<> last = tensor_3d.index({"...", "3:"});
+    CHECK(last.shapes() == vector<size_t>{4, 3, 2});
+    CHECK(last[3, 1, 1] == 314.0f);
+
+    Tensor<> middle = tensor_3d.index({1u, "...", 2u});
+    CHECK(middle.shapes() == vector<size_t>{3});
+    CHECK(middle[2] == 122.0f);
+
+    // views of views, and operations on views
+    Tensor<> nested = strided.index({":", "1:"});
+    CHECK(nested.shapes() == vector<size_t>{2, 2});
+    CHECK(nested[1, 1] == 214.0f);
+    CHECK((nested + 1.0f)[1, 0] == 214.0f);
+    CHECK(nested.clone() == nested);
+
+    // the view shares the storage, but writes are copy-on-write
+    batch[0, 0, 0] = -1.0f;
+    CHECK(batch[0, 0, 0] == -1.0f);
+    CHECK(tensor_3d[1, 0, 0] == 100.0f);
+
+    // a precompiled plan gives the same view
+    const IndexPlan plan({"::2", 1u, "-3:"});
+    CHECK(tensor_3d.index(plan) == strided);
+    CHECK(tensor_3d.index(plan) == tensor_3d.index({"::2", 1u, "-3:"}));
+
+    CHECK_THROWS_AS(tensor_3d.index({"...", ":", "..."}), std::invalid_argument);
+    CHECK_THROWS_AS(tensor_3d.index({"::0"}), std::invalid_argument);
+    CHECK_THROWS_AS(tensor_3d.index({0u, 0u, 0u, 0u}), std::invalid_argument);
+    CHECK_THROWS_AS(tensor_3d.index({4u}), std::out_of_range);
+}
+
 TEST_CASE("TensorTest - Transpose")
 {
     Tensor<> tensor_2d = {{1.0f, 2.0f}, {3.0f, 4.0f}};
@@ -650,4 +745,1674 @@ TEST_CASE("TensorTest - Matrix Multiplication")
     CHECK(matrix_multiplication_2d_1[0, 1] == 11.0f);
     CHECK(matrix_multiplication_2d_1[1, 0] == 11.0f);
     CHECK(matrix_multiplication_2d_1[1, 1] == 25.0f);
-}
\ No newline at end of file
+}
+
+TEST_CASE("TensorTest - Matrix Multiplication Engine")
+{
+    // Sizes that are not multiples of the register tiles, with K larger than one packed block
+    const size_t n = 70, m = 300, p = 45;
+
+    vector<vector<float>> a_data(n, vector<float>(m)), b_data(m, vector<float>(p));
+    for (size_t i = 0; i < n; ++i)
+        for (size_t k = 0; k < m; ++k)
+            a_data[i][k] = std::sin(static_cast<float>(i * m + k));
+    for (size_t k = 0; k < m; ++k)
+        for (size_t j = 0; j < p; ++j)
+            b_data[k][j] = std::cos(static_cast<float>(k * p + j));
+
+    const Tensor<> a(a_data), b(b_data);
+
+    auto check_result = [&](const Tensor<> &result)
+    {
+        REQUIRE(result.shapes() == vector<size_t>{n, p});
+        for (size_t i = 0; i < n; ++i)
+        {
+            for (size_t j = 0; j < p; ++j)
+            {
+                double expected = 0.0;
+                for (size_t k = 0; k < m; ++k)
+                {
+                    expected += static_cast<double>(a_data[i][k]) * b_data[k][j];
+                }
+                CHECK(result[i, j] == doctest::Approx(expected).epsilon(1e-4));
+            }
+        }
+    };
+
+    const simd::ISA default_isa = simd::active_isa();
+    const size_t default_num_threads = get_num_threads();
+
+    for (const simd::ISA isa : {simd::ISA::SCALAR, simd::ISA::AVX2, simd::ISA::AVX512})
+    {
+        if (!simd::is_supported(isa))
+        {
+            continue;
+        }
+        simd::set_isa(isa);
+
+        for (const size_t num_threads : {1, 3})
+        {
+            set_num_threads(num_threads);
+            check_result(a.matmul(b));
+        }
+    }
+
+    simd::set_isa(default_isa);
+    set_num_threads(default_num_threads);
+
+    // batched matrix multiplication
+    Tensor<> batch_a = a.reshape({2, 35, 300});
+    Tensor<> batch_result = batch_a.matmul(Tensor<>({2, 300, 45}, 1.0f));
+    CHECK(batch_result.shapes() == vector<size_t>{2, 35, 45});
+    double last_row_sum = 0.0;
+    for (size_t k = 0; k < m; ++k)
+    {
+        last_row_sum += a_data[n - 1][k];
+    }
+    CHECK(batch_result[1, 34, 44] == doctest::Approx(last_row_sum).epsilon(1e-4));
+}
+
+TEST_CASE("TensorTest - Matrix Multiplication with Transposed Operands")
+{
+    // small problems use the direct path, large ones the packed path
+    for (const vector<size_t> &size : {vector<size_t>{5, 6, 7}, vector<size_t>{70, 300, 45}})
+    {
+        const size_t n = size[0], m = size[1], p = size[2];
+
+        Tensor<> a({n, m}, 0.0f), a_t({m, n}, 0.0f), b({m, p}, 0.0f), b_t({p, m}, 0.0f);
+        for (size_t i = 0; i < n; ++i)
+        {
+            for (size_t k = 0; k < m; ++k)
+            {
+                a[i, k] = std::sin(static_cast<float>(i * m + k));
+                a_t[k, i] = a[i, k];
+            }
+        }
+        for (size_t k = 0; k < m; ++k)
+        {
+            for (size_t j = 0; j < p; ++j)
+            {
+                b[k, j] = std::cos(static_cast<float>(k * p + j));
+                b_t[j, k] = b[k, j];
+            }
+        }
+
+        // column-major views of the same matrices, sharing the buffers of a_t and b_t
+        const Tensor<> a_view = a_t.transpose();
+        const Tensor<> b_view = b_t.transpose();
+        CHECK_FALSE(a_view.is_contiguous());
+        CHECK_FALSE(b_view.is_contiguous());
+
+        const Tensor<> expected = a.matmul(b);
+
+        for (const Tensor<> &result : {a_view.matmul(b), a.matmul(b_view), a_view.matmul(b_view)})
+        {
+            REQUIRE(result.shapes() == vector<size_t>{n, p});
+            for (size_t i = 0; i < n; ++i)
+            {
+                for (size_t j = 0; j < p; ++j)
+                {
+                    CHECK(result[i, j] == doctest::Approx(expected[i, j]).epsilon(1e-4));
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("TensorTest - Batched Matrix Multiplication")
+{
+    const size_t B = 3, H = 4, n = 5, m = 6, p = 7;
+
+    Tensor<> a({B, 1, n, m}, 0.0f);
+    Tensor<> b({H, m, p}, 0.0f);
+    Tensor<> shared({m, p}, 0.0f);
+
+    for (size_t x = 0; x < B; ++x)
+        for (size_t i = 0; i < n; ++i)
+            for (size_t k = 0; k < m; ++k)
+                a[x, 0, i, k] = static_cast<float>(x + i) - static_cast<float>(k) * 0.5f;
+
+    for (size_t h = 0; h < H; ++h)
+        for (size_t k = 0; k < m; ++k)
+            for (size_t j = 0; j < p; ++j)
+                b[h, k, j] = static_cast<float>(h * k) * 0.25f - static_cast<float>(j);
+
+    for (size_t k = 0; k < m; ++k)
+        for (size_t j = 0; j < p; ++j)
+            shared[k, j] = static_cast<float>(k + 2 * j);
+
+    // [B, 1, n, m] x [H, m, p] -> [B, H, n, p]
+    Tensor<> broadcast = a.matmul(b);
+    CHECK(broadcast.shapes() == vector<size_t>{B, H, n, p});
+
+    // [B, 1, n, m] x [m, p] -> [B, 1, n, p]
+    Tensor<> with_shared = a.matmul(shared);
+    CHECK(with_shared.shapes() == vector<size_t>{B, 1, n, p});
+
+    for (size_t x = 0; x < B; ++x)
+    {
+        for (size_t h = 0; h < H; ++h)
+        {
+            for (size_t i = 0; i < n; ++i)
+            {
+                for (size_t j = 0; j < p; ++j)
+                {
+                    float expected = 0.0f, expected_shared = 0.0f;
+                    for (size_t k = 0; k < m; ++k)
+                    {
+                        expected += a[x, 0, i, k] * b[h, k, j];
+                        expected_shared += a[x, 0, i, k] * shared[k, j];
+                    }
+                    CHECK(broadcast[x, h, i, j] == doctest::Approx(expected));
+                    CHECK(with_shared[x, 0, i, j] == doctest::Approx(expected_shared));
+                }
+            }
+        }
+    }
+
+    // many small matrices, split among the threads
+    const size_t default_num_threads = get_num_threads();
+    set_num_threads(3);
+
+    Tensor<> many({500, 4, 4}, 1.0f);
+    Tensor<> identity({4, 4}, 0.0f);
+    for (size_t i = 0; i < 4; ++i)
+    {
+        identity[i, i] = 2.0f;
+    }
+    many[499, 3, 3] = 5.0f;
+
+    Tensor<> doubled = many.matmul(identity);
+    CHECK(doubled.shapes() == vector<size_t>{500, 4, 4});
+    CHECK(doubled[0, 0, 0] == 2.0f);
+    CHECK(doubled[250, 1, 2] == 2.0f);
+    CHECK(doubled[499, 3, 3] == 10.0f);
+
+    Tensor<> expanded = identity.matmul(many);
+    CHECK(expanded.shapes() == vector<size_t>{500, 4, 4});
+    CHECK(expanded[499, 3, 3] == 10.0f);
+
+    set_num_threads(default_num_threads);
+
+    // batch dimensions that cannot be broadcast
+    CHECK_THROWS_AS(Tensor<>({2, 3, 4}, 1.0f).matmul(Tensor<>({3, 4, 2}, 1.0f)), std::invalid_argument);
+}
+
+TEST_CASE("TensorTest - Broadcasting")
+{
+    Tensor<> tensor_2d = {{1.0f, 2.0f, 3.0f}, {4.0f, 5.0f, 6.0f}};
+
+    // row vector with missing leading dimension
+    Tensor<> row = {10.0f, 20.0f, 30.0f};
+    Tensor<> added = tensor_2d + row;
+    CHECK(added.ndim() == 2);
+    CHECK(added.shapes()[0] == 2);
+    CHECK(added.shapes()[1] == 3);
+    CHECK(added[0, 0] == 11.0f);
+    CHECK(added[0, 2] == 33.0f);
+    CHECK(added[1, 1] == 25.0f);
+
+    // column vector with size-1 dimension
+    Tensor<> column = Tensor<>({2.0f, 3.0f}).reshape({2, 1});
+    Tensor<> multiplied = tensor_2d * column;
+    CHECK(multiplied[0, 0] == 2.0f);
+    CHECK(multiplied[0, 2] == 6.0f);
+    CHECK(multiplied[1, 0] == 12.0f);
+    CHECK(multiplied[1, 2] == 18.0f);
+
+    // both operands are broadcast
+    Tensor<> outer = column.sub(row.reshape({1, 3}));
+    CHECK(outer.shapes()[0] == 2);
+    CHECK(outer.shapes()[1] == 3);
+    CHECK(outer[0, 0] == -8.0f);
+    CHECK(outer[1, 2] == -27.0f);
+
+    // broadcast operand given as a transposed view
+    Tensor<> bias = Tensor<>({1.0f, 2.0f, 4.0f}).reshape({3, 1});
+    Tensor<> divided = tensor_2d.div(bias.transpose());
+    CHECK(divided[1, 0] == 4.0f);
+    CHECK(divided[1, 1] == 2.5f);
+    CHECK(divided[1, 2] == 1.5f);
+
+    // per-channel operand of a 4D tensor
+    Tensor<> tensor_4d({2, 3, 2, 2}, 1.0f);
+    Tensor<> channel_scale = Tensor<>({1.0f, 2.0f, 3.0f}).reshape({3, 1, 1});
+    Tensor<> scaled = tensor_4d * channel_scale;
+    CHECK(scaled.shapes() == vector<size_t>{2, 3, 2, 2});
+    CHECK(scaled[0, 0, 1, 1] == 1.0f);
+    CHECK(scaled[1, 1, 0, 1] == 2.0f);
+    CHECK(scaled[1, 2, 1, 0] == 3.0f);
+
+    // incompatible shapes
+    Tensor<> incompatible = {1.0f, 2.0f};
+    CHECK_THROWS(tensor_2d + incompatible);
+}
+
+TEST_CASE("TensorTest - Element-wise Operations on Strided Tensors")
+{
+    Tensor<> tensor_3d = {{{1.0f, 2.0f, 3.0f}, {4.0f, 5.0f, 6.0f}}, {{7.0f, 8.0f, 9.0f}, {10.0f, 11.0f, 12.0f}}}; // 2 x 2 x 3
+    Tensor<> permuted = tensor_3d.permute(2, 0, 1);                                                               // 3 x 2 x 2
+    CHECK_FALSE(permuted.is_contiguous());
+    CHECK(tensor_3d.is_contiguous());
+
+    Tensor<> contiguous = permuted.clone();
+    CHECK(contiguous.is_contiguous());
+    CHECK(contiguous == permuted);
+    CHECK(contiguous[2, 1, 0] == 9.0f);
+
+    // strided operand mixed with a contiguous operand
+    Tensor<> sum = permuted + contiguous;
+    CHECK(sum.shapes() == vector<size_t>{3, 2, 2});
+    CHECK(sum[0, 0, 1] == 8.0f);
+    CHECK(sum[2, 1, 1] == 24.0f);
+
+    // two strided operands
+    Tensor<> product = permuted * permuted;
+    CHECK(product[1, 1, 0] == 64.0f);
+
+    // unary operations on a strided tensor
+    Tensor<> negated = permuted * -1.0f;
+    CHECK(negated.abs() == contiguous);
+    CHECK(permuted.map([](float x)
+                       { return x + 1.0f; })[1, 0, 1] == 6.0f);
+
+    Tensor<int> equal_tensor = permuted.equal(contiguous);
+    CHECK(equal_tensor.sum() == 12);
+    CHECK_FALSE(permuted == negated);
+}
+
+TEST_CASE("TensorTest - Lazy Expressions")
+{
+    Tensor<> a = {{1.0f, 2.0f, 3.0f}, {4.0f, 5.0f, 6.0f}};
+    Tensor<> b = {{6.0f, 5.0f, 4.0f}, {3.0f, 2.0f, 1.0f}};
+    Tensor<> row = {10.0f, 20.0f, 30.0f};
+
+    // a fused chain gives the same result as the eager operators
+    Tensor<> fused = lazy(a) * 2.0f + b * lazy(a) - 1.0f;
+    CHECK(fused == a * 2.0f + b * a - 1.0f);
+
+    Tensor<> unary = sqrt(abs(-lazy(a))) / 2.0f;
+    CHECK(unary == a.sqrt() / 2.0f);
+
+    // broadcast operands
+    Tensor<> broadcast = lazy(a) + row;
+    CHECK(broadcast.shapes() == vector<size_t>{2, 3});
+    CHECK(broadcast == a + row);
+
+    // strided operands
+    Tensor<> transposed = a.transpose();
+    Tensor<> strided = lazy(transposed) * transposed;
+    CHECK(strided.shapes() == vector<size_t>{3, 2});
+    CHECK(strided == transposed * transposed);
+
+    // fused reduction
+    CHECK(((lazy(a) - b) * (lazy(a) - b)).sum() == doctest::Approx(70.0f));
+    CHECK((lazy(transposed) + 1.0f).sum() == doctest::Approx(27.0f));
+
+    // the result is written into the existing storage when the destination is not shared
+    Tensor<> m({2, 3}, 1.0f);
+    const float *storage = &m[0, 0];
+    m = lazy(m) * 0.5f + lazy(a) * 0.5f;
+    CHECK(&m[0, 0] == storage);
+    CHECK(m[1, 2] == 3.5f);
+
+    // a destination shared with another tensor is not overwritten (copy-on-write)
+    Tensor<> shared = m;
+    m = lazy(m) + 1.0f;
+    CHECK(m[1, 2] == 4.5f);
+    CHECK(shared[1, 2] == 3.5f);
+
+    // the destination can be read by the expression when its shape changes
+    Tensor<> r = row;
+    r = lazy(r) + a;
+    CHECK(r.shapes() == vector<size_t>{2, 3});
+    CHECK(r[1, 0] == 14.0f);
+
+    // large expressions are evaluated in parallel
+    Tensor<> x({512, 300}, 2.0f), y({512, 300}, 3.0f);
+    Tensor<> z = lazy(x) * y + 1.0f;
+    CHECK(z.sum() == doctest::Approx(7.0f * 512 * 300));
+
+    CHECK_THROWS_AS(Tensor<>(lazy(a) + Tensor<>({1.0f, 2.0f})), std::runtime_error);
+}
+
+TEST_CASE("TensorTest - In-place Operations")
+{
+    Tensor<> a = {{1.0f, 2.0f, 3.0f}, {4.0f, 5.0f, 6.0f}};
+    Tensor<> b = {{6.0f, 5.0f, 4.0f}, {3.0f, 2.0f, 1.0f}};
+    Tensor<> row = {10.0f, 20.0f, 30.0f};
+
+    const float *storage = &a[0, 0];
+
+    a.add_(b);
+    CHECK(a == Tensor<>({{7.0f, 7.0f, 7.0f}, {7.0f, 7.0f, 7.0f}}));
+    a.sub_(b, 2.0f);
+    CHECK(a == Tensor<>({{-5.0f, -3.0f, -1.0f}, {1.0f, 3.0f, 5.0f}}));
+    a.add_(row).mul_(2.0f).div_(b);
+    CHECK(a[0, 0] == doctest::Approx(10.0f / 6.0f));
+    CHECK(a[1, 2] == 70.0f);
+    a.clamp_(0.0f, 20.0f);
+    CHECK(a[1, 2] == 20.0f);
+    CHECK(&a[0, 0] == storage);
+
+    // compound operators work in place and return the tensor itself
+    Tensor<> c = b;
+    (c += 1.0f) *= 2.0f;
+    c -= row;
+    c /= 2.0f;
+    CHECK(c == (b + 1.0f) - row / 2.0f);
+    CHECK(b[0, 0] == 6.0f); // the copy c shared the storage of b (copy-on-write)
+
+    // a tensor cannot be broadcast to a bigger shape in place
+    CHECK_THROWS_AS(row += b, std::runtime_error);
+    CHECK_THROWS_AS(a.clamp_(1.0f, 0.0f), std::invalid_argument);
+
+    // strided destination and strided source
+    Tensor<> t = Tensor<>({{1.0f, 2.0f}, {3.0f, 4.0f}, {5.0f, 6.0f}}).transpose(); // 2 x 3, non-contiguous and not shared
+    CHECK_FALSE(t.is_contiguous());
+    t.add_(Tensor<>({{1.0f, 1.0f}, {2.0f, 2.0f}, {3.0f, 3.0f}}).transpose());
+    CHECK(t == Tensor<>({{2.0f, 5.0f, 8.0f}, {3.0f, 6.0f, 9.0f}}));
+
+    // views are copied before they are written (copy-on-write), the original tensor is not modified
+    Tensor<> base = {{1.0f, 2.0f}, {3.0f, 4.0f}};
+    Tensor<> view = base.index({":", 1u});
+    view.mul_(10.0f);
+    CHECK(view == Tensor<>({20.0f, 40.0f}));
+    CHECK(base[0, 1] == 2.0f);
+
+    // copy_ broadcasts the source, fill_ and zero_ overwrite every element
+    Tensor<> d({2, 3}, 0.0f);
+    d.copy_(row);
+    CHECK(d[1, 2] == 30.0f);
+    d.fill_(4.0f);
+    CHECK(d.sum() == 24.0f);
+    Tensor<> shared = d;
+    d.zero_();
+    CHECK(d.sum() == 0.0f);
+    CHECK(shared.sum() == 24.0f);
+
+    Tensor<int> e = {{-3, 7}, {2, 9}};
+    e.clamp_(0, 5).add_(Tensor<int>({1, 2}));
+    CHECK(e == Tensor<int>({{1, 7}, {3, 7}}));
+}
+
+TEST_CASE("TensorTest - Storage and Allocators")
+{
+    auto is_aligned = [](const float *ptr)
+    { return reinterpret_cast<uintptr_t>(ptr) % memory::ALIGNMENT == 0; };
+
+    // every storage is 64-byte aligned, whatever the constructor
+    Tensor<> a = {{1.0f, 2.0f, 3.0f}, {4.0f, 5.0f, 6.0f}};
+    Tensor<> b({3, 7}, 1.0f);
+    Tensor<> c = a.transpose() * 2.0f;
+    CHECK(is_aligned(&a[0, 0]));
+    CHECK(is_aligned(&b[0, 0]));
+    CHECK(is_aligned(&c[0, 0]));
+
+    Tensor<> e = Tensor<>::empty({4, 5});
+    CHECK(e.shapes() == vector<size_t>{4, 5});
+    CHECK(e.is_contiguous());
+    e.fill_(2.0f);
+    CHECK(e.sum() == 40.0f);
+
+    CHECK_THROWS_AS(Tensor<>({{1.0f, 2.0f}, {3.0f}}), std::invalid_argument);
+
+    // the pool reuses the freed blocks of the same size class
+    memory::PoolAllocator pool;
+    void *block = pool.allocate(1000);
+    pool.deallocate(block, 1000);
+    CHECK(pool.allocate(900) == block);
+    pool.deallocate(block, 900);
+
+    // tensors created under a guard are allocated from its allocator
+    memory::ArenaAllocator arena(1 << 16);
+    memory::Allocator *previous = memory::get_allocator();
+    {
+        memory::AllocatorGuard guard(&arena);
+        CHECK(memory::get_allocator() == &arena);
+
+        Tensor<> x({64, 64}, 1.0f); // 16 KB
+        Tensor<> y = x + x;
+        CHECK(y[63, 63] == 2.0f);
+        CHECK(arena.capacity() == (1 << 16));
+    }
+    CHECK(memory::get_allocator() == previous);
+    arena.reset();
+
+    memory::MmapAllocator mmap_allocator;
+    memory::set_allocator(&mmap_allocator);
+    Tensor<> big({1024, 1024}, 3.0f); // 4 MB, backed by huge pages when available
+    memory::set_allocator(nullptr);
+    CHECK(is_aligned(&big[0, 0]));
+    CHECK(big.sum() == doctest::Approx(3.0f * 1024 * 1024));
+
+    const bool huge_pages = memory::huge_pages_enabled();
+    memory::set_huge_pages(false);
+    CHECK_FALSE(memory::huge_pages_enabled());
+    Tensor<> large({1024, 1024}, 1.0f);
+    CHECK(is_aligned(&large[0, 0]));
+    memory::set_huge_pages(huge_pages);
+}
+
+TEST_CASE("TensorTest - Caching Allocator")
+{
+    memory::CachingAllocator *cache = memory::caching_allocator();
+    CHECK(memory::get_allocator() == cache);
+
+    CHECK(memory::CachingAllocator::round_size(1) == 64);
+    CHECK(memory::CachingAllocator::round_size(1000) == 1024);
+    CHECK(memory::CachingAllocator::round_size(1025) == 1280);
+    CHECK(memory::CachingAllocator::round_size(3000000) % 64 == 0);
+
+    auto step = []()
+    {
+        Tensor<> x({32, 48}, 1.0f), w({48, 16}, 0.5f);
+        Tensor<> y = x.matmul(w) + 1.0f;
+        y *= 2.0f;
+        return y.sum();
+    };
+
+    // the first iteration fills the cache, the next ones only reuse the cached blocks
+    const float expected = step();
+    cache->reset_stats();
+    for (int i = 0; i < 5; ++i)
+    {
+        CHECK(step() == expected);
+    }
+
+    const memory::CacheStats stats = cache->stats();
+    CHECK(stats.allocations > 0);
+    CHECK(stats.misses == 0);
+    CHECK(stats.hits == stats.allocations);
+    CHECK(stats.bytes_cached > 0);
+
+    // blocks freed by other threads are reused as well
+    std::thread([&]()
+                { CHECK(step() == expected); })
+        .join();
+
+    Tensor<> kept({100, 100}, 1.0f);
+    const size_t in_use = cache->stats().bytes_in_use;
+    CHECK(in_use >= 100 * 100 * sizeof(float));
+
+    cache->empty_cache();
+    CHECK(cache->stats().bytes_cached == 0);
+    CHECK(cache->stats().bytes_in_use == in_use);
+    CHECK(kept.sum() == 10000.0f);
+}
+
+TEST_CASE("TensorTest - Inline Shape Storage")
+{
+    DimVector dims = {2, 3};
+    dims.push_back(4);
+    dims.insert(dims.begin(), 5);
+    CHECK(dims == vector<size_t>{5, 2, 3, 4});
+    dims.erase(dims.begin() + 1);
+    dims.resize(5, 1);
+    CHECK(dims == DimVector{5, 3, 4, 1, 1});
+
+    // the shape keeps the interface of a vector<size_t>
+    Tensor<> a({2, 3, 4}, 1.0f);
+    const vector<size_t> shape = a.shapes();
+    CHECK(shape == vector<size_t>{2, 3, 4});
+    CHECK(a.shapes() == shape);
+    CHECK(a.shapes()[2] == 4);
+    CHECK(Tensor<>(a.shapes(), 0.0f).shapes() == shape);
+    CHECK(a.reshape(vector<size_t>{6, 4}).shapes() == vector<size_t>{6, 4});
+
+    // up to MAX_DIMS dimensions
+    Tensor<> b(vector<size_t>(DimVector::MAX_DIMS, 2), 1.0f);
+    CHECK(b.sum() == 256.0f);
+    CHECK((b + b.transpose()).ndim() == DimVector::MAX_DIMS);
+    CHECK_THROWS_AS(Tensor<>(vector<size_t>(DimVector::MAX_DIMS + 1, 2), 1.0f), std::invalid_argument);
+}
+
+TEST_CASE("TensorTest - Axis Reductions")
+{
+    // (2, 3, 4, 5) tensor of 0, 1, ..., 119
+    Tensor<> x = Tensor<>::arange(0, 119).reshape({2, 3, 4, 5});
+
+    // per-channel sum, as for the bias gradient of Conv2d
+    Tensor<> channel_sum = x.sum({0, 2, 3});
+    CHECK(channel_sum.shapes() == vector<size_t>{3});
+    for (size_t c = 0; c < 3; ++c)
+    {
+        float expected = 0.0f;
+        for (size_t n = 0; n < 2; ++n)
+            for (size_t h = 0; h < 4; ++h)
+                for (size_t w = 0; w < 5; ++w)
+                    expected += x[n, c, h, w];
+        CHECK(channel_sum[c] == expected);
+    }
+
+    // keepdim, negative dimensions, outer and inner dimensions
+    CHECK(x.sum({0, -2, -1}, true).shapes() == vector<size_t>{1, 3, 1, 1});
+    CHECK(x.sum({0, -2, -1}, true).reshape({3}) == channel_sum);
+
+    Tensor<> outer_sum = x.sum(0);
+    CHECK(outer_sum.shapes() == vector<size_t>{3, 4, 5});
+    CHECK(outer_sum[2, 3, 4] == 59.0f + 119.0f);
+
+    Tensor<> middle_sum = x.sum(2, true);
+    CHECK(middle_sum.shapes() == vector<size_t>{2, 3, 1, 5});
+    CHECK(middle_sum[1, 2, 0, 1] == x[1, 2, 0, 1] + x[1, 2, 1, 1] + x[1, 2, 2, 1] + x[1, 2, 3, 1]);
+
+    Tensor<> total = x.sum(vector<int64_t>{});
+    CHECK(total.shapes() == vector<size_t>{1});
+    CHECK(total[0] == x.sum());
+
+    // reductions of a permuted view are the same as of a contiguous copy
+    Tensor<> permuted = x.permute(3, 1, 0, 2);
+    Tensor<> permuted_copy = permuted.clone();
+    CHECK(permuted.sum({1, 3}) == permuted_copy.sum({1, 3}));
+    CHECK(permuted.max(2) == permuted_copy.max(2));
+    CHECK(permuted.argmin(0, true) == permuted_copy.argmin(0, true));
+
+    // mean, max, min, argmax, argmin
+    CHECK(x.mean({0, 2, 3}) == channel_sum / 40.0f);
+    CHECK(x.max({1, 2})[1, 4] == 119.0f);
+    CHECK(x.min(-1)[1, 2, 3] == 115.0f);
+
+    Tensor<> scores = {{0.1f, 0.7f, 0.2f}, {0.5f, 0.1f, 0.5f}, {-1.0f, -3.0f, -2.0f}};
+    CHECK(scores.argmax(1) == Tensor<size_t>({1, 0, 0}));
+    CHECK(scores.argmax(0) == Tensor<size_t>({1, 0, 1}));
+    CHECK(scores.argmin(-1, true).shapes() == vector<size_t>{3, 1});
+    CHECK(scores.argmin(-1) == Tensor<size_t>({0, 1, 1}));
+    CHECK(scores.argmax(1) == scores.argmax());
+
+    // variance, unbiased by default
+    Tensor<> samples = {{1.0f, 2.0f, 3.0f, 4.0f}, {2.0f, 2.0f, 2.0f, 2.0f}};
+    CHECK(samples.var(1) == Tensor<>({5.0f / 3.0f, 0.0f}));
+    CHECK(samples.var(1, false) == Tensor<>({1.25f, 0.0f}));
+    CHECK(samples.var(0, false, true) == Tensor<>({{0.25f, 0.0f, 0.25f, 1.0f}}));
+
+    // large enough to run in parallel, with several blocks of columns
+    Tensor<> wide = Tensor<>::arange(0, 64 * 3000 - 1).reshape({64, 3000}).map([](float v) { return std::fmod(v, 7.0f); });
+    Tensor<> column_sum = wide.sum(0);
+    Tensor<> row_max = wide.max(1);
+    Tensor<size_t> column_argmax = wide.argmax(0);
+    for (size_t j = 0; j < 3000; j += 499)
+    {
+        float expected = 0.0f;
+        size_t expected_argmax = 0;
+        for (size_t i = 0; i < 64; ++i)
+        {
+            expected += wide[i, j];
+            if (wide[i, j] > wide[expected_argmax, j])
+            {
+                expected_argmax = i;
+            }
+        }
+        CHECK(column_sum[j] == expected);
+        CHECK(column_argmax[j] == expected_argmax);
+    }
+    CHECK(row_max == Tensor<>({64}, 6.0f));
+
+    CHECK_THROWS_AS(x.sum(4), std::out_of_range);
+    CHECK_THROWS_AS(x.sum({1, -3}), std::invalid_argument);
+    CHECK_THROWS_AS(Tensor<>({0, 3}, 0.0f).max(0), std::runtime_error);
+    CHECK(Tensor<>({0, 3}, 0.0f).sum(0) == Tensor<>({3}, 0.0f));
+
+    // a NaN is skipped by argmax and argmin (unless it comes first), on every instruction set
+    Tensor<> with_nan({2, 32}, 0.0f);
+    with_nan[0, 16] = std::nanf("");
+    with_nan[0, 20] = 1.0f;
+    with_nan[1, 0] = std::nanf("");
+    with_nan[1, 8] = -1.0f;
+    Tensor<> single_nan({1, 32}, 0.0f);
+    single_nan[0, 16] = std::nanf("");
+
+    const simd::ISA default_isa = simd::active_isa();
+    for (const simd::ISA isa : {simd::ISA::SCALAR, simd::ISA::AVX2, simd::ISA::AVX512})
+    {
+        if (!simd::is_supported(isa))
+        {
+            continue;
+        }
+        simd::set_isa(isa);
+
+        CHECK(with_nan.argmax(1) == Tensor<size_t>({20, 0}));
+        CHECK(with_nan.argmin(1) == Tensor<size_t>({0, 0}));
+        CHECK(single_nan.argmax() == Tensor<size_t>({0}));
+        CHECK(single_nan.argmax(1) == Tensor<size_t>({0}));
+        CHECK(single_nan.argmin(-1) == Tensor<size_t>({0}));
+    }
+    simd::set_isa(default_isa);
+}
+
+TEST_CASE("TensorTest - Deterministic Summation")
+{
+    // 1M elements, i.e. many blocks, whose exact sum is known
+    const size_t n = 1 << 20;
+    Tensor<> x = Tensor<>::arange(0, n - 1).map([](float v) { return 0.1f + static_cast<float>(static_cast<size_t>(v) % 1000) * 1e-3f; });
+
+    double exact = 0.0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        exact += static_cast<double>(x[i]);
+    }
+
+    const size_t default_num_threads = get_num_threads();
+
+    set_num_threads(1);
+    const float pairwise = x.sum();
+    const float kahan = x.sum(Summation::KAHAN);
+    const float fused = (lazy(x) * 2.0f).sum();
+    const float strided = x.reshape({1024, 1024}).transpose().sum();
+
+    // bitwise identical whatever the number of threads
+    for (size_t num_threads : {2, 3, 8})
+    {
+        set_num_threads(num_threads);
+        CHECK(x.sum() == pairwise);
+        CHECK(x.sum(Summation::KAHAN) == kahan);
+        CHECK((lazy(x) * 2.0f).sum() == fused);
+        CHECK(x.reshape({1024, 1024}).transpose().sum() == strided);
+        CHECK(x.sum(vector<int64_t>{})[0] == pairwise);
+        CHECK(x.reshape({64, n / 64}).sum(1).sum() == x.reshape({64, n / 64}).sum(1).sum());
+    }
+    set_num_threads(default_num_threads);
+
+    // a left-to-right float sum of 1M times 0.1 drifts by 1%, the blocked sums do not
+    Tensor<> tenths({n}, 0.1f);
+    float serial = 0.0f;
+    for (size_t i = 0; i < n; ++i)
+    {
+        serial += tenths[i];
+    }
+    const double exact_tenths = static_cast<double>(0.1f) * n;
+    CHECK(std::abs(serial - exact_tenths) / exact_tenths > 1e-3);
+    CHECK(std::abs(tenths.sum() - exact_tenths) / exact_tenths < 1e-5);
+    CHECK(std::abs(tenths.sum(Summation::KAHAN) - exact_tenths) / exact_tenths < 1e-7);
+
+    CHECK(std::abs(pairwise - exact) / exact < 1e-6);
+    CHECK(std::abs(kahan - exact) / exact < 1e-7);
+    CHECK(std::abs(fused - 2.0 * exact) / exact < 1e-6);
+
+    // compensation recovers the small terms lost next to a large one
+    Tensor<> skewed({100000}, 1e-4f);
+    skewed[0] = 1e4f;
+    CHECK(skewed.sum(Summation::KAHAN) == doctest::Approx(1e4f + 10.0f - 1e-4f).epsilon(1e-7));
+    CHECK((lazy(skewed) + 0.0f).sum(Summation::KAHAN) == doctest::Approx(1e4f + 10.0f - 1e-4f).epsilon(1e-7));
+
+    // also along the strided rows of a view, which are summed like contiguous ones
+    Tensor<> skewed_pairs({100000, 2}, 1e-4f);
+    skewed_pairs[0, 0] = 1e4f;
+    skewed_pairs[0, 1] = 1e4f;
+    const Tensor<> skewed_rows = skewed_pairs.transpose();
+    CHECK(skewed_rows.sum(Summation::KAHAN) == doctest::Approx(2.0f * (1e4f + 10.0f - 1e-4f)).epsilon(1e-7));
+    CHECK(skewed_rows.sum(Summation::KAHAN) == skewed_rows.clone().sum(Summation::KAHAN));
+
+    // integer tensors are summed exactly
+    CHECK(Tensor<int>({3, 100000}, 7).sum() == 2100000);
+}
+
+TEST_CASE("TensorTest - Element-wise Callables")
+{
+    Tensor<> x = {{-2.0f, -1.0f, 0.0f}, {1.0f, 2.0f, 3.0f}};
+
+    // capturing lambdas
+    const float slope = 0.5f;
+    Tensor<> leaky = x.map([slope](float v) { return v > 0.0f ? v : slope * v; });
+    CHECK(leaky == Tensor<>({{-1.0f, -0.5f, 0.0f}, {1.0f, 2.0f, 3.0f}}));
+
+    const float threshold = 1.5f;
+    CHECK(x.filter([threshold](float v) { return v > threshold; }) == Tensor<>({{0.0f, 0.0f, 0.0f}, {0.0f, 2.0f, 3.0f}}));
+
+    // the result takes the return type of the callable
+    Tensor<int> signs = x.map([](float v) { return v > 0.0f ? 1 : (v < 0.0f ? -1 : 0); });
+    CHECK(signs == Tensor<int>({{-1, -1, 0}, {1, 1, 1}}));
+
+    // function objects and overloaded function names
+    CHECK(x.map(std::negate<float>()) == x * -1.0f);
+    CHECK(x.abs().map(std::sqrt) == x.abs().sqrt());
+
+    // views are read through their strides
+    Tensor<> transposed = x.transpose();
+    CHECK(transposed.map([](float v) { return v * 10.0f; }) == (x * 10.0f).transpose());
+    CHECK(x.index({":", "1:"}).map([](float v) { return v + 1.0f; }) == Tensor<>({{0.0f, 1.0f}, {3.0f, 4.0f}}));
+
+    // in place, on a tensor and on a view (which is copied on write, like the other in-place operations)
+    Tensor<> y = x;
+    y.map_([](float v) { return v * v; });
+    CHECK(y == x * x);
+    CHECK(x[0, 0] == -2.0f);
+
+    Tensor<> column_view = x.transpose();
+    column_view.map_([](float v) { return v - 1.0f; });
+    CHECK(column_view == (x - 1.0f).transpose());
+
+    // zip_with broadcasts
+    Tensor<> row = {1.0f, -1.0f, 2.0f};
+    CHECK(x.zip_with(row, [](float a, float b) { return std::max(a, b); }) == Tensor<>({{1.0f, -1.0f, 2.0f}, {1.0f, 2.0f, 3.0f}}));
+    Tensor<int> greater = x.zip_with(row, [](float a, float b) { return static_cast<int>(a > b); });
+    CHECK(greater == Tensor<int>({{0, 0, 0}, {0, 1, 1}}));
+    CHECK_THROWS(x.zip_with(Tensor<>({1.0f, 2.0f}), std::plus<float>()));
+
+    // large tensors are split across threads, with the same result as on one thread
+    const size_t default_num_threads = get_num_threads();
+    Tensor<> big = Tensor<>::arange(0, (1 << 18) - 1).reshape({512, 512});
+
+    set_num_threads(1);
+    const Tensor<> expected_map = big.map([](float v) { return std::fmod(v, 3.0f); });
+    const Tensor<> expected_strided = big.transpose().map([](float v) { return std::fmod(v, 3.0f); });
+    const Tensor<> expected_zip = big.zip_with(big.transpose(), [](float a, float b) { return a - b; });
+
+    set_num_threads(4);
+    CHECK(big.map([](float v) { return std::fmod(v, 3.0f); }) == expected_map);
+    CHECK(big.transpose().map([](float v) { return std::fmod(v, 3.0f); }) == expected_strided);
+    CHECK(big.zip_with(big.transpose(), [](float a, float b) { return a - b; }) == expected_zip);
+
+    Tensor<> big_view = big.transpose();
+    big_view.map_([](float v) { return std::fmod(v, 3.0f); });
+    CHECK(big_view == expected_strided);
+
+    set_num_threads(default_num_threads);
+}
+
+TEST_CASE("TensorTest - Half Precision Types")
+{
+    // bf16: round to nearest even, subnormals flushed to signed zero, overflow to infinity
+    CHECK(bf16(1.0f).bits == 0x3f80);
+    CHECK(static_cast<float>(bf16(1.00390625f)) == 1.0f);      // halfway, ties to the even 1.0
+    CHECK(static_cast<float>(bf16(1.01171875f)) == 1.015625f); // halfway, ties to the even 1.015625
+    CHECK(bf16(1e-39f).bits == 0x0000);
+    CHECK(bf16(-1e-39f).bits == 0x8000);
+    CHECK(std::isinf(static_cast<float>(bf16(3.4e38f))));
+    CHECK(std::isnan(static_cast<float>(bf16(NAN))));
+
+    // fp16: round to nearest even, subnormals, overflow to infinity
+    CHECK(fp16(1.0f).bits == 0x3c00);
+    CHECK(fp16(1.0f + std::ldexp(1.0f, -11)).bits == 0x3c00);
+    CHECK(fp16(1.0f + 3 * std::ldexp(1.0f, -11)).bits == 0x3c02);
+    CHECK(fp16(65504.0f).bits == 0x7bff);
+    CHECK(fp16(65520.0f).bits == 0x7c00);
+    CHECK(fp16(std::ldexp(1.0f, -24)).bits == 0x0001);
+    CHECK(fp16(std::ldexp(1.0f, -25)).bits == 0x0000);
+    CHECK(fp16(3 * std::ldexp(1.0f, -25)).bits == 0x0002);
+    CHECK(static_cast<float>(fp16::from_bits(0x03ff)) == 1023 * std::ldexp(1.0f, -24));
+    CHECK(std::isnan(static_cast<float>(fp16(NAN))));
+
+    // Every fp16 value (and every normal bf16 value) goes through float and back unchanged, with the vectorized conversions too
+    Tensor<uint16_t> all_bits = Tensor<uint16_t>::empty({1 << 16});
+    for (size_t i = 0; i < all_bits.size(); ++i)
+    {
+        all_bits[i] = static_cast<uint16_t>(i);
+    }
+
+    const Tensor<fp16> all_fp16 = all_bits.map([](const uint16_t &bits)
+                                               { return fp16::from_bits(bits); });
+    const Tensor<fp16> fp16_round_trip = all_fp16.dtype<float>().dtype<fp16>();
+    const Tensor<bf16> all_bf16 = all_bits.map([](const uint16_t &bits)
+                                               { return bf16::from_bits(bits); });
+    const Tensor<bf16> bf16_round_trip = all_bf16.dtype<float>().dtype<bf16>();
+
+    size_t fp16_mismatches = 0, bf16_mismatches = 0;
+    for (size_t i = 0; i < all_bits.size(); ++i)
+    {
+        const bool fp16_nan = (i & 0x7c00) == 0x7c00 && (i & 0x03ff) != 0;
+        const bool bf16_nan_or_subnormal = (i & 0x7f80) == 0x7f80 ? (i & 0x007f) != 0 : (i & 0x7f80) == 0;
+        fp16_mismatches += !fp16_nan && fp16_round_trip[i].bits != i;
+        bf16_mismatches += !bf16_nan_or_subnormal && bf16_round_trip[i].bits != i;
+    }
+    CHECK(fp16_mismatches == 0);
+    CHECK(bf16_mismatches == 0);
+
+    // Element-wise operations are computed in float and rounded once, on contiguous tensors, views and broadcasts
+    const Tensor<> a = (Tensor<>::arange(0, 1002) - 501.0f) * 0.37f;
+    const Tensor<> b = (Tensor<>::arange(0, 1002) * 0.11f + 1.0f).reshape({1, 1003});
+    const Tensor<bf16> a16 = a.dtype<bf16>(), b16 = b.dtype<bf16>();
+
+    const Tensor<bf16> sum16 = a16 + b16.reshape({1003});
+    const Tensor<bf16> quotient16 = a16 / 3.0f;
+    const Tensor<bf16> scaled16 = a16 - 2.0f;
+    size_t elementwise_mismatches = 0;
+    for (size_t i = 0; i < a.size(); ++i)
+    {
+        elementwise_mismatches += sum16[i].bits != bf16(static_cast<float>(a16[i]) + static_cast<float>(b16[0, i])).bits;
+        elementwise_mismatches += quotient16[i].bits != bf16(static_cast<float>(a16[i]) / 3.0f).bits;
+        elementwise_mismatches += scaled16[i].bits != bf16(static_cast<float>(a16[i]) - 2.0f).bits;
+    }
+    CHECK(elementwise_mismatches == 0);
+
+    Tensor<fp16> matrix = Tensor<>::arange(0, 11).reshape({3, 4}).dtype<fp16>();
+    const Tensor<fp16> column = Tensor<>({1.0f, 2.0f, 3.0f}).reshape({3, 1}).dtype<fp16>();
+    matrix += column;
+    CHECK((matrix.transpose() * 0.5f).dtype<float>() == (Tensor<>::arange(0, 11).reshape({3, 4}) + Tensor<>({1.0f, 2.0f, 3.0f}).reshape({3, 1})).transpose() * 0.5f);
+    CHECK(matrix.transpose().dtype<int>() == Tensor<int>({{1, 6, 11}, {2, 7, 12}, {3, 8, 13}, {4, 9, 14}}));
+
+    // Reductions accumulate in float: a bf16 accumulator would stop growing at 32
+    const Tensor<bf16> tenths = Tensor<bf16>({1 << 20}, 0.1f);
+    const float exact_sum = static_cast<float>(bf16(0.1f)) * (1 << 20);
+    CHECK(std::abs(static_cast<float>(tenths.sum()) - exact_sum) <= exact_sum * 0.004f);
+    CHECK(std::abs(static_cast<float>(tenths.reshape({1024, 1024}).mean(0)[0]) - static_cast<float>(bf16(0.1f))) < 1e-6f);
+    CHECK(std::abs(static_cast<float>(a16.var(0)[0]) - static_cast<float>(a16.dtype<float>().var(0)[0])) <= 0.004f * static_cast<float>(a16.dtype<float>().var(0)[0]));
+    CHECK(a16[a16.argmax(0)[0]] == a16.max(0)[0]);
+
+    // The matrix multiplication accumulates in float: the result is the float product of the inputs, rounded once
+    const Tensor<> x = Tensor<>::arange(0, 2 * 64 * 96 - 1).reshape({2, 64, 96}).map([](const float &v)
+                                                                                      { return std::sin(v); });
+    const Tensor<> w = Tensor<>::arange(0, 80 * 96 - 1).reshape({80, 96}).map([](const float &v)
+                                                                              { return std::cos(v); });
+
+    const Tensor<bf16> x_bf16 = x.dtype<bf16>(), w_bf16 = w.dtype<bf16>();
+    CHECK(x_bf16.matmul(w_bf16.transpose()) == x_bf16.dtype<float>().matmul(w_bf16.dtype<float>().transpose()).dtype<bf16>());
+
+    const Tensor<fp16> x_fp16 = x.dtype<fp16>(), w_fp16 = w.dtype<fp16>();
+    const Tensor<> product = x_fp16.matmul(w_fp16.transpose()).dtype<float>();
+    CHECK(product == x_fp16.dtype<float>().matmul(w_fp16.dtype<float>().transpose()).dtype<fp16>().dtype<float>());
+    CHECK((product - x.matmul(w.transpose())).abs().max(vector<int64_t>{})[0] < 0.05f);
+
+    const Tensor<bf16> small = Tensor<>({{1.0f, 2.0f}, {3.0f, 4.0f}}).dtype<bf16>();
+    CHECK(small.matmul(small).dtype<float>() == Tensor<>({{7.0f, 10.0f}, {15.0f, 22.0f}}));
+}
+
+TEST_CASE("TensorTest - Contiguous Copies")
+{
+    const size_t default_num_threads = get_num_threads();
+
+    // sizes that are not multiples of the tiles of the copy engine
+    const Tensor<> x = Tensor<>::arange(0, 3 * 67 * 131 - 1).reshape({3, 67, 131});
+
+    for (const size_t num_threads : {1, 4})
+    {
+        set_num_threads(num_threads);
+
+        // a contiguous tensor is returned as is
+        CHECK(x.contiguous() == x);
+        CHECK(x.contiguous().is_contiguous());
+
+        const Tensor<> t = x.transpose(1, 2);
+        const Tensor<> t_copy = t.contiguous();
+        CHECK_FALSE(t.is_contiguous());
+        CHECK(t_copy.is_contiguous());
+        CHECK(t_copy.shapes() == DimVector{3, 131, 67});
+
+        bool equal = true;
+        for (size_t b = 0; b < 3; ++b)
+            for (size_t i = 0; i < 131; ++i)
+                for (size_t j = 0; j < 67; ++j)
+                    equal = equal && t_copy[b, i, j] == x[b, j, i];
+        CHECK(equal);
+
+        // every permutation of a 4D tensor, compared with the element-wise engine
+        const Tensor<> y = Tensor<>::arange(0, 5 * 3 * 70 * 9 - 1).reshape({5, 3, 70, 9});
+        const auto identity = [](const float &v)
+        { return v; };
+
+        CHECK(y.permute(0, 1, 3, 2).clone() == y.permute(0, 1, 3, 2).map(identity));
+        CHECK(y.permute(1, 0, 2, 3).clone() == y.permute(1, 0, 2, 3).map(identity));
+        CHECK(y.permute(0, 2, 3, 1).clone() == y.permute(0, 2, 3, 1).map(identity));
+        CHECK(y.permute(0, 3, 1, 2).clone() == y.permute(0, 3, 1, 2).map(identity));
+        CHECK(y.permute(3, 2, 1, 0).clone() == y.permute(3, 2, 1, 0).map(identity));
+        CHECK(y.permute(2, 0, 3, 1).clone() == y.permute(2, 0, 3, 1).map(identity));
+
+        // slices with steps, and transposed slices
+        const Tensor<> strided = x.index({":", "::2", "1:"}).transpose(1, 2);
+        CHECK(strided.contiguous() == strided.map(identity));
+        CHECK(strided.contiguous().shapes() == DimVector{3, 130, 34});
+
+        // reshape of a view keeps the logical order of the elements
+        const Tensor<> flat = t.reshape({3 * 131 * 67});
+        CHECK(flat[1] == x[0, 1, 0]);
+        CHECK(flat[67] == x[0, 0, 1]);
+        CHECK(flat[131 * 67 + 2] == x[1, 2, 0]);
+    }
+
+    set_num_threads(default_num_threads);
+
+    // other element types
+    const Tensor<int> ints = {{1, 2, 3}, {4, 5, 6}};
+    CHECK(ints.transpose().contiguous() == Tensor<int>({{1, 4}, {2, 5}, {3, 6}}));
+
+    const Tensor<bf16> halves = x.dtype<bf16>();
+    CHECK(halves.transpose(0, 2).contiguous().dtype<float>() == x.dtype<bf16>().dtype<float>().transpose(0, 2).map([](const float &v)
+                                                                                                                     { return v; }));
+
+    // a copy does not share the storage of the view
+    Tensor<> source = {{1.0f, 2.0f}, {3.0f, 4.0f}};
+    Tensor<> copy = source.transpose().contiguous();
+    source[0, 1] = 10.0f;
+    CHECK(copy[1, 0] == 2.0f);
+}
+
+TEST_CASE("TensorTest - Accessor")
+{
+    const Tensor<> matrix = Tensor<>::arange(0, 11).reshape({3, 4});
+
+    // the accessor of a view follows its strides
+    const Tensor<> transposed = matrix.transpose();
+    const TensorAccessor<const float, 2> t = transposed.accessor<2>();
+    CHECK(t.size(0) == 4);
+    CHECK(t.size(1) == 3);
+    for (size_t i = 0; i < 4; ++i)
+    {
+        for (size_t j = 0; j < 3; ++j)
+        {
+            CHECK(t[i, j] == matrix[j, i]);
+        }
+    }
+    CHECK(t.ptr(1, 2) == &t[1, 2]);
+
+    // a write through the accessor does not modify the tensors sharing the storage
+    Tensor<> copy = matrix;
+    const TensorAccessor<float, 2> c = copy.accessor<2>();
+    c[2, 3] = -1.0f;
+    CHECK(copy[2, 3] == -1.0f);
+    CHECK(matrix[2, 3] == 11.0f);
+
+    const Tensor<> volume = Tensor<>::arange(0, 23).reshape({2, 3, 4});
+    const Tensor<> slice = volume.index({":", "1:", "::2"});
+    const TensorAccessor<const float, 3> v = slice.accessor<3>();
+    CHECK(v[1, 1, 1] == volume[1, 2, 2]);
+
+    Tensor<> zeros({2, 2}, 0.0f);
+    const TensorAccessor<const float, 2> z = zeros.accessor<2>(); // read-only view of a writable accessor
+    CHECK(z[1, 1] == 0.0f);
+
+    CHECK_THROWS_AS(matrix.accessor<3>(), std::invalid_argument);
+
+#ifdef NEURALNET_ACCESSOR_CHECKS
+    CHECK_THROWS_AS(t[4, 0], std::out_of_range);
+#endif
+}
+
+TEST_CASE("TensorTest - Sparse Tensors")
+{
+    // every third element of a 4 x 6 matrix, with small integer values so that the products are exact
+    Tensor<> dense({4, 6}, 0.0f);
+    for (size_t i = 0; i < 4; ++i)
+    {
+        for (size_t j = (i % 3); j < 6; j += 3)
+        {
+            dense[i, j] = static_cast<float>(i + j + 1);
+        }
+    }
+    const Tensor<> other = Tensor<>::arange(0, 6 * 5 - 1).reshape({6, 5}) - 7.0f;
+
+    SUBCASE("Conversions")
+    {
+        const SparseCSR csr = SparseCSR::from_dense(dense);
+        CHECK(csr.nnz() == 8);
+        CHECK(csr.row_ptr() == vector<size_t>{0, 2, 4, 6, 8});
+        CHECK(csr.density() == doctest::Approx(8.0f / 24.0f));
+        CHECK(csr.to_dense() == dense);
+        CHECK(csr.to_coo().to_csr().to_dense() == dense);
+        CHECK(SparseCOO::from_dense(dense).to_dense() == dense);
+        CHECK(csr.transpose().to_dense() == dense.transpose());
+
+        // the elements of a COO matrix can be added in any order, and the duplicates are summed
+        SparseCOO coo(3, 3);
+        coo.push_back(2, 0, 1.0f);
+        coo.push_back(0, 1, 2.0f);
+        coo.push_back(2, 0, 3.0f);
+        const SparseCSR coalesced = coo.to_csr();
+        CHECK(coalesced.nnz() == 2);
+        CHECK(coalesced.col_indices() == vector<size_t>{1, 0});
+        CHECK(coalesced.values() == vector<float>{2.0f, 4.0f});
+        CHECK(coalesced.to_dense() == coo.to_dense());
+    }
+
+    SUBCASE("Products with dense matrices")
+    {
+        const SparseCSR csr = SparseCSR::from_dense(dense);
+        CHECK(csr.matmul(other) == dense.matmul(other));
+        CHECK(csr.matmul(other.index({":", "::2"})) == dense.matmul(other.index({":", "::2"}))); // non-contiguous operand
+
+        const Tensor<> grad = Tensor<>::arange(0, 4 * 3 - 1).reshape({4, 3});
+        CHECK(csr.transposed_matmul(grad) == dense.transpose().matmul(grad));
+
+        // a matrix without any non-zero element
+        CHECK(SparseCSR::from_dense(Tensor<>({2, 6}, 0.0f)).matmul(other) == Tensor<>({2, 5}, 0.0f));
+
+        CHECK_THROWS_AS(csr.matmul(grad), std::invalid_argument);
+        CHECK_THROWS_AS(csr.transposed_matmul(other), std::invalid_argument);
+    }
+
+    SUBCASE("Element-wise operations")
+    {
+        const SparseCSR csr = SparseCSR::from_dense(dense);
+        const Tensor<> factors = Tensor<>::arange(0, 4 * 6 - 1).reshape({4, 6});
+
+        CHECK(csr.multiply(factors).to_dense() == dense * factors);
+        const Tensor<> row = factors.index({"1:2", ":"}).reshape({1, 6});
+        CHECK(csr.multiply(row).to_dense() == dense * row); // broadcast to every row
+        CHECK(csr.multiply(factors).nnz() == csr.nnz());
+        CHECK(csr.add(factors) == dense + factors);
+        CHECK((csr * 2.0f).to_dense() == dense * 2.0f);
+
+        CHECK_THROWS_AS(csr.multiply(other), std::invalid_argument);
+        CHECK_THROWS_AS(csr.add(row), std::invalid_argument);
+    }
+
+    SUBCASE("Invalid matrices")
+    {
+        CHECK_THROWS_AS(SparseCOO(2, 2, {0, 1}, {0}, {1.0f, 2.0f}), std::invalid_argument);
+        CHECK_THROWS_AS(SparseCOO(2, 2, {0, 2}, {0, 1}, {1.0f, 2.0f}), std::out_of_range);
+        CHECK_THROWS_AS(SparseCSR(2, 2, {0, 2, 1}, {0}, {1.0f}), std::invalid_argument);
+        CHECK_THROWS_AS(SparseCSR(2, 2, {0, 1, 1}, {2}, {1.0f}), std::out_of_range);
+
+        SparseCOO coo(2, 2);
+        CHECK_THROWS_AS(coo.push_back(0, 2, 1.0f), std::out_of_range);
+    }
+}
+
+TEST_CASE("TensorTest - Random Fills")
+{
+    SUBCASE("Philox4x32-10 known answers")
+    {
+        uint32_t out[4];
+
+        const uint32_t zero_counter[4] = {0, 0, 0, 0};
+        const uint32_t zero_key[2] = {0, 0};
+        rng::philox4x32(zero_counter, zero_key, out);
+        CHECK(out[0] == 0x6627e8d5u);
+        CHECK(out[1] == 0xe169c58du);
+        CHECK(out[2] == 0xbc57ac4cu);
+        CHECK(out[3] == 0x9b00dbd8u);
+
+        const uint32_t pi_counter[4] = {0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344};
+        const uint32_t pi_key[2] = {0xa4093822, 0x299f31d0};
+        rng::philox4x32(pi_counter, pi_key, out);
+        CHECK(out[0] == 0xd16cfe09u);
+        CHECK(out[1] == 0x94fdccebu);
+        CHECK(out[2] == 0x5001e420u);
+        CHECK(out[3] == 0x24126ea1u);
+    }
+
+    SUBCASE("Independent of the number of threads")
+    {
+        const size_t default_num_threads = get_num_threads();
+
+        vector<Tensor<>> results;
+        for (const size_t num_threads : {1, 3, 4})
+        {
+            set_num_threads(num_threads);
+            rng::Generator gen(1234);
+            Tensor<> t = Tensor<>::empty({301, 517}); // not a multiple of the batches
+            t.uniform_(-1.0f, 1.0f, gen);
+            results.push_back(t);
+            results.push_back(t.normal_(0.0f, 1.0f, gen));
+            results.push_back(t.bernoulli_(0.3f, gen));
+        }
+        set_num_threads(default_num_threads);
+
+        for (size_t i = 3; i < results.size(); ++i)
+        {
+            CHECK(results[i] == results[i % 3]);
+        }
+    }
+
+    SUBCASE("Streams")
+    {
+        rng::Generator gen(7);
+        const Tensor<> first = Tensor<>::empty({1000}).uniform_(0.0f, 1.0f, gen);
+        const Tensor<> second = Tensor<>::empty({1000}).uniform_(0.0f, 1.0f, gen);
+        CHECK_FALSE(first == second);
+
+        // the same seed restarts the same stream
+        gen.manual_seed(7);
+        CHECK(Tensor<>::empty({1000}).uniform_(0.0f, 1.0f, gen) == first);
+
+        rng::manual_seed(7);
+        CHECK(Tensor<>::empty({1000}).uniform_() == first);
+    }
+
+    SUBCASE("Distributions")
+    {
+        rng::Generator gen(42);
+        const size_t n = 1 << 18;
+
+        Tensor<> u = Tensor<>::empty({n}).uniform_(2.0f, 5.0f, gen);
+        CHECK(u.min(vector<int64_t>{})[0] >= 2.0f);
+        CHECK(u.max(vector<int64_t>{})[0] < 5.0f);
+        CHECK(u.mean(vector<int64_t>{})[0] == doctest::Approx(3.5f).epsilon(0.01));
+
+        Tensor<> z = Tensor<>::empty({n}).normal_(1.0f, 2.0f, gen);
+        CHECK(z.mean(vector<int64_t>{})[0] == doctest::Approx(1.0f).epsilon(0.02));
+        CHECK(z.var(vector<int64_t>{})[0] == doctest::Approx(4.0f).epsilon(0.02));
+
+        Tensor<> b = Tensor<>::empty({n}).bernoulli_(0.25f, gen);
+        CHECK(b.sum() == doctest::Approx(0.25f * n).epsilon(0.02));
+        CHECK((b * (b - 1.0f)).sum() == 0.0f); // only 0 and 1
+
+        CHECK(Tensor<>::empty({100}).bernoulli_(0.0f, gen).sum() == 0.0f);
+        CHECK(Tensor<>::empty({100}).bernoulli_(1.0f, gen).sum() == 100.0f);
+
+        CHECK_THROWS_AS(Tensor<>::empty({4}).uniform_(1.0f, 0.0f, gen), std::invalid_argument);
+        CHECK_THROWS_AS(Tensor<>::empty({4}).normal_(0.0f, -1.0f, gen), std::invalid_argument);
+        CHECK_THROWS_AS(Tensor<>::empty({4}).bernoulli_(1.5f, gen), std::invalid_argument);
+    }
+
+    SUBCASE("Views, shared storages and other element types")
+    {
+        Tensor<> matrix({4, 6}, 0.0f);
+        const Tensor<> shared = matrix;
+
+        // copy on write: the tensors sharing the storage keep their values
+        Tensor<> column = matrix.index({":", "2"});
+        column.uniform_(1.0f, 2.0f);
+        CHECK(column.min(vector<int64_t>{})[0] >= 1.0f);
+        CHECK(matrix.sum() == 0.0f);
+        CHECK(shared.sum() == 0.0f);
+
+        Tensor<> view = matrix.transpose();
+        view.normal_();
+        CHECK(view.shapes() == DimVector{6, 4});
+        CHECK(view.var(vector<int64_t>{})[0] > 0.0f);
+
+        Tensor<bf16> half = Tensor<bf16>::empty({16, 16});
+        half.uniform_(-1.0f, 1.0f);
+        CHECK(static_cast<float>(half.max(vector<int64_t>{})[0]) <= 1.0f);
+        CHECK(static_cast<float>(half.min(vector<int64_t>{})[0]) >= -1.0f);
+    }
+}
+
+TEST_CASE("TensorTest - Gather, Scatter and Concatenation")
+{
+    const Tensor<> x = {{1.0f, 2.0f, 3.0f}, {4.0f, 5.0f, 6.0f}, {7.0f, 8.0f, 9.0f}, {10.0f, 11.0f, 12.0f}};
+
+    SUBCASE("Split and chunk return views")
+    {
+        vector<Tensor<>> parts = x.split(3);
+        REQUIRE(parts.size() == 2);
+        CHECK(parts[0] == Tensor<>({{1.0f, 2.0f, 3.0f}, {4.0f, 5.0f, 6.0f}, {7.0f, 8.0f, 9.0f}}));
+        CHECK(parts[1] == Tensor<>({{10.0f, 11.0f, 12.0f}}));
+        CHECK(parts[1].data() == x.data() + 9);
+
+        vector<Tensor<>> columns = x.split(vector<size_t>{1, 2}, -1);
+        REQUIRE(columns.size() == 2);
+        CHECK(columns[0].shapes() == DimVector{4, 1});
+        CHECK(columns[1] == Tensor<>({{2.0f, 3.0f}, {5.0f, 6.0f}, {8.0f, 9.0f}, {11.0f, 12.0f}}));
+        CHECK_FALSE(columns[1].is_contiguous());
+
+        // torch.chunk: 3 chunks of 4 rows are chunks of 2 rows, so there are only 2 of them
+        CHECK(x.chunk(3).size() == 2);
+        CHECK(x.chunk(4)[3] == Tensor<>({{10.0f, 11.0f, 12.0f}}));
+        CHECK(x.narrow(1, 2, 1) == columns[1].narrow(1, 1, 1));
+
+        // writing into a view does not change x
+        Tensor<> first = x.chunk(2)[0];
+        first *= 0.0f;
+        CHECK(x[0, 0] == 1.0f);
+
+        CHECK_THROWS_AS(x.split(0), std::invalid_argument);
+        CHECK_THROWS_AS(x.split(vector<size_t>{1, 1}, 1), std::invalid_argument);
+        CHECK_THROWS_AS(x.narrow(0, 3, 2), std::out_of_range);
+        CHECK_THROWS_AS(x.chunk(2, 2), std::out_of_range);
+    }
+
+    SUBCASE("Cat and stack")
+    {
+        const Tensor<> a = {{1.0f, 2.0f}, {3.0f, 4.0f}};
+        const Tensor<> b = {{5.0f, 6.0f}};
+
+        CHECK(Tensor<>::cat({a, b}) == Tensor<>({{1.0f, 2.0f}, {3.0f, 4.0f}, {5.0f, 6.0f}}));
+        CHECK(Tensor<>::cat({a, a.transpose()}, -1) == Tensor<>({{1.0f, 2.0f, 1.0f, 3.0f}, {3.0f, 4.0f, 2.0f, 4.0f}}));
+        CHECK(Tensor<>::cat(x.split(1)) == x);
+        CHECK(Tensor<>::cat(x.chunk(2, 1), 1) == x);
+
+        CHECK(Tensor<>::stack({a, a * 2.0f}) == Tensor<>({{{1.0f, 2.0f}, {3.0f, 4.0f}}, {{2.0f, 4.0f}, {6.0f, 8.0f}}}));
+        CHECK(Tensor<>::stack({a, a * 2.0f}, 2) == Tensor<>({{{1.0f, 2.0f}, {2.0f, 4.0f}}, {{3.0f, 6.0f}, {4.0f, 8.0f}}}));
+        CHECK(Tensor<>::stack({b.index({"0"}), a.index({":", "1"})}, -1) == Tensor<>({{5.0f, 2.0f}, {6.0f, 4.0f}}));
+
+        CHECK_THROWS_AS(Tensor<>::cat({a, b}, 1), std::invalid_argument);
+        CHECK_THROWS_AS(Tensor<>::stack({a, b}), std::invalid_argument);
+        CHECK_THROWS_AS(Tensor<>::stack({a}, 3), std::out_of_range);
+        CHECK_THROWS_AS(Tensor<>::cat({}), std::invalid_argument);
+    }
+
+    SUBCASE("Index select")
+    {
+        CHECK(x.index_select(0, vector<size_t>{3, 0, 3}) == Tensor<>({{10.0f, 11.0f, 12.0f}, {1.0f, 2.0f, 3.0f}, {10.0f, 11.0f, 12.0f}}));
+        CHECK(x.index_select(1, Tensor<size_t>({2, 0})) == Tensor<>({{3.0f, 1.0f}, {6.0f, 4.0f}, {9.0f, 7.0f}, {12.0f, 10.0f}}));
+        CHECK(x.transpose().index_select(-1, vector<size_t>{1}) == Tensor<>({4.0f, 5.0f, 6.0f}).reshape({3, 1}));
+        CHECK(x.index_select(0, vector<size_t>{}).shapes() == DimVector{0, 3});
+
+        CHECK_THROWS_AS(x.index_select(0, vector<size_t>{4}), std::out_of_range);
+    }
+
+    SUBCASE("Gather and scatter add")
+    {
+        const Tensor<size_t> labels = Tensor<size_t>({2, 0, 1, 2}).reshape({4, 1});
+        CHECK(x.gather(1, labels) == Tensor<>({3.0f, 4.0f, 8.0f, 12.0f}).reshape({4, 1}));
+        CHECK(x.gather(0, Tensor<size_t>({{3, 0, 1}})) == Tensor<>({{10.0f, 2.0f, 6.0f}}));
+        CHECK(x.transpose().gather(-1, Tensor<size_t>({{0, 3}, {1, 1}})) == Tensor<>({{1.0f, 10.0f}, {5.0f, 5.0f}}));
+
+        Tensor<> grad({4, 3}, 0.0f);
+        const Tensor<> shared = grad;
+        grad.scatter_add_(1, labels, Tensor<>({4, 1}, -1.0f));
+        CHECK(grad == Tensor<>({{0.0f, 0.0f, -1.0f}, {-1.0f, 0.0f, 0.0f}, {0.0f, -1.0f, 0.0f}, {0.0f, 0.0f, -1.0f}}));
+        CHECK(shared.sum() == 0.0f);
+
+        // repeated indices accumulate, e.g. the gradients of the rows of an embedding
+        Tensor<> rows({3, 2}, 0.0f);
+        rows.scatter_add_(0, Tensor<size_t>({{1, 1}, {0, 0}, {1, 1}}), Tensor<>({{1.0f, 2.0f}, {3.0f, 4.0f}, {5.0f, 6.0f}}));
+        CHECK(rows == Tensor<>({{3.0f, 4.0f}, {6.0f, 8.0f}, {0.0f, 0.0f}}));
+
+        CHECK_THROWS_AS(x.gather(1, Tensor<size_t>({3}).reshape({1, 1})), std::out_of_range);
+        CHECK_THROWS_AS(x.gather(1, Tensor<size_t>({0, 1})), std::invalid_argument);
+        CHECK_THROWS_AS(x.gather(0, Tensor<size_t>({{0, 0, 0, 0}})), std::invalid_argument);
+        CHECK_THROWS_AS(grad.scatter_add_(1, labels, Tensor<>({3, 1}, 1.0f)), std::invalid_argument);
+    }
+
+    SUBCASE("Large tensors do not depend on the number of threads")
+    {
+        rng::Generator gen(7);
+        const Tensor<> big = Tensor<>::empty({512, 300}).uniform_(-1.0f, 1.0f, gen);
+        const Tensor<size_t> index = Tensor<>::empty({512, 300}).uniform_(0.0f, 299.5f, gen).dtype<size_t>();
+
+        const size_t default_num_threads = get_num_threads();
+        vector<Tensor<>> gathered, scattered, selected;
+        for (const size_t num_threads : {1, 3})
+        {
+            set_num_threads(num_threads);
+            gathered.push_back(big.gather(1, index));
+            scattered.push_back(Tensor<>({512, 300}, 0.0f).scatter_add_(1, index, big));
+            selected.push_back(big.index_select(0, vector<size_t>{511, 0, 7, 7}));
+        }
+        set_num_threads(default_num_threads);
+
+        CHECK(gathered[0] == gathered[1]);
+        CHECK(scattered[0] == scattered[1]);
+        CHECK(selected[0] == selected[1]);
+        CHECK(scattered[0].sum() == doctest::Approx(big.sum()).epsilon(1e-4));
+        CHECK(selected[0].narrow(0, 3, 1) == big.narrow(0, 7, 1));
+    }
+}
+
+TEST_CASE("TensorTest - Serialization")
+{
+    const string path = (std::filesystem::temp_directory_path() / "neuralnet_tensor_test.nnt").string();
+
+    const Tensor<> weight = Tensor<>::arange(0, 6 * 7 - 1).reshape({6, 7}) * 0.5f;
+    const Tensor<> transposed = weight.transpose();
+    const Tensor<int64_t> indices({3, 1, 4, 1, 5});
+    const Tensor<bf16> half = weight.dtype<bf16>();
+
+    serialization::TensorWriter writer;
+    writer.add("weight", weight);
+    writer.add("transposed", transposed);
+    writer.add("indices", indices);
+    writer.add("half", half);
+    CHECK_THROWS_AS(writer.add("weight", weight), std::invalid_argument);
+    writer.write(path);
+
+    SUBCASE("Tensors are backed by the mapping")
+    {
+        const serialization::TensorFile file(path);
+        CHECK(file.size() == 4);
+        CHECK(file.names() == vector<string>{"weight", "transposed", "indices", "half"});
+        CHECK(file.dtype("indices") == serialization::DType::INT64);
+        CHECK(file.shape("transposed") == DimVector{7, 6});
+
+        const Tensor<> loaded = file.get<float>("weight");
+        CHECK(loaded == weight);
+        CHECK(file.get<float>("transposed") == transposed);
+        CHECK(file.get<int64_t>("indices") == indices);
+        CHECK(file.get<bf16>("half").dtype<float>() == half.dtype<float>());
+
+        // the data is aligned, and the same tensor is read twice from the same bytes
+        CHECK(reinterpret_cast<uintptr_t>(loaded.data()) % serialization::ALIGNMENT == 0);
+        CHECK(file.get<float>("weight").data() == loaded.data());
+
+        CHECK_THROWS_AS(file.get<float>("indices"), std::invalid_argument);
+        CHECK_THROWS_AS(file.get<float>("bias"), std::out_of_range);
+    }
+
+    SUBCASE("The mapping outlives the file and is private")
+    {
+        Tensor<> loaded;
+        {
+            const serialization::TensorFile file(path);
+            loaded = file.get<float>("weight");
+        }
+        loaded.fill_(1.0f);
+        CHECK(loaded == Tensor<>({6, 7}, 1.0f));
+        CHECK(serialization::TensorFile(path).get<float>("weight") == weight);
+    }
+
+    SUBCASE("Invalid files")
+    {
+        CHECK_THROWS_AS(serialization::TensorFile(path + ".missing"), std::runtime_error);
+
+        // a file cut in the middle of the data
+        ifstream in(path, ios::binary);
+        const string bytes((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+        ofstream(path, ios::binary | ios::trunc).write(bytes.data(), static_cast<streamsize>(bytes.size() - 8));
+        CHECK_THROWS_AS(serialization::TensorFile{path}, std::runtime_error);
+
+        ofstream(path, ios::binary | ios::trunc) << "not a tensor file";
+        CHECK_THROWS_AS(serialization::TensorFile{path}, std::runtime_error);
+    }
+
+    SUBCASE("Crafted headers")
+    {
+        // a single (2, 3) tensor, whose dimensions, offset and size are patched in the header
+        serialization::TensorWriter small;
+        small.add("w", Tensor<>({2, 3}, 1.0f));
+        small.write(path);
+
+        ifstream in(path, ios::binary);
+        const string bytes((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+        in.close();
+
+        const uint64_t shape[2] = {2, 3};
+        const size_t dims_pos = bytes.find(string(reinterpret_cast<const char *>(shape), sizeof(shape)));
+        REQUIRE(dims_pos != string::npos);
+
+        auto write_patched = [&](uint8_t ndim, uint64_t dim0, uint64_t dim1, uint64_t nbytes)
+        {
+            string patched = bytes;
+            patched[dims_pos - 1] = static_cast<char>(ndim);
+            memcpy(patched.data() + dims_pos, &dim0, sizeof(dim0));
+            memcpy(patched.data() + dims_pos + 8, &dim1, sizeof(dim1));
+            memcpy(patched.data() + dims_pos + 24, &nbytes, sizeof(nbytes));
+            ofstream(path, ios::binary | ios::trunc).write(patched.data(), static_cast<streamsize>(patched.size()));
+        };
+
+        write_patched(2, 2, 3, 24);
+        CHECK(serialization::TensorFile(path).get<float>("w") == Tensor<>({2, 3}, 1.0f));
+
+        // 2^32 x 2^32 elements wrap to 0, and 2^62 floats to 0 bytes
+        write_patched(2, uint64_t(1) << 32, uint64_t(1) << 32, 0);
+        CHECK_THROWS_AS(serialization::TensorFile{path}, std::runtime_error);
+        write_patched(2, uint64_t(1) << 62, 1, 0);
+        CHECK_THROWS_AS(serialization::TensorFile{path}, std::runtime_error);
+
+        // more dimensions than a tensor can have
+        write_patched(DimVector::MAX_DIMS + 1, 2, 3, 24);
+        CHECK_THROWS_AS(serialization::TensorFile{path}, std::runtime_error);
+    }
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("TensorTest - Quantized Tensors")
+{
+    SUBCASE("Quantization parameters")
+    {
+        const QuantParams symmetric = choose_qparams(-0.5f, 1.0f, -127, 127, true);
+        CHECK(symmetric.scale == doctest::Approx(1.0f / 127.0f));
+        CHECK(symmetric.zero_point == 0);
+
+        const QuantParams relu = choose_qparams(0.0f, 2.55f, 0, 255);
+        CHECK(relu.scale == doctest::Approx(0.01f));
+        CHECK(relu.zero_point == 0);
+
+        // the range is extended to 0, and 0 is represented exactly
+        const QuantParams shifted = choose_qparams(-1.0f, 3.0f, 0, 255);
+        CHECK(shifted.zero_point == 64);
+        CHECK(choose_qparams(1.0f, 3.0f, 0, 255).zero_point == 0);
+
+        CHECK(choose_qparams(0.0f, 0.0f, 0, 127).scale == 1.0f);
+        CHECK_THROWS(choose_qparams(1.0f, -1.0f, 0, 255));
+    }
+
+    SUBCASE("Per tensor quantization")
+    {
+        // rounded half to even, and clamped
+        const Tensor<> x = {0.5f, 1.5f, 2.5f, -0.5f, -1.5f, 300.0f, -300.0f, 3.2f};
+        const QTensor<int8_t> q = QTensor<int8_t>::quantize(x, 1.0f, 0);
+        CHECK(q.int_repr() == Tensor<int8_t>({0, 2, 2, 0, -2, 127, -128, 3}));
+        CHECK_FALSE(q.is_per_channel());
+
+        const QTensor<uint8_t> narrowed = QTensor<uint8_t>::quantize(x, 0.5f, 10, 0, 127);
+        CHECK(narrowed.int_repr() == Tensor<uint8_t>({11, 13, 15, 9, 7, 127, 0, 16}));
+        CHECK(narrowed.dequantize() == Tensor<>({0.5f, 1.5f, 2.5f, -0.5f, -1.5f, 58.5f, -5.0f, 3.0f}));
+        CHECK_THROWS(QTensor<int8_t>::quantize(x, 1.0f, 0, -200, 100));
+
+        // the error of the round trip is at most half a step
+        const Tensor<> y = (Tensor<>::arange(0, 99999) * 0.001f - 40.0f).reshape({1000, 100});
+        const QuantParams params = choose_qparams(-40.0f, 60.0f, 0, 255);
+        const Tensor<> round_trip = QTensor<uint8_t>::quantize(y, params).dequantize();
+        CHECK(round_trip.shapes() == y.shapes());
+        CHECK((round_trip - y).abs().max(vector<int64_t>{})[0] <= params.scale * 0.5001f);
+
+        // views are quantized in their logical order
+        const Tensor<> t = y.transpose();
+        CHECK(QTensor<uint8_t>::quantize(t, params).int_repr() == QTensor<uint8_t>::quantize(t.clone(), params).int_repr());
+    }
+
+    SUBCASE("Per channel quantization")
+    {
+        const Tensor<> w = {{1.0f, -20.0f, 0.3f}, {-2.0f, 5.0f, 0.1f}};
+        const vector<float> scales = {1.0f / 64.0f, 20.0f / 127.0f, 0.3f / 127.0f};
+        const QTensor<int8_t> q = QTensor<int8_t>::quantize_per_channel(w, scales, {0, 0, 0}, -1, -127, 127);
+
+        CHECK(q.is_per_channel());
+        CHECK(q.axis() == 1);
+        CHECK(q.int_repr() == Tensor<int8_t>({{64, -127, 127}, {-127, 32, 42}}));
+
+        const Tensor<> dequantized = q.dequantize();
+        for (size_t j = 0; j < 3; ++j)
+        {
+            CHECK(std::fabs(dequantized[0, j] - w[0, j]) <= scales[j] * 0.5f);
+        }
+        CHECK(dequantized[1, 0] == doctest::Approx(-127.0f / 64.0f)); // clamped
+
+        // along the first axis
+        const QTensor<int8_t> rows = QTensor<int8_t>::quantize_per_channel(w, {1.0f, 0.5f}, {0, 1}, 0);
+        CHECK(rows.int_repr() == Tensor<int8_t>({{1, -20, 0}, {-3, 11, 1}}));
+
+        CHECK_THROWS(QTensor<int8_t>::quantize_per_channel(w, {1.0f, 1.0f}, {0, 0}, 1));
+        CHECK_THROWS(QTensor<int8_t>::quantize_per_channel(w, {1.0f, 1.0f}, {0, 0}, 2));
+    }
+
+    SUBCASE("Quantized GEMM")
+    {
+        // sizes with tails in M, N and K for every kernel
+        const size_t M = 37, N = 45, K = 83;
+
+        mt19937 gen(7);
+        uniform_int_distribution<int> a_dist(0, qgemm::A_MAX), b_dist(-qgemm::B_MAX, qgemm::B_MAX);
+
+        vector<uint8_t> A(M * K);
+        vector<int8_t> B(K * N);
+        for (auto &a : A)
+            a = static_cast<uint8_t>(a_dist(gen));
+        for (auto &b : B)
+            b = static_cast<int8_t>(b_dist(gen));
+
+        // the extreme values, for which the pairs of products would saturate int16 with a full uint8 range
+        A[0] = A[1] = A[2] = A[3] = qgemm::A_MAX;
+        B[0] = B[N] = B[2 * N] = B[3 * N] = qgemm::B_MAX;
+
+        vector<int32_t> expected(M * N, 0);
+        for (size_t i = 0; i < M; ++i)
+            for (size_t k = 0; k < K; ++k)
+                for (size_t j = 0; j < N; ++j)
+                    expected[i * N + j] += static_cast<int32_t>(A[i * K + k]) * B[k * N + j];
+
+        const qgemm::PackedMatrix packed(B.data(), K, N, N, 1);
+        CHECK(packed.rows() == K);
+        CHECK(packed.cols() == N);
+
+        // the transpose of B packs to the same matrix
+        vector<int8_t> BT(N * K);
+        for (size_t k = 0; k < K; ++k)
+            for (size_t j = 0; j < N; ++j)
+                BT[j * K + k] = B[k * N + j];
+        const qgemm::PackedMatrix packed_t(BT.data(), K, N, 1, K);
+
+        B[5] = -128;
+        CHECK_THROWS(qgemm::PackedMatrix(B.data(), K, N, N, 1));
+
+        const simd::ISA default_isa = simd::active_isa();
+
+        for (const simd::ISA isa : {simd::ISA::SCALAR, simd::ISA::SSE42, simd::ISA::AVX2, simd::ISA::AVX512})
+        {
+            if (!simd::is_supported(isa))
+            {
+                continue;
+            }
+            simd::set_isa(isa);
+
+            // bitwise identical on every instruction set
+            vector<int32_t> C(M * N, -1);
+            qgemm::gemm_u8s8s32(M, A.data(), K, packed, C.data(), N);
+            CHECK(C == expected);
+
+            fill(C.begin(), C.end(), -1);
+            qgemm::gemm_u8s8s32(M, A.data(), K, packed_t, C.data(), N);
+            CHECK(C == expected);
+
+            // with a zero point, scales and a bias
+            const int32_t zero_point = 9;
+            vector<float> scales(N), bias(N), D(M * N);
+            for (size_t j = 0; j < N; ++j)
+            {
+                scales[j] = 0.001f * (j + 1);
+                bias[j] = 0.5f * j;
+            }
+            qgemm::gemm_u8s8f32(M, A.data(), K, zero_point, packed, scales.data(), bias.data(), D.data(), N);
+
+            bool close = true;
+            for (size_t i = 0; i < M; ++i)
+            {
+                for (size_t j = 0; j < N; ++j)
+                {
+                    int32_t column_sum = 0;
+                    for (size_t k = 0; k < K; ++k)
+                        column_sum += BT[j * K + k];
+
+                    const float reference = scales[j] * (expected[i * N + j] - zero_point * column_sum) + bias[j];
+                    close = close && std::fabs(D[i * N + j] - reference) <= 1e-4f * std::fabs(reference) + 1e-4f;
+                }
+            }
+            CHECK(close);
+        }
+
+        simd::set_isa(default_isa);
+        CHECK_FALSE(qgemm::kernel_name().empty());
+    }
+
+    SUBCASE("Quantized linear map")
+    {
+        const Tensor<> x = (Tensor<>::arange(0, 64 * 100 - 1) * 0.37f).map([](const float &v)
+                                                                          { return std::fmod(v, 3.0f) - 1.0f; })
+                               .reshape({2, 32, 100});
+        const Tensor<> w = (Tensor<>::arange(0, 100 * 24 - 1) * 0.11f).map([](const float &v)
+                                                                          { return std::sin(v) * 0.2f; })
+                               .reshape({100, 24});
+
+        const QTensor<uint8_t> qx = QTensor<uint8_t>::quantize(x, choose_qparams(-1.0f, 2.0f, 0, qgemm::A_MAX), 0, qgemm::A_MAX);
+
+        vector<float> scales(24);
+        for (size_t j = 0; j < 24; ++j)
+        {
+            scales[j] = 0.2f / 127.0f;
+        }
+        const QTensor<int8_t> qw = QTensor<int8_t>::quantize_per_channel(w, scales, vector<int32_t>(24, 0), 1, -127, 127);
+        const qgemm::PackedMatrix packed(qw.data(), 100, 24, 24, 1);
+
+        // the same as the float product of the dequantized tensors
+        const Tensor<> y = qx.linear(packed, scales, vector<float>(24, 1.0f));
+        CHECK(y.shapes() == DimVector{2, 32, 24});
+        CHECK((y - qx.dequantize().matmul(qw.dequantize()) - 1.0f).abs().max(vector<int64_t>{})[0] < 1e-3f);
+
+        // and close to the float product
+        CHECK((y - x.matmul(w) - 1.0f).abs().max(vector<int64_t>{})[0] < 0.1f);
+
+        // the inputs must be in [0, 127]
+        CHECK_THROWS(QTensor<uint8_t>::quantize(x, 0.1f, 10).linear(packed, scales));
+        CHECK_THROWS(qx.linear(packed, vector<float>(3, 1.0f)));
+    }
+}
+
+TEST_CASE("TensorTest - Vectorized Kernels")
+{
+    // 1003 elements, so every kernel also runs its tail
+    Tensor<> a = Tensor<>::arange(0, 1002) - 501.0f;
+    Tensor<> b = a * 0.5f + 600.0f;
+    Tensor<> row = b.reshape({1, 1003});
+    Tensor<> column = Tensor<>({1.0f, -2.0f, 3.0f}).reshape({3, 1});
+
+    const simd::ISA default_isa = simd::active_isa();
+
+    simd::set_isa(simd::ISA::SCALAR);
+    const Tensor<> expected_add = a + b;
+    const Tensor<> expected_div = a / b;
+    const Tensor<> expected_scaled = a * 2.0f;
+    const Tensor<> expected_broadcast = column * row;
+    const Tensor<> expected_sqrt = b.sqrt();
+    const Tensor<> expected_abs = a.abs();
+    const float expected_sum = b.sum();
+    const float expected_kahan_sum = b.sum(Summation::KAHAN);
+
+    // Values across the whole range of float (subnormals, halfway cases, overflows for fp16), converted to 16 bits
+    const Tensor<> wide = (a * 0.0137f).map([](const float &v)
+                                            { return std::ldexp(v, static_cast<int>(std::fmod(std::fabs(v) * 997.0f, 300.0f)) - 150); });
+    const Tensor<uint16_t> expected_bf16 = wide.dtype<bf16>().map([](const bf16 &v)
+                                                                   { return v.bits; });
+    const Tensor<uint16_t> expected_fp16 = wide.dtype<fp16>().map([](const fp16 &v)
+                                                                   { return v.bits; });
+    const Tensor<> expected_from_fp16 = wide.dtype<fp16>().dtype<float>();
+
+    // Philox batches, one of them crossing a multiple of 2^32 blocks
+    const uint64_t philox_key = 0x0123456789abcdefull;
+    const uint64_t philox_firsts[2] = {1024, 0xffffffe0ull};
+    vector<uint32_t> expected_philox(2 * 4 * simd::PHILOX_BATCH);
+    simd::philox_batch(philox_key, philox_firsts[0], expected_philox.data());
+    simd::philox_batch(philox_key, philox_firsts[1], expected_philox.data() + 4 * simd::PHILOX_BATCH);
+
+    // the scalar batches are the blocks of the reference implementation
+    for (size_t i = 0; i < 2; ++i)
+    {
+        for (const size_t b : {size_t(0), size_t(31), simd::PHILOX_BATCH - 1})
+        {
+            const uint64_t block = philox_firsts[i] + b;
+            const uint32_t counter[4] = {static_cast<uint32_t>(block), static_cast<uint32_t>(block >> 32), 0, 0};
+            const uint32_t key[2] = {static_cast<uint32_t>(philox_key), static_cast<uint32_t>(philox_key >> 32)};
+            uint32_t out[4];
+            rng::philox4x32(counter, key, out);
+            for (size_t j = 0; j < 4; ++j)
+            {
+                CHECK(expected_philox[(4 * i + j) * simd::PHILOX_BATCH + b] == out[j]);
+            }
+        }
+    }
+
+    for (const simd::ISA isa : {simd::ISA::SSE42, simd::ISA::AVX2, simd::ISA::AVX512})
+    {
+        if (!simd::is_supported(isa))
+        {
+            CHECK_THROWS(simd::set_isa(isa));
+            continue;
+        }
+
+        simd::set_isa(isa);
+        CHECK(simd::active_isa() == isa);
+
+        CHECK((a + b) == expected_add);
+        CHECK((a / b) == expected_div);
+        CHECK((a * 2.0f) == expected_scaled);
+        CHECK((column * row) == expected_broadcast);
+        CHECK(b.sqrt() == expected_sqrt);
+        CHECK(a.abs() == expected_abs);
+
+        // the sum is bitwise identical on every instruction set
+        CHECK(b.sum() == expected_sum);
+        CHECK(b.sum(Summation::KAHAN) == expected_kahan_sum);
+
+        // the conversions to and from 16 bits are bitwise identical on every instruction set
+        CHECK(wide.dtype<bf16>().map([](const bf16 &v)
+                                     { return v.bits; }) == expected_bf16);
+        CHECK(wide.dtype<fp16>().map([](const fp16 &v)
+                                     { return v.bits; }) == expected_fp16);
+        CHECK(wide.dtype<fp16>().dtype<float>() == expected_from_fp16);
+
+        // the random numbers are the same on every instruction set
+        vector<uint32_t> philox(2 * 4 * simd::PHILOX_BATCH);
+        simd::philox_batch(philox_key, philox_firsts[0], philox.data());
+        simd::philox_batch(philox_key, philox_firsts[1], philox.data() + 4 * simd::PHILOX_BATCH);
+        CHECK(philox == expected_philox);
+
+        CHECK(a.max()[0] == 501.0f);
+        CHECK(a.min()[0] == -501.0f);
+        CHECK(a.argmax()[0] == 1002);
+        CHECK(a.argmin()[0] == 0);
+    }
+
+    simd::set_isa(default_isa);
+}